@@ -8,13 +8,15 @@
 #include "backend/Camera.h"
 #include "backend/ColorRuntimeLoader.h"
 #include "backend/ColorUtils.h"
+#include "backend/CpuAffinity.h"
 #include "backend/FakeCamera.h"
+#include "backend/FrameStage_PixelStats.h"
+#include "backend/FrameStage_Track.h"
 #include "backend/Log.h"
-#include "backend/ParticleLinker.h"
 #include "backend/PrdFileSave.h"
 #include "backend/PrdFileUtils.h"
 #include "backend/TiffFileSave.h"
-#include "backend/TrackRuntimeLoader.h"
+#include "backend/UniqueThreadPool.h"
 #include "backend/Utils.h"
 
 /* System */
@@ -34,18 +36,68 @@
 // May need this header file for this
 #include <PVCamTest/PVCamTest_Ui.h>
 
+// Max. number of frames the disk thread takes from queue at once.
+// These frames are out of the queue but not saved yet, they are not counted
+// in the queue size and thus can slightly exceed the RAM limit.
+static constexpr size_t cDiskThreadBatchMaxFrames = 16;
+
+// Restricts calling thread to given CPUs if any. Failure is not fatal, the
+// thread just keeps running on any CPU.
+static void PinCurrentThread(const char* threadName,
+        const pm::CpuAffinity::CpuSet& cpus)
+{
+    if (cpus.empty())
+        return;
+    if (!pm::CpuAffinity::PinCurrentThread(cpus))
+    {
+        pm::Log::LogW("Failure restricting %s thread to CPUs %s", threadName,
+                pm::CpuAffinity::CpuSetToStr(cpus).c_str());
+    }
+}
+
 // TODO: Remove completely after testing
 //#define PM_PRINT_WRITE_STATS
 #ifdef PM_PRINT_WRITE_STATS
+    // Guards the counters below, updated by all disk writers
+    std::mutex sWriteMutex{};
     size_t sWriteCount{ 0 };
-    pm::Timer sWriteTimer{};
     double sWriteTimeSec{ 0.0 };
 #endif
 
+// Appends line with latency percentiles to stats message
+static void PrintLatency(std::ostringstream& ss, const char* name,
+        const pm::LatencyHistogram& latency)
+{
+    if (latency.GetCount() == 0)
+        return;
+
+    ss << "\n  " << name << " latency = "
+        << latency.GetPercentile(50.0) * 1e6 << " us p50, "
+        << latency.GetPercentile(99.0) * 1e6 << " us p99, "
+        << latency.GetPercentile(99.9) * 1e6 << " us p99.9, "
+        << latency.GetMax() * 1e6 << " us max";
+}
+
+pm::Acquisition::DiskWriter::~DiskWriter()
+{
+    delete thread;
+
+    ColorUtils::AssignContexts(&ownTiffHelper.colorCtx, nullptr);
+    delete ownTiffHelper.fullBmp;
+}
+
+pm::Acquisition::StageRunner::~StageRunner()
+{
+    delete thread;
+}
+
 pm::Acquisition::Acquisition(std::shared_ptr<Camera> camera)
     : m_camera(camera)
 {
     m_tiffHelper.frameProc = &m_tiffFrameProc;
+
+    m_unusedFramesPool.SetReleaseHandler(
+            std::bind(&Acquisition::UnpinFrame, this, std::placeholders::_1));
 }
 
 pm::Acquisition::~Acquisition()
@@ -94,68 +146,17 @@ bool pm::Acquisition::Start(std::shared_ptr<FpsLimiter> fpsLimiter,
     if (!ConfigureStorage())
         return false;
 
+    if (!ConfigureSpillFile())
+        return false;
+
     const auto framePoolOps = FramePool::Ops::Shrink/* | FramePool::Ops::Prefetch*/;
     if (!PreallocateUnusedFrames(framePoolOps))
         return false;
 
-    const bool centroidsCapable =
-        m_camera->GetParams().Get<PARAM_CENTROIDS_ENABLED>()->IsAvail();
-    const bool centroidsEnabled = centroidsCapable
-        && m_camera->GetParams().Get<PARAM_CENTROIDS_ENABLED>()->GetCur();
-    const bool centroidsCountCapable =
-        m_camera->GetParams().Get<PARAM_CENTROIDS_COUNT>()->IsAvail();
-    const bool centroidsRadiusCapable =
-        m_camera->GetParams().Get<PARAM_CENTROIDS_RADIUS>()->IsAvail();
-    const bool centroidsModeCapable =
-        m_camera->GetParams().Get<PARAM_CENTROIDS_MODE>()->IsAvail();
-    // Cache the tracking functionality status
-    m_trackEnabled = PH_TRACK && centroidsEnabled && centroidsCountCapable
-        && centroidsRadiusCapable && centroidsModeCapable
-        && m_camera->GetParams().Get<PARAM_CENTROIDS_MODE>()->GetCur()
-            == PL_CENTROIDS_MODE_TRACK;
-
-    if (m_trackEnabled)
-    {
-        m_centroidsRadius =
-            m_camera->GetParams().Get<PARAM_CENTROIDS_RADIUS>()->GetCur();
-
-        const uint16_t maxFramesToLink = m_camera->GetSettings().GetTrackLinkFrames();
-        const uint16_t maxDistPerFrame = m_camera->GetSettings().GetTrackMaxDistance();
-        const uint16_t maxParticles =
-            m_camera->GetParams().Get<PARAM_CENTROIDS_COUNT>()->GetCur();
-        const bool useCpuOnly = m_camera->GetSettings().GetTrackCpuOnly();
-        const int32_t trackErr =
-            PH_TRACK->init(&m_trackContext, maxFramesToLink, maxDistPerFrame,
-                    useCpuOnly, maxParticles, &m_trackMaxParticles);
-        if (trackErr != PH_TRACK_ERROR_NONE)
-        {
-            char msg[PH_TRACK_MAX_ERROR_LEN] = "Unknown error";
-            uint32_t size = PH_TRACK_MAX_ERROR_LEN;
-            PH_TRACK->get_last_error_message(msg, &size);
-            Log::LogE("Failed to initialize tracking context (%s)", msg);
-            return false;
-        }
-
-        m_trackParticles = new(std::nothrow) ph_track_particle[m_trackMaxParticles];
-        if (!m_trackParticles)
-        {
-            PH_TRACK->uninit(&m_trackContext);
-            m_trackContext = nullptr;
-            return false;
-        }
+    if (!ConfigureFrameStages())
+        return false;
 
-        const uint32_t historyDepth =
-            (uint32_t)m_camera->GetSettings().GetTrackTrajectoryDuration();
-        m_trackLinker = new(std::nothrow) ParticleLinker(maxParticles, historyDepth);
-        if (!m_trackLinker)
-        {
-            delete [] m_trackParticles;
-            m_trackParticles = nullptr;
-            PH_TRACK->uninit(&m_trackContext);
-            m_trackContext = nullptr;
-            return false;
-        }
-    }
+    ConfigureThreadAffinity();
 
     m_acqThreadReadyFlag = false;
     m_acqThreadAbortFlag = false;
@@ -232,7 +233,7 @@ void pm::Acquisition::RequestAbort(bool abortBufferedFramesProcessing)
     if (m_acqThread)
     {
         // Wake acq waiter
-        m_toBeProcessedFramesCond.notify_one();
+        m_toBeProcessedFrames.WakeUp();
     }
     else
     {
@@ -245,7 +246,17 @@ void pm::Acquisition::RequestAbort(bool abortBufferedFramesProcessing)
         if (m_diskThread)
         {
             // Wake disk waiter
-            m_toBeSavedFramesCond.notify_one();
+            m_toBeSavedFrames.WakeUp();
+            // Wake stages, the list doesn't change while disk thread runs
+            for (auto& runner : m_stageRunners)
+            {
+                runner->queue.WakeUp();
+            }
+            // Wake disk writers, the list doesn't change while disk thread runs
+            for (auto& writer : m_diskWriters)
+            {
+                writer->queue.WakeUp();
+            }
         }
         else
         {
@@ -283,19 +294,19 @@ bool pm::Acquisition::WaitForStop(bool printStats)
         m_updateThread = nullptr;
     }
 
-    if (m_trackContext != PH_TRACK_CONTEXT_INVALID)
+    // Runners are kept till next start for statistics
+    for (auto& runner : m_stageRunners)
     {
-        PH_TRACK->uninit(&m_trackContext);
-        m_trackContext = PH_TRACK_CONTEXT_INVALID;
+        runner->stage->Stop();
     }
-    delete [] m_trackParticles;
-    m_trackParticles = nullptr;
-    delete m_trackLinker;
-    m_trackLinker = nullptr;
+
+    // Frees the disk space, the file is created again at next start
+    m_spillFile = nullptr;
 
     if (printStats)
     {
         PrintAcqThreadStats();
+        PrintStageStats();
         PrintDiskThreadStats();
     }
 
@@ -317,6 +328,16 @@ bool pm::Acquisition::WaitForStop(bool printStats)
     return wasAborted;
 }
 
+bool pm::Acquisition::TriggerCapture()
+{
+    if (!m_preTriggerActiveFlag)
+        return false;
+
+    // Handled by disk thread with next frame
+    m_preTriggerFlag = true;
+    return true;
+}
+
 const pm::AcquisitionStats& pm::Acquisition::GetAcqStats() const
 {
     return m_toBeProcessedFramesStats;
@@ -327,6 +348,35 @@ const pm::AcquisitionStats& pm::Acquisition::GetDiskStats() const
     return m_toBeSavedFramesStats;
 }
 
+bool pm::Acquisition::AddFrameStage(std::shared_ptr<FrameStage> stage)
+{
+    if (!stage || IsRunning())
+        return false;
+
+    m_customStages.push_back(stage);
+    return true;
+}
+
+bool pm::Acquisition::RemoveFrameStages()
+{
+    if (IsRunning())
+        return false;
+
+    m_customStages.clear();
+    m_stageRunners.clear();
+    return true;
+}
+
+size_t pm::Acquisition::GetFrameStageCount() const
+{
+    return m_stageRunners.size();
+}
+
+const pm::AcquisitionStats& pm::Acquisition::GetFrameStageStats(size_t index) const
+{
+    return m_stageRunners.at(index)->stats;
+}
+
 void PV_DECL pm::Acquisition::EofCallback(FRAME_INFO* frameInfo,
         void* Acquisition_pointer)
 {
@@ -346,17 +396,16 @@ bool pm::Acquisition::HandleEofCallback(FRAME_INFO* frameInfo)
     if (m_acqThreadAbortFlag)
         return true; // Return value doesn't matter, abort is already in progress
 
+    const double handoffStart = m_toBeProcessedFramesTimer.Seconds();
+
     auto CheckLostFrames = [&](uint32_t frameNr) {
-        if (frameNr > m_lastFrameNumberInCallback + 1)
+        const uint32_t lastFrameNr = m_lastFrameNumberInCallback;
+        if (frameNr > lastFrameNr + 1)
         {
-            m_toBeProcessedFramesStats.ReportFrameLost(
-                    frameNr - m_lastFrameNumberInCallback - 1);
+            m_toBeProcessedFramesStats.ReportFrameLost(frameNr - lastFrameNr - 1);
 
             // Log all the frame numbers we missed
-            for (uint32_t nr = m_lastFrameNumberInCallback + 1; nr < frameNr; nr++)
-            {
-                m_uncaughtFrames.AddItem(nr);
-            }
+            m_uncaughtFrames.AddItems(lastFrameNr + 1, frameNr - 1);
         }
         m_lastFrameNumberInCallback = frameNr;
     };
@@ -369,10 +418,13 @@ bool pm::Acquisition::HandleEofCallback(FRAME_INFO* frameInfo)
     std::shared_ptr<Frame> frame = m_unusedFramesPool.TakeFrame();
     if (!frame)
     {
-        // No RAM for new frame, this should happen rarely as we reuse frames
         m_toBeProcessedFramesStats.ReportFrameLost();
         m_uncaughtFrames.AddItem(cbFrameNr);
-        return false;
+        // With growth the pool is only empty, e.g. during a burst or once
+        // the frame limit is reached, drop this frame and keep going.
+        // Otherwise there is no RAM for new frame, this should happen rarely
+        // as we reuse frames.
+        return m_unusedFramesPool.IsGrowthEnabled();
     }
 
     if (!m_camera->GetLatestFrame(*frame))
@@ -383,38 +435,50 @@ bool pm::Acquisition::HandleEofCallback(FRAME_INFO* frameInfo)
         return false;
     }
 
-    // Put frame to queue for processing
+    // Shallow frame references camera buffer directly, keep the slot pinned
+    // until the frame returns to m_unusedFramesPool, see UnpinFrame
+    if (!frame->UsesDeepCopy())
     {
-        std::lock_guard<std::mutex> lock(m_toBeProcessedFramesMutex);
-
-        if (m_toBeProcessedFramesStats.GetQueueSize()
-                < m_toBeProcessedFramesStats.GetQueueCapacity())
+        size_t index;
+        if (m_camera->GetFrameIndexByData(frame->GetDataPointer(), index))
         {
-            m_toBeProcessedFrames.push(frame);
-            m_toBeProcessedFramesStats.SetQueueSize(m_toBeProcessedFrames.size());
+            m_camera->PinFrameAt(index);
         }
-        else
-        {
-            // No RAM for frame processing
+    }
 
-            // frameNr from GetLatestFrame could be newer than in frameInfo
-            // passed to callback function
-            const uint32_t frameNr = frame->GetInfo().GetFrameNr();
-            if (cbFrameNr < frameNr)
-            {
-                CheckLostFrames(frameNr);
-            }
+    // frameNr from GetLatestFrame could be newer than in frameInfo
+    // passed to callback function
+    const uint32_t frameNr = frame->GetInfo().GetFrameNr();
+
+    frame->SetArrivalTime(handoffStart);
+
+    // Put frame to queue for processing, wakes acq thread if parked.
+    // The queue size is updated here only as the only producer.
+    if (m_toBeProcessedFrames.Push(frame))
+    {
+        m_toBeProcessedFramesStats.SetQueueSize(m_toBeProcessedFrames.GetSize());
+    }
+    else
+    {
+        // No RAM for frame processing
+        if (cbFrameNr < frameNr)
+        {
+            CheckLostFrames(frameNr);
         }
     }
-    // Notify acq thread about new captured frame
-    m_toBeProcessedFramesCond.notify_one();
+
+    m_toBeProcessedFramesStats.ReportHandoffTime(
+            m_toBeProcessedFramesTimer.Seconds() - handoffStart);
 
     return true;
 }
 
 bool pm::Acquisition::HandleNewFrame(std::shared_ptr<Frame> frame)
 {
-    // Do deep copy
+    m_callbackLatency.Record(
+            m_toBeProcessedFramesTimer.Seconds() - frame->GetArrivalTime());
+
+    // Do deep copy, in zero-copy mode only the data pointer is taken
     if (!frame->CopyData())
         return false;
 
@@ -439,258 +503,318 @@ bool pm::Acquisition::HandleNewFrame(std::shared_ptr<Frame> frame)
         m_toBeProcessedFramesStats.ReportFrameLost(lostFrameCount);
 
         // Log all the frame numbers we missed
-        for (uint32_t nr = m_lastFrameNumberInHandling + 1; nr < frameNr; nr++)
-        {
-            m_uncaughtFrames.AddItem(nr);
-        }
+        m_uncaughtFrames.AddItems(m_lastFrameNumberInHandling + 1, frameNr - 1);
     }
     m_lastFrameNumberInHandling = frameNr;
 
+    // Could be overwritten while waiting in m_toBeProcessedFrames queue
+    if (IsFrameOverwritten(frameNr))
+    {
+        m_overwrittenFrameCount++;
+        m_toBeProcessedFramesStats.ReportFrameLost();
+        m_uncaughtFrames.AddItem(frameNr);
+        return true;
+    }
+
     m_toBeProcessedFramesStats.ReportFrameAcquired();
 
-    // If we don't need to track particles, send frame to GUI here so displaying
-    // is not slowed down by saving images.
-    if (!m_trackEnabled && m_fpsLimiter)
+    // If there are no stages, send frame to GUI here so displaying
+    // is not slowed down by saving images. Otherwise the last stage does it.
+    if (m_stageRunners.empty() && m_fpsLimiter)
     {
         m_fpsLimiter->InputNewFrame(frame);
     }
 
-    {
-        std::unique_lock<std::mutex> lock(m_toBeSavedFramesMutex);
-
-        if (m_toBeSavedFramesStats.GetQueueSize()
-                < m_toBeSavedFramesStats.GetQueueCapacity())
-        {
-            m_toBeSavedFrames.push(frame);
-            m_toBeSavedFramesStats.SetQueueSize(m_toBeSavedFrames.size());
-        }
-        else
-        {
-            // Not enough RAM to queue it for saving
-            m_toBeSavedFramesStats.ReportFrameLost();
-            m_unsavedFrames.AddItem(frameNr);
-        }
-    }
-    // Notify disk waiter about new queued frame
-    m_toBeSavedFramesCond.notify_one();
+    QueueFrame(0, frame);
 
     return true;
 }
 
-bool pm::Acquisition::TrackNewFrame(std::shared_ptr<Frame> frame)
+bool pm::Acquisition::ConfigureFrameStages()
 {
-    const uint32_t frameNr = frame->GetInfo().GetFrameNr();
-
-    // If all ROIs have particle ID set (non-zero) by camera,
-    // linking is not needed.
-    bool isLinkingNeeded = false;
-
-    // 1. Decode
-    if (!frame->DecodeMetadata())
-        return false;
-    auto frameMeta = frame->GetMetadata();
-    // Format is: map<roiNr, md_ext_item_collection>
-    auto frameExtMeta = frame->GetExtMetadata();
+    m_stageRunners.clear();
 
-    // 2. Verify extended metadata before using it
-    for (uint16_t n = 0; n < frameMeta->roiCount; ++n)
+    std::vector<std::shared_ptr<FrameStage>> stages;
+    if (FrameStage_Track::IsNeeded(*m_camera))
     {
-        const md_frame_roi& mdRoi = frameMeta->roiArray[n];
-
-        // Do not work with background image ROI
-        if (!(mdRoi.header->flags & PL_MD_ROI_FLAG_HEADER_ONLY))
-            continue;
-
-        const uint16_t roiNr = mdRoi.header->roiNr;
-        md_ext_item_collection* collection = &frameExtMeta[roiNr];
-
-        // Extract particle ID from extended metadata
-        const md_ext_item* item_id = collection->map[PL_MD_EXT_TAG_PARTICLE_ID];
-        if (!item_id)
+        try
         {
-            // Particle ID is usually missing, we get it after linking
-            isLinkingNeeded = true;
+            stages.push_back(
+                    std::make_shared<FrameStage_Track>(m_camera, m_fpsLimiter));
         }
-        else
+        catch (...)
         {
-            if (!item_id->value || !item_id->tagInfo
-                || item_id->tagInfo->type != TYPE_UNS32
-                || item_id->tagInfo->size != 4)
-            {
-                Log::LogE("Invalid particle ID in ext. metadata, frameNr %u, roiNr=%u",
-                        frameNr, roiNr);
-                return false;
-            }
-
-            if (*((uint32_t*)item_id->value) == 0)
-            {
-                // Particle ID sent by camera is invalid, we get it after linking
-                isLinkingNeeded = true;
-            }
+            Log::LogE("Failure creating particle tracking stage");
+            return false;
         }
-        // Extract M0 from extended metadata
-        const md_ext_item* item_m0 = collection->map[PL_MD_EXT_TAG_PARTICLE_M0];
-        if (!item_m0 || !item_m0->value || !item_m0->tagInfo
-                || item_m0->tagInfo->type != TYPE_UNS32
-                || item_m0->tagInfo->size != 4)
+    }
+    if (m_camera->GetSettings().GetPixelStats())
+    {
+        try
         {
-            Log::LogE("Missing M0 moment in ext. metadata, frameNr %u, roiNr=%u",
-                    frameNr, roiNr);
-            return false;
+            stages.push_back(std::make_shared<FrameStage_PixelStats>(
+                        m_camera->GetSettings().GetSaveDir(),
+                        m_camera->GetSettings().GetStorageType(),
+                        m_camera->GetSettings().GetPixelStatsCheckpoint()));
         }
-        // Extract M2 from extended metadata
-        const md_ext_item* item_m2 = collection->map[PL_MD_EXT_TAG_PARTICLE_M2];
-        if (!item_m2 || !item_m2->value || !item_m2->tagInfo
-                || item_m2->tagInfo->type != TYPE_UNS32
-                || item_m2->tagInfo->size != 4)
+        catch (...)
         {
-            Log::LogE("Missing M2 moment in ext. metadata, frameNr %u, roiNr=%u",
-                    frameNr, roiNr);
+            Log::LogE("Failure creating pixel statistics stage");
             return false;
         }
     }
+    stages.insert(stages.end(), m_customStages.begin(), m_customStages.end());
 
-    // 3. Link particles
-    std::vector<ph_track_particle_event> events;
-    // Copy to separate variable that get overwritten after linking
-    uint32_t particlesCount = m_trackMaxParticles;
-
-    if (!isLinkingNeeded)
+    for (auto& stage : stages)
     {
-        // Camera sent valid ID yet, linking not needed
-
-        // Just convert data to the same format as goes from track library
-        for (uint16_t n = 0; n < frameMeta->roiCount; ++n)
+        std::unique_ptr<StageRunner> runner(new(std::nothrow) StageRunner());
+        if (!runner || !stage->Start())
         {
-            const md_frame_roi& mdRoi = frameMeta->roiArray[n];
+            Log::LogE("Failure starting stage '%s'", stage->GetName().c_str());
+            for (auto& startedRunner : m_stageRunners)
+            {
+                startedRunner->stage->Stop();
+            }
+            m_stageRunners.clear();
+            return false;
+        }
+
+        runner->stage = stage;
+        runner->stats.SetQueueCapacity(stage->GetQueueCapacity());
+        m_stageRunners.push_back(std::move(runner));
+    }
 
-            // Do not work with background image ROI
-            if (!(mdRoi.header->flags & PL_MD_ROI_FLAG_HEADER_ONLY))
-                continue;
+    return true;
+}
 
-            const uint16_t roiNr = mdRoi.header->roiNr;
+void pm::Acquisition::QueueFrame(size_t stageIndex, std::shared_ptr<Frame> frame)
+{
+    const uint32_t frameNr = frame->GetInfo().GetFrameNr();
+    frame->SetQueuedTime(m_toBeProcessedFramesTimer.Seconds());
+    // Frames queued for stages occupy RAM too, they count to the same limit
+    const bool fitsRam =
+        GetToBeSavedFramesCount() < m_toBeSavedFramesStats.GetQueueCapacity();
 
-            // Extract particle ID from extended metadata
-            const md_ext_item* item_id =
-                frameExtMeta[roiNr].map[PL_MD_EXT_TAG_PARTICLE_ID];
-            const uint32_t id = *((uint32_t*)item_id->value);
+    if (stageIndex < m_stageRunners.size())
+    {
+        StageRunner& runner = *m_stageRunners[stageIndex];
 
-            ph_track_particle particle;
-            particle.event = events[n - 1];
-            particle.id = id;
-            particle.lifetime = 10;
-            particle.state = PH_TRACK_PARTICLE_STATE_CONTINUATION;
-            m_trackParticles[n - 1] = particle;
+        // Queue frame for stage, wakes stage thread if parked.
+        // The queue size is updated here only as the only producer.
+        if (fitsRam && runner.queue.GetSize() < runner.stats.GetQueueCapacity()
+                && runner.queue.Push(frame))
+        {
+            runner.stats.SetQueueSize(runner.queue.GetSize());
+        }
+        else
+        {
+            runner.stats.ReportFrameLost();
+            runner.droppedFrames.AddItem(frameNr);
         }
+        return;
+    }
 
-        // Update count the same way as ph_track_link_particles does
-        particlesCount = frameMeta->roiCount - 1;
+    // Once spilling started, following frames are spilled too until disk
+    // thread reads all of them back
+    const bool isSpilling = m_spillPendingFrames > 0;
+
+    // Queue frame for saving, wakes disk thread if parked.
+    // The queue size is updated here only as the only producer.
+    if (fitsRam && !isSpilling && m_toBeSavedFrames.Push(frame))
+    {
+        m_toBeSavedFramesStats.SetQueueSize(GetToBeSavedFramesCount());
+    }
+    else if (m_spillFile && SpillFrame(*frame))
+    {
+        // Frame data is on disk now, the frame can be reused right away
     }
     else
     {
-        // Linking is needed
+        // Not enough RAM to queue it for saving
+        m_toBeSavedFramesStats.ReportFrameLost();
+        m_unsavedFrames.AddItem(frameNr);
+    }
+}
 
-        // 3a. Prepare input data for linking
-        const uint16_t radius = m_centroidsRadius;
+bool pm::Acquisition::SpillFrame(const Frame& frame)
+{
+    // All spilled frames have been read back, start over so the file grows
+    // only up to the longest series of spilled frames
+    if (m_spillPendingFrames == 0)
+    {
+        m_spillWriteOffset = 0;
+    }
 
-        for (uint16_t n = 0; n < frameMeta->roiCount; ++n)
-        {
-            const md_frame_roi& mdRoi = frameMeta->roiArray[n];
+    SpillRecord record;
+    record.info = frame.GetInfo();
+    record.trajectories = frame.GetTrajectoriesSnapshot();
+    record.offset = m_spillWriteOffset;
+    record.arrivalTime = frame.GetArrivalTime();
+    record.queuedTime = frame.GetQueuedTime();
 
-            // Do not work with background image ROI
-            if (!(mdRoi.header->flags & PL_MD_ROI_FLAG_HEADER_ONLY))
-                continue;
+    if (!m_spillFile->Write(record.offset, frame.GetData()))
+        return false;
 
-            const uint16_t roiNr = mdRoi.header->roiNr;
+    // Zero-copy frame could be overwritten by camera while being written
+    if (!frame.UsesDeepCopy() && IsFrameOverwritten(record.info.GetFrameNr()))
+    {
+        m_overwrittenFrameCount++;
+        return true;
+    }
 
-            const rgn_type& rgn = mdRoi.header->roi;
-            const uint16_t roiX = rgn.s1 / rgn.sbin;
-            const uint16_t roiY = rgn.p1 / rgn.pbin;
+    // Counted before push so disk thread never reads frame not counted yet
+    const size_t pendingFrames = ++m_spillPendingFrames;
+    if (!m_spilledFrames.Push(record))
+    {
+        m_spillPendingFrames--;
+        return false;
+    }
+    m_spillWriteOffset += m_spillFile->GetSlotBytes();
 
-            const uint16_t x = roiX + radius;
-            const uint16_t y = roiY + radius;
+    m_spilledFrameCount++;
+    m_spilledFramesPeak = std::max(m_spilledFramesPeak, pendingFrames);
 
-            // Extract M0 from extended metadata
-            const md_ext_item* item_m0 =
-                frameExtMeta[roiNr].map[PL_MD_EXT_TAG_PARTICLE_M0];
-            const uint32_t m0 = *((uint32_t*)item_m0->value);
+    // Disk thread parks on RAM queue only
+    m_toBeSavedFrames.WakeUp();
+    return true;
+}
 
-            // Extract M2 from extended metadata
-            const md_ext_item* item_m2 =
-                frameExtMeta[roiNr].map[PL_MD_EXT_TAG_PARTICLE_M2];
-            const uint32_t m2 = *((uint32_t*)item_m2->value);
+bool pm::Acquisition::UnspillFrame(std::shared_ptr<Frame>& frame, bool readData)
+{
+    frame = nullptr;
 
-            ph_track_particle_event event;
-            event.roiNr = mdRoi.header->roiNr;
-            event.center = ph_track_particle_coord{(double)x, (double)y};
-            // Unsigned fixed-point real number in format Q22.0
-            event.m0 = Utils::FixedPointToReal<double, uint32_t>(22, 0, m0);
-            // Unsigned fixed-point real number in format Q3.19
-            event.m2 = Utils::FixedPointToReal<double, uint32_t>(3, 19, m2);
+    SpillRecord record;
+    if (!m_spilledFrames.Pop(record))
+        return true;
 
-            events.push_back(event);
-        }
+    bool ok = true;
 
-        // 3b. Link particles
-        const int32_t trackErr =
-            PH_TRACK->link_particles(m_trackContext,
-                    events.data(), (uint32_t)events.size(),
-                    m_trackParticles, &particlesCount);
-        if (trackErr != PH_TRACK_ERROR_NONE)
+    std::shared_ptr<Frame> spilledFrame = m_spilledFramesPool.TakeFrame();
+    if (!spilledFrame)
+    {
+        Log::LogE("Failure allocating frame for spilled data");
+        ok = false;
+    }
+    else if (readData)
+    {
+        // HACK: The const casted out for now
+        void* data = const_cast<void*>(spilledFrame->GetData());
+        if (!m_spillFile->Read(record.offset, data))
         {
-            char msg[PH_TRACK_MAX_ERROR_LEN] = "Unknown error";
-            uint32_t size = PH_TRACK_MAX_ERROR_LEN;
-            PH_TRACK->get_last_error_message(msg, &size);
-            Log::LogE("Failed to link particles for frame nr. %u (%s)",
-                    frameNr, msg);
-            return false;
+            Log::LogE("Failure reading frame nr. %u from '%s'",
+                    record.info.GetFrameNr(), m_spillFile->GetFileName().c_str());
+            ok = false;
+        }
+        else
+        {
+            m_spillDrainLatency.Record(
+                    m_toBeProcessedFramesTimer.Seconds() - record.queuedTime);
+
+            spilledFrame->OverrideValidity(true);
         }
     }
 
-    // 4. "Convert" particles to trajectories
-    m_trackLinker->AddParticles(m_trackParticles, particlesCount);
+    if (ok)
+    {
+        spilledFrame->SetInfo(record.info);
+        spilledFrame->SetTrajectories(record.trajectories);
+        spilledFrame->SetArrivalTime(record.arrivalTime);
+        spilledFrame->SetQueuedTime(record.queuedTime);
+        frame = spilledFrame;
+    }
 
-    // 5. Store them in frame
-    frame->SetTrajectories(m_trackLinker->GetTrajectories());
+    // The slot in file is not used anymore
+    m_spillPendingFrames--;
+    return ok;
+}
 
-    // 6. Update trajectories in camera's circular buffer
-    size_t index;
-    if (m_camera->GetFrameIndex(*frame, index))
+bool pm::Acquisition::IsFeedDone(size_t stageIndex) const
+{
+    if (stageIndex == 0)
+        return m_acqThreadDoneFlag;
+
+    return m_stageRunners[stageIndex - 1]->doneFlag;
+}
+
+void pm::Acquisition::WakeConsumer(size_t stageIndex)
+{
+    if (stageIndex < m_stageRunners.size())
     {
-        auto camFrame = m_camera->GetFrameAt(index);
-        if (camFrame)
-        {
-            camFrame->SetTrajectories(m_trackLinker->GetTrajectories());
-        }
+        m_stageRunners[stageIndex]->queue.WakeUp();
     }
-    if (m_fpsLimiter)
+    else
     {
-        m_fpsLimiter->InputNewFrame(frame);
+        m_toBeSavedFrames.WakeUp();
     }
+}
 
-    return true;
+void pm::Acquisition::UnpinFrame(Frame& frame)
+{
+    // Deep copied frames don't reference camera buffer after CopyData
+    if (frame.UsesDeepCopy())
+        return;
+
+    size_t index;
+    if (m_camera->GetFrameIndexByData(frame.GetDataPointer(), index))
+    {
+        m_camera->UnpinFrameAt(index);
+    }
+    // Forget the slot so it is not unpinned twice
+    frame.SetDataPointer(nullptr);
+}
+
+bool pm::Acquisition::IsFrameOverwritten(uint32_t frameNr) const
+{
+    if (!m_checkOverwrittenFrames)
+        return false;
+
+    // The camera starts storing frame with number frameNr + m_bufferFrameCount
+    // to the same slot right after delivering the frame before it
+    const uint64_t nextFrameNr = (uint64_t)m_lastFrameNumberInCallback + 1;
+    return nextFrameNr >= (uint64_t)frameNr + m_bufferFrameCount;
 }
 
 void pm::Acquisition::UpdateToBeSavedFramesMax()
 {
-    static const size_t totalRamMB = Utils::GetTotalRamMB();
-    const size_t availRamMB = Utils::GetAvailRamMB();
-    /* We allow allocation of memory up to bigger value from these:
-       - 90% of total RAM
-       - whole available RAM reduced by 2048MB (former 1GB limit seemed to
-         activate Windows swapping and caused huge performance glitches) */
-    const size_t dontTouchRamMB = std::min<size_t>(totalRamMB * (100 - 90) / 100, 2048);
-    const size_t maxFreeRamMB =
-        (availRamMB >= dontTouchRamMB) ? availRamMB - dontTouchRamMB : 0;
-    // Left shift by 20 bits "converts" megabytes to bytes
-    const size_t maxFreeRamBytes = maxFreeRamMB << 20;
+    /* The budget leaves untouched 10% of RAM or of cgroup limit, up to 2048MB
+       (former 1GB limit seemed to activate Windows swapping and caused huge
+       performance glitches) */
+    m_memBudget.Update();
+    const size_t maxFreeRamBytes = m_memBudget.GetHeadroomBytes();
 
     const size_t frameBytes = m_camera->GetFrameAcqCfg().GetFrameBytes();
-    const size_t maxNewFrameCount =
-        (frameBytes == 0) ? 0 : maxFreeRamBytes / frameBytes;
+    // Ready frames in pool are already counted as used memory
+    const size_t maxNewFrameCount = (frameBytes == 0)
+        ? 0 : maxFreeRamBytes / frameBytes + m_unusedFramesPool.GetSize();
+
+    size_t capacity = GetToBeSavedFramesCount() + maxNewFrameCount;
+    // Frames referencing camera buffer cannot outnumber its slots
+    if (m_camera->GetSettings().GetAcqZeroCopy())
+    {
+        capacity = std::min<size_t>(capacity,
+                m_camera->GetSettings().GetBufferFrameCount());
+    }
+
+    m_toBeSavedFramesStats.SetQueueCapacity(capacity);
+
+    // Pool grows up to the number of frames that can be in flight at once
+    const size_t batchCount = m_stageRunners.size() + m_diskWriters.size() + 2;
+    m_unusedFramesPool.SetMaxFrames(capacity
+            + m_toBeProcessedFramesStats.GetQueueCapacity()
+            + batchCount * cDiskThreadBatchMaxFrames);
+}
 
-    m_toBeSavedFramesStats.SetQueueCapacity(
-            m_toBeSavedFramesStats.GetQueueSize() + maxNewFrameCount);
+size_t pm::Acquisition::GetToBeSavedFramesCount() const
+{
+    // Frames passed to writers or kept for pre-trigger capture still occupy
+    // RAM, count them as queued
+    size_t count = m_toBeSavedFrames.GetSize() + m_diskWritersPendingFrames
+        + m_preTriggerFrames;
+    for (auto& runner : m_stageRunners)
+    {
+        count += runner->queue.GetSize();
+    }
+    return count;
 }
 
 bool pm::Acquisition::PreallocateUnusedFrames(int framePoolOps)
@@ -698,6 +822,14 @@ bool pm::Acquisition::PreallocateUnusedFrames(int framePoolOps)
     // Limit the queue with captured frames to half of the circular buffer size
     m_toBeProcessedFramesStats.SetQueueCapacity(
             (m_camera->GetSettings().GetBufferFrameCount() / 2) + 1);
+    // Moved unprocessed frames to unused frames queue
+    if (!m_toBeProcessedFrames.Setup(m_toBeProcessedFramesStats.GetQueueCapacity()))
+    {
+        Log::LogE("Failure allocating queue for %zu captured frames",
+                m_toBeProcessedFramesStats.GetQueueCapacity());
+        return false;
+    }
+    m_toBeProcessedFramesStats.SetQueueSize(0);
 
     UpdateToBeSavedFramesMax();
 
@@ -710,22 +842,127 @@ bool pm::Acquisition::PreallocateUnusedFrames(int framePoolOps)
     const size_t recommendedFrameCount = std::min<size_t>(
             10 + std::min(frameCount, frameCountIn100MB),
             m_toBeSavedFramesStats.GetQueueCapacity());
-    const bool deepCopy =
-        m_camera->GetSettings().GetAcqMode() != AcqMode::SnapSequence;
+    const AcqMode acqMode = m_camera->GetSettings().GetAcqMode();
+    const bool zeroCopy = m_camera->GetSettings().GetAcqZeroCopy();
+    // Sequence fits the buffer as a whole, no need to copy frames out of it
+    const bool deepCopy = !zeroCopy && acqMode != AcqMode::SnapSequence;
 
-    // Moved unprocessed frames to unused frames queue
-    std::queue<std::shared_ptr<Frame>>().swap(m_toBeProcessedFrames);
-    m_toBeProcessedFramesStats.SetQueueSize(0);
+    m_checkOverwrittenFrames = zeroCopy && acqMode != AcqMode::SnapSequence
+        && !m_camera->HonorsFramePins();
+    m_bufferFrameCount = m_camera->GetSettings().GetBufferFrameCount();
 
     // Moved unsaved frames to unused frames queue
-    std::queue<std::shared_ptr<Frame>>().swap(m_toBeSavedFrames);
+    m_toBeSavedFrames.Clear();
+    m_toBeSavedFramesBatch.clear();
+    for (auto& runner : m_stageRunners)
+    {
+        runner->queue.Clear();
+        runner->batch.clear();
+        runner->stats.SetQueueSize(0);
+    }
+    for (auto& writer : m_diskWriters)
+    {
+        writer->queue.Clear();
+        writer->batch.clear();
+    }
+    m_diskWritersPendingFrames = 0;
     m_toBeSavedFramesStats.SetQueueSize(0);
 
+    m_spilledFrames.Clear();
+    m_spillPendingFrames = 0;
+    m_spillWriteOffset = 0;
+
+    // With acq thread bound to some CPUs, fault the frame pages in right now
+    // on NUMA node local to them. Otherwise the first touch would happen in
+    // acquisition path, on node where the copying thread just runs.
+    const int numaNode =
+        CpuAffinity::GetNumaNode(m_camera->GetSettings().GetCpusAcq());
+    // Restored at the end, the thread could have policy e.g. from numactl
+    CpuAffinity::MemPolicy memPolicy;
+    const bool useNumaNode = numaNode >= 0
+        && CpuAffinity::GetCurrentThreadMemPolicy(memPolicy)
+        && CpuAffinity::SetCurrentThreadMemNode(numaNode);
+    if (numaNode >= 0 && !useNumaNode)
+    {
+        Log::LogW("Failure allocating frames on NUMA node %d, using default "
+                "memory policy", numaNode);
+    }
+    if (useNumaNode)
+        framePoolOps |= FramePool::Ops::Prefetch;
+
+    // Spilled frames are read back one by one, few frames are enough
+    const size_t spilledFrameCount = (m_spillFile) ? cDiskThreadBatchMaxFrames : 0;
+
     m_unusedFramesPool.Setup(frameAcqCfg, deepCopy, allocator);
-    if (!m_unusedFramesPool.EnsureReadyFrames(recommendedFrameCount, framePoolOps))
-        return false;
+    m_spilledFramesPool.Setup(frameAcqCfg, true, allocator);
+    const bool ok =
+        m_unusedFramesPool.EnsureReadyFrames(recommendedFrameCount, framePoolOps)
+        && m_spilledFramesPool.EnsureReadyFrames(spilledFrameCount, framePoolOps);
+
+    // Restored before the grow thread starts, it inherits the policy
+    if (useNumaNode)
+        CpuAffinity::SetCurrentThreadMemPolicy(memPolicy);
+
+    // Further frames for HandleEofCallback are allocated in background, in
+    // chunks of the same size as preallocated ones, on the same NUMA node
+    m_unusedFramesPool.SetGrowthAffinity(m_camera->GetSettings().GetCpusAux(),
+            (useNumaNode) ? numaNode : -1);
+    m_unusedFramesPool.SetGrowth(std::max<size_t>(3, recommendedFrameCount / 2),
+            recommendedFrameCount);
+
+    return ok;
+}
 
-    return true;
+void pm::Acquisition::ConfigureThreadAffinity()
+{
+    const SettingsReader& settings = m_camera->GetSettings();
+    const auto& cpusWorkers = settings.GetCpusWorkers();
+    const auto& cpusAux = settings.GetCpusAux();
+
+    // Threads living longer than acquisition are (un)restricted every time,
+    // new threads are restricted when they start
+    if (!UniqueThreadPool::Get().GetPool()->SetAffinity(cpusWorkers))
+    {
+        Log::LogW("Failure restricting thread pool to CPUs %s",
+                CpuAffinity::CpuSetToStr(cpusWorkers).c_str());
+    }
+    for (auto& runner : m_stageRunners)
+    {
+        auto pool = runner->stage->GetThreadPool();
+        if (pool && !pool->SetAffinity(cpusWorkers))
+        {
+            Log::LogW("Failure restricting workers of stage '%s' to CPUs %s",
+                    runner->stage->GetName().c_str(),
+                    CpuAffinity::CpuSetToStr(cpusWorkers).c_str());
+        }
+    }
+    if (!Log::SetThreadAffinity(cpusAux))
+    {
+        Log::LogW("Failure restricting logging thread to CPUs %s",
+                CpuAffinity::CpuSetToStr(cpusAux).c_str());
+    }
+
+    const auto& cpusAcq = settings.GetCpusAcq();
+    const auto& cpusDisk = settings.GetCpusDisk();
+    const unsigned int rtPriority = settings.GetAcqRtPriority();
+    if (cpusAcq.empty() && cpusDisk.empty() && cpusWorkers.empty()
+            && cpusAux.empty() && rtPriority == 0)
+        return;
+
+    const int numaNode = CpuAffinity::GetNumaNode(cpusAcq);
+    const std::string priorityStr = (rtPriority == 0)
+        ? "normal"
+        : "real-time " + std::to_string(rtPriority);
+    const std::string numaNodeStr = (numaNode < 0)
+        ? "default"
+        : std::to_string(numaNode);
+    Log::LogI("Thread CPUs: acq %s, disk %s, workers %s, aux %s; "
+            "acq priority: %s; frames NUMA node: %s",
+            CpuAffinity::CpuSetToStr(cpusAcq).c_str(),
+            CpuAffinity::CpuSetToStr(cpusDisk).c_str(),
+            CpuAffinity::CpuSetToStr(cpusWorkers).c_str(),
+            CpuAffinity::CpuSetToStr(cpusAux).c_str(),
+            priorityStr.c_str(), numaNodeStr.c_str());
 }
 
 bool pm::Acquisition::ConfigureStorage()
@@ -828,38 +1065,136 @@ bool pm::Acquisition::ConfigureStorage()
         }
     }
 
+    if (!ConfigureDiskWriters())
+        return false;
+
     UpdateToBeSavedFramesMax();
 
     return true;
 }
 
-void pm::Acquisition::AcqThreadLoop()
+bool pm::Acquisition::ConfigureSpillFile()
 {
-    m_acqTime = 0.0;
-
-    m_toBeProcessedFramesStats.Reset();
-
-    m_lastFrameNumberInCallback = 0;
-    m_lastFrameNumberInHandling = 0;
-    m_outOfOrderFrameCount = 0;
-    m_uncaughtFrames.Clear();
+    m_spillFile = nullptr;
 
-    const AcqMode acqMode = m_camera->GetSettings().GetAcqMode();
-    const bool isAcqModeLive =
-        acqMode == AcqMode::LiveCircBuffer || acqMode == AcqMode::LiveTimeLapse;
+    const std::string& spillDir = m_camera->GetSettings().GetSaveSpillDir();
+    if (spillDir.empty()
+            || m_camera->GetSettings().GetStorageType() == StorageType::None)
+        return true;
 
-    const size_t frameCount = (isAcqModeLive)
-        ? 0
-        : m_camera->GetSettings().GetAcqFrameCount();
+    const std::string fileName = spillDir + "/0_spill.tmp";
+    const size_t frameBytes = m_camera->GetFrameAcqCfg().GetFrameBytes();
 
-    if (!m_camera->StartExp(&Acquisition::EofCallback, this))
+    m_spillFile.reset(new(std::nothrow) SpillFile(fileName, frameBytes));
+    if (!m_spillFile || !m_spillFile->Open())
     {
-        RequestAbort();
+        Log::LogE("Failure creating spill file '%s'", fileName.c_str());
+        m_spillFile = nullptr;
+        return false;
+    }
 
-        // Let Start method know that this thread has started regardless of
-        // StartExp failure. It aborts everything based on m_acqThreadAbortFlag.
-        {
-            std::unique_lock<std::mutex> lock(m_acqThreadReadyMutex);
+    return true;
+}
+
+bool pm::Acquisition::ConfigureDiskWriters()
+{
+    const auto saveAs = m_camera->GetSettings().GetStorageType();
+    const auto saveAsTiff =
+        saveAs == StorageType::Tiff || saveAs == StorageType::BigTiff;
+    // Without saving the disk thread only processes frames
+    const size_t writerCount = (saveAs == StorageType::None)
+        ? 1
+        : m_camera->GetSettings().GetSaveThreadCount();
+
+    m_diskWriters.clear();
+    for (size_t n = 0; n < writerCount; ++n)
+    {
+        std::unique_ptr<DiskWriter> writer(new(std::nothrow) DiskWriter());
+        if (!writer)
+        {
+            Log::LogE("Failure allocating disk writer");
+            return false;
+        }
+
+        if (n == 0)
+        {
+            writer->tiffHelper = &m_tiffHelper;
+        }
+        else
+        {
+            TiffFileSave::Helper& helper = writer->ownTiffHelper;
+            helper.frameProc = &writer->ownTiffFrameProc;
+            helper.fillValue = m_tiffHelper.fillValue;
+            if (saveAsTiff)
+            {
+                if (!ColorUtils::AssignContexts(&helper.colorCtx, m_tiffHelper.colorCtx))
+                    return false;
+                if (helper.colorCtx)
+                {
+                    if (PH_COLOR_ERROR_NONE
+                            != PH_COLOR->context_apply_changes(helper.colorCtx))
+                    {
+                        ColorUtils::LogError("Failure applying color helper context changes");
+                        return false;
+                    }
+                }
+
+                const Bitmap* bmp = m_tiffHelper.fullBmp;
+                helper.fullBmp = new(std::nothrow) Bitmap(
+                        bmp->GetWidth(), bmp->GetHeight(), bmp->GetFormat());
+                if (!helper.fullBmp)
+                {
+                    Log::LogE("Failure allocating bitmap for streaming");
+                    return false;
+                }
+            }
+            writer->tiffHelper = &helper;
+        }
+
+        m_diskWriters.push_back(std::move(writer));
+    }
+
+    return true;
+}
+
+void pm::Acquisition::AcqThreadLoop()
+{
+    PinCurrentThread("acquisition", m_camera->GetSettings().GetCpusAcq());
+
+    const unsigned int rtPriority = m_camera->GetSettings().GetAcqRtPriority();
+    if (rtPriority > 0 && !CpuAffinity::SetCurrentThreadRtPriority(rtPriority))
+    {
+        Log::LogW("Failure setting real-time priority %u to acquisition "
+                "thread, insufficient privileges?", rtPriority);
+    }
+
+    m_acqTime = 0.0;
+
+    m_toBeProcessedFramesStats.Reset();
+    m_callbackLatency.Reset();
+
+    m_lastFrameNumberInCallback = 0;
+    m_lastFrameNumberInHandling = 0;
+    m_outOfOrderFrameCount = 0;
+    m_overwrittenFrameCount = 0;
+    m_uncaughtFrames.Clear();
+
+    const AcqMode acqMode = m_camera->GetSettings().GetAcqMode();
+    const bool isAcqModeLive =
+        acqMode == AcqMode::LiveCircBuffer || acqMode == AcqMode::LiveTimeLapse;
+
+    const size_t frameCount = (isAcqModeLive)
+        ? 0
+        : m_camera->GetSettings().GetAcqFrameCount();
+
+    if (!m_camera->StartExp(&Acquisition::EofCallback, this))
+    {
+        RequestAbort();
+
+        // Let Start method know that this thread has started regardless of
+        // StartExp failure. It aborts everything based on m_acqThreadAbortFlag.
+        {
+            std::unique_lock<std::mutex> lock(m_acqThreadReadyMutex);
             m_acqThreadReadyFlag = true;
             m_acqThreadReadyCond.notify_one();
         }
@@ -881,12 +1216,12 @@ void pm::Acquisition::AcqThreadLoop()
                 && !m_acqThreadAbortFlag)
         {
             std::shared_ptr<Frame> frame = nullptr;
+            if (!m_toBeProcessedFrames.Pop(frame))
             {
-                std::unique_lock<std::mutex> lock(m_toBeProcessedFramesMutex);
-
-                const bool timedOut = !m_toBeProcessedFramesCond.wait_for(
-                        lock, std::chrono::milliseconds(5000), [this]() {
-                            return (!m_toBeProcessedFrames.empty() || m_acqThreadAbortFlag);
+                // Spins for a moment first, parks only if no frame comes soon
+                const bool timedOut = !m_toBeProcessedFrames.WaitForItems(
+                        std::chrono::milliseconds(5000), [this]() {
+                            return m_acqThreadAbortFlag.load();
                         });
                 if (timedOut)
                 {
@@ -900,9 +1235,8 @@ void pm::Acquisition::AcqThreadLoop()
                 if (m_acqThreadAbortFlag)
                     break;
 
-                frame = m_toBeProcessedFrames.front();
-                m_toBeProcessedFrames.pop();
-                m_toBeProcessedFramesStats.SetQueueSize(m_toBeProcessedFrames.size());
+                if (!m_toBeProcessedFrames.Pop(frame))
+                    continue;
             }
             // frame is always valid here
             if (!HandleNewFrame(frame))
@@ -910,9 +1244,6 @@ void pm::Acquisition::AcqThreadLoop()
                 RequestAbort(false); // Let queued frames to be processed
                 break;
             }
-
-            // Ensure there are some ready-to-use frame for HandleEofCallback
-            m_unusedFramesPool.EnsureReadyFrames(3);
         }
 
         m_acqTime = m_acqTimer.Seconds();
@@ -934,8 +1265,8 @@ void pm::Acquisition::AcqThreadLoop()
         m_fpsLimiter->SetAcqFinished();
     }
 
-    // Wake disk waiter just in case it will abort right away
-    m_toBeSavedFramesCond.notify_one();
+    // Wake first stage or disk waiter just in case it will abort right away
+    WakeConsumer(0);
 
     // Allow update thread to finish
     m_updateThreadCond.notify_one();
@@ -943,44 +1274,81 @@ void pm::Acquisition::AcqThreadLoop()
 
 void pm::Acquisition::DiskThreadLoop()
 {
+    PinCurrentThread("disk", m_camera->GetSettings().GetCpusDisk());
+
     m_diskTimer.Reset();
     m_diskTime = 0.0;
 
     m_toBeSavedFramesStats.Reset();
+    m_toBeSavedFramesLatency.Reset();
+    for (auto& writer : m_diskWriters)
+    {
+        writer->writeLatency.Reset();
+        writer->totalLatency.Reset();
+    }
     m_toBeSavedFramesSaved = 0;
     m_unsavedFrames.Clear();
 
+    m_spilledFrameCount = 0;
+    m_spilledFramesPeak = 0;
+    m_spillDrainLatency.Reset();
+
+    m_memBudget.ResetMinHeadroom();
+
     const StorageType storageType = m_camera->GetSettings().GetStorageType();
 
     DiskThreadLoopWriter();
 
     m_diskTime = m_diskTimer.Seconds();
 
-    if (m_trackEnabled && m_diskThreadAbortFlag)
+    if (!m_stageRunners.empty() && m_diskThreadAbortFlag)
     {
-        // Moved unsaved frames to unused frames queue while invalidating
-        // trajectories in camera's circular buffer.
-        // No locking needed here.
-        while (!m_toBeSavedFrames.empty())
+        // Moved unsaved frames to unused frames queue while letting stages
+        // release what they did with them, e.g. trajectories in camera's
+        // circular buffer.
+        // Frames left in writers go first as the oldest ones, then those
+        // left in the batch and finally those still in queue.
+        // No locking needed here, stages and writers have already finished.
+        std::vector<std::shared_ptr<Frame>> writersFrames;
+        for (auto& writer : m_diskWriters)
         {
-            auto frame = m_toBeSavedFrames.front();
-            m_toBeSavedFrames.pop();
-
-            size_t index;
-            if (m_camera->GetFrameIndex(*frame, index))
+            for (auto& item : writer->batch)
             {
-                auto camFrame = m_camera->GetFrameAt(index);
-                if (camFrame)
-                {
-                    camFrame->SetTrajectories(Frame::Trajectories());
-
-                    if (m_toBeSavedFrames.empty() && m_fpsLimiter)
-                    {
-                        m_fpsLimiter->InputNewFrame(camFrame);
-                    }
-                }
+                writersFrames.push_back(std::move(item.frame));
             }
+            writer->batch.clear();
+            DiskWriterItem item;
+            while (writer->queue.Pop(item))
+            {
+                writersFrames.push_back(std::move(item.frame));
+            }
+        }
+        m_diskWritersPendingFrames = 0;
+        m_toBeSavedFramesBatch.insert(m_toBeSavedFramesBatch.begin(),
+                writersFrames.begin(), writersFrames.end());
+        m_toBeSavedFrames.PopBatch(m_toBeSavedFramesBatch,
+                m_toBeSavedFrames.GetSize());
+        // Spilled frames are newer than those queued in RAM, there is no need
+        // to read their data
+        std::shared_ptr<Frame> spilledFrame;
+        while (UnspillFrame(spilledFrame, false) && spilledFrame)
+        {
+            m_toBeSavedFramesBatch.push_back(std::move(spilledFrame));
+        }
+        // Going backwards, each stage gets frames it has processed already,
+        // frames waiting for the stage are newer and go to previous stage
+        for (size_t n = m_stageRunners.size(); n-- > 0;)
+        {
+            StageRunner& runner = *m_stageRunners[n];
+            runner.stage->ReleaseUnsavedFrames(m_toBeSavedFramesBatch);
+
+            m_toBeSavedFramesBatch.insert(m_toBeSavedFramesBatch.end(),
+                    runner.batch.begin(), runner.batch.end());
+            runner.batch.clear();
+            runner.queue.PopBatch(m_toBeSavedFramesBatch, runner.queue.GetSize());
+            runner.stats.SetQueueSize(0);
         }
+        m_toBeSavedFramesBatch.clear();
         m_toBeSavedFramesStats.SetQueueSize(0);
     }
 
@@ -1043,6 +1411,25 @@ void pm::Acquisition::DiskThreadLoopWriter()
         ? 0
         : std::min(frameCount, m_camera->GetSettings().GetSaveLast());
 
+    // Pre-trigger capture keeps recent frames in RAM up to half of the limit,
+    // the other half is left for frames queued for saving after trigger
+    const size_t savePreTrigger = m_camera->GetSettings().GetSavePreTrigger();
+    const size_t savePostTrigger = m_camera->GetSettings().GetSavePostTrigger();
+    const size_t preTriggerMax = (isAcqModeLive && storageType != StorageType::None)
+        ? std::min(savePreTrigger, m_toBeSavedFramesStats.GetQueueCapacity() / 2)
+        : 0;
+    const bool usePreTrigger = preTriggerMax > 0;
+    if (savePreTrigger > 0 && !usePreTrigger)
+    {
+        Log::LogW("Pre-trigger capture is supported in live modes with saving "
+                "enabled only, option ignored");
+    }
+    else if (preTriggerMax < savePreTrigger)
+    {
+        Log::LogW("Pre-trigger capture reduced to %zu frames to fit in RAM",
+                preTriggerMax);
+    }
+
     const rgn_type rgn = SettingsReader::GetImpliedRegion(
             m_camera->GetSettings().GetRegions());
     const auto allocator = m_camera->GetAllocator();
@@ -1056,13 +1443,18 @@ void pm::Acquisition::DiskThreadLoopWriter()
     const bool saveAsStack = maxStackSize > 0;
     const uint32_t maxFramesPerFile = (saveAsStack) ? m_frameCountThatFitsStack : 1;
 
+    const unsigned int ioQueueDepth = m_camera->GetSettings().GetSaveIoQueueDepth();
+
     const std::string fileDir = ((saveDir.empty()) ? "." : saveDir) + "/";
     std::string fileName;
-    FileSave* file = nullptr;
-    
+
     // Absolute frame index in saving sequence
     size_t frameIndex = 0;
 
+    // Each new file goes to next writer in turn, the writer gets all its frames
+    size_t fileCount = 0;
+    size_t writerIndex = 0;
+
     // Store import instructions for PRD in 'saveDir' before first frame arrives
     if (storageType == StorageType::Prd)
     {
@@ -1082,68 +1474,195 @@ void pm::Acquisition::DiskThreadLoopWriter()
         prdHeader.frameCount = 1; // Change back
     }
 
+    // Stages are started here so they can be joined before abort cleanup
+    for (size_t n = 0; n < m_stageRunners.size(); ++n)
+    {
+        StageRunner& runner = *m_stageRunners[n];
+        runner.stats.Reset();
+        runner.queueLatency.Reset();
+        runner.processLatency.Reset();
+        runner.droppedFrames.Clear();
+        runner.doneFlag = false;
+        runner.thread = new(std::nothrow) std::thread(
+                &Acquisition::StageThreadLoop, this, n);
+        if (!runner.thread)
+        {
+            Log::LogE("Failure starting thread for stage '%s'",
+                    runner.stage->GetName().c_str());
+            RequestAbort(); // The main while loop below won't be entered
+            break;
+        }
+    }
+
+    // With single writer this thread writes the files itself
+    m_diskWritersFeedDoneFlag = false;
+    if (m_diskWriters.size() > 1)
+    {
+        for (auto& writer : m_diskWriters)
+        {
+            writer->thread = new(std::nothrow) std::thread(
+                    &Acquisition::DiskWriterThreadLoop, this, writer.get());
+            if (!writer->thread)
+            {
+                Log::LogE("Failure starting disk writer thread");
+                RequestAbort(); // The main while loop below won't be entered
+                break;
+            }
+        }
+    }
+
     {
         std::unique_lock<std::mutex> lock(m_diskThreadReadyMutex);
         m_diskThreadReadyFlag = true;
         m_diskThreadReadyCond.notify_one();
     }
 
+    // Index of next frame to be processed in m_toBeSavedFramesBatch
+    size_t batchIndex = 0;
+    m_toBeSavedFramesBatch.clear();
+    m_toBeSavedFramesBatch.reserve(cDiskThreadBatchMaxFrames);
+
+    // Frames kept for pre-trigger capture, the oldest one is at head
+    std::vector<std::shared_ptr<Frame>> preTriggerRing;
+    size_t preTriggerHead = 0;
+    size_t preTriggerCount = 0;
+    // Frames in current capture, zero while waiting for trigger
+    size_t captureCount = 0;
+    // Index of frame in current capture
+    size_t captureIndex = 0;
+    // Number of triggered captures, used in file names
+    size_t captureNumber = 0;
+    if (usePreTrigger)
+    {
+        try
+        {
+            preTriggerRing.resize(preTriggerMax);
+        }
+        catch (...)
+        {
+            Log::LogE("Failure allocating ring for %zu pre-trigger frames",
+                    preTriggerMax);
+            RequestAbort(); // The main while loop below won't be entered
+        }
+        m_preTriggerFlag = false;
+        m_preTriggerActiveFlag = true;
+        Log::LogI("Pre-trigger capture armed, keeping up to %zu frames in RAM",
+                preTriggerMax);
+    }
+
     while ((isAcqModeLive || frameIndex < frameCount)
             && !m_diskThreadAbortFlag)
     {
-        std::shared_ptr<Frame> frame = nullptr;
+        // Frames kept before trigger are older than any queued frame
+        const bool isPreTriggerFrame = captureCount > 0 && preTriggerCount > 0;
+
+        if (!isPreTriggerFrame && batchIndex == m_toBeSavedFramesBatch.size())
         {
-            std::unique_lock<std::mutex> lock(m_toBeSavedFramesMutex);
+            m_toBeSavedFramesBatch.clear();
+            batchIndex = 0;
 
-            if (m_toBeSavedFrames.empty())
-            {
-                // There are no queued frames and acquisition has finished, stop this thread
-                if (m_acqThreadDoneFlag)
-                    break;
+            // Read the flag before the queue, acq thread or last stage sets
+            // it after last push
+            const bool feedDone = IsFeedDone(m_stageRunners.size());
 
-                m_toBeSavedFramesCond.wait(lock, [this]() {
-                    const bool empty = m_toBeSavedFrames.empty();
-                    return (!empty || m_diskThreadAbortFlag
-                            || (m_acqThreadDoneFlag && empty));
-                });
+            // Take all ready frames at once, up to the limit
+            if (m_toBeSavedFrames.PopBatch(m_toBeSavedFramesBatch,
+                        cDiskThreadBatchMaxFrames) == 0)
+            {
+                // Spilled frames are newer than any frame queued in RAM,
+                // they are read back only once the queue is empty
+                if (m_spillPendingFrames > 0)
+                {
+                    std::shared_ptr<Frame> spilledFrame;
+                    if (!UnspillFrame(spilledFrame, true))
+                    {
+                        RequestAbort();
+                        break;
+                    }
+                    // Null if the record is being pushed right now
+                    if (!spilledFrame)
+                        continue;
+                    m_toBeSavedFramesBatch.push_back(spilledFrame);
+                }
+                else
+                {
+                    // There are no queued frames and acquisition has finished, stop this thread
+                    if (feedDone)
+                        break;
+
+                    m_toBeSavedFrames.WaitForItems([this]() {
+                        return m_diskThreadAbortFlag
+                            || IsFeedDone(m_stageRunners.size())
+                            || m_spillPendingFrames > 0;
+                    });
+                    continue;
+                }
             }
-            if (m_diskThreadAbortFlag)
-                break;
-            if (m_acqThreadDoneFlag && m_toBeSavedFrames.empty())
-                break;
-
-            frame = m_toBeSavedFrames.front();
-            m_toBeSavedFrames.pop();
-            m_toBeSavedFramesStats.SetQueueSize(m_toBeSavedFrames.size());
         }
 
+        std::shared_ptr<Frame> frame;
         bool keepGoing = true;
 
-        // If not tracking particles, frame is sent to GUI in acquisition thread
-        if (m_trackEnabled)
+        if (isPreTriggerFrame)
         {
-            if (!TrackNewFrame(frame))
-            {
-                RequestAbort();
-                break;
-            }
+            // Already reported when it was put to the ring
+            frame = std::move(preTriggerRing[preTriggerHead]);
+            preTriggerHead = (preTriggerHead + 1) % preTriggerRing.size();
+            m_preTriggerFrames = --preTriggerCount;
         }
         else
         {
-            if (m_acqThreadDoneFlag && m_fpsLimiter)
+            frame = m_toBeSavedFramesBatch[batchIndex];
+            m_toBeSavedFramesBatch[batchIndex++] = nullptr;
+
+            m_toBeSavedFramesLatency.Record(
+                    m_toBeProcessedFramesTimer.Seconds() - frame->GetQueuedTime());
+
+            // Frame has been sent to GUI in acquisition thread or in last stage
+            if (IsFeedDone(m_stageRunners.size()) && m_fpsLimiter)
             {
                 // Pass null frame to FPS limiter for later processing in GUI
                 // to let GUI know that disk thread is still working
                 m_fpsLimiter->InputNewFrame(nullptr);
             }
+            m_toBeSavedFramesStats.ReportFrameAcquired();
         }
-        m_toBeSavedFramesStats.ReportFrameAcquired();
 
-        const bool doSaveFirst = saveFirst > 0 && frameIndex < saveFirst;
+        if (usePreTrigger && captureCount == 0)
+        {
+            // No disk I/O until trigger, once the ring is full the oldest
+            // frame is replaced and returns to the pool
+            const size_t tail =
+                (preTriggerHead + preTriggerCount) % preTriggerRing.size();
+            preTriggerRing[tail] = frame;
+            if (preTriggerCount < preTriggerRing.size())
+                preTriggerCount++;
+            else
+                preTriggerHead = (preTriggerHead + 1) % preTriggerRing.size();
+            m_preTriggerFrames = preTriggerCount;
+
+            if (m_preTriggerFlag.exchange(false))
+            {
+                captureCount = preTriggerCount + savePostTrigger;
+                captureIndex = 0;
+                captureNumber++;
+                Log::LogI("Capture %zu triggered, saving %zu kept and %zu following frames",
+                        captureNumber, preTriggerCount, savePostTrigger);
+            }
+
+            frameIndex++;
+            continue;
+        }
+
+        // In pre-trigger mode only frames of triggered capture get here
+        const bool doSaveCapture = usePreTrigger;
+        const bool doSaveFirst =
+            !doSaveCapture && saveFirst > 0 && frameIndex < saveFirst;
         const bool doSaveLast = saveLast > 0 && frameIndex >= frameCount - saveLast;
-        const bool doSaveAll = (saveFirst == 0 && saveLast == 0)
-            || (!isAcqModeLive && saveFirst >= frameCount - saveLast);
-        const bool doSave = doSaveFirst || doSaveLast || doSaveAll;
+        const bool doSaveAll = !doSaveCapture
+            && ((saveFirst == 0 && saveLast == 0)
+                || (!isAcqModeLive && saveFirst >= frameCount - saveLast));
+        const bool doSave = doSaveFirst || doSaveLast || doSaveAll || doSaveCapture;
 
         if (storageType != StorageType::None && doSave)
         {
@@ -1155,7 +1674,12 @@ void pm::Acquisition::DiskThreadLoopWriter()
 
             if (saveAsStack)
             {
-                if (doSaveFirst || doSaveAll)
+                if (doSaveCapture)
+                {
+                    fileIndex = captureIndex / maxFramesPerFile;
+                    frameIndexInFile = captureIndex % maxFramesPerFile;
+                }
+                else if (doSaveFirst || doSaveAll)
                 {
                     fileIndex = frameIndex / maxFramesPerFile;
                     frameIndexInFile = frameIndex % maxFramesPerFile;
@@ -1173,22 +1697,29 @@ void pm::Acquisition::DiskThreadLoopWriter()
                 frameIndexInFile = 0;
             }
             
-            // First frame in new file, close previous file and open new one
+            DiskWriterItem item;
+            item.frame = frame;
+            item.frameIndex = (doSaveCapture) ? captureIndex : frameIndex;
+
+            // First frame in new file, create it for next writer, the writer
+            // closes its previous file and opens the new one
             if (frameIndexInFile == 0)
             {
-                // Close previous file if some open
-                if (file)
-                {
-                    file->Close();
-                    delete file;
-                    file = nullptr;
-                }
+                writerIndex = fileCount++ % m_diskWriters.size();
+                DiskWriter& writer = *m_diskWriters[writerIndex];
+
+                FileSave* file = nullptr;
 
                 fileName = fileDir;
                 if (saveAsStack)
                 {
                     size_t saveCount;
-                    if (doSaveAll)
+                    if (doSaveCapture)
+                    {
+                        saveCount = captureCount;
+                        fileName += "ss_stack_trig" + std::to_string(captureNumber) + "_";
+                    }
+                    else if (doSaveAll)
                     {
                         saveCount = frameCount;
                         fileName += "ss_stack_";
@@ -1227,69 +1758,115 @@ void pm::Acquisition::DiskThreadLoopWriter()
                 {
                 case StorageType::Prd:
                     fileName += ".prd";
-                    file = new(std::nothrow) PrdFileSave(fileName, prdHeader, allocator);
+                    file = new(std::nothrow) PrdFileSave(fileName, prdHeader,
+                            allocator, ioQueueDepth);
                     break;
                 case StorageType::Tiff:
                 case StorageType::BigTiff:
                     fileName += ".tiff";
                     file = new(std::nothrow) TiffFileSave(fileName, prdHeader,
-                            &m_tiffHelper, storageType == StorageType::BigTiff);
+                            writer.tiffHelper, storageType == StorageType::BigTiff);
                     break;
                 case StorageType::None:
                     break;
                 // No default section, compiler will complain when new format added
                 }
 
-                // Open the file
-                if (!file || !file->Open())
+                if (!file)
                 {
-                    Log::LogE("Error in opening file '%s' for frame with index %zu",
+                    Log::LogE("Error in creating file '%s' for frame with index %zu",
                             fileName.c_str(), frameIndex);
                     keepGoing = false;
-
-                    delete file;
-                    file = nullptr;
                 }
+                item.file.reset(file);
             }
 
-            // If file is open store current frame in it
-            if (file)
+            if (keepGoing)
             {
-#ifdef PM_PRINT_WRITE_STATS
-                sWriteTimer.Reset();
-#endif
-
-                if (!file->WriteFrame(frame))
+                DiskWriter& writer = *m_diskWriters[writerIndex];
+                if (!writer.thread)
                 {
-                    Log::LogE("Error in writing RAW data to '%s' for frame with index %zu",
-                            fileName.c_str(), frameIndex);
-                    keepGoing = false;
+                    keepGoing = DiskWriterHandleItem(writer, item);
                 }
                 else
                 {
-                    m_toBeSavedFramesSaved++;
+                    // Counted before push so the frame is never out of limit
+                    m_diskWritersPendingFrames++;
+                    if (!writer.queue.Push(item))
+                    {
+                        m_diskWritersPendingFrames--;
+                        Log::LogE("Error in queuing frame with index %zu for writing",
+                                frameIndex);
+                        keepGoing = false;
+                    }
                 }
-
-#ifdef PM_PRINT_WRITE_STATS
-                sWriteTimeSec += sWriteTimer.Seconds();
-                sWriteCount++;
-#endif
             }
         }
 
+        if (doSaveCapture && ++captureIndex == captureCount)
+        {
+            // Triggers during the capture are ignored, wait for new one
+            captureCount = 0;
+            m_preTriggerFlag = false;
+            Log::LogI("Capture %zu saved", captureNumber);
+        }
+
         if (!keepGoing)
             RequestAbort();
 
         frameIndex++;
     }
 
-    // Just to be sure, close last file if remained open
-    if (file)
+    if (usePreTrigger)
     {
-        file->Close();
-        delete file;
+        m_preTriggerActiveFlag = false;
+        if (captureCount > 0)
+        {
+            Log::LogW("Capture %zu incomplete, only %zu of %zu frames saved",
+                    captureNumber, captureIndex, captureCount);
+        }
+        // Frames kept in RAM are dropped without saving
+        preTriggerRing.clear();
+        m_preTriggerFrames = 0;
     }
 
+    // Stages are done or aborted, they finish right after acquisition
+    for (auto& runner : m_stageRunners)
+    {
+        if (runner->thread)
+        {
+            runner->queue.WakeUp();
+            if (runner->thread->joinable())
+                runner->thread->join();
+            delete runner->thread;
+            runner->thread = nullptr;
+        }
+    }
+
+    // Let writers finish queued frames, on abort they stop right away
+    m_diskWritersFeedDoneFlag = true;
+    for (auto& writer : m_diskWriters)
+    {
+        if (writer->thread)
+        {
+            writer->queue.WakeUp();
+            if (writer->thread->joinable())
+                writer->thread->join();
+            delete writer->thread;
+            writer->thread = nullptr;
+        }
+        else if (writer->file)
+        {
+            // Just to be sure, close last file if remained open
+            writer->file->Close();
+            writer->file = nullptr;
+        }
+    }
+
+    // Keep unprocessed frames only, DiskThreadLoop may need them on abort
+    m_toBeSavedFramesBatch.erase(m_toBeSavedFramesBatch.begin(),
+            m_toBeSavedFramesBatch.begin() + batchIndex);
+
 #ifdef PM_PRINT_WRITE_STATS
     if (sWriteCount > 0)
     {
@@ -1312,8 +1889,211 @@ void pm::Acquisition::DiskThreadLoopWriter()
 #endif
 }
 
+void pm::Acquisition::StageThreadLoop(size_t stageIndex)
+{
+    StageRunner& runner = *m_stageRunners[stageIndex];
+    const bool isLastStage = stageIndex + 1 == m_stageRunners.size();
+
+    PinCurrentThread("stage", m_camera->GetSettings().GetCpusWorkers());
+
+    runner.batch.clear();
+    runner.batch.reserve(cDiskThreadBatchMaxFrames);
+
+    while (!m_diskThreadAbortFlag)
+    {
+        // Read the flag before the queue, producer sets it after last push
+        const bool feedDone = IsFeedDone(stageIndex);
+
+        // Take all ready frames at once, up to the limit
+        if (runner.queue.PopBatch(runner.batch, cDiskThreadBatchMaxFrames) == 0)
+        {
+            // There are no queued frames and producer has finished, stop this thread
+            if (feedDone)
+                break;
+
+            runner.queue.WaitForItems([this, stageIndex]() {
+                return m_diskThreadAbortFlag || IsFeedDone(stageIndex);
+            });
+            continue;
+        }
+
+        bool keepGoing = true;
+
+        size_t batchIndex = 0;
+        while (batchIndex < runner.batch.size() && !m_diskThreadAbortFlag)
+        {
+            std::shared_ptr<Frame> frame = std::move(runner.batch[batchIndex++]);
+
+            const double processStart = m_toBeProcessedFramesTimer.Seconds();
+            runner.queueLatency.Record(processStart - frame->GetQueuedTime());
+
+            if (!runner.stage->ProcessFrame(frame))
+            {
+                Log::LogE("Stage '%s' failed to process frame nr. %u",
+                        runner.stage->GetName().c_str(),
+                        frame->GetInfo().GetFrameNr());
+                keepGoing = false;
+                break;
+            }
+            runner.processLatency.Record(
+                    m_toBeProcessedFramesTimer.Seconds() - processStart);
+            runner.stats.ReportFrameAcquired();
+
+            // Frames are displayed with results from all stages
+            if (isLastStage && m_fpsLimiter)
+            {
+                m_fpsLimiter->InputNewFrame(frame);
+            }
+
+            QueueFrame(stageIndex + 1, frame);
+        }
+
+        // Keep unprocessed frames only, DiskThreadLoop may need them on abort
+        runner.batch.erase(runner.batch.begin(),
+                runner.batch.begin() + batchIndex);
+
+        if (!keepGoing)
+        {
+            RequestAbort();
+            break;
+        }
+    }
+
+    runner.doneFlag = true;
+
+    // Wake next stage or disk waiter, it might wait for the flag
+    WakeConsumer(stageIndex + 1);
+}
+
+void pm::Acquisition::DiskWriterThreadLoop(DiskWriter* writer)
+{
+    PinCurrentThread("disk writer", m_camera->GetSettings().GetCpusDisk());
+
+    writer->batch.clear();
+    writer->batch.reserve(cDiskThreadBatchMaxFrames);
+
+    while (!m_diskThreadAbortFlag)
+    {
+        // Read the flag before the queue, disk thread sets it after last push
+        const bool feedDone = m_diskWritersFeedDoneFlag;
+
+        // Take all ready frames at once, up to the limit
+        if (writer->queue.PopBatch(writer->batch, cDiskThreadBatchMaxFrames) == 0)
+        {
+            // There are no queued frames and disk thread has finished, stop this thread
+            if (feedDone)
+                break;
+
+            writer->queue.WaitForItems([this]() {
+                return m_diskThreadAbortFlag || m_diskWritersFeedDoneFlag;
+            });
+            continue;
+        }
+
+        size_t batchIndex = 0;
+        while (batchIndex < writer->batch.size() && !m_diskThreadAbortFlag)
+        {
+            DiskWriterItem& item = writer->batch[batchIndex++];
+            const bool keepGoing = DiskWriterHandleItem(*writer, item);
+
+            // Return the frame to pool before it's removed from RAM usage
+            item = DiskWriterItem();
+            m_diskWritersPendingFrames--;
+
+            if (!keepGoing)
+            {
+                RequestAbort();
+                break;
+            }
+        }
+
+        // Keep unprocessed items only, DiskThreadLoop may need them on abort
+        writer->batch.erase(writer->batch.begin(),
+                writer->batch.begin() + batchIndex);
+    }
+
+    // Close last file if remained open
+    if (writer->file)
+    {
+        writer->file->Close();
+        writer->file = nullptr;
+    }
+}
+
+bool pm::Acquisition::DiskWriterHandleItem(DiskWriter& writer,
+        DiskWriterItem& item)
+{
+    // First frame in new file, close previous file and open new one
+    if (item.file)
+    {
+        if (writer.file)
+        {
+            writer.file->Close();
+        }
+        writer.file = std::move(item.file);
+
+        if (!writer.file->Open())
+        {
+            Log::LogE("Error in opening file '%s' for frame with index %zu",
+                    writer.file->GetFileName().c_str(), item.frameIndex);
+            writer.file = nullptr;
+            return false;
+        }
+    }
+
+    // If file is open store current frame in it
+    if (!writer.file)
+        return true;
+
+    // Zero-copy frame could be overwritten by camera while waiting in queues,
+    // deep copies come from spill file
+    const uint32_t frameNr = item.frame->GetInfo().GetFrameNr();
+    const bool isShallow = !item.frame->UsesDeepCopy();
+    if (isShallow && IsFrameOverwritten(frameNr))
+    {
+        m_overwrittenFrameCount++;
+        return true;
+    }
+
+#ifdef PM_PRINT_WRITE_STATS
+    Timer writeTimer;
+#endif
+
+    const double writeStart = m_toBeProcessedFramesTimer.Seconds();
+
+    if (!writer.file->WriteFrame(item.frame))
+    {
+        Log::LogE("Error in writing RAW data to '%s' for frame with index %zu",
+                writer.file->GetFileName().c_str(), item.frameIndex);
+        return false;
+    }
+    m_toBeSavedFramesSaved++;
+
+    const double writeEnd = m_toBeProcessedFramesTimer.Seconds();
+    writer.writeLatency.Record(writeEnd - writeStart);
+    writer.totalLatency.Record(writeEnd - item.frame->GetArrivalTime());
+
+    // Or even while being written, the file contains corrupted frame then
+    if (isShallow && IsFrameOverwritten(frameNr))
+    {
+        m_overwrittenFrameCount++;
+    }
+
+#ifdef PM_PRINT_WRITE_STATS
+    {
+        std::lock_guard<std::mutex> lock(sWriteMutex);
+        sWriteTimeSec += writeTimer.Seconds();
+        sWriteCount++;
+    }
+#endif
+
+    return true;
+}
+
 void pm::Acquisition::UpdateThreadLoop()
 {
+    PinCurrentThread("update", m_camera->GetSettings().GetCpusAux());
+
     const std::vector<std::string> progress{ "|", "/", "-", "\\" };
     size_t progressIndex = 0;
     size_t maxRefreshCounter = 0;
@@ -1336,9 +2116,11 @@ void pm::Acquisition::UpdateThreadLoop()
         if (m_acqThreadDoneFlag && m_diskThreadDoneFlag)
             break;
 
-        // Don't update limits too often
+        // Don't update limits too often, unless in cgroup with memory limit
+        // where reaching the limit kills the process instead of swapping
         maxRefreshCounter++;
-        if ((maxRefreshCounter % 8 == 0) && !m_acqThreadDoneFlag)
+        const size_t maxRefreshPeriod = (m_memBudget.IsCgroupLimited()) ? 1 : 8;
+        if ((maxRefreshCounter % maxRefreshPeriod == 0) && !m_acqThreadDoneFlag)
         {
             UpdateToBeSavedFramesMax();
         }
@@ -1361,9 +2143,13 @@ void pm::Acquisition::UpdateThreadLoop()
         ss << ", " << m_toBeSavedFramesStats.GetFramesTotal() << " queued";
         if (m_toBeSavedFramesStats.GetFramesLost() > 0)
             ss << " (" << m_toBeSavedFramesStats.GetFramesLost() << " dropped)";
+        if (m_spilledFrameCount > 0)
+            ss << " (" << m_spilledFrameCount << " spilled)";
 
         ss << ", " << m_toBeSavedFramesStats.GetFramesAcquired() << " processed";
         ss << ", " << m_toBeSavedFramesSaved << " saved";
+        if (m_memBudget.IsCgroupLimited())
+            ss << ", " << (m_memBudget.GetHeadroomBytes() >> 20) << "MiB free";
 
         if (m_diskThreadAbortFlag)
             ss << ", aborting...";
@@ -1395,7 +2181,11 @@ void pm::Acquisition::PrintAcqThreadStats() const
         << "\n  Longest series of dropped frames = " << m_uncaughtFrames.GetLargestCluster()
         << "\n  Max. used frames = " << m_toBeProcessedFramesStats.GetQueueSizePeak()
         << " out of " << m_toBeProcessedFramesStats.GetQueueCapacity()
+        << "\n  Avg. frame handoff time = "
+            << m_toBeProcessedFramesStats.GetAvgHandoffTime() * 1e6 << " us (max. "
+            << m_toBeProcessedFramesStats.GetMaxHandoffTime() * 1e6 << " us)"
         << "\n  Acquisition ran with " << fps << " fps (" << MiBps << " MiB/s)";
+    PrintLatency(ss, "Callback to acquisition thread", m_callbackLatency);
     if (m_outOfOrderFrameCount > 0)
     {
         ss << "\n  " << m_outOfOrderFrameCount
@@ -1406,6 +2196,36 @@ void pm::Acquisition::PrintAcqThreadStats() const
     Log::LogI(ss.str());
 }
 
+void pm::Acquisition::PrintStageStats() const
+{
+    for (auto& runner : m_stageRunners)
+    {
+        const AcquisitionStats& stats = runner->stats;
+        const ListStatistics<size_t>& droppedFrames = runner->droppedFrames;
+
+        const size_t frameCount = stats.GetFramesTotal();
+        const double frameDropsPercent = (frameCount > 0)
+            ? ((double)droppedFrames.GetCount() / (double)frameCount) * 100
+            : 0.0;
+        const double fps = stats.GetOverallFrameRate();
+
+        std::ostringstream ss;
+        ss << "Stage '" << runner->stage->GetName() << "' queue stats:"
+            << "\n  Frame count = " << frameCount
+            << "\n  Frame drops = " << droppedFrames.GetCount()
+                << " (" << frameDropsPercent << " %)"
+            << "\n  Average # frames between drops = " << droppedFrames.GetAvgSpacing()
+            << "\n  Longest series of dropped frames = " << droppedFrames.GetLargestCluster()
+            << "\n  Max. used frames = " << stats.GetQueueSizePeak()
+            << "\n  Processing ran with " << fps << " fps";
+        PrintLatency(ss, "Queue", runner->queueLatency);
+        PrintLatency(ss, "Processing", runner->processLatency);
+        ss << "\n";
+
+        Log::LogI(ss.str());
+    }
+}
+
 void pm::Acquisition::PrintDiskThreadStats() const
 {
     const size_t frameCount = m_toBeSavedFramesStats.GetFramesTotal();
@@ -1426,7 +2246,44 @@ void pm::Acquisition::PrintDiskThreadStats() const
         << "\n  Max. used frames = " << m_toBeSavedFramesStats.GetQueueSizePeak()
         // Queue capacity could be less than current peak which would confuse users
         //<< " out of " << m_toBeSavedFramesStats.GetQueueCapacity()
-        << "\n  Processing ran with " << fps << " fps (" << MiBps << " MiB/s)\n";
+        << "\n  Min. free RAM for frames = "
+            << (m_memBudget.GetMinHeadroomBytes() >> 20) << " MiB";
+    if (m_memBudget.IsCgroupLimited())
+    {
+        ss << " (cgroup limit " << (m_memBudget.GetCgroupLimitBytes() >> 20)
+            << " MiB)";
+    }
+    ss << "\n  Processing ran with " << fps << " fps (" << MiBps << " MiB/s)";
+
+    // Writers record in own threads, merge them now they are finished
+    LatencyHistogram writeLatency;
+    LatencyHistogram totalLatency;
+    for (auto& writer : m_diskWriters)
+    {
+        writeLatency.Add(writer->writeLatency);
+        totalLatency.Add(writer->totalLatency);
+    }
+    PrintLatency(ss, "Queue", m_toBeSavedFramesLatency);
+    PrintLatency(ss, "Write", writeLatency);
+    PrintLatency(ss, "End-to-end", totalLatency);
+
+    if (m_overwrittenFrameCount > 0)
+    {
+        ss << "\n  " << m_overwrittenFrameCount
+            << " frames overwritten in camera buffer before processed or saved";
+    }
+    if (m_spilledFrameCount > 0)
+    {
+        const size_t spilledBytes =
+            m_spilledFrameCount * m_camera->GetFrameAcqCfg().GetFrameBytes();
+        const double spilledMiB = round(spilledBytes * 10.0 / 1024 / 1024) / 10.0;
+        ss << "\n  Spilled frames = " << m_spilledFrameCount
+                << " (" << spilledMiB << " MiB)"
+            << "\n  Max. spilled frames at once = " << m_spilledFramesPeak;
+        // On abort not all spilled frames are read back
+        PrintLatency(ss, "Spill drain", m_spillDrainLatency);
+    }
+    ss << "\n";
 
     Log::LogI(ss.str());
 }
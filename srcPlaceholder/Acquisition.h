@@ -7,25 +7,28 @@
 
 /* Local */
 #include "backend/AcquisitionStats.h"
+#include "backend/FileSave.h"
 #include "backend/FpsLimiter.h"
 #include "backend/Frame.h"
 #include "backend/FramePool.h"
 #include "backend/FrameProcessor.h"
+#include "backend/FrameStage.h"
+#include "backend/LatencyHistogram.h"
 #include "backend/ListStatistics.h"
+#include "backend/MemoryBudget.h"
 #include "backend/PrdFileFormat.h"
+#include "backend/SpillFile.h"
+#include "backend/SpscQueue.h"
+#include "backend/SpscRing.h"
 #include "backend/TiffFileSave.h"
 #include "backend/Timer.h"
 
-
-/* pvcam_helper_track */
-#include "pvcam_helper_track.h"
-
 /* System */
 #include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <vector>
 
 namespace std
 {
@@ -42,7 +45,6 @@ struct ph_color_context;
 namespace pm {
 
 class Camera;
-class ParticleLinker;
 
 class Acquisition
 {
@@ -69,12 +71,98 @@ public:
     /* Blocks until the acquisition completes or reacts to abort request.
        Return true if stopped due to abort request. */
     bool WaitForStop(bool printStats = false);
+    /* Triggers pre-trigger capture, frames kept in RAM are saved together
+       with following frames, see option --save-pre-trigger.
+       Returns false if the capture is not enabled or acquisition not running.
+       It only sets a flag, it is safe to call it from signal handler. */
+    bool TriggerCapture();
 
     // Returns acquisition related statistics
     const AcquisitionStats& GetAcqStats() const;
     // Returns storage/processing related statistics
     const AcquisitionStats& GetDiskStats() const;
 
+    // Adds custom frame processing stage. Stages run after built-in ones
+    // (particle tracking) in order they were added.
+    // Returns false if acquisition is running.
+    bool AddFrameStage(std::shared_ptr<FrameStage> stage);
+    // Removes all custom stages, returns false if acquisition is running
+    bool RemoveFrameStages();
+    // Returns number of stages used by last or current acquisition
+    size_t GetFrameStageCount() const;
+    // Returns statistics of stage with given index, see GetFrameStageCount
+    const AcquisitionStats& GetFrameStageStats(size_t index) const;
+
+private:
+    // Frame with its file assignment, queued by disk thread for a writer
+    struct DiskWriterItem
+    {
+        std::shared_ptr<Frame> frame{ nullptr };
+        // Absolute frame index in saving sequence, used in error messages
+        size_t frameIndex{ 0 };
+        // New file that starts with this frame, not open yet.
+        // Null if the frame is appended to the file open in writer.
+        std::unique_ptr<FileSave> file{ nullptr };
+    };
+
+    // Writes whole files assigned by disk thread, one file at a time
+    struct DiskWriter
+    {
+        ~DiskWriter();
+
+        // Null if the disk thread does the writing itself
+        std::thread* thread{ nullptr };
+        // Frames to be written, the disk thread is the only producer
+        SpscQueue<DiskWriterItem> queue{};
+        // Items taken from queue at once but not processed yet
+        std::vector<DiskWriterItem> batch{};
+        // The file currently open for writing
+        std::unique_ptr<FileSave> file{ nullptr };
+        // Either points to m_tiffHelper or to ownTiffHelper, frame
+        // processing and color context cannot be shared between threads
+        TiffFileSave::Helper* tiffHelper{ nullptr };
+        TiffFileSave::Helper ownTiffHelper{};
+        FrameProcessor ownTiffFrameProc{};
+        // Time spent in FileSave::WriteFrame
+        LatencyHistogram writeLatency{};
+        // Time from frame arrival in callback till written
+        LatencyHistogram totalLatency{};
+    };
+
+    // Runs one FrameStage in own thread, fed by previous stage or acq thread
+    struct StageRunner
+    {
+        ~StageRunner();
+
+        std::shared_ptr<FrameStage> stage{ nullptr };
+        std::thread* thread{ nullptr };
+        // Frames to be processed, the previous stage is the only producer
+        SpscQueue<std::shared_ptr<Frame>> queue{};
+        // Frames taken from queue at once but not processed yet
+        std::vector<std::shared_ptr<Frame>> batch{};
+        // Statistics with processed & dropped frames and queue usage
+        AcquisitionStats stats{};
+        // Numbers of frames dropped due to full queue, used by producer only
+        ListStatistics<size_t> droppedFrames{};
+        // Time frames spent in queue and in FrameStage::ProcessFrame
+        LatencyHistogram queueLatency{};
+        LatencyHistogram processLatency{};
+        // Set by stage thread once it won't queue any more frames
+        std::atomic<bool> doneFlag{ false };
+    };
+
+    // Frame stored in m_spillFile, only the data is not kept in RAM
+    struct SpillRecord
+    {
+        Frame::Info info{};
+        std::shared_ptr<const Frame::Trajectories> trajectories{};
+        // Offset of frame data in m_spillFile
+        uint64_t offset{ 0 };
+        // Frame timestamps, see Frame::GetArrivalTime
+        double arrivalTime{ 0.0 };
+        double queuedTime{ 0.0 };
+    };
+
 private:
     static void PV_DECL EofCallback(FRAME_INFO* frameInfo,
             void* Acquisition_pointer);
@@ -84,8 +172,21 @@ private:
     bool HandleEofCallback(FRAME_INFO* frameInfo);
     // Called from AcqThreadLoop to handle new frame
     bool HandleNewFrame(std::shared_ptr<Frame> frame);
-    // Tracks particles and updates trajectories points
-    bool TrackNewFrame(std::shared_ptr<Frame> frame);
+    // Creates runners for built-in and custom stages and starts the stages
+    bool ConfigureFrameStages();
+    // Queues frame for stage with given index or for saving if the index is
+    // past the last stage. Called from the only producer of that queue.
+    void QueueFrame(size_t stageIndex, std::shared_ptr<Frame> frame);
+    // Returns true if producer of queue for given stage (or saving) is done
+    bool IsFeedDone(size_t stageIndex) const;
+    // Wakes consumer of queue for given stage (or saving)
+    void WakeConsumer(size_t stageIndex);
+    // Called for each frame returned to m_unusedFramesPool, unpins the camera
+    // buffer slot referenced by shallow frame
+    void UnpinFrame(Frame& frame);
+    // Returns true if the camera might have overwritten data of shallow frame
+    // with given number, see m_checkOverwrittenFrames
+    bool IsFrameOverwritten(uint32_t frameNr) const;
 
     // Updates max. allowed number of frames in queue to be saved
     void UpdateToBeSavedFramesMax();
@@ -93,6 +194,15 @@ private:
     bool PreallocateUnusedFrames(int framePoolOps = FramePool::Ops::None);
     // Configures how frames will be stored on disk
     bool ConfigureStorage();
+    // Creates scratch file for frames that don't fit in RAM if enabled
+    bool ConfigureSpillFile();
+    // Restricts threads living longer than acquisition to configured CPUs
+    void ConfigureThreadAffinity();
+    // Stores frame to m_spillFile, called from producer of m_toBeSavedFrames
+    bool SpillFrame(const Frame& frame);
+    // Takes the oldest spilled frame, with data read back if readData is true.
+    // The frame is null if there is none. Returns false on failure.
+    bool UnspillFrame(std::shared_ptr<Frame>& frame, bool readData);
 
     // The function performs in m_acqThread, caches frames from camera
     void AcqThreadLoop();
@@ -100,10 +210,22 @@ private:
     void DiskThreadLoop();
     // Called from DiskThreadLoop, now for both, one frame per file and stacked frames
     void DiskThreadLoopWriter();
+    // The function performs in StageRunner::thread, processes frames in stage
+    void StageThreadLoop(size_t stageIndex);
+    // The function performs in DiskWriter::thread, writes frames to assigned files
+    void DiskWriterThreadLoop(DiskWriter* writer);
+    // Opens new file if any and stores frame to it, returns false on failure
+    bool DiskWriterHandleItem(DiskWriter& writer, DiskWriterItem& item);
+    // Creates writers with own TIFF helper configured the same way as m_tiffHelper
+    bool ConfigureDiskWriters();
+    // Returns number of frames queued for saving incl. those passed to writers
+    // and those queued for stages
+    size_t GetToBeSavedFramesCount() const;
     // The function performs in m_updateThread, saves frames to disk
     void UpdateThreadLoop();
 
     void PrintAcqThreadStats() const;
+    void PrintStageStats() const;
     void PrintDiskThreadStats() const;
 
 private:
@@ -143,24 +265,24 @@ private:
     // Time taken to finish saving, zero if in progress
     double m_diskTime{ 0.0 };
 
-    uint32_t m_lastFrameNumberInCallback{ 0 };
+    // Atomic as it is read in other threads by IsFrameOverwritten
+    std::atomic<uint32_t> m_lastFrameNumberInCallback{ 0 };
     uint32_t m_lastFrameNumberInHandling{ 0 };
 
-    // Cached value so we don't check settings with every frame
-    bool m_trackEnabled{ false };
-    PH_TRACK_CONTEXT m_trackContext{ PH_TRACK_CONTEXT_INVALID };
-    uns32 m_trackMaxParticles{ 0 };
-    ph_track_particle* m_trackParticles{ nullptr };
-    ParticleLinker* m_trackLinker{ nullptr };
-
     uint32_t m_expTimeRes{ EXP_RES_ONE_MILLISEC };
-    uint16_t m_centroidsRadius{ 1 };
 
     TiffFileSave::Helper m_tiffHelper{};
     FrameProcessor m_tiffFrameProc{};
 
     std::atomic<size_t> m_outOfOrderFrameCount{ 0 };
 
+    // True in zero-copy mode with camera that doesn't honor pinned frames
+    bool m_checkOverwrittenFrames{ false };
+    // Cached value so we don't check settings with every frame
+    uint32_t m_bufferFrameCount{ 0 };
+    // Frames dropped because camera overwrote them before saved
+    std::atomic<size_t> m_overwrittenFrameCount{ 0 };
+
     // Mutex that guards all non-atomic m_updateThread* variables
     std::mutex              m_updateThreadMutex{};
     // Condition the update thread waits on for new update iteration
@@ -171,38 +293,93 @@ private:
        1. In callback handler thread is:
           - taken one frame from m_unusedFramesPool
           - stored frame info and pointer to data (shallow copy only) in frame
+          - pinned camera buffer slot if frames are not deep copied
           - frame put to m_toBeProcessedFrames queue
        2. In acquisition thread is:
-          - made deep copy of frame's data
+          - made deep copy of frame's data (skipped in zero-copy mode)
           - done check for lost frames
-          - frame moved to m_toBeSavedFrames queue
-       3. In disk thread is:
-          - tracked frame trajectory
-          - frame stored to disk in chosen format
-          - frame moved back to m_unusedFramesPool
+          - frame moved to queue of first stage in m_stageRunners if any,
+            otherwise to m_toBeSavedFrames queue
+       3. In each stage thread is:
+          - frame processed, e.g. tracked frame trajectory
+          - frame moved to queue of next stage or to m_toBeSavedFrames queue
+       In both cases a frame that doesn't fit in RAM for saving is stored to
+       m_spillFile instead, if enabled.
+       4. In disk thread is:
+          - frame read back from m_spillFile once m_toBeSavedFrames is empty
+          - with pre-trigger capture frame kept in RAM until triggered
+          - assigned file name and index within the file
+          - frame stored to disk in chosen format, or passed to one of
+            m_diskWriters that owns the file
+          - frame moved back to m_unusedFramesPool, slot unpinned if any
     */
 
-    // Frames captured in callback thread to be processed in acquisition thread
-    std::queue<std::shared_ptr<Frame>>  m_toBeProcessedFrames{};
-    // Mutex that guards all non-atomic m_toBeProcessed* variables
-    std::mutex                          m_toBeProcessedFramesMutex{};
-    // Condition the acquisition thread waits on for new frame
-    std::condition_variable             m_toBeProcessedFramesCond{};
+    // Frames captured in callback thread to be processed in acquisition thread.
+    // Lock-free, the acquisition thread spins a while and then parks on it.
+    SpscRing<std::shared_ptr<Frame>>    m_toBeProcessedFrames{};
+    // Used to measure time spent in callback thread per frame, also the clock
+    // for frame timestamps in the whole pipeline
+    Timer                               m_toBeProcessedFramesTimer{};
+    // Time from frame arrival in callback till taken by acquisition thread
+    LatencyHistogram                    m_callbackLatency{};
     // Acquisition statistics with captured & lost frames and queue usage
     AcquisitionStats                    m_toBeProcessedFramesStats{};
 
-    // Frames queued in acquisition thread to be saved to disk
-    std::queue<std::shared_ptr<Frame>>  m_toBeSavedFrames{};
-    // Mutex that guards all non-atomic m_toBeSavedFrames* variables
-    std::mutex                          m_toBeSavedFramesMutex{};
-    // Condition the frame saving thread waits on for new frame
-    std::condition_variable             m_toBeSavedFramesCond{};
+    // Frames queued in acquisition thread to be saved to disk.
+    // Lock-free, the disk thread spins a while and then parks on it.
+    SpscQueue<std::shared_ptr<Frame>>   m_toBeSavedFrames{};
+    // Frames taken from m_toBeSavedFrames at once but not processed yet,
+    // used by disk thread only
+    std::vector<std::shared_ptr<Frame>> m_toBeSavedFramesBatch{};
     // Acquisition statistics with queued & dropped frames and queue usage
     AcquisitionStats                    m_toBeSavedFramesStats{};
+    // Time frames spent in queue (or spill file) till taken by disk thread
+    LatencyHistogram                    m_toBeSavedFramesLatency{};
 
     // Holds how many queued frames have been saved to disk
     std::atomic<size_t>                 m_toBeSavedFramesSaved{ 0 };
 
+    // Set by disk thread while it keeps frames for pre-trigger capture
+    std::atomic<bool>                   m_preTriggerActiveFlag{ false };
+    // Set by TriggerCapture, cleared by disk thread once capture started
+    std::atomic<bool>                   m_preTriggerFlag{ false };
+    // Frames kept in RAM by disk thread until the capture is triggered
+    std::atomic<size_t>                 m_preTriggerFrames{ 0 };
+
+    // Writers the disk thread distributes files to, the first one reuses
+    // m_tiffHelper. With one writer only the disk thread writes by itself.
+    std::vector<std::unique_ptr<DiskWriter>> m_diskWriters{};
+    // Frames passed to writers but not written yet
+    std::atomic<size_t>                 m_diskWritersPendingFrames{ 0 };
+    // Set by disk thread once it won't queue any more frames for writers
+    std::atomic<bool>                   m_diskWritersFeedDoneFlag{ false };
+
+    // Custom stages added via AddFrameStage
+    std::vector<std::shared_ptr<FrameStage>> m_customStages{};
+    // Stages frames go through before saving, built in Start, the stage
+    // threads are started and joined by disk thread
+    std::vector<std::unique_ptr<StageRunner>> m_stageRunners{};
+
+    // Scratch file for frames that don't fit in RAM, null if disabled
+    std::unique_ptr<SpillFile>          m_spillFile{ nullptr };
+    // Frames stored in m_spillFile, all are newer than any frame queued in
+    // m_toBeSavedFrames
+    SpscQueue<SpillRecord>              m_spilledFrames{};
+    // Spilled frames not read back yet incl. the one being read. Frames are
+    // spilled until it drops to zero, otherwise they would get out of order.
+    std::atomic<size_t>                 m_spillPendingFrames{ 0 };
+    // Offset for next spilled frame, used by producer only
+    uint64_t                            m_spillWriteOffset{ 0 };
+    // Deep-copy frames the spilled data is read back to
+    FramePool                           m_spilledFramesPool{};
+    // Spill statistics, the drain time is the time spent by frame in file
+    std::atomic<size_t>                 m_spilledFrameCount{ 0 };
+    size_t                              m_spilledFramesPeak{ 0 };
+    LatencyHistogram                    m_spillDrainLatency{};
+
+    // RAM that can be still used for queued frames, honors cgroup limits
+    MemoryBudget                        m_memBudget{};
+
     // Unused but allocated frames to be re-used
     FramePool m_unusedFramesPool{};
 };
@@ -13,6 +13,10 @@ void pm::AcquisitionStats::Reset()
     m_framesAcquired = 0;
     m_framesLost = 0;
 
+    m_handoffCount = 0;
+    m_handoffTimeSum = 0.0;
+    m_handoffTimeMax = 0.0;
+
     m_firstFrameTime = 0.0;
     m_firstFrameCount = 0;
 
@@ -84,6 +88,26 @@ size_t pm::AcquisitionStats::GetFramesTotal() const
     return m_framesAcquired + m_framesLost;
 }
 
+void pm::AcquisitionStats::ReportHandoffTime(double seconds)
+{
+    m_handoffCount += 1;
+    m_handoffTimeSum += seconds;
+    if (m_handoffTimeMax < seconds)
+    {
+        m_handoffTimeMax = seconds;
+    }
+}
+
+double pm::AcquisitionStats::GetAvgHandoffTime() const
+{
+    return (m_handoffCount > 0) ? (m_handoffTimeSum / m_handoffCount) : 0.0;
+}
+
+double pm::AcquisitionStats::GetMaxHandoffTime() const
+{
+    return m_handoffTimeMax;
+}
+
 double pm::AcquisitionStats::GetFramePeriod() const
 {
     return m_framePeriod;
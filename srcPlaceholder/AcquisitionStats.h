@@ -36,6 +36,13 @@ public:
 
     size_t GetFramesTotal() const;
 
+    // Time spent by producer thread to hand one frame over, in seconds
+    void ReportHandoffTime(double seconds);
+    // Average value for all handoffs since last reset, in seconds
+    double GetAvgHandoffTime() const;
+    // Longest handoff since last reset, in seconds
+    double GetMaxHandoffTime() const;
+
     // For two consecutive frames, in seconds
     double GetFramePeriod() const;
     double GetFrameRate() const;
@@ -64,6 +71,13 @@ private:
     // Holds how many frames have been lost since last reset
     size_t m_framesLost{ 0 };
 
+    // Holds how many handoffs have been reported since last reset
+    size_t m_handoffCount{ 0 };
+    // Sum of all handoff times reported since last reset
+    double m_handoffTimeSum{ 0.0 };
+    // Longest handoff time reported since last reset
+    double m_handoffTimeMax{ 0.0 };
+
     Timer m_timer{};
 
     double m_firstFrameTime{ 0.0 };
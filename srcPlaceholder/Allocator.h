@@ -15,6 +15,15 @@ namespace pm {
 
 class Allocator
 {
+public:
+    // Honored by allocators that get memory directly from OS only
+    enum Flags : int
+    {
+        None     = 0,
+        Lock     = 1 << 0, // Keeps the memory in RAM, never swapped out
+        Prefault = 1 << 1, // Maps all pages on allocation
+    };
+
 protected:
     Allocator(AllocatorType type) : m_type(type) {}
 
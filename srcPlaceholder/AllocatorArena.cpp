@@ -0,0 +1,201 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/AllocatorArena.h"
+
+/* Local */
+#include "backend/AllocatorFactory.h"
+
+/* System */
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+// Slots never share cache line, not even with default allocator
+static constexpr size_t cMinSlotAlignment = 64;
+
+static size_t GetSlotBytes(size_t bytes, const pm::Allocator& upstream)
+{
+    const size_t alignment = std::max(cMinSlotAlignment,
+            pm::AllocatorFactory::GetAlignment(upstream));
+    return ((bytes + alignment - 1) / alignment) * alignment;
+}
+
+pm::AllocatorArena::AllocatorArena(std::shared_ptr<Allocator> upstream,
+        size_t slotBytes)
+    : Allocator(upstream->GetType()),
+    m_upstream(upstream),
+    m_slotBytes(::GetSlotBytes(slotBytes, *upstream))
+{
+    assert(m_slotBytes > 0);
+}
+
+pm::AllocatorArena::~AllocatorArena()
+{
+    // Whoever allocated slots holds shared_ptr to this allocator, all slots
+    // are free now
+    for (auto& chunk : m_chunks)
+    {
+        m_upstream->Free(chunk.begin);
+    }
+}
+
+std::shared_ptr<pm::Allocator> pm::AllocatorArena::GetUpstream() const
+{
+    return m_upstream;
+}
+
+size_t pm::AllocatorArena::GetSlotBytes() const
+{
+    return m_slotBytes;
+}
+
+size_t pm::AllocatorArena::GetSlotCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_slotCount;
+}
+
+size_t pm::AllocatorArena::GetFreeSlotCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_freeSlots.size();
+}
+
+bool pm::AllocatorArena::Reserve(size_t freeSlotCount)
+{
+    size_t slotCount;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_freeSlots.size() >= freeSlotCount)
+            return true;
+        slotCount = freeSlotCount - m_freeSlots.size();
+    }
+
+    if (slotCount > (std::numeric_limits<size_t>::max)() / m_slotBytes)
+        return false;
+
+    // Allocate without lock, it could take a while
+    Chunk chunk;
+    chunk.begin = static_cast<uint8_t*>(m_upstream->Allocate(slotCount * m_slotBytes));
+    if (!chunk.begin)
+        return false;
+    chunk.slotCount = slotCount;
+    chunk.freeSlotCount = slotCount;
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Free never allocates then, all slots fit in
+        m_freeSlots.reserve(m_slotCount + slotCount);
+        auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), chunk.begin,
+                [](const uint8_t* ptr, const Chunk& c) { return ptr < c.begin; });
+        m_chunks.insert(it, chunk);
+
+        // Pushed in reverse order so the slots are taken from chunk start
+        for (size_t n = slotCount; n > 0; --n)
+        {
+            m_freeSlots.push_back(chunk.begin + (n - 1) * m_slotBytes);
+        }
+        m_slotCount += slotCount;
+    }
+    catch (...)
+    {
+        m_upstream->Free(chunk.begin);
+        return false;
+    }
+
+    return true;
+}
+
+size_t pm::AllocatorArena::ReleaseFreeChunks()
+{
+    std::vector<uint8_t*> freeChunks;
+    size_t releasedSlotCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto itChunk = m_chunks.begin();
+        while (itChunk != m_chunks.end())
+        {
+            if (itChunk->freeSlotCount < itChunk->slotCount)
+            {
+                ++itChunk;
+                continue;
+            }
+
+            const uint8_t* begin = itChunk->begin;
+            const uint8_t* end = begin + itChunk->slotCount * m_slotBytes;
+            m_freeSlots.erase(std::remove_if(m_freeSlots.begin(), m_freeSlots.end(),
+                        [begin, end](void* slot) {
+                            return slot >= begin && slot < end;
+                        }), m_freeSlots.end());
+
+            releasedSlotCount += itChunk->slotCount;
+            m_slotCount -= itChunk->slotCount;
+            freeChunks.push_back(itChunk->begin);
+            itChunk = m_chunks.erase(itChunk);
+        }
+    }
+
+    for (auto begin : freeChunks)
+    {
+        m_upstream->Free(begin);
+    }
+
+    return releasedSlotCount;
+}
+
+void* pm::AllocatorArena::Allocate(size_t size)
+{
+    if (size > m_slotBytes)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_freeSlots.empty())
+        return nullptr;
+
+    void* slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    auto itChunk = FindChunk(slot);
+    assert(itChunk != m_chunks.end());
+    itChunk->freeSlotCount--;
+
+    return slot;
+}
+
+void pm::AllocatorArena::Free(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto itChunk = FindChunk(ptr);
+    if (itChunk == m_chunks.end())
+        return; // Not allocated by this allocator
+    itChunk->freeSlotCount++;
+
+    // Never throws, capacity is reserved for all slots
+    m_freeSlots.push_back(ptr);
+}
+
+std::vector<pm::AllocatorArena::Chunk>::iterator pm::AllocatorArena::FindChunk(
+        const void* ptr)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(ptr);
+    // The first chunk that begins after ptr, the previous one could contain it
+    auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), p,
+            [](const uint8_t* value, const Chunk& c) { return value < c.begin; });
+    if (it == m_chunks.begin())
+        return m_chunks.end();
+    --it;
+    if (p >= it->begin + it->slotCount * m_slotBytes)
+        return m_chunks.end();
+    return it;
+}
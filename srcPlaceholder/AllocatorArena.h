@@ -0,0 +1,76 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_ALLOCATOR_ARENA_H
+#define PM_ALLOCATOR_ARENA_H
+
+/* Local */
+#include "backend/Allocator.h"
+
+/* System */
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace pm {
+
+/* Hands out equally sized slots carved from big contiguous chunks.
+   The chunks are allocated by upstream allocator in Reserve only, Allocate and
+   Free just take and return a slot, they never call the upstream allocator.
+   Each slot keeps the alignment of upstream allocator, at least 64 bytes.
+   Reports the same type as upstream allocator so frames allocated from it
+   match frame configuration.
+   All methods are thread-safe. */
+class AllocatorArena final : public Allocator
+{
+public:
+    AllocatorArena(std::shared_ptr<Allocator> upstream, size_t slotBytes);
+    virtual ~AllocatorArena();
+
+public:
+    std::shared_ptr<Allocator> GetUpstream() const;
+    // Requested slot size rounded up to the alignment
+    size_t GetSlotBytes() const;
+    // Number of slots in all chunks
+    size_t GetSlotCount() const;
+    size_t GetFreeSlotCount() const;
+
+    // Makes sure there are at least given number of free slots, missing
+    // slots are allocated at once as one new chunk
+    bool Reserve(size_t freeSlotCount);
+    // Releases chunks with all slots free, returns number of released slots
+    size_t ReleaseFreeChunks();
+
+public: // From Allocator
+    // Returns null if size is bigger than slot or if there is no free slot
+    virtual void* Allocate(size_t size) override;
+    virtual void Free(void* ptr) override;
+
+private:
+    struct Chunk
+    {
+        uint8_t* begin{ nullptr };
+        size_t slotCount{ 0 };
+        size_t freeSlotCount{ 0 };
+    };
+
+private:
+    // Returns chunk the pointer belongs to, m_chunks.end() if none
+    std::vector<Chunk>::iterator FindChunk(const void* ptr);
+
+private:
+    const std::shared_ptr<Allocator> m_upstream;
+    const size_t m_slotBytes;
+
+    mutable std::mutex m_mutex{};
+    // Sorted by begin address
+    std::vector<Chunk> m_chunks{};
+    std::vector<void*> m_freeSlots{};
+    size_t m_slotCount{ 0 };
+};
+
+} // namespace
+
+#endif
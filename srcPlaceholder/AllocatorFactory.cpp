@@ -6,8 +6,10 @@
 /* Local */
 #include "backend/AllocatorAligned.h"
 #include "backend/AllocatorDefault.h"
+#include "backend/AllocatorHugePages.h"
 
-std::shared_ptr<pm::Allocator> pm::AllocatorFactory::Create(AllocatorType type)
+std::shared_ptr<pm::Allocator> pm::AllocatorFactory::Create(AllocatorType type,
+        int flags)
 {
     try
     {
@@ -17,6 +19,8 @@ std::shared_ptr<pm::Allocator> pm::AllocatorFactory::Create(AllocatorType type)
         case AllocatorType::Align32: return std::make_shared<AllocatorAligned32>();
         case AllocatorType::Align4k: return std::make_shared<AllocatorAligned4k>();
         case AllocatorType::Default: return std::make_shared<AllocatorDefault  >();
+        case AllocatorType::HugePages2M: return std::make_shared<AllocatorHugePages2M>(flags);
+        case AllocatorType::HugePages1G: return std::make_shared<AllocatorHugePages1G>(flags);
         }
     }
     catch (...)
@@ -32,6 +36,10 @@ size_t pm::AllocatorFactory::GetAlignment(AllocatorType type)
     case AllocatorType::Align16: return 16;
     case AllocatorType::Align32: return 32;
     case AllocatorType::Align4k: return 4096;
+    // Blocks are aligned to huge page size but the alignment is used also
+    // for data in files, 4k is enough for direct I/O
+    case AllocatorType::HugePages2M: return 4096;
+    case AllocatorType::HugePages1G: return 4096;
     default:
     case AllocatorType::Default: return 0;
     }
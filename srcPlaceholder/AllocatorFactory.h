@@ -16,7 +16,9 @@ namespace pm {
 class AllocatorFactory
 {
 public:
-    static std::shared_ptr<Allocator> Create(AllocatorType type);
+    // The flags is combination of Allocator::Flags
+    static std::shared_ptr<Allocator> Create(AllocatorType type,
+            int flags = Allocator::Flags::None);
 
 public:
     static size_t GetAlignment(AllocatorType type);
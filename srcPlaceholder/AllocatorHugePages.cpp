@@ -0,0 +1,279 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/AllocatorHugePages.h"
+
+/* Local */
+#include "backend/AllocatorFactory.h"
+#include "backend/Log.h"
+
+/* System */
+#include <cstdint>
+#include <limits>
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <sys/mman.h>
+    #ifndef MAP_HUGE_SHIFT
+        #define MAP_HUGE_SHIFT 26
+    #endif
+#endif
+
+// Transparent huge pages on x86_64, also the size of Windows large pages
+static constexpr size_t cTransparentPageBytes = 2 << 20;
+
+static size_t RoundUp(size_t size, size_t step)
+{
+    return ((size + step - 1) / step) * step;
+}
+
+#ifdef _WIN32
+// Large pages can be allocated only with SeLockMemoryPrivilege enabled,
+// it is not enabled by default even if granted to the user
+static bool EnableLockMemoryPrivilege()
+{
+    HANDLE token;
+    if (!::OpenProcessToken(::GetCurrentProcess(),
+                TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+        return false;
+
+    TOKEN_PRIVILEGES tp{};
+    tp.PrivilegeCount = 1;
+    tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool ok = ::LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege",
+            &tp.Privileges[0].Luid) == TRUE;
+    // Succeeds even if privilege not granted, the last error tells the truth
+    ok = ok && ::AdjustTokenPrivileges(token, FALSE, &tp, 0, NULL, NULL) == TRUE
+        && ::GetLastError() == ERROR_SUCCESS;
+
+    ::CloseHandle(token);
+    return ok;
+}
+#endif
+
+pm::AllocatorHugePages::AllocatorHugePages(AllocatorType type, int flags)
+    : Allocator(type),
+    m_pageBytes((type == AllocatorType::HugePages1G) ? (1 << 30) : (2 << 20)),
+    m_flags(flags)
+{
+}
+
+pm::AllocatorHugePages::~AllocatorHugePages()
+{
+    // All blocks should be released already, but don't leak them anyway
+    for (auto& block : m_blocks)
+    {
+        FreePages(block.first, block.second);
+    }
+}
+
+size_t pm::AllocatorHugePages::GetPageBytes() const
+{
+    return m_pageBytes;
+}
+
+int pm::AllocatorHugePages::GetFlags() const
+{
+    return m_flags;
+}
+
+void* pm::AllocatorHugePages::Allocate(size_t size)
+{
+    if (size == 0 || size > (std::numeric_limits<size_t>::max)() - m_pageBytes)
+        return nullptr;
+
+    size_t bytes = 0;
+    void* ptr = nullptr;
+    if (size >= m_pageBytes)
+    {
+        ptr = AllocateHugePages(size, bytes);
+        if (!ptr)
+        {
+#ifdef _WIN32
+            WarnOnce(m_hugePagesWarned, "Failure allocating large pages, "
+                    "using regular pages. The 'Lock pages in memory' "
+                    "privilege is required for large pages.");
+#else
+            WarnOnce(m_hugePagesWarned, "Failure allocating "
+                    + std::to_string(m_pageBytes >> 20) + " MiB huge pages, "
+                    "using transparent huge pages. Reserve more huge pages "
+                    "via /proc/sys/vm/nr_hugepages.");
+#endif
+        }
+    }
+    if (!ptr && size >= cTransparentPageBytes)
+    {
+        ptr = AllocateTransparentHugePages(size, bytes);
+    }
+    if (!ptr)
+    {
+        ptr = AllocateRegularPages(size, bytes);
+        if (!ptr)
+            return nullptr;
+    }
+
+    if (m_flags & Allocator::Flags::Prefault)
+    {
+        // Write to each page so no page fault happens later on hot path,
+        // the memory from OS is zeroed so the content doesn't change
+        volatile uint8_t* data = static_cast<uint8_t*>(ptr);
+        const size_t step = AllocatorFactory::GetAlignment(AllocatorType::Align4k);
+        for (size_t n = 0; n < bytes; n += step)
+        {
+            data[n] = 0;
+        }
+    }
+
+    if (m_flags & Allocator::Flags::Lock)
+    {
+#ifdef _WIN32
+        // Large pages are always locked, the others up to working set size
+        const bool locked = ::VirtualLock(ptr, bytes) == TRUE;
+#else
+        const bool locked = ::mlock(ptr, bytes) == 0;
+#endif
+        if (!locked)
+        {
+            WarnOnce(m_lockWarned, "Failure locking allocated memory in RAM, "
+                    "the limit for locked memory is probably too low");
+        }
+    }
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(m_blocksMutex);
+        m_blocks[ptr] = bytes;
+    }
+    catch (...)
+    {
+        FreePages(ptr, bytes);
+        return nullptr;
+    }
+
+    return ptr;
+}
+
+void pm::AllocatorHugePages::Free(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    size_t bytes;
+    {
+        std::lock_guard<std::mutex> lock(m_blocksMutex);
+        auto it = m_blocks.find(ptr);
+        if (it == m_blocks.end())
+            return; // Not allocated by this allocator
+        bytes = it->second;
+        m_blocks.erase(it);
+    }
+
+    FreePages(ptr, bytes);
+}
+
+void* pm::AllocatorHugePages::AllocateHugePages(size_t size, size_t& bytes)
+{
+#ifdef _WIN32
+    static const bool canUseLargePages = EnableLockMemoryPrivilege();
+    const size_t largePageBytes = ::GetLargePageMinimum();
+    if (!canUseLargePages || largePageBytes == 0)
+        return nullptr;
+
+    const size_t pageBytes = RoundUp(size, largePageBytes);
+    void* ptr = ::VirtualAlloc(NULL, pageBytes,
+            MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (!ptr)
+        return nullptr;
+#else
+    unsigned int pageShift = 0;
+    while (((size_t)1 << pageShift) < m_pageBytes)
+    {
+        pageShift++;
+    }
+
+    const size_t pageBytes = RoundUp(size, m_pageBytes);
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB
+        | (int)(pageShift << MAP_HUGE_SHIFT);
+    void* ptr = ::mmap(nullptr, pageBytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (ptr == MAP_FAILED)
+        return nullptr;
+#endif
+
+    bytes = pageBytes;
+    return ptr;
+}
+
+void* pm::AllocatorHugePages::AllocateTransparentHugePages(size_t size, size_t& bytes)
+{
+#ifdef _WIN32
+    // There's nothing like transparent huge pages on Windows
+    (void)size;
+    (void)bytes;
+    return nullptr;
+#else
+    const size_t pageBytes = RoundUp(size, cTransparentPageBytes);
+    // Map one page more so the block can be aligned to huge page boundary,
+    // only aligned ranges are backed by huge pages
+    const size_t mapBytes = pageBytes + cTransparentPageBytes;
+    void* map = ::mmap(nullptr, mapBytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        return nullptr;
+
+    const uintptr_t mapBegin = reinterpret_cast<uintptr_t>(map);
+    const uintptr_t begin = RoundUp(mapBegin, cTransparentPageBytes);
+    const size_t headBytes = begin - mapBegin;
+    const size_t tailBytes = mapBytes - headBytes - pageBytes;
+    if (headBytes > 0)
+        ::munmap(map, headBytes);
+    if (tailBytes > 0)
+        ::munmap(reinterpret_cast<void*>(begin + pageBytes), tailBytes);
+
+    void* ptr = reinterpret_cast<void*>(begin);
+    // Just a hint, THP could be disabled in system
+    ::madvise(ptr, pageBytes, MADV_HUGEPAGE);
+
+    bytes = pageBytes;
+    return ptr;
+#endif
+}
+
+void* pm::AllocatorHugePages::AllocateRegularPages(size_t size, size_t& bytes)
+{
+    const size_t pageBytes =
+        AllocatorFactory::GetAlignedSize(size, AllocatorType::Align4k);
+#ifdef _WIN32
+    void* ptr = ::VirtualAlloc(NULL, pageBytes, MEM_RESERVE | MEM_COMMIT,
+            PAGE_READWRITE);
+    if (!ptr)
+        return nullptr;
+#else
+    void* ptr = ::mmap(nullptr, pageBytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+        return nullptr;
+#endif
+
+    bytes = pageBytes;
+    return ptr;
+}
+
+void pm::AllocatorHugePages::FreePages(void* ptr, size_t bytes)
+{
+#ifdef _WIN32
+    (void)bytes;
+    ::VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    ::munmap(ptr, bytes);
+#endif
+}
+
+void pm::AllocatorHugePages::WarnOnce(std::atomic<bool>& warned,
+        const std::string& message)
+{
+    if (!warned.exchange(true))
+    {
+        Log::LogW(message);
+    }
+}
@@ -0,0 +1,84 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_ALLOCATOR_HUGE_PAGES_H
+#define PM_ALLOCATOR_HUGE_PAGES_H
+
+/* Local */
+#include "backend/Allocator.h"
+
+/* System */
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace pm {
+
+/* Allocates memory directly from OS, blocks of at least one huge page are
+   backed by huge pages to reduce TLB misses on large buffers.
+   On Linux it uses pages reserved via vm.nr_hugepages (MAP_HUGETLB) and if
+   there are not enough of them, it falls back to transparent huge pages.
+   Smaller blocks get transparent huge pages if at least 2 MiB big, regular
+   pages otherwise.
+   On Windows it uses large pages (2 MiB) regardless of type, it requires
+   "Lock pages in memory" privilege, regular pages are used otherwise.
+   All blocks are aligned to 4 kB at least. */
+class AllocatorHugePages : public Allocator
+{
+protected:
+    AllocatorHugePages(AllocatorType type, int flags);
+
+public:
+    virtual ~AllocatorHugePages();
+
+public:
+    // Size of huge page, blocks of this size or bigger are rounded up to it
+    size_t GetPageBytes() const;
+    // Combination of Allocator::Flags
+    int GetFlags() const;
+
+public: // From Allocator
+    virtual void* Allocate(size_t size) override;
+    virtual void Free(void* ptr) override;
+
+private:
+    // Return null on failure, bytes is set to real size of the block
+    void* AllocateHugePages(size_t size, size_t& bytes);
+    void* AllocateTransparentHugePages(size_t size, size_t& bytes);
+    void* AllocateRegularPages(size_t size, size_t& bytes);
+    void FreePages(void* ptr, size_t bytes);
+
+    // Logs warning only once per allocator instance
+    void WarnOnce(std::atomic<bool>& warned, const std::string& message);
+
+private:
+    const size_t m_pageBytes;
+    const int m_flags;
+
+    // Size of each allocated block, needed to release it
+    std::mutex m_blocksMutex{};
+    std::unordered_map<void*, size_t> m_blocks{};
+
+    std::atomic<bool> m_hugePagesWarned{ false };
+    std::atomic<bool> m_lockWarned{ false };
+};
+
+class AllocatorHugePages2M : public AllocatorHugePages
+{
+public:
+    explicit AllocatorHugePages2M(int flags = Allocator::Flags::None)
+        : AllocatorHugePages(AllocatorType::HugePages2M, flags) {}
+};
+
+class AllocatorHugePages1G : public AllocatorHugePages
+{
+public:
+    explicit AllocatorHugePages1G(int flags = Allocator::Flags::None)
+        : AllocatorHugePages(AllocatorType::HugePages1G, flags) {}
+};
+
+} // namespace
+
+#endif
@@ -16,6 +16,8 @@ enum class AllocatorType
     Align16,
     Align32,
     Align4k,
+    HugePages2M,
+    HugePages1G,
 };
 
 } // namespace
@@ -123,6 +123,9 @@ uint8_t pm::BitmapFormat::GetSamplesPerPixel() const
         return 1;
     case pm::BitmapPixelType::RGB:
         return 3;
+    case pm::BitmapPixelType::RGBA:
+    case pm::BitmapPixelType::BGRA:
+        return 4;
     }
     return 0; // Never happens
 }
@@ -158,6 +161,14 @@ void pm::BitmapFormat::SetupPixelAndDataType(ImageFormat imageFormat)
         m_dataType = BitmapDataType::UInt32;
         m_pixelType = BitmapPixelType::RGB;
         return;
+    case ImageFormat::RGBA32:
+        m_dataType = BitmapDataType::UInt8;
+        m_pixelType = BitmapPixelType::RGBA;
+        return;
+    case ImageFormat::BGRA32:
+        m_dataType = BitmapDataType::UInt8;
+        m_pixelType = BitmapPixelType::BGRA;
+        return;
     }
     throw Exception("Unsupported image format " + std::to_string(
             static_cast<std::underlying_type<ImageFormat>::type>(imageFormat)));
@@ -177,6 +188,12 @@ void pm::BitmapFormat::SetupImageFormat(BitmapPixelType pixelType,
         case pm::BitmapPixelType::RGB:
             m_imageFormat = ImageFormat::RGB24;
             return;
+        case pm::BitmapPixelType::RGBA:
+            m_imageFormat = ImageFormat::RGBA32;
+            return;
+        case pm::BitmapPixelType::BGRA:
+            m_imageFormat = ImageFormat::BGRA32;
+            return;
         }
         break; // Throws below
 
@@ -189,6 +206,9 @@ void pm::BitmapFormat::SetupImageFormat(BitmapPixelType pixelType,
         case pm::BitmapPixelType::RGB:
             m_imageFormat = ImageFormat::RGB48;
             return;
+        case pm::BitmapPixelType::RGBA:
+        case pm::BitmapPixelType::BGRA:
+            break; // Supported with UInt8 only
         }
         break; // Throws below
 
@@ -201,6 +221,9 @@ void pm::BitmapFormat::SetupImageFormat(BitmapPixelType pixelType,
         case pm::BitmapPixelType::RGB:
             m_imageFormat = ImageFormat::RGB96;
             return;
+        case pm::BitmapPixelType::RGBA:
+        case pm::BitmapPixelType::BGRA:
+            break; // Supported with UInt8 only
         }
         break; // Throws below
 
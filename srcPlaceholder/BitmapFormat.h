@@ -32,16 +32,22 @@ enum class ImageFormat : int32_t
     Bayer32 = 10, ///< 32bit bayer masked image, 4 bytes per pixel.
     // TODO: Fix the value once defined in pvcam.h
     RGB96 = 11, ///< 32bit RGB, 4 bytes per sample, 12 bytes per pixel.
+    // Display formats, never reported by camera, not defined in pvcam.h
+    RGBA32 = 1000, ///< 8bit RGBA, 1 byte per sample, 4 bytes per pixel.
+    BGRA32 = 1001, ///< 8bit BGRA, 1 byte per sample, 4 bytes per pixel.
 };
 
 /**
 Pixel type. A pixel may consists of several samples. For monochrome bitmap the
 pixel is a simple single value, for RGB bitmaps the pixel contains 3 samples.
+RGBA and BGRA bitmaps are meant for display only and support UInt8 data type.
 */
 enum class BitmapPixelType : int32_t
 {
     Mono = 0, ///< Each pixel contains only one sample
     RGB, ///< Each pixel consists of 3 samples, Red, Green, Blue, in this order
+    RGBA, ///< Each pixel consists of 4 samples, Red, Green, Blue, Alpha, in this order
+    BGRA, ///< Each pixel consists of 4 samples, Blue, Green, Red, Alpha, in this order
 };
 
 /**
@@ -143,7 +149,8 @@ public:
     /**
     Returns the bitmap pixel type. For example Mono or RGB.
     This value is directly related to #SamplesPerPixel(), i.e. a Mono bitmap has
-    one sample per pixel, an RGB bitmap has 3 samples per pixel.
+    one sample per pixel, an RGB bitmap has 3 samples per pixel, RGBA and BGRA
+    bitmaps have 4 samples per pixel.
     @return Bitmap pixel type.
     */
     BitmapPixelType GetPixelType() const;
@@ -219,8 +226,8 @@ public:
     size_t GetBytesPerSample() const;
     /**
     @brief Returns number of samples per pixel.
-    @details For example an RGB bitmap has 3 samples per pixel, an RGBA or CMYK
-    bitmap would consists of 4 samples per pixel. Monochrome bitmaps use 1 sample
+    @details For example an RGB bitmap has 3 samples per pixel, an RGBA or BGRA
+    bitmap consists of 4 samples per pixel. Monochrome bitmaps use 1 sample
     per pixel.
     @return Number of samples per pixel.
     */
@@ -15,6 +15,7 @@
 
 /* System */
 #include <algorithm>
+#include <cstring> // std::memset
 #include <limits>
 #include <sstream>
 
@@ -648,6 +649,53 @@ std::shared_ptr<pm::Frame> pm::Camera::GetFrameAt(size_t index) const
     return m_frames.at(index);
 }
 
+bool pm::Camera::GetFrameIndexByData(const void* data, size_t& index) const
+{
+    const size_t frameBytes = m_frameAcqCfg.GetFrameBytes();
+    if (!m_buffer || !data || frameBytes == 0)
+        return false;
+
+    const auto begin = m_buffer.get();
+    const auto ptr = static_cast<const uns8*>(data);
+    if (ptr < begin || ptr >= begin + m_frameCount * frameBytes)
+        return false;
+
+    index = static_cast<size_t>(ptr - begin) / frameBytes;
+    return true;
+}
+
+void pm::Camera::PinFrameAt(size_t index)
+{
+    if (!m_framePins || index >= m_frameCount)
+        return;
+
+    m_framePins[index].fetch_add(1, std::memory_order_acquire);
+}
+
+void pm::Camera::UnpinFrameAt(size_t index)
+{
+    if (!m_framePins || index >= m_frameCount)
+        return;
+
+    // Release pairs with acquire in IsFramePinnedAt so the camera cannot
+    // overwrite the data while still being read by the holder.
+    // Never goes below zero, e.g. for frames pinned before buffer re-allocation.
+    auto& pins = m_framePins[index];
+    uint32_t count = pins.load(std::memory_order_relaxed);
+    while (count > 0 && !pins.compare_exchange_weak(count, count - 1,
+                std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+bool pm::Camera::IsFramePinnedAt(size_t index) const
+{
+    if (!m_framePins || index >= m_frameCount)
+        return false;
+
+    return m_framePins[index].load(std::memory_order_acquire) > 0;
+}
+
 bool pm::Camera::GetFrameIndex(const Frame& frame, size_t& index) const
 {
     const uint32_t frameNr = frame.GetInfo().GetFrameNr();
@@ -836,15 +884,19 @@ bool pm::Camera::AllocateBuffers(uns32 frameCount, uns32 frameBytes)
     const auto allocatorType = m_settings.GetAllocatorType();
     const Frame::AcqCfg frameAcqCfg(frameBytes, roiCount, m_usesMetadata,
             implRoi, m_bmpFormat, outputBmpRois, allocatorType);
+    const int allocatorFlags =
+        ((m_settings.GetAllocatorLock()) ? Allocator::Flags::Lock : 0)
+        | ((m_settings.GetAllocatorPrefault()) ? Allocator::Flags::Prefault : 0);
 
     if (m_frameCount == frameCount
             && m_frameAcqCfg == frameAcqCfg
+            && m_allocatorFlags == allocatorFlags
             && m_buffer)
         return true;
 
     DeleteBuffers();
 
-    auto allocator = AllocatorFactory::Create(allocatorType);
+    auto allocator = AllocatorFactory::Create(allocatorType, allocatorFlags);
     if (!allocator)
     {
         Log::LogE("Failure allocating memory allocator");
@@ -885,7 +937,15 @@ bool pm::Camera::AllocateBuffers(uns32 frameCount, uns32 frameBytes)
         const auto bufferBytesSafeAligned =
             AllocatorFactory::GetAlignedSize(bufferBytesSafe, allocatorType);
 
-        m_buffer = std::make_unique<uns8[]>(bufferBytesSafeAligned);
+        uns8* buffer =
+            static_cast<uns8*>(allocator->Allocate(bufferBytesSafeAligned));
+        if (!buffer)
+            throw std::bad_alloc();
+        // Zeroed as it used to be with value-initialized array
+        std::memset(buffer, 0, bufferBytesSafeAligned);
+        m_buffer = BufferPtr(buffer, [allocator](uns8* ptr) {
+            allocator->Free(ptr);
+        });
     }
     catch (...)
     {
@@ -926,8 +986,21 @@ bool pm::Camera::AllocateBuffers(uns32 frameCount, uns32 frameBytes)
     }
     m_frames.shrink_to_fit();
 
+    try
+    {
+        // Value-initialized, i.e. no frame is pinned
+        m_framePins = std::make_unique<std::atomic<uint32_t>[]>(frameCount);
+    }
+    catch (...)
+    {
+        DeleteBuffers();
+        Log::LogE("Failure allocating pin counters for %u frames", frameCount);
+        return false;
+    }
+
     m_frameAcqCfg = frameAcqCfg;
     m_allocator = allocator;
+    m_allocatorFlags = allocatorFlags;
     m_frameCount = frameCount;
 
     return true;
@@ -937,11 +1010,13 @@ void pm::Camera::DeleteBuffers()
 {
     m_frames.clear();
     m_framesMap.clear();
+    m_framePins = nullptr;
 
     m_buffer = nullptr;
 
     m_frameAcqCfg = Frame::AcqCfg();
     m_allocator = nullptr;
+    m_allocatorFlags = Allocator::Flags::None;
     m_frameCount = 0;
 }
 
@@ -17,6 +17,8 @@
 #include "pvcam.h"
 
 /* System */
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory> // std::shared_ptr
 #include <string>
@@ -152,6 +154,18 @@ public:
     virtual std::shared_ptr<Frame> GetFrameAt(size_t index) const;
     // Get index of the frame from circular buffer
     virtual bool GetFrameIndex(const Frame& frame, size_t& index) const;
+    // Get index of the frame in circular buffer the data pointer belongs to
+    virtual bool GetFrameIndexByData(const void* data, size_t& index) const;
+
+    // Pinned frame is referenced by shallow frame(s) outside the camera,
+    // e.g. in zero-copy acquisition. Pins are counted, every pin needs unpin.
+    virtual void PinFrameAt(size_t index);
+    virtual void UnpinFrameAt(size_t index);
+    virtual bool IsFramePinnedAt(size_t index) const;
+    // Returns true if the camera never overwrites pinned frames. Otherwise
+    // the caller has to detect overwritten frames on its own.
+    virtual bool HonorsFramePins() const
+    { return false; }
 
     // Get current acquisition configuration for frame
     virtual Frame::AcqCfg GetFrameAcqCfg() const
@@ -228,12 +242,17 @@ protected:
     Frame::AcqCfg m_frameAcqCfg{}; // Updated in Camera::AllocateBuffers
     // Allocator for buffers and frames
     std::shared_ptr<Allocator> m_allocator{}; // Updated in Camera::AllocateBuffers
+    // Allocator::Flags used to create m_allocator
+    int m_allocatorFlags{ Allocator::Flags::None };
     // Number of frames in buffer (circ/sequence)
     uns32 m_frameCount{ 0 };
-    // PVCAM buffer (raw bytes)
-    std::unique_ptr<uns8[]> m_buffer{ nullptr };
+    // PVCAM buffer (raw bytes), allocated by m_allocator
+    using BufferPtr = std::unique_ptr<uns8[], std::function<void(uns8*)>>;
+    BufferPtr m_buffer{ nullptr };
 
     std::vector<std::shared_ptr<Frame>> m_frames{};
+    // Pin counters, one for each frame in m_frames
+    std::unique_ptr<std::atomic<uint32_t>[]> m_framePins{ nullptr };
     // Lookup map - frameNr is the key, index to m_frames vector is the value
     mutable std::map<uint32_t, size_t> m_framesMap{};
 };
@@ -0,0 +1,292 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/CpuAffinity.h"
+
+/* Local */
+#include "backend/Utils.h"
+
+/* System */
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <linux/mempolicy.h> // MPOL_*
+#endif
+
+#if defined(__linux__)
+// Reads first line of a sysfs file with CPU or node list
+static bool ReadSysList(const std::string& fileName, pm::CpuAffinity::CpuSet& list)
+{
+    std::ifstream file(fileName);
+    std::string line;
+    if (!file || !std::getline(file, line))
+        return false;
+    return pm::CpuAffinity::StrToCpuSet(pm::Utils::Trim(line), list);
+}
+
+// CPUs the process was started with, e.g. restricted by taskset or cgroup.
+// Captured during static initialization, before any thread is pinned.
+static cpu_set_t GetInitialCpus()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) != 0)
+    {
+        const long cpuCount = ::sysconf(_SC_NPROCESSORS_CONF);
+        for (long n = 0; n < cpuCount && n < CPU_SETSIZE; ++n)
+        {
+            CPU_SET((size_t)n, &set);
+        }
+    }
+    return set;
+}
+static const cpu_set_t sInitialCpus = GetInitialCpus();
+
+static bool PinThreadHandle(pthread_t thread, const pm::CpuAffinity::CpuSet& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (cpus.empty())
+    {
+        // Same as process affinity mask on Windows
+        set = sInitialCpus;
+    }
+    else
+    {
+        for (auto cpu : cpus)
+        {
+            if (cpu >= CPU_SETSIZE)
+                return false;
+            CPU_SET(cpu, &set);
+        }
+    }
+    return (::pthread_setaffinity_np(thread, sizeof(set), &set) == 0);
+}
+#elif defined(_WIN32)
+static bool PinThreadHandle(HANDLE thread, const pm::CpuAffinity::CpuSet& cpus)
+{
+    DWORD_PTR mask = 0;
+    if (cpus.empty())
+    {
+        DWORD_PTR systemMask;
+        if (!::GetProcessAffinityMask(::GetCurrentProcess(), &mask, &systemMask))
+            return false;
+    }
+    else
+    {
+        for (auto cpu : cpus)
+        {
+            if (cpu >= sizeof(DWORD_PTR) * 8)
+                return false;
+            mask |= (DWORD_PTR)1 << cpu;
+        }
+    }
+    return (::SetThreadAffinityMask(thread, mask) != 0);
+}
+#endif
+
+bool pm::CpuAffinity::StrToCpuSet(const std::string& str, CpuSet& cpus)
+{
+    CpuSet set;
+
+    std::istringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        Utils::Trim(item);
+        if (item.empty())
+            return false;
+
+        unsigned int first;
+        unsigned int last;
+        const size_t dashPos = item.find('-');
+        if (dashPos == std::string::npos)
+        {
+            if (!Utils::StrToNumber<unsigned int>(item, first))
+                return false;
+            last = first;
+        }
+        else
+        {
+            std::string firstStr = item.substr(0, dashPos);
+            std::string lastStr = item.substr(dashPos + 1);
+            if (!Utils::StrToNumber<unsigned int>(Utils::Trim(firstStr), first)
+                    || !Utils::StrToNumber<unsigned int>(Utils::Trim(lastStr), last)
+                    || last < first)
+                return false;
+        }
+
+        // Protect against typos like "0-4000000000"
+        if (last - first >= 65536)
+            return false;
+
+        for (unsigned int cpu = first; cpu <= last && cpu >= first; ++cpu)
+        {
+            set.push_back(cpu); // Stops also on overflow at max. value
+        }
+    }
+
+    std::sort(set.begin(), set.end());
+    set.erase(std::unique(set.begin(), set.end()), set.end());
+
+    cpus.swap(set);
+    return true;
+}
+
+std::string pm::CpuAffinity::CpuSetToStr(const CpuSet& cpus)
+{
+    if (cpus.empty())
+        return "all";
+
+    std::ostringstream ss;
+    size_t n = 0;
+    while (n < cpus.size())
+    {
+        // Find end of consecutive run
+        size_t last = n;
+        while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1)
+        {
+            last++;
+        }
+
+        if (n > 0)
+            ss << ',';
+        ss << cpus[n];
+        if (last > n)
+            ss << '-' << cpus[last];
+
+        n = last + 1;
+    }
+    return ss.str();
+}
+
+bool pm::CpuAffinity::PinThread(std::thread& thread, const CpuSet& cpus)
+{
+#if defined(__linux__) || defined(_WIN32)
+    if (!thread.joinable())
+        return false;
+    return PinThreadHandle(thread.native_handle(), cpus);
+#else
+    (void)thread;
+    return cpus.empty();
+#endif
+}
+
+bool pm::CpuAffinity::PinCurrentThread(const CpuSet& cpus)
+{
+#if defined(__linux__)
+    return PinThreadHandle(::pthread_self(), cpus);
+#elif defined(_WIN32)
+    return PinThreadHandle(::GetCurrentThread(), cpus);
+#else
+    return cpus.empty();
+#endif
+}
+
+bool pm::CpuAffinity::SetCurrentThreadRtPriority(unsigned int priority)
+{
+    if (priority < 1 || priority > 99)
+        return false;
+
+#if defined(__linux__)
+    // Clamp to what the system allows, range 1-99 on Linux anyway
+    const int minPrio = ::sched_get_priority_min(SCHED_FIFO);
+    const int maxPrio = ::sched_get_priority_max(SCHED_FIFO);
+    sched_param param{};
+    param.sched_priority = std::min(std::max((int)priority, minPrio), maxPrio);
+    return (::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param) == 0);
+#elif defined(_WIN32)
+    // There are no priority levels like on Linux, use the highest one
+    return (::SetThreadPriority(::GetCurrentThread(),
+                THREAD_PRIORITY_TIME_CRITICAL) == TRUE);
+#else
+    return false;
+#endif
+}
+
+int pm::CpuAffinity::GetNumaNode(unsigned int cpu)
+{
+#if defined(__linux__)
+    CpuSet nodes;
+    if (!ReadSysList("/sys/devices/system/node/online", nodes))
+        return -1;
+    for (auto node : nodes)
+    {
+        CpuSet nodeCpus;
+        const std::string fileName =
+            "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+        if (!ReadSysList(fileName, nodeCpus))
+            continue;
+        if (std::binary_search(nodeCpus.begin(), nodeCpus.end(), cpu))
+            return (int)node;
+    }
+    return -1;
+#elif defined(_WIN32)
+    if (cpu > 0xFF)
+        return -1;
+    UCHAR node;
+    if (!::GetNumaProcessorNode((UCHAR)cpu, &node) || node == 0xFF)
+        return -1;
+    return (int)node;
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+int pm::CpuAffinity::GetNumaNode(const CpuSet& cpus)
+{
+    return (cpus.empty()) ? -1 : GetNumaNode(cpus.front());
+}
+
+bool pm::CpuAffinity::SetCurrentThreadMemNode(int node)
+{
+#if defined(__linux__)
+    // Raw syscall, no need to depend on libnuma for this single call
+    if (node < 0)
+        return (::syscall(__NR_set_mempolicy, MPOL_DEFAULT, nullptr, 0) == 0);
+
+    unsigned long mask[16]{}; // Same size as in MemPolicy
+    const size_t bitsPerItem = sizeof(mask[0]) * 8;
+    if ((size_t)node >= bitsPerItem * 16)
+        return false;
+    mask[node / bitsPerItem] |= 1ul << (node % bitsPerItem);
+    // Preferred only, falls back to other nodes rather than failing
+    return (::syscall(__NR_set_mempolicy, MPOL_PREFERRED, mask,
+                bitsPerItem * 16) == 0);
+#else
+    return (node < 0);
+#endif
+}
+
+bool pm::CpuAffinity::GetCurrentThreadMemPolicy(MemPolicy& policy)
+{
+    policy = MemPolicy();
+#if defined(__linux__)
+    // The mode comes with flags like MPOL_F_STATIC_NODES, set accepts them too
+    const size_t maxNode = sizeof(policy.nodeMask) * 8;
+    return (::syscall(__NR_get_mempolicy, &policy.mode, policy.nodeMask,
+                maxNode, nullptr, 0) == 0);
+#else
+    return true;
+#endif
+}
+
+bool pm::CpuAffinity::SetCurrentThreadMemPolicy(const MemPolicy& policy)
+{
+#if defined(__linux__)
+    const size_t maxNode = sizeof(policy.nodeMask) * 8;
+    return (::syscall(__NR_set_mempolicy, policy.mode, policy.nodeMask,
+                maxNode) == 0);
+#else
+    return (policy.mode == 0);
+#endif
+}
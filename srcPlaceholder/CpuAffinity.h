@@ -0,0 +1,64 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_CPU_AFFINITY_H
+#define PM_CPU_AFFINITY_H
+
+/* System */
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pm {
+
+/* Helpers for binding threads and memory to given CPUs.
+   CPU set is a sorted list of unique logical CPU indexes, an empty set means
+   no restriction, i.e. all CPUs allowed for the process at its start.
+   On Windows only CPUs from first processor group (0-63) are supported. */
+class CpuAffinity final
+{
+public:
+    using CpuSet = std::vector<unsigned int>;
+
+    // Memory policy of a thread, see GetCurrentThreadMemPolicy
+    struct MemPolicy
+    {
+        int mode{ 0 }; // MPOL_DEFAULT
+        unsigned long nodeMask[16]{}; // Up to 1024 nodes
+    };
+
+public:
+    // Parses list like "0-3,8,10-11" to CPU set, empty string gives empty set
+    static bool StrToCpuSet(const std::string& str, CpuSet& cpus);
+    // Converts CPU set back to compact string, "all" for empty set
+    static std::string CpuSetToStr(const CpuSet& cpus);
+
+    // Restricts given thread to given CPUs, empty set allows again all CPUs
+    // the process was started with
+    static bool PinThread(std::thread& thread, const CpuSet& cpus);
+    // Restricts calling thread to given CPUs, empty set allows again all CPUs
+    // the process was started with
+    static bool PinCurrentThread(const CpuSet& cpus);
+
+    // Switches calling thread to real-time scheduling with given priority
+    // 1-99 (SCHED_FIFO on Linux, time-critical priority on Windows)
+    static bool SetCurrentThreadRtPriority(unsigned int priority);
+
+    // Returns NUMA node the CPU belongs to, -1 if unknown
+    static int GetNumaNode(unsigned int cpu);
+    // Returns NUMA node of first CPU in set, -1 for empty set or if unknown
+    static int GetNumaNode(const CpuSet& cpus);
+    // Makes memory touched for the first time by calling thread being
+    // allocated on given NUMA node if possible, -1 restores default policy.
+    // Supported on Linux only.
+    static bool SetCurrentThreadMemNode(int node);
+    // Saves memory policy of calling thread, e.g. one set by numactl, so it
+    // can be restored after SetCurrentThreadMemNode. Supported on Linux only.
+    static bool GetCurrentThreadMemPolicy(MemPolicy& policy);
+    static bool SetCurrentThreadMemPolicy(const MemPolicy& policy);
+};
+
+} // namespace pm
+
+#endif /* PM_CPU_AFFINITY_H */
@@ -0,0 +1,120 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/CpuFeatures.h"
+
+/* System */
+#include <algorithm>
+#include <atomic>
+
+#if PM_SIMD_X86
+    #if defined(_MSC_VER)
+        #include <intrin.h> // __cpuid, __cpuidex, _xgetbv
+    #else
+        #include <cpuid.h> // __get_cpuid, __get_cpuid_count
+    #endif
+#endif
+
+#if PM_SIMD_X86
+static void CpuId(uint32_t leaf, uint32_t subLeaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, (int)leaf, (int)subLeaf);
+    for (int n = 0; n < 4; ++n)
+    {
+        regs[n] = (uint32_t)info[n];
+    }
+#else
+    if (!__get_cpuid_count(leaf, subLeaf, &regs[0], &regs[1], &regs[2], &regs[3]))
+    {
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    }
+#endif
+}
+
+// Returns register state components enabled by OS, valid with OSXSAVE only
+static uint64_t GetXcr0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t lo;
+    uint32_t hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+#endif
+
+static pm::SimdLevel DetectSimdLevel()
+{
+#if PM_SIMD_X86
+    uint32_t regs[4]; // EAX, EBX, ECX, EDX
+
+    CpuId(0, 0, regs);
+    const uint32_t maxLeaf = regs[0];
+    if (maxLeaf < 1)
+        return pm::SimdLevel::Scalar;
+
+    CpuId(1, 0, regs);
+    const bool hasSse41 = (regs[2] & (1u << 19)) != 0;
+    const bool hasOsXsave = (regs[2] & (1u << 27)) != 0;
+    const bool hasAvx = (regs[2] & (1u << 28)) != 0;
+    if (!hasSse41)
+        return pm::SimdLevel::Scalar;
+    if (!hasOsXsave || !hasAvx || maxLeaf < 7)
+        return pm::SimdLevel::Sse41;
+
+    // OS must save YMM (and ZMM) registers on context switch
+    const uint64_t xcr0 = GetXcr0();
+    const bool osHasYmm = (xcr0 & 0x06) == 0x06;
+    const bool osHasZmm = (xcr0 & 0xE6) == 0xE6;
+
+    CpuId(7, 0, regs);
+    const bool hasAvx2 = (regs[1] & (1u << 5)) != 0;
+    const bool hasAvx512F = (regs[1] & (1u << 16)) != 0;
+    const bool hasAvx512BW = (regs[1] & (1u << 30)) != 0;
+    if (!osHasYmm || !hasAvx2)
+        return pm::SimdLevel::Sse41;
+    if (!osHasZmm || !hasAvx512F || !hasAvx512BW)
+        return pm::SimdLevel::Avx2;
+    return pm::SimdLevel::Avx512;
+#else
+    return pm::SimdLevel::Scalar;
+#endif
+}
+
+static const pm::SimdLevel sSupportedSimdLevel = DetectSimdLevel();
+static std::atomic<pm::SimdLevel> sSimdLevel{ sSupportedSimdLevel };
+
+pm::SimdLevel pm::CpuFeatures::GetSupportedSimdLevel()
+{
+    return sSupportedSimdLevel;
+}
+
+pm::SimdLevel pm::CpuFeatures::GetSimdLevel()
+{
+    return sSimdLevel.load(std::memory_order_relaxed);
+}
+
+void pm::CpuFeatures::SetSimdLevel(SimdLevel level)
+{
+    sSimdLevel = std::min(level, sSupportedSimdLevel);
+}
+
+const char* pm::CpuFeatures::SimdLevelToStr(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar:
+        return "Scalar";
+    case SimdLevel::Sse41:
+        return "SSE4.1";
+    case SimdLevel::Avx2:
+        return "AVX2";
+    case SimdLevel::Avx512:
+        return "AVX-512";
+    }
+    return "unknown";
+}
@@ -0,0 +1,60 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_CPU_FEATURES_H
+#define PM_CPU_FEATURES_H
+
+/* System */
+#include <cstdint>
+
+// Instruction set extensions can be used in functions marked by these macros
+// without compiling whole project for given CPU. The caller has to check the
+// CPU supports it first, see CpuFeatures::GetSimdLevel.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    #define PM_SIMD_X86 1
+    #if defined(_MSC_VER) && !defined(__clang__)
+        // MSVC allows all intrinsics anywhere
+        #define PM_TARGET_SSE41
+        #define PM_TARGET_AVX2
+        #define PM_TARGET_AVX512
+    #else
+        #define PM_TARGET_SSE41 __attribute__((target("sse4.1")))
+        #define PM_TARGET_AVX2 __attribute__((target("avx2")))
+        #define PM_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+    #endif
+#else
+    #define PM_SIMD_X86 0
+#endif
+
+namespace pm {
+
+/* Instruction set extensions for vectorized kernels, ordered by width.
+   Each level implies all lower ones. */
+enum class SimdLevel : int32_t
+{
+    Scalar = 0,
+    Sse41,  // SSE4.1
+    Avx2,   // AVX2
+    Avx512, // AVX-512 F and BW
+};
+
+/* Detects SIMD support of CPU and operating system at runtime. */
+class CpuFeatures final
+{
+public:
+    // Returns highest level supported by CPU and OS, detected only once
+    static SimdLevel GetSupportedSimdLevel();
+
+    // Returns level kernels should use, the supported one unless lowered
+    static SimdLevel GetSimdLevel();
+    // Limits the level used by kernels, e.g. to compare them in benchmark.
+    // Levels higher than supported one fall back to the supported one.
+    static void SetSimdLevel(SimdLevel level);
+
+    static const char* SimdLevelToStr(SimdLevel level);
+};
+
+} // namespace pm
+
+#endif /* PM_CPU_FEATURES_H */
@@ -912,6 +912,17 @@ unsigned int pm::FakeCamera::GetTargetFps() const
     return m_targetFps;
 }
 
+bool pm::FakeCamera::SetTargetFps(unsigned int targetFps)
+{
+    // Frame generator thread takes the readout time at start only
+    if (targetFps == 0 || m_isImaging)
+        return false;
+
+    m_targetFps = targetFps;
+    m_readoutTimeUs = 1000000.0 / targetFps;
+    return true;
+}
+
 void pm::FakeCamera::SetError(FakeCameraErrors error) const
 {
     m_error = error;
@@ -2663,8 +2674,20 @@ void pm::FakeCamera::FrameGeneratorLoop()
                 (m_frameGenFrameInfo.TimeStamp - m_frameGenFrameInfo.TimeStampBOF);
         }
 
+        // Pinned frame is still referenced outside (zero-copy acquisition).
+        // Drop new frame like real camera does when its buffer is full,
+        // the frame number is consumed so the gap is visible in callback.
+        const size_t bufferPos = m_frameGenFrameIndex % bufferFrameCount;
+        if (IsFramePinnedAt(bufferPos))
+        {
+            if (isSequence && m_frameGenFrameIndex + 1 >= acqFrameCount)
+                break;
+            m_frameGenFrameIndex++;
+            continue;
+        }
+
         // Set frame data
-        m_frameGenBufferPos = m_frameGenFrameIndex % bufferFrameCount;
+        m_frameGenBufferPos = bufferPos;
         const size_t frameBytes = m_frameAcqCfg.GetFrameBytes();
         void* dst = &m_buffer[m_frameGenBufferPos * frameBytes];
         const void* src = &m_frameGenBuffer[
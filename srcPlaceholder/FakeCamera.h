@@ -44,6 +44,8 @@ public:
 
 public:
     unsigned int GetTargetFps() const;
+    // Changes frame rate for next acquisition, fails while imaging
+    bool SetTargetFps(unsigned int targetFps);
 
 protected:
     template<typename T> friend class FakeParamBase;
@@ -80,6 +82,9 @@ public: // From Camera
     virtual bool GetLatestFrameIndex(size_t& index, bool suppressCamErrMsg = false)
         const override;
 
+    virtual bool HonorsFramePins() const override
+    { return true; }
+
 protected: // From Camera
     virtual bool AllocateBuffers(uint32_t frameCount, uint32_t frameBytes) override;
     virtual void DeleteBuffers() override;
@@ -140,8 +145,8 @@ private:
     static bool s_isInitialized; // Init state is common for all cameras
 
 private:
-    const unsigned int m_targetFps;
-    const double m_readoutTimeUs; // Calculated from FPS, in microseconds
+    unsigned int m_targetFps;
+    double m_readoutTimeUs; // Calculated from FPS, in microseconds
 
     std::map<ParamBase*, uint64_t> m_paramChangeHandleMap{};
 
@@ -4,9 +4,9 @@
 #include "backend/Frame.h"
 
 /* Local */
+#include "backend/AllocatorArena.h"
 #include "backend/AllocatorFactory.h"
 #include "backend/Log.h"
-#include "backend/PvcamRuntimeLoader.h"
 #include "backend/TaskSet_CopyMemory.h"
 #include "backend/UniqueThreadPool.h"
 
@@ -217,34 +217,6 @@ pm::Frame::Info::Info(uint32_t frameNr, uint64_t timestampBOF, uint64_t timestam
 {
 }
 
-pm::Frame::Info::Info(const Frame::Info& other)
-    : m_frameNr(other.m_frameNr),
-    m_timestampBOF(other.m_timestampBOF),
-    m_timestampEOF(other.m_timestampEOF),
-    m_readoutTime(other.m_readoutTime),
-    m_expTime(other.m_expTime),
-    m_colorWbScaleRed(other.m_colorWbScaleRed),
-    m_colorWbScaleGreen(other.m_colorWbScaleGreen),
-    m_colorWbScaleBlue(other.m_colorWbScaleBlue)
-{
-}
-
-pm::Frame::Info& pm::Frame::Info::operator=(const Frame::Info& other)
-{
-    if (&other != this)
-    {
-        m_frameNr = other.m_frameNr;
-        m_timestampBOF = other.m_timestampBOF;
-        m_timestampEOF = other.m_timestampEOF;
-        m_readoutTime = other.m_readoutTime;
-        m_expTime = other.m_expTime;
-        m_colorWbScaleRed = other.m_colorWbScaleRed;
-        m_colorWbScaleGreen = other.m_colorWbScaleGreen;
-        m_colorWbScaleBlue = other.m_colorWbScaleBlue;
-    }
-    return *this;
-}
-
 bool pm::Frame::Info::operator==(const Frame::Info& other) const
 {
     return m_frameNr == other.m_frameNr
@@ -338,18 +310,9 @@ pm::Frame::Frame(const AcqCfg& acqCfg, bool deepCopy,
 
     if (m_acqCfg.HasMetadata())
     {
-        if (!PvcamRuntimeLoader::Get()->hasMetadataFunctions())
+        if (!m_metadata.Setup(m_acqCfg.GetRoiCount()))
         {
-            Log::LogE("Failed to allocate frame metadata structure."
-                " Loaded PVCAM does not support metadata");
-        }
-        else
-        {
-            if (PV_OK != PVCAM->pl_md_create_frame_struct_cont(
-                        &m_metadata, m_acqCfg.GetRoiCount()))
-            {
-                Log::LogE("Failed to allocate frame metadata structure");
-            }
+            Log::LogE("Failed to allocate frame metadata structure");
         }
     }
 }
@@ -361,13 +324,7 @@ pm::Frame::~Frame()
     if (m_deepCopy)
     {
         // m_data must not be deleted on shallow copy
-        m_allocator->Free(m_data);
-    }
-
-    if (m_metadata)
-    {
-        // Ignore errors
-        PVCAM->pl_md_release_frame_struct(m_metadata);
+        m_allocator->Free(m_data.load());
     }
 }
 
@@ -391,77 +348,122 @@ std::shared_ptr<pm::Allocator> pm::Frame::GetAllocator() const
 
 void pm::Frame::SetDataPointer(void* data)
 {
-    std::lock_guard<std::shared_timed_mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
 
     DoSetDataPointer(data);
 }
 
+const void* pm::Frame::GetDataPointer() const
+{
+    return m_dataSrc.load(std::memory_order_acquire);
+}
+
 bool pm::Frame::CopyData()
 {
-    std::lock_guard<std::shared_timed_mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
 
     return DoCopyData();
 }
 
 const void* pm::Frame::GetData() const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
-
-    return m_data;
+    return m_data.load(std::memory_order_acquire);
 }
 
 bool pm::Frame::IsValid() const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
-
-    return m_isValid;
+    return m_isValid.load(std::memory_order_acquire);
 }
 
 void pm::Frame::Invalidate()
 {
-    std::lock_guard<std::shared_timed_mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
 
     DoInvalidate();
 }
 
 void pm::Frame::OverrideValidity(bool isValid)
 {
-    std::lock_guard<std::shared_timed_mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
 
     DoOverrideValidity(isValid);
 }
 
-const pm::Frame::Info& pm::Frame::GetInfo() const
+pm::Frame::Info pm::Frame::GetInfo() const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
-
-    return m_info;
+    return m_info.Load();
 }
 
 void pm::Frame::SetInfo(const Frame::Info& frameInfo)
 {
-    std::lock_guard<std::shared_timed_mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
 
     DoSetInfo(frameInfo);
 }
 
 const pm::Frame::Trajectories& pm::Frame::GetTrajectories() const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
+    const Frame::Trajectories* trajectories =
+        m_trajectoriesPtr.load(std::memory_order_acquire);
+    return (trajectories) ? *trajectories : sEmptyFrameTrajectories;
+}
+
+std::shared_ptr<const pm::Frame::Trajectories> pm::Frame::GetTrajectoriesSnapshot() const
+{
+    // The owning pointer is not atomic, guarded the same way as by writers
+    std::lock_guard<std::mutex> lock(m_mutex);
 
     return m_trajectories;
 }
 
 void pm::Frame::SetTrajectories(const Frame::Trajectories& trajectories)
 {
-    std::lock_guard<std::shared_timed_mutex> lock(m_mutex);
+    std::shared_ptr<const Frame::Trajectories> snapshot;
+    try
+    {
+        snapshot = std::make_shared<const Frame::Trajectories>(trajectories);
+    }
+    catch (...)
+    {
+        Log::LogE("Failed to allocate frame trajectories");
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    DoSetTrajectories(snapshot);
+}
+
+void pm::Frame::SetTrajectories(
+        std::shared_ptr<const Frame::Trajectories> trajectories)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
 
     DoSetTrajectories(trajectories);
 }
 
+double pm::Frame::GetArrivalTime() const
+{
+    return m_arrivalTime;
+}
+
+void pm::Frame::SetArrivalTime(double seconds)
+{
+    m_arrivalTime = seconds;
+}
+
+double pm::Frame::GetQueuedTime() const
+{
+    return m_queuedTime;
+}
+
+void pm::Frame::SetQueuedTime(double seconds)
+{
+    m_queuedTime = seconds;
+}
+
 bool pm::Frame::DecodeMetadata()
 {
-    std::lock_guard<std::shared_timed_mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
 
     if (!m_needsDecoding)
         return true;
@@ -472,22 +474,14 @@ bool pm::Frame::DecodeMetadata()
         return false;
     }
 
-    if (!PvcamRuntimeLoader::Get()->hasMetadataFunctions())
-    {
-        Log::LogE("Unable to decode frame. Loaded PVCAM does not support metadata");
-        return false;
-    }
-
-    const uns32 frameBytes = (uns32)m_acqCfg.GetFrameBytes();
+    const size_t frameBytes = m_acqCfg.GetFrameBytes();
 
-    if (PV_OK != PVCAM->pl_md_frame_decode(m_metadata, m_data, frameBytes))
+    if (!m_metadata.Decode(m_data, frameBytes))
     {
-        const int16 errId = PVCAM->pl_error_code();
-        char errMsg[ERROR_MSG_LEN] = "<unknown>";
-        PVCAM->pl_error_message(errId, errMsg);
+        const char* errMsg = m_metadata.GetError();
 
-        const uint8_t* dumpData = static_cast<uint8_t*>(m_data);
-        const uint32_t dumpDataBytes = std::min<uint32_t>(frameBytes, 32u);
+        const uint8_t* dumpData = static_cast<uint8_t*>(m_data.load());
+        const size_t dumpDataBytes = std::min<size_t>(frameBytes, 32u);
         std::ostringstream dumpStream;
         dumpStream << std::hex << std::uppercase << std::setfill('0');
         std::for_each(dumpData, dumpData + dumpDataBytes, [&dumpStream](uint8_t byte) {
@@ -495,16 +489,19 @@ bool pm::Frame::DecodeMetadata()
         });
 
         Log::LogE("Unable to decode frame %u (%s), addr: 0x%p, data: %s",
-                m_info.GetFrameNr(), errMsg, m_data, dumpStream.str().c_str());
+                m_info.Load().GetFrameNr(), errMsg, m_data.load(),
+                dumpStream.str().c_str());
 
         DoInvalidate();
         return false;
     }
 
+    const md_frame& metadata = m_metadata.GetFrame();
+
     m_roiBitmapValidCount = 0;
-    for (uint16_t roiIdx = 0; roiIdx < m_metadata->roiCount; ++roiIdx)
+    for (uint16_t roiIdx = 0; roiIdx < metadata.roiCount; ++roiIdx)
     {
-        const md_frame_roi& mdRoi = m_metadata->roiArray[roiIdx];
+        const md_frame_roi& mdRoi = metadata.roiArray[roiIdx];
 
         if (!(mdRoi.header->flags & PL_MD_ROI_FLAG_HEADER_ONLY))
         {
@@ -528,26 +525,6 @@ bool pm::Frame::DecodeMetadata()
                 return false;
             }
         }
-
-        if (mdRoi.extMdDataSize > 0)
-        {
-            md_ext_item_collection* collection = &m_extMetadata[mdRoi.header->roiNr];
-
-            // Extract extended metadata from ROI
-            if (PV_OK != PVCAM->pl_md_read_extended(collection, mdRoi.extMdData,
-                        mdRoi.extMdDataSize))
-            {
-                const int16 errId = PVCAM->pl_error_code();
-                char errMsg[ERROR_MSG_LEN] = "<unknown>";
-                PVCAM->pl_error_message(errId, errMsg);
-
-                Log::LogE("Failed to read ext. metadata for frame nr. %u (%s)",
-                        m_info.GetFrameNr(), errMsg);
-
-                DoInvalidate();
-                return false;
-            }
-        }
     }
 
     m_needsDecoding = false;
@@ -557,22 +534,27 @@ bool pm::Frame::DecodeMetadata()
 
 const md_frame* pm::Frame::GetMetadata() const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
+    return (m_acqCfg.HasMetadata()) ? &m_metadata.GetFrame() : nullptr;
+}
 
-    return m_metadata;
+const pm::MetadataDecoder::ExtItems* pm::Frame::GetExtMetadata() const
+{
+    return m_metadata.GetRoiExtItems();
 }
 
-const std::map<uint16_t, md_ext_item_collection>& pm::Frame::GetExtMetadata() const
+const pm::MetadataDecoder::ExtItems* pm::Frame::FindExtMetadata(uint16_t roiNr) const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
+    // Searches through decoded data, must not overlap with decoding
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-    return m_extMetadata;
+    const uint16_t roiIdx = m_metadata.FindRoiIndex(roiNr);
+    if (roiIdx >= m_metadata.GetFrame().roiCount)
+        return nullptr;
+    return &m_metadata.GetRoiExtItems()[roiIdx];
 }
 
 const std::vector<std::unique_ptr<pm::Bitmap>>& pm::Frame::GetRoiBitmaps() const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
-
     return m_roiBitmaps;
 }
 
@@ -593,8 +575,11 @@ size_t pm::Frame::GetRoiBitmapValidCount() const
 
 bool pm::Frame::Copy(const Frame& other, bool deepCopy)
 {
-    std::unique_lock<std::shared_timed_mutex> wrLock(m_mutex, std::defer_lock);
-    std::shared_lock<std::shared_timed_mutex> rdLock(other.m_mutex, std::defer_lock);
+    if (&other == this)
+        return true;
+
+    std::unique_lock<std::mutex> wrLock(m_mutex, std::defer_lock);
+    std::unique_lock<std::mutex> rdLock(other.m_mutex, std::defer_lock);
     std::lock(wrLock, rdLock);
 
     return DoCopy(other, *this, deepCopy);
@@ -602,13 +587,17 @@ bool pm::Frame::Copy(const Frame& other, bool deepCopy)
 
 std::shared_ptr<pm::Frame> pm::Frame::Clone(bool deepCopy) const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
 
     std::shared_ptr<pm::Frame> frame;
 
+    // Arena slots are reserved for pool frames, the clone lives on its own
+    const auto arena = std::dynamic_pointer_cast<AllocatorArena>(m_allocator);
+    const auto allocator = (arena) ? arena->GetUpstream() : m_allocator;
+
     try
     {
-        frame = std::make_shared<Frame>(m_acqCfg, deepCopy, m_allocator);
+        frame = std::make_shared<Frame>(m_acqCfg, deepCopy, allocator);
     }
     catch (...)
     {
@@ -639,7 +628,7 @@ bool pm::Frame::DoCopyData()
         return false;
     }
 
-    if (m_acqCfg.HasMetadata() && !m_metadata)
+    if (m_acqCfg.HasMetadata() && m_metadata.GetFrame().roiCapacity == 0)
     {
         Log::LogE("Invalid metadata pointer");
         return false;
@@ -659,12 +648,12 @@ bool pm::Frame::DoCopyData()
     }
     else
     {
-        m_data = m_dataSrc;
+        m_data.store(m_dataSrc, std::memory_order_release);
     }
 
     if (m_shallowInfo != sEmptyFrameInfo)
     {
-        m_info = m_shallowInfo;
+        m_info.Store(m_shallowInfo);
         m_shallowInfo = sEmptyFrameInfo;
     }
 
@@ -676,18 +665,14 @@ void pm::Frame::DoInvalidate()
     if (!m_isValid)
         return;
 
-    m_isValid = false;
+    m_isValid.store(false, std::memory_order_release);
 
-    m_info = sEmptyFrameInfo;
-    m_trajectories = sEmptyFrameTrajectories;
+    m_info.Store(sEmptyFrameInfo);
+    DoSetTrajectories(nullptr);
 
     m_needsDecoding = m_acqCfg.HasMetadata();
-    if (m_metadata)
-    {
-        // Invalidate metadata
-        m_metadata->roiCount = 0;
-    }
-    m_extMetadata.clear();
+    // Invalidate metadata
+    m_metadata.Reset();
 
     for (auto&& roiBitmap : m_roiBitmaps)
     {
@@ -698,7 +683,7 @@ void pm::Frame::DoInvalidate()
 
 bool pm::Frame::DoOverrideValidity(bool isValid)
 {
-    m_isValid = isValid;
+    m_isValid.store(isValid, std::memory_order_release);
 
     // For meta-frame, bitmaps are updated during decode, for non-meta-frame here
     if (isValid && !m_acqCfg.HasMetadata())
@@ -729,12 +714,14 @@ bool pm::Frame::DoOverrideValidity(bool isValid)
 
 void pm::Frame::DoSetInfo(const Frame::Info& frameInfo)
 {
-    m_info = frameInfo;
+    m_info.Store(frameInfo);
 }
 
-void pm::Frame::DoSetTrajectories(const Frame::Trajectories& trajectories)
+void pm::Frame::DoSetTrajectories(
+        std::shared_ptr<const Frame::Trajectories> trajectories)
 {
-    m_trajectories = trajectories;
+    m_trajectories = std::move(trajectories);
+    m_trajectoriesPtr.store(m_trajectories.get(), std::memory_order_release);
 }
 
 bool pm::Frame::DoCopy(const Frame& from, Frame& to, bool deepCopy) const
@@ -746,21 +733,21 @@ bool pm::Frame::DoCopy(const Frame& from, Frame& to, bool deepCopy) const
         return false;
     }
 
-    to.DoSetDataPointer(from.m_data);
+    to.DoSetDataPointer(from.m_data.load());
 
     if (deepCopy)
     {
         if (!to.DoCopyData())
             return false;
 
-        to.DoSetInfo(from.m_info);
+        to.DoSetInfo(from.m_info.Load());
         to.DoSetTrajectories(from.m_trajectories);
 
         to.m_shallowInfo = sEmptyFrameInfo;
     }
     else
     {
-        to.m_shallowInfo = from.m_info;
+        to.m_shallowInfo = from.m_info.Load();
     }
 
     return true;
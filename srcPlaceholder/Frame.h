@@ -9,19 +9,21 @@
 #include "backend/Allocator.h"
 #include "backend/Bitmap.h"
 #include "backend/BitmapFormat.h"
+#include "backend/MetadataDecoder.h"
 #include "backend/PrdFileFormat.h"
+#include "backend/SeqLock.h"
 
 /* PVCAM */
 #include "master.h"
 #include "pvcam.h" // rgn_type, md_frame
 
 /* System */
+#include <atomic>
 #include <cstdint>
 #include <cstring> // memset
 #include <map>
 #include <memory> // std::shared_ptr, std::unique_ptr
-#include <mutex> // std::lock_guard, std::unique_lock
-#include <shared_mutex> // std::shared_(timed_)mutex, std::shared_lock
+#include <mutex> // std::mutex, std::lock_guard, std::unique_lock
 #include <utility> // std::pair
 #include <vector>
 
@@ -113,8 +115,9 @@ public:
         Info(uint32_t frameNr, uint64_t timestampBOF, uint64_t timestampEOF,
                 uint32_t expTime, float colorWbScaleRed,
                 float colorWbScaleGreen, float colorWbScaleBlue);
-        Info(const Info& other);
-        Info& operator=(const Info& other);
+        // Trivially copyable so it can be guarded by SeqLock
+        Info(const Info& other) = default;
+        Info& operator=(const Info& other) = default;
         bool operator==(const Info& other) const;
         bool operator!=(const Info& other) const;
 
@@ -158,6 +161,8 @@ public:
     /* Stores only pointer to data without copying it.
        To copy the data itself call CopyData method. */
     void SetDataPointer(void* data);
+    /* Returns pointer stored by SetDataPointer, i.e. the source for CopyData. */
+    const void* GetDataPointer() const;
     /* Invalidates the frame and makes a deep copy with data pointer stored by
        SetDataPointers.
        This is usually done by another thread and it is *not* responsibility
@@ -178,16 +183,34 @@ public:
     /* Should be used in very rare cases where you know what you're doing */
     void OverrideValidity(bool isValid);
 
-    const Frame::Info& GetInfo() const;
+    /* Returns a copy, the info can be changed by other thread meanwhile. */
+    Frame::Info GetInfo() const;
     void SetInfo(const Frame::Info& frameInfo);
 
     /* Returns previously set list of <X, Y> coordinates in sensor area for each
        particle detected in frame data. For each particle first item in array
        are coordinates of given particle on this frame, next item is location of
        the same particle on previous frame, and so on up to max. number of
-       frames configured by user.*/
+       frames configured by user.
+       The reference is valid until trajectories are set again or the frame
+       is invalidated, use GetTrajectoriesSnapshot to keep them longer. */
     const Frame::Trajectories& GetTrajectories() const;
+    /* Returns the same trajectories as immutable snapshot shared with other
+       frames, null if there are none. */
+    std::shared_ptr<const Frame::Trajectories> GetTrajectoriesSnapshot() const;
+    /* Stores a copy of given trajectories. */
     void SetTrajectories(const Frame::Trajectories& trajectories);
+    /* Stores only reference to given snapshot, it must not change anymore. */
+    void SetTrajectories(std::shared_ptr<const Frame::Trajectories> trajectories);
+
+    /* Timestamps used by Acquisition for latency statistics, in seconds from
+       an arbitrary point in time. The arrival time is set once frame comes from camera,
+       the queued time whenever the frame enters next queue in the pipeline.
+       Not guarded by mutex, the frame is handled by one thread at a time. */
+    double GetArrivalTime() const;
+    void SetArrivalTime(double seconds);
+    double GetQueuedTime() const;
+    void SetQueuedTime(double seconds);
 
     /* Decodes frame metadata if AcqCfg::HasMetadata is set. The method returns
        immediately if metadata has already been decoded.
@@ -198,8 +221,12 @@ public:
        returned value is valid. */
     const md_frame* GetMetadata() const;
     /* Returns decoded extended metadata, e.g. with m0/m2 moments for particle
-       tracking. */
-    const std::map<uint16_t, md_ext_item_collection>& GetExtMetadata() const;
+       tracking. The array is parallel to md_frame::roiArray returned by
+       GetMetadata, it is null if frame has no metadata. */
+    const MetadataDecoder::ExtItems* GetExtMetadata() const;
+    /* Returns decoded extended metadata of ROI with given number, null if
+       there is no such ROI. */
+    const MetadataDecoder::ExtItems* FindExtMetadata(uint16_t roiNr) const;
 
     // Provides a Bitmap wrapper for each ROI in frame.
     // If AcqCfg::m_outputBmpRois is empty, Frame's c-tor allocates
@@ -229,7 +256,7 @@ private:
     void DoInvalidate();
     bool DoOverrideValidity(bool isValid);
     void DoSetInfo(const Frame::Info& frameInfo);
-    void DoSetTrajectories(const Frame::Trajectories& trajectories);
+    void DoSetTrajectories(std::shared_ptr<const Frame::Trajectories> trajectories);
     /* Uses DoSetDataPointer and DoCopyData methods to make the copy. It also
        copies frame info and trajectories. Metadata if available has to be
        decoded by calling DecodeMetadata method as we cannot safely do a deep copy. */
@@ -240,23 +267,30 @@ private:
     const bool m_deepCopy;
     const std::shared_ptr<Allocator> m_allocator;
 
-    // Using shared mutex for simple implementation or reader-writer lock.
-    // With C++17 change to std::shared_mutex.
-    mutable std::shared_timed_mutex m_mutex{};
+    // Serializes writers and operations like data copy or decoding.
+    // Getters of data, validity, info and trajectories don't lock it, they
+    // read atomics or SeqLock so readers never write shared cache lines.
+    mutable std::mutex m_mutex{};
 
-    void* m_data{ nullptr };
-    void* m_dataSrc{ nullptr };
+    std::atomic<void*> m_data{ nullptr };
+    std::atomic<void*> m_dataSrc{ nullptr };
 
-    bool m_isValid{ false };
+    std::atomic<bool> m_isValid{ false };
 
-    Frame::Info m_info{};
+    SeqLock<Frame::Info> m_info{};
+    // Accessed by writers only
     Frame::Info m_shallowInfo{};
-    Frame::Trajectories m_trajectories{};
+    // Shared by frames till replaced, null if frame has no trajectories.
+    // Accessed by writers only, readers use the raw pointer published below.
+    std::shared_ptr<const Frame::Trajectories> m_trajectories{};
+    std::atomic<const Frame::Trajectories*> m_trajectoriesPtr{ nullptr };
+
+    double m_arrivalTime{ 0.0 };
+    double m_queuedTime{ 0.0 };
 
     bool m_needsDecoding{ false };
-    md_frame* m_metadata{ nullptr };
-    // Returns map<roiNr, md_ext_item_collection>
-    std::map<uint16_t, md_ext_item_collection> m_extMetadata{};
+    // Decodes metadata into arrays allocated once for max. number of ROIs
+    MetadataDecoder m_metadata{};
 
     std::vector<std::unique_ptr<Bitmap>> m_roiBitmaps{};
     std::vector<rgn_type> m_roiBitmapRegions{};
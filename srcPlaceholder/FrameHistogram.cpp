@@ -0,0 +1,135 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/FrameHistogram.h"
+
+/* Local */
+#include "backend/exceptions/Exception.h"
+#include "backend/PixelKernels.h"
+
+/* System */
+#include <algorithm>
+#include <cmath>
+
+pm::FrameHistogram::FrameHistogram()
+{
+    Reset(0);
+}
+
+void pm::FrameHistogram::Reset(uint16_t bitDepth)
+{
+    const uint16_t binBits = std::min(bitDepth, cMaxBinBits);
+
+    m_bitDepth = bitDepth;
+    m_binShift = bitDepth - binBits;
+    m_bins.assign((size_t)1 << binBits, 0);
+    m_pixelCount = 0;
+}
+
+void pm::FrameHistogram::Clear()
+{
+    std::fill(m_bins.begin(), m_bins.end(), 0);
+    m_pixelCount = 0;
+}
+
+bool pm::FrameHistogram::IsEmpty() const
+{
+    return m_pixelCount == 0;
+}
+
+uint16_t pm::FrameHistogram::GetBitDepth() const
+{
+    return m_bitDepth;
+}
+
+uint32_t pm::FrameHistogram::GetBinCount() const
+{
+    return static_cast<uint32_t>(m_bins.size());
+}
+
+uint16_t pm::FrameHistogram::GetBinShift() const
+{
+    return m_binShift;
+}
+
+uint32_t pm::FrameHistogram::GetBinIndex(uint32_t value) const
+{
+    return std::min(value >> m_binShift, GetBinCount() - 1);
+}
+
+double pm::FrameHistogram::GetBinMinValue(uint32_t binIdx) const
+{
+    return static_cast<double>((uint64_t)binIdx << m_binShift);
+}
+
+double pm::FrameHistogram::GetBinMaxValue(uint32_t binIdx) const
+{
+    return static_cast<double>((((uint64_t)binIdx + 1) << m_binShift) - 1);
+}
+
+const std::vector<uint32_t>& pm::FrameHistogram::GetBins() const
+{
+    return m_bins;
+}
+
+uint64_t pm::FrameHistogram::GetPixelCount() const
+{
+    return m_pixelCount;
+}
+
+void pm::FrameHistogram::Add(const FrameHistogram& histogram)
+{
+    if (histogram.m_bitDepth != m_bitDepth)
+        throw Exception("Unable to add histogram with different bit depth");
+
+    Add(histogram.m_bins.data(), histogram.m_pixelCount);
+}
+
+void pm::FrameHistogram::Add(const uint32_t* bins, uint64_t pixelCount)
+{
+    if (pixelCount == 0)
+        return;
+
+    PixelKernels::AddCounts(m_bins.data(), bins, m_bins.size());
+    m_pixelCount += pixelCount;
+}
+
+bool pm::FrameHistogram::GetPercentileLimits(double lowPercent,
+        double highPercent, double& min, double& max) const
+{
+    if (m_pixelCount == 0)
+        return false;
+
+    lowPercent = std::min(std::max(lowPercent, 0.0), 100.0);
+    highPercent = std::min(std::max(highPercent, lowPercent), 100.0);
+
+    // Number of pixels allowed to be clipped at each end
+    const auto lowClip = static_cast<uint64_t>(
+            ::floor(m_pixelCount * lowPercent / 100.0));
+    const auto highClip = static_cast<uint64_t>(
+            ::floor(m_pixelCount * (100.0 - highPercent) / 100.0));
+
+    const uint32_t binCount = GetBinCount();
+
+    uint32_t minIdx = 0;
+    uint64_t count = 0;
+    for (; minIdx < binCount - 1; ++minIdx)
+    {
+        count += m_bins[minIdx];
+        if (count > lowClip)
+            break;
+    }
+
+    uint32_t maxIdx = binCount - 1;
+    count = 0;
+    for (; maxIdx > minIdx; --maxIdx)
+    {
+        count += m_bins[maxIdx];
+        if (count > highClip)
+            break;
+    }
+
+    min = GetBinMinValue(minIdx);
+    max = GetBinMaxValue(maxIdx);
+    return true;
+}
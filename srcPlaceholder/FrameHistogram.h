@@ -0,0 +1,67 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_FRAME_HISTOGRAM_H
+#define PM_FRAME_HISTOGRAM_H
+
+/* System */
+#include <cstdint>
+#include <vector>
+
+namespace pm {
+
+/* Pixel counts per value. Each value up to 16 bits has its own bin, with
+   higher bit depths the values are shifted right to keep 65536 bins. */
+class FrameHistogram
+{
+public:
+    static constexpr uint16_t cMaxBinBits = 16;
+
+public:
+    explicit FrameHistogram();
+
+public:
+    // Sets the bins for given bit depth and clears all counts
+    void Reset(uint16_t bitDepth);
+    // Clears all counts, the bins stay the same
+    void Clear();
+
+    // Histogram is empty if there is no pixel
+    bool IsEmpty() const;
+
+    uint16_t GetBitDepth() const;
+    uint32_t GetBinCount() const;
+    // Pixel value shifted right by this number of bits is the bin index
+    uint16_t GetBinShift() const;
+
+    // Values beyond the bit depth end up in the last bin
+    uint32_t GetBinIndex(uint32_t value) const;
+    // Returns the lowest and highest pixel value counted in given bin
+    double GetBinMinValue(uint32_t binIdx) const;
+    double GetBinMaxValue(uint32_t binIdx) const;
+
+    const std::vector<uint32_t>& GetBins() const;
+    uint64_t GetPixelCount() const;
+
+    // Adds counts of the histogram with same bit depth
+    void Add(const FrameHistogram& histogram);
+    // Adds GetBinCount() counts from given array, e.g. computed by tasks
+    void Add(const uint32_t* bins, uint64_t pixelCount);
+
+    // Finds values that clip given percentage of darkest and brightest
+    // pixels, e.g. 0.1 and 99.9. Unlike raw min. and max. they don't move
+    // with a few hot or dead pixels. Returns false if histogram is empty.
+    bool GetPercentileLimits(double lowPercent, double highPercent,
+            double& min, double& max) const;
+
+private:
+    uint16_t m_bitDepth{ 0 };
+    uint16_t m_binShift{ 0 };
+    uint64_t m_pixelCount{ 0 };
+    std::vector<uint32_t> m_bins{};
+};
+
+} // namespace
+
+#endif
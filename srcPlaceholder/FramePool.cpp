@@ -3,7 +3,11 @@
 /******************************************************************************/
 #include "backend/FramePool.h"
 
+/* Local */
+#include "backend/AllocatorFactory.h"
+
 /* System */
+#include <algorithm>
 #include <functional>
 
 #ifdef _WIN32
@@ -23,24 +27,87 @@ const static auto sPageSize = []() -> size_t
 #endif
 }();
 
+// Decreases counter by value, never below zero
+static void DecreaseCount(std::atomic<size_t>& counter, size_t value)
+{
+    size_t count = counter.load(std::memory_order_relaxed);
+    while (!counter.compare_exchange_weak(count,
+                (count > value) ? count - value : 0, std::memory_order_relaxed))
+    {
+    }
+}
+
 pm::FramePool::FramePool()
 {
+    // Without the ring all ready frames go to overflow queue
+    m_ring.Setup(cRingCapacity);
+}
+
+pm::FramePool::~FramePool()
+{
+    if (m_growThread)
+    {
+        m_growExitFlag = true;
+        m_growWaiter.WakeUp();
+        if (m_growThread->joinable())
+            m_growThread->join();
+        delete m_growThread;
+    }
 }
 
 void pm::FramePool::Setup(Frame::AcqCfg acqCfg, bool deepCopy,
         std::shared_ptr<Allocator> allocator)
 {
+    std::lock_guard<std::mutex> allocLock(m_allocMutex);
     std::lock_guard<std::mutex> lock(m_mutex);
 
-    if (!m_queue.empty() && !MatchesSetup(acqCfg, deepCopy))
+    const bool matchesSetup = MatchesSetup(acqCfg, deepCopy);
+    if (!matchesSetup)
     {
+        // Frames taken so far get released once returned
+        m_generation++;
+
         // Release all frames, frame configuration has changed
+        std::unique_ptr<Frame> frame;
+        while (m_ring.Pop(frame))
+        {
+            frame = nullptr;
+        }
         std::queue<std::unique_ptr<Frame>>().swap(m_queue);
+        m_queueSize = 0;
+        m_frameCount = 0;
     }
 
+    // Frames already created keep their arena, new one is needed if frame
+    // size or allocator changes
+    const bool needsNewArena = !m_arena || !matchesSetup
+        || (allocator && allocator != m_arena->GetUpstream());
+
     m_acqCfg = acqCfg;
     m_deepCopy = deepCopy;
     m_allocator = allocator;
+    m_growFailed = false;
+
+    if (!m_deepCopy || m_acqCfg.GetFrameBytes() == 0)
+    {
+        m_arena = nullptr;
+    }
+    else if (needsNewArena)
+    {
+        auto upstream = (allocator)
+            ? allocator
+            : AllocatorFactory::Create(m_acqCfg.GetAllocatorType());
+        try
+        {
+            m_arena = (upstream)
+                ? std::make_shared<AllocatorArena>(upstream, m_acqCfg.GetFrameBytes())
+                : nullptr;
+        }
+        catch (...)
+        {
+            m_arena = nullptr;
+        }
+    }
 }
 
 bool pm::FramePool::MatchesSetup(const Frame& frame) const
@@ -52,89 +119,164 @@ bool pm::FramePool::MatchesSetup(const Frame& frame) const
 
 bool pm::FramePool::IsEmpty() const
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-
-    return m_queue.empty();
+    return GetSize() == 0;
 }
 
 void pm::FramePool::Clear()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-
-    if (m_queue.empty())
-        return;
+    size_t count = 0;
+    std::unique_ptr<Frame> frame;
+    while (PopReady(frame))
+    {
+        frame = nullptr;
+        count++;
+    }
 
-    std::queue<std::unique_ptr<Frame>>().swap(m_queue);
+    DecreaseCount(m_frameCount, count);
 }
 
 size_t pm::FramePool::GetSize() const
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-
-    return m_queue.size();
+    return m_ring.GetSize() + m_queueSize.load(std::memory_order_relaxed);
 }
 
 std::shared_ptr<pm::Frame> pm::FramePool::TakeFrame()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-
     std::unique_ptr<Frame> frame = nullptr;
 
-    if (m_queue.empty())
+    while (PopReady(frame))
     {
-        frame = std::move(AllocateNewFrame());
+        // Frame returned while Setup was changing it, not thread-safe with
+        // this method so the setup can be accessed without lock
+        if (MatchesSetup(frame->GetAcqCfg(), frame->UsesDeepCopy()))
+            break;
+        frame = nullptr;
     }
-    else
+
+    if (m_growChunkFrames.load(std::memory_order_relaxed) > 0)
     {
-        frame = std::move(m_queue.front());
-        m_queue.pop();
+        // Let the grow thread refill the pool in advance
+        if (NeedsGrowth())
+        {
+            m_growWaiter.Notify();
+        }
+        if (!frame)
+            return nullptr;
     }
 
     if (!frame)
-        return nullptr;
+    {
+        // Growth disabled, allocate on demand
+        std::lock_guard<std::mutex> allocLock(m_allocMutex);
+        frame = std::move(AllocateNewFrame());
+        if (!frame)
+            return nullptr;
+
+        m_frameCount++;
+    }
+
+    const uint64_t generation = m_generation.load(std::memory_order_relaxed);
 
     // Transform unique_ptr to shared_ptr with custom deleter
     return std::shared_ptr<Frame>(frame.release(),
-            std::bind(&FramePool::PushBack, this, std::placeholders::_1));
+            std::bind(&FramePool::PushBack, this, std::placeholders::_1,
+                generation));
 }
 
 bool pm::FramePool::EnsureReadyFrames(size_t count, int ops)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> allocLock(m_allocMutex);
+
+    m_growFailed = false;
 
     if (ops & FramePool::Ops::Shrink)
     {
         // Release surplus frames
-        while (m_queue.size() > count)
+        std::unique_ptr<Frame> frame;
+        while (GetSize() > count && PopReady(frame))
+        {
+            frame = nullptr;
+            DecreaseCount(m_frameCount, 1);
+        }
+
+        if (m_arena)
         {
-            m_queue.pop();
+            // Return memory of released frames if whole chunks are unused
+            m_arena->ReleaseFreeChunks();
         }
     }
 
+    const size_t readyCount = GetSize();
+    const size_t missingCount = (readyCount < count) ? count - readyCount : 0;
+
+    // Allocate missing ready-to-use frames without blocking TakeFrame
     const bool doPrefetch = m_deepCopy && (ops & FramePool::Ops::Prefetch);
+    std::vector<std::unique_ptr<Frame>> frames;
+    const bool allocated = AllocateNewFrames(missingCount, doPrefetch, frames);
 
-    // Allocate missing ready-to-use frames
-    while (m_queue.size() < count)
+    m_frameCount += frames.size();
+    for (auto& frame : frames)
     {
-        std::unique_ptr<Frame> frame = std::move(AllocateNewFrame());
-        if (!frame)
-            return false;
+        PushReady(frame);
+    }
+
+    return allocated;
+}
+
+void pm::FramePool::SetGrowth(size_t minReadyFrames, size_t chunkFrames)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_growMinReadyFrames = minReadyFrames;
+        m_growChunkFrames = chunkFrames;
+        m_growFailed = false;
 
-        if (doPrefetch)
+        if (chunkFrames > 0 && !m_growThread)
         {
-            // HACK: The const casted out for now
-            uint8_t* data = (uint8_t*)frame->GetData();
-            const size_t frameBytes = m_acqCfg.GetFrameBytes();
-            for (size_t n = 0; n < frameBytes; n += sPageSize)
+            m_growThread = new(std::nothrow) std::thread(
+                    &FramePool::GrowThreadFunc, this);
+            if (!m_growThread)
             {
-                data[n] = 0xA5;
+                // Fall back to allocation on demand
+                m_growChunkFrames = 0;
             }
         }
-
-        m_queue.push(std::move(frame));
     }
+    m_growWaiter.WakeUp();
+}
 
-    return true;
+bool pm::FramePool::IsGrowthEnabled() const
+{
+    return m_growChunkFrames.load(std::memory_order_relaxed) > 0;
+}
+
+void pm::FramePool::SetGrowthAffinity(const CpuAffinity::CpuSet& cpus,
+        int memNode)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_growCpus = cpus;
+    m_growMemNode = memNode;
+    m_growAffinityChanged = true;
+}
+
+void pm::FramePool::SetMaxFrames(size_t maxFrames)
+{
+    m_maxFrames = maxFrames;
+    m_growWaiter.WakeUp();
+}
+
+size_t pm::FramePool::GetFrameCount() const
+{
+    return m_frameCount;
+}
+
+void pm::FramePool::SetReleaseHandler(std::function<void(Frame&)> handler)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_releaseHandler = handler;
 }
 
 bool pm::FramePool::MatchesSetup(Frame::AcqCfg acqCfg, bool deepCopy) const
@@ -149,30 +291,205 @@ std::unique_ptr<pm::Frame> pm::FramePool::AllocateNewFrame()
     if (m_acqCfg.GetFrameBytes() == 0)
         return nullptr;
 
+    // The data slot has to be ready before the frame is constructed
+    if (m_deepCopy && (!m_arena || !m_arena->Reserve(1)))
+        return nullptr;
+
     try
     {
-        frame = std::make_unique<Frame>(m_acqCfg, m_deepCopy, m_allocator);
+        frame = std::make_unique<Frame>(m_acqCfg, m_deepCopy,
+                (m_deepCopy) ? m_arena : m_allocator);
     }
     catch (...)
     {
     }
 
+    if (frame && m_deepCopy && !frame->GetData())
+        return nullptr;
+
     return frame;
 }
 
-void pm::FramePool::PushBack(Frame* frame)
+bool pm::FramePool::AllocateNewFrames(size_t count, bool prefetch,
+        std::vector<std::unique_ptr<Frame>>& frames)
+{
+    if (count == 0)
+        return true;
+
+    // Data for all frames in one chunk
+    if (m_deepCopy && (!m_arena || !m_arena->Reserve(count)))
+        return false;
+
+    try
+    {
+        frames.reserve(frames.size() + count);
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    for (size_t n = 0; n < count; ++n)
+    {
+        std::unique_ptr<Frame> frame = std::move(AllocateNewFrame());
+        if (!frame)
+            return false;
+
+        if (prefetch)
+        {
+            // HACK: The const casted out for now
+            uint8_t* data = (uint8_t*)frame->GetData();
+            const size_t frameBytes = m_acqCfg.GetFrameBytes();
+            for (size_t n = 0; n < frameBytes; n += sPageSize)
+            {
+                data[n] = 0xA5;
+            }
+        }
+
+        frames.push_back(std::move(frame));
+    }
+
+    return true;
+}
+
+void pm::FramePool::PushBack(Frame* frame, uint64_t generation)
 {
     if (!frame)
         return;
 
-    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_releaseHandler)
+    {
+        m_releaseHandler(*frame);
+    }
 
-    if (!MatchesSetup(frame->GetAcqCfg(), frame->UsesDeepCopy()))
+    if (generation != m_generation.load(std::memory_order_acquire))
     {
         delete frame;
         return;
     }
 
     frame->Invalidate();
-    m_queue.push(std::move(std::unique_ptr<Frame>(frame)));
+    std::unique_ptr<Frame> readyFrame(frame);
+    PushReady(readyFrame);
+}
+
+void pm::FramePool::PushReady(std::unique_ptr<Frame>& frame)
+{
+    if (m_ring.Push(frame))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_queue.push(std::move(frame));
+    m_queueSize = m_queue.size();
+}
+
+bool pm::FramePool::PopReady(std::unique_ptr<Frame>& frame)
+{
+    if (m_ring.Pop(frame))
+        return true;
+
+    if (m_queueSize.load(std::memory_order_relaxed) == 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_queue.empty())
+        return false;
+
+    frame = std::move(m_queue.front());
+    m_queue.pop();
+
+    // Move some frames to ring so next calls don't lock again
+    while (!m_queue.empty() && m_ring.GetSize() < m_ring.GetCapacity() / 2)
+    {
+        if (!m_ring.Push(m_queue.front()))
+            break;
+        m_queue.pop();
+    }
+    m_queueSize = m_queue.size();
+
+    return true;
+}
+
+bool pm::FramePool::NeedsGrowth() const
+{
+    const size_t maxFrames = m_maxFrames.load(std::memory_order_relaxed);
+    return m_growChunkFrames.load(std::memory_order_relaxed) > 0
+        && !m_growFailed.load(std::memory_order_relaxed)
+        && GetSize() < m_growMinReadyFrames.load(std::memory_order_relaxed)
+        && (maxFrames == 0
+                || m_frameCount.load(std::memory_order_relaxed) < maxFrames);
+}
+
+void pm::FramePool::GrowThreadFunc()
+{
+    // Inherited from the thread that enabled growth, restored for no node
+    CpuAffinity::MemPolicy initialMemPolicy;
+    const bool hasInitialMemPolicy =
+        CpuAffinity::GetCurrentThreadMemPolicy(initialMemPolicy);
+    // Without CPUs the thread is touched only to undo previous pinning
+    bool isPinned = false;
+
+    for (;;)
+    {
+        m_growWaiter.Wait([this]() {
+            return m_growExitFlag.load(std::memory_order_relaxed) || NeedsGrowth();
+        });
+        if (m_growExitFlag)
+            break;
+
+        // Setup cannot change while allocating, the frames match it.
+        // Data pages are touched here so it doesn't happen in acquisition.
+        std::lock_guard<std::mutex> allocLock(m_allocMutex);
+
+        // Conditions could change while waiting for allocation lock
+        if (!NeedsGrowth())
+            continue;
+
+        // Frames are prefaulted here, on node local to the acquisition
+        if (m_growAffinityChanged.exchange(false))
+        {
+            CpuAffinity::CpuSet cpus;
+            int memNode;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                cpus = m_growCpus;
+                memNode = m_growMemNode;
+            }
+            if (!cpus.empty() || isPinned)
+            {
+                // Empty set restores CPUs the process was started with
+                CpuAffinity::PinCurrentThread(cpus);
+                isPinned = !cpus.empty();
+            }
+            if (memNode >= 0)
+                CpuAffinity::SetCurrentThreadMemNode(memNode);
+            else if (hasInitialMemPolicy)
+                CpuAffinity::SetCurrentThreadMemPolicy(initialMemPolicy);
+        }
+
+        size_t count = m_growChunkFrames;
+        const size_t maxFrames = m_maxFrames;
+        const size_t frameCount = m_frameCount;
+        if (maxFrames > 0)
+        {
+            count = (frameCount < maxFrames)
+                ? std::min(count, maxFrames - frameCount) : 0;
+        }
+
+        std::vector<std::unique_ptr<Frame>> frames;
+        const bool allocated = AllocateNewFrames(count, m_deepCopy, frames);
+
+        m_frameCount += frames.size();
+        for (auto& frame : frames)
+        {
+            PushReady(frame);
+        }
+        if (!allocated)
+        {
+            // Don't try again and again in loop, e.g. when out of memory
+            m_growFailed = true;
+        }
+    }
 }
@@ -6,12 +6,21 @@
 #define PM_FRAME_POOL_H
 
 /* Local */
+#include "backend/AllocatorArena.h"
+#include "backend/CpuAffinity.h"
 #include "backend/Frame.h"
+#include "backend/MpmcRing.h"
+#include "backend/SpinParkWaiter.h"
 
 /* System */
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <thread>
+#include <vector>
 
 namespace pm {
 
@@ -27,8 +36,11 @@ public:
 
 public:
     explicit FramePool();
+    ~FramePool();
 
 public:
+    /* Must not be called concurrently with TakeFrame. Frames taken before
+    with different setup are released once returned. */
     void Setup(Frame::AcqCfg acqCfg, bool deepCopy,
             std::shared_ptr<Allocator> allocator = nullptr);
     bool MatchesSetup(const Frame& frame) const;
@@ -39,25 +51,101 @@ public:
     size_t GetSize() const;
 
     /* Returns one Frame, either from pool or newly allocated.
+    With growth enabled it never allocates, it returns null if pool is empty.
     PushBack is intentionally private. Once the returned shared_ptr gets
-    out of scope, custom deleter will return it automatically to the pool. */
+    out of scope, custom deleter will return it automatically to the pool.
+    Ready frames are kept in lock-free ring so taking frame in one thread and
+    returning others from any number of threads don't block each other. */
     std::shared_ptr<Frame> TakeFrame();
 
     bool EnsureReadyFrames(size_t count, int ops = FramePool::Ops::None);
 
+    /* Enables growing in background thread. Once there is less than
+    minReadyFrames frames in pool, chunkFrames new frames are allocated at
+    once, with data in one contiguous block.
+    Zero chunkFrames disables the growth, TakeFrame then allocates frames
+    on demand itself. */
+    void SetGrowth(size_t minReadyFrames, size_t chunkFrames);
+    // With growth enabled, null from TakeFrame means only the pool is empty
+    bool IsGrowthEnabled() const;
+    /* Restricts the grow thread to given CPUs and makes it allocate frames on
+    given NUMA node, -1 keeps the memory policy the thread started with.
+    Applied before next growth. */
+    void SetGrowthAffinity(const CpuAffinity::CpuSet& cpus, int memNode);
+    /* Limits the growth, the total number of frames doesn't exceed maxFrames.
+    Zero means no limit. Can be changed any time, e.g. when memory budget
+    changes, frames over the limit are not released. */
+    void SetMaxFrames(size_t maxFrames);
+    // Returns number of frames owned by pool, ready ones and taken ones
+    size_t GetFrameCount() const;
+
+    /* Sets function invoked for every frame returned to the pool before it is
+    invalidated or released, e.g. to release a resource the frame references.
+    It has to be set before any frame is taken. It is invoked concurrently
+    from all threads returning frames, it must be thread-safe. */
+    void SetReleaseHandler(std::function<void(Frame&)> handler);
+
 private:
     bool MatchesSetup(Frame::AcqCfg acqCfg, bool deepCopy) const;
+    // Both require m_allocMutex to be locked
     std::unique_ptr<Frame> AllocateNewFrame();
+    bool AllocateNewFrames(size_t count, bool prefetch,
+            std::vector<std::unique_ptr<Frame>>& frames);
     // Custom deleter for std::shared_ptr<Frame>
-    void PushBack(Frame* frame);
+    void PushBack(Frame* frame, uint64_t generation);
+
+    // Put frame to ring, to overflow queue if full
+    void PushReady(std::unique_ptr<Frame>& frame);
+    // Takes frame from ring, from overflow queue if empty
+    bool PopReady(std::unique_ptr<Frame>& frame);
+
+    bool NeedsGrowth() const;
+    // The function performs in m_growThread, allocates frames in advance
+    void GrowThreadFunc();
 
 private:
+    // Holds all ready frames unless there are too many of them
+    static constexpr size_t cRingCapacity = 1024;
+
+    MpmcRing<std::unique_ptr<Frame>> m_ring{};
+
+    // Guards the overflow queue and the setup
     mutable std::mutex m_mutex{};
     std::queue<std::unique_ptr<Frame>> m_queue{};
+    // Checked without lock so TakeFrame locks only if there is something
+    std::atomic<size_t> m_queueSize{ 0 };
+    // Number of frames with current setup, ready and taken
+    std::atomic<size_t> m_frameCount{ 0 };
+    // Incremented on every setup change, frames taken with older one are
+    // released when returned
+    std::atomic<uint64_t> m_generation{ 0 };
+
+    // Serializes allocation of new frames, locked before m_mutex if both.
+    // Setup changes are done with both locked.
+    std::mutex m_allocMutex{};
 
     pm::Frame::AcqCfg m_acqCfg{};
     bool m_deepCopy{ true };
     std::shared_ptr<Allocator> m_allocator{};
+    // Data of deep copy frames is carved from this arena
+    std::shared_ptr<AllocatorArena> m_arena{};
+    std::function<void(Frame&)> m_releaseHandler{};
+
+    // Growth members are read by TakeFrame and grow thread without lock
+    std::atomic<size_t> m_growMinReadyFrames{ 0 };
+    std::atomic<size_t> m_growChunkFrames{ 0 };
+    std::atomic<size_t> m_maxFrames{ 0 };
+    // Set if the last growth failed, not retried until EnsureReadyFrames
+    // or Setup is called
+    std::atomic<bool> m_growFailed{ false };
+    std::atomic<bool> m_growExitFlag{ false };
+    // Guarded by m_mutex, the grow thread applies them if flag is set
+    CpuAffinity::CpuSet m_growCpus{};
+    int m_growMemNode{ -1 };
+    std::atomic<bool> m_growAffinityChanged{ false };
+    // TakeFrame only pays for a fence unless the grow thread is parked
+    SpinParkWaiter m_growWaiter{};
+    std::thread* m_growThread{ nullptr };
 };
 
 } // namespace
@@ -33,6 +33,8 @@ void pm::FrameProcessor::Invalidate()
 
     m_stats.Clear();
     m_roiStats.clear();
+
+    m_histogram.Clear();
 }
 
 void pm::FrameProcessor::SetFrame(std::shared_ptr<Frame> frame)
@@ -185,6 +187,65 @@ const std::vector<std::unique_ptr<pm::Bitmap>>&
     return m_rgb8bitBitmaps;
 }
 
+void pm::FrameProcessor::SetRgb8bitPixelType(BitmapPixelType pixelType)
+{
+    m_rgb8bitPixelType = pixelType;
+}
+
+pm::BitmapPixelType pm::FrameProcessor::GetRgb8bitPixelType() const
+{
+    return m_rgb8bitPixelType;
+}
+
+void pm::FrameProcessor::CovertToRgb8bitWithStats(UseBmp useBmp,
+        double min, double max, bool autoConbright, int brightness, int contrast,
+        bool withHistogram)
+{
+    if (!m_frame || !m_frame->IsValid())
+        return;
+
+    m_stats.Clear();
+
+    const size_t count = m_validRoiCount;
+    if (count == 0)
+    {
+        if (withHistogram)
+            m_histogram.Clear();
+        return;
+    }
+
+    auto& srcBitmaps = GetBitmaps(useBmp);
+    auto& srcBmp = srcBitmaps[0];
+    TaskSet_ConvertToRgb8::UpdateLookupMap(m_convToRgb8bitLookupMap,
+            srcBmp->GetFormat(), min, max, autoConbright, brightness, contrast);
+
+    if (withHistogram)
+    {
+        const auto bitDepth = srcBmp->GetFormat().GetBitDepth();
+        if (m_histogram.GetBitDepth() != bitDepth)
+            m_histogram.Reset(bitDepth);
+        else
+            m_histogram.Clear();
+    }
+
+    for (uint16_t roiIdx = 0; roiIdx < count; ++roiIdx)
+    {
+        DoConvertRoiToRgb8bitWithStats(roiIdx, useBmp,
+                min, max, autoConbright, brightness, contrast, withHistogram);
+    }
+
+    // Histogram counts are added to m_histogram in Wait, one ROI at a time
+    for (uint16_t roiIdx = 0; roiIdx < count; ++roiIdx)
+    {
+        if (!m_tasksConvToRgb8WithStatsActive[roiIdx])
+            continue;
+        m_tasksConvToRgb8WithStats[roiIdx]->Wait();
+        m_tasksConvToRgb8WithStatsActive[roiIdx] = false;
+
+        m_stats.Add(m_roiStats[roiIdx]);
+    }
+}
+
 void pm::FrameProcessor::ComputeStats(UseBmp useBmp)
 {
     if (!m_frame || !m_frame->IsValid())
@@ -234,6 +295,55 @@ const std::vector<pm::FrameStats>& pm::FrameProcessor::GetRoiStats() const
     return m_roiStats;
 }
 
+void pm::FrameProcessor::ComputeHistogram(UseBmp useBmp)
+{
+    if (!m_frame || !m_frame->IsValid())
+        return;
+
+    const size_t count = m_validRoiCount;
+    if (count == 0)
+    {
+        m_histogram.Clear();
+        return;
+    }
+
+    auto& srcBitmaps = GetBitmaps(useBmp);
+    const auto bitDepth = srcBitmaps[0]->GetFormat().GetBitDepth();
+    if (m_histogram.GetBitDepth() != bitDepth)
+        m_histogram.Reset(bitDepth);
+    else
+        m_histogram.Clear();
+
+    if (!m_taskHistogram)
+    {
+        m_taskHistogram = std::make_unique<TaskSet_ComputeHistogram>(
+                UniqueThreadPool::Get().GetPool());
+    }
+
+    for (uint16_t roiIdx = 0; roiIdx < count; ++roiIdx)
+    {
+        m_taskHistogram->SetUp(srcBitmaps[roiIdx].get(), &m_histogram);
+        m_taskHistogram->Execute();
+        m_taskHistogram->Wait();
+    }
+}
+
+const pm::FrameHistogram& pm::FrameProcessor::GetHistogram() const
+{
+    return m_histogram;
+}
+
+bool pm::FrameProcessor::ComputePercentileLimits(double lowPercent,
+        double highPercent, double& min, double& max, UseBmp useBmp)
+{
+    if (!m_frame || !m_frame->IsValid())
+        return false;
+
+    ComputeHistogram(useBmp);
+
+    return m_histogram.GetPercentileLimits(lowPercent, highPercent, min, max);
+}
+
 void pm::FrameProcessor::Recompose(UseBmp useBmp,
         Bitmap* dstBmp, uint16_t dstOffX, uint16_t dstOffY)
 {
@@ -310,6 +420,7 @@ void pm::FrameProcessor::Reconfigure(const Frame& frame)
     {
         m_tasksRoiStats.reserve(size);
         m_tasksConvToRgb8.reserve(size);
+        m_tasksConvToRgb8WithStats.reserve(size);
         m_tasksFillBitmap.reserve(size);
 
         while (m_tasksRoiStats.size() < size)
@@ -318,12 +429,16 @@ void pm::FrameProcessor::Reconfigure(const Frame& frame)
                         UniqueThreadPool::Get().GetPool()));
             m_tasksConvToRgb8.push_back(std::make_unique<TaskSet_ConvertToRgb8>(
                         UniqueThreadPool::Get().GetPool()));
+            m_tasksConvToRgb8WithStats.push_back(
+                    std::make_unique<TaskSet_ConvertToRgb8WithStats>(
+                        UniqueThreadPool::Get().GetPool()));
             m_tasksFillBitmap.push_back(std::make_unique<TaskSet_FillBitmap>(
                         UniqueThreadPool::Get().GetPool()));
         }
 
         m_tasksRoiStatsActive.resize(size, false);
         m_tasksConvToRgb8Active.resize(size, false);
+        m_tasksConvToRgb8WithStatsActive.resize(size, false);
         m_tasksFillBitmapActive.resize(size, false);
     }
 
@@ -332,6 +447,7 @@ void pm::FrameProcessor::Reconfigure(const Frame& frame)
     {
         m_tasksRoiStatsActive[n] = false;
         m_tasksConvToRgb8Active[n] = false;
+        m_tasksConvToRgb8WithStatsActive[n] = false;
         m_tasksFillBitmapActive[n] = false;
     }
 }
@@ -375,31 +491,64 @@ void pm::FrameProcessor::DoDebayerRoi(uint16_t roiIdx,
     }
 }
 
-void pm::FrameProcessor::DoConvertRoiToRgb8bit(uint16_t roiIdx, UseBmp useBmp,
-        double min, double max, bool autoConbright, int brightness, int contrast)
+pm::Bitmap* pm::FrameProcessor::PrepareRgb8bitBitmap(uint16_t roiIdx,
+        const Bitmap& srcBmp)
 {
-    auto& srcBitmaps = GetBitmaps(useBmp);
-    auto& srcBmp = srcBitmaps[roiIdx];
+    // Color sources cannot be converted to gray
+    const auto pixelType = (m_rgb8bitPixelType == BitmapPixelType::Mono
+            && srcBmp.GetFormat().GetPixelType() != BitmapPixelType::Mono)
+        ? BitmapPixelType::RGB
+        : m_rgb8bitPixelType;
+    const auto format = BitmapFormat(pixelType, BitmapDataType::UInt8, 8);
 
     auto& rgb8bitBitmap = m_rgb8bitBitmaps[roiIdx];
-    if (!rgb8bitBitmap)
+    if (!rgb8bitBitmap || rgb8bitBitmap->GetFormat() != format)
     {
-        const auto rgbFormat =
-            BitmapFormat(BitmapPixelType::RGB, BitmapDataType::UInt8, 8);
-        const auto width = srcBmp->GetWidth();
-        const auto height = srcBmp->GetHeight();
+        const auto width = srcBmp.GetWidth();
+        const auto height = srcBmp.GetHeight();
         rgb8bitBitmap =
-            std::move(std::make_unique<Bitmap>(width, height, rgbFormat));
+            std::move(std::make_unique<Bitmap>(width, height, format));
     }
+    return rgb8bitBitmap.get();
+}
+
+void pm::FrameProcessor::DoConvertRoiToRgb8bit(uint16_t roiIdx, UseBmp useBmp,
+        double min, double max, bool autoConbright, int brightness, int contrast)
+{
+    auto& srcBitmaps = GetBitmaps(useBmp);
+    auto& srcBmp = srcBitmaps[roiIdx];
+
+    auto rgb8bitBitmap = PrepareRgb8bitBitmap(roiIdx, *srcBmp);
 
     auto& taskConvToRgb8 = m_tasksConvToRgb8[roiIdx];
-    taskConvToRgb8->SetUp(rgb8bitBitmap.get(), srcBmp.get(), min, max,
+    taskConvToRgb8->SetUp(rgb8bitBitmap, srcBmp.get(), min, max,
             &m_convToRgb8bitLookupMap, autoConbright, brightness, contrast);
     taskConvToRgb8->Execute();
 
     m_tasksConvToRgb8Active[roiIdx] = true;
 }
 
+void pm::FrameProcessor::DoConvertRoiToRgb8bitWithStats(uint16_t roiIdx,
+        UseBmp useBmp, double min, double max, bool autoConbright,
+        int brightness, int contrast, bool withHistogram)
+{
+    auto& srcBitmaps = GetBitmaps(useBmp);
+    auto& srcBmp = srcBitmaps[roiIdx];
+
+    auto rgb8bitBitmap = PrepareRgb8bitBitmap(roiIdx, *srcBmp);
+
+    auto& roiStats = m_roiStats[roiIdx];
+    roiStats.Clear();
+
+    auto& task = m_tasksConvToRgb8WithStats[roiIdx];
+    task->SetUp(rgb8bitBitmap, srcBmp.get(), min, max, &roiStats,
+            (withHistogram) ? &m_histogram : nullptr,
+            &m_convToRgb8bitLookupMap, autoConbright, brightness, contrast);
+    task->Execute();
+
+    m_tasksConvToRgb8WithStatsActive[roiIdx] = true;
+}
+
 void pm::FrameProcessor::DoComputeRoiStats(uint16_t roiIdx, UseBmp useBmp)
 {
     auto& srcBitmaps = GetBitmaps(useBmp);
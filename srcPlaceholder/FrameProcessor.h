@@ -7,9 +7,12 @@
 
 /* Local */
 #include "backend/Frame.h"
+#include "backend/FrameHistogram.h"
 #include "backend/FrameStats.h"
 #include "backend/TaskSet_ComputeFrameStats.h"
+#include "backend/TaskSet_ComputeHistogram.h"
 #include "backend/TaskSet_ConvertToRgb8.h"
+#include "backend/TaskSet_ConvertToRgb8WithStats.h"
 #include "backend/TaskSet_FillBitmap.h"
 #include "backend/TaskSet_FillBitmapValue.h"
 
@@ -69,6 +72,19 @@ public:
             double min, double max, bool autoConbright = true,
             int brightness = 0, int contrast = 0);
     const std::vector<std::unique_ptr<Bitmap>>& GetRgb8bitBitmaps() const;
+    // Pixel type of 8-bit bitmaps, RGB by default. Mono gives one gray byte
+    // per pixel for mono sources, RGB sources are still converted to RGB.
+    // RGBA and BGRA have alpha set to 255 and can be uploaded to display
+    // textures without repacking. Bitmaps are reallocated on next conversion.
+    void SetRgb8bitPixelType(BitmapPixelType pixelType);
+    BitmapPixelType GetRgb8bitPixelType() const;
+    // Does CovertToRgb8bit and ComputeStats (and optionally ComputeHistogram)
+    // in one pass over mono bitmaps. The stats are not known before the
+    // conversion, so the min/max limits are usually taken from GetStats()
+    // or GetHistogram() of previous frame before calling this method.
+    void CovertToRgb8bitWithStats(UseBmp useBmp,
+            double min, double max, bool autoConbright = true,
+            int brightness = 0, int contrast = 0, bool withHistogram = false);
 
     // Computes stats from frame's raw (mono) bitmaps by default
     void ComputeStats(UseBmp useBmp = UseBmp::Raw);
@@ -76,6 +92,15 @@ public:
     void ComputeRoiStats(uint16_t roiIdx, UseBmp useBmp = UseBmp::Raw);
     const std::vector<FrameStats>& GetRoiStats() const;
 
+    // Computes one histogram from all frame's raw (mono) bitmaps by default
+    void ComputeHistogram(UseBmp useBmp = UseBmp::Raw);
+    const FrameHistogram& GetHistogram() const;
+    // Computes histogram and returns min/max for CovertToRgb8bit that clip
+    // given percentage of darkest and brightest pixels, e.g. 0.1 and 99.9.
+    // Returns false if there is no pixel and min/max are unchanged.
+    bool ComputePercentileLimits(double lowPercent, double highPercent,
+            double& min, double& max, UseBmp useBmp = UseBmp::Raw);
+
     // Can work on any bitmap type
     void Recompose(UseBmp useBmp,
             Bitmap* dstBmp, uint16_t dstOffX, uint16_t dstOffY);
@@ -90,9 +115,15 @@ private:
 
     void DoDebayerRoi(uint16_t roiIdx, const ph_color_context* colorCtx);
 
+    // Allocates the 8-bit bitmap for given source if not yet done or if its
+    // format doesn't match the wanted pixel type
+    Bitmap* PrepareRgb8bitBitmap(uint16_t roiIdx, const Bitmap& srcBmp);
     void DoConvertRoiToRgb8bit(uint16_t roiIdx, UseBmp useBmp,
             double min, double max, bool autoConbright,
             int brightness, int contrast);
+    void DoConvertRoiToRgb8bitWithStats(uint16_t roiIdx, UseBmp useBmp,
+            double min, double max, bool autoConbright,
+            int brightness, int contrast, bool withHistogram);
 
     void DoComputeRoiStats(uint16_t roiIdx, UseBmp useBmp);
 
@@ -106,6 +137,7 @@ private:
 
     std::vector<std::unique_ptr<Bitmap>> m_debayeredBitmaps{};
     std::vector<std::unique_ptr<Bitmap>> m_rgb8bitBitmaps{};
+    BitmapPixelType m_rgb8bitPixelType{ BitmapPixelType::RGB };
 
     FrameStats m_stats{};
     std::vector<FrameStats> m_roiStats{};
@@ -113,10 +145,17 @@ private:
     std::vector<std::unique_ptr<TaskSet_ComputeFrameStats>> m_tasksRoiStats{};
     std::vector<bool> m_tasksRoiStatsActive{};
 
+    FrameHistogram m_histogram{};
+    // Regions are processed one by one, sharing sub-histograms of tasks
+    std::unique_ptr<TaskSet_ComputeHistogram> m_taskHistogram{};
+
     std::vector<std::unique_ptr<TaskSet_ConvertToRgb8>> m_tasksConvToRgb8{};
     std::vector<bool> m_tasksConvToRgb8Active{};
     std::vector<uint8_t> m_convToRgb8bitLookupMap{};
 
+    std::vector<std::unique_ptr<TaskSet_ConvertToRgb8WithStats>> m_tasksConvToRgb8WithStats{};
+    std::vector<bool> m_tasksConvToRgb8WithStatsActive{};
+
     std::vector<std::unique_ptr<TaskSet_FillBitmap>> m_tasksFillBitmap{};
     std::vector<bool> m_tasksFillBitmapActive{};
 
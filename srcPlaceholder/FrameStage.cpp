@@ -0,0 +1,70 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/FrameStage.h"
+
+/* Local */
+#include "backend/Log.h"
+
+/* System */
+#include <algorithm>
+
+pm::FrameStage::FrameStage(const std::string& name, size_t queueCapacity,
+        size_t workerCount)
+    : m_name(name),
+    m_queueCapacity(std::max<size_t>(queueCapacity, 1)),
+    m_workerCount(workerCount)
+{
+}
+
+pm::FrameStage::~FrameStage()
+{
+}
+
+const std::string& pm::FrameStage::GetName() const
+{
+    return m_name;
+}
+
+size_t pm::FrameStage::GetQueueCapacity() const
+{
+    return m_queueCapacity;
+}
+
+size_t pm::FrameStage::GetWorkerCount() const
+{
+    return m_workerCount;
+}
+
+std::shared_ptr<pm::ThreadPool> pm::FrameStage::GetThreadPool() const
+{
+    return m_pool;
+}
+
+bool pm::FrameStage::Start()
+{
+    if (m_workerCount == 0 || m_pool)
+        return true;
+
+    try
+    {
+        m_pool = std::make_shared<ThreadPool>(m_workerCount);
+    }
+    catch (...)
+    {
+        Log::LogE("Failure creating %zu worker threads for stage '%s'",
+                m_workerCount, m_name.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void pm::FrameStage::ReleaseUnsavedFrames(
+        const std::vector<std::shared_ptr<Frame>>& /*frames*/)
+{
+}
+
+void pm::FrameStage::Stop()
+{
+}
@@ -0,0 +1,66 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_FRAME_STAGE_H
+#define PM_FRAME_STAGE_H
+
+/* Local */
+#include "backend/Frame.h"
+#include "backend/ThreadPool.h"
+
+/* System */
+#include <memory> // std::shared_ptr
+#include <string>
+#include <vector>
+
+namespace pm {
+
+/* One step of online frame processing (corrections, reductions, tracking...)
+   that runs between acquisition and disk threads.
+   Acquisition runs each stage in its own thread with own bounded input queue.
+   Frames come to the stage in order they were acquired, one at a time. Frames
+   that don't fit the queue are dropped and reported in stage statistics. */
+class FrameStage
+{
+public:
+    // The workerCount is the number of threads in stage's own pool usable for
+    // processing of single frame in parallel, e.g. via TaskSet.
+    // Zero means the stage does all the work in its thread only.
+    explicit FrameStage(const std::string& name, size_t queueCapacity,
+            size_t workerCount = 0);
+    virtual ~FrameStage();
+
+    FrameStage(const FrameStage&) = delete;
+    FrameStage& operator=(const FrameStage&) = delete;
+
+public:
+    const std::string& GetName() const;
+    // Max. number of frames waiting in queue for this stage
+    size_t GetQueueCapacity() const;
+    size_t GetWorkerCount() const;
+    // Null until Start is called or if worker count is zero
+    std::shared_ptr<ThreadPool> GetThreadPool() const;
+
+    // Called by Acquisition::Start before any frame arrives.
+    // Overrides have to call this base implementation that creates the pool.
+    virtual bool Start();
+    // Called in stage thread for each frame, returning false aborts acquisition
+    virtual bool ProcessFrame(std::shared_ptr<Frame> frame) = 0;
+    // Called in disk thread on abort with frames already processed by this
+    // stage that won't be saved, the oldest first
+    virtual void ReleaseUnsavedFrames(
+            const std::vector<std::shared_ptr<Frame>>& frames);
+    // Called by Acquisition::WaitForStop after stage thread has finished
+    virtual void Stop();
+
+private:
+    const std::string m_name;
+    const size_t m_queueCapacity;
+    const size_t m_workerCount;
+    std::shared_ptr<ThreadPool> m_pool{ nullptr };
+};
+
+} // namespace pm
+
+#endif /* PM_FRAME_STAGE_H */
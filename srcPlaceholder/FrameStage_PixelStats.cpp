@@ -0,0 +1,305 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/FrameStage_PixelStats.h"
+
+/* Local */
+#include "backend/Bitmap.h"
+#include "backend/Log.h"
+#include "backend/PrdFileSave.h"
+#include "backend/PrdFileUtils.h"
+#include "backend/TiffFileSave.h"
+
+/* System */
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+static constexpr size_t cCheckpointPages = 4;
+
+static uint32_t ToFixedPoint(double value)
+{
+    constexpr double maxValue = (std::numeric_limits<uint32_t>::max)();
+    const double scaled =
+        value * (1u << pm::FrameStage_PixelStats::cCheckpointFracBits) + 0.5;
+    return (scaled >= maxValue)
+        ? (std::numeric_limits<uint32_t>::max)()
+        : static_cast<uint32_t>(scaled);
+}
+
+pm::FrameStage_PixelStats::FrameStage_PixelStats(const std::string& saveDir,
+        StorageType storageType, size_t checkpointFrames)
+    // Queue is limited by RAM only, the same way as the queue for saving
+    : FrameStage("Pixel statistics", (std::numeric_limits<size_t>::max)(),
+            std::max(1u, std::thread::hardware_concurrency())),
+    m_saveDir(saveDir),
+    m_storageType(storageType),
+    m_checkpointFrames(checkpointFrames)
+{
+}
+
+pm::FrameStage_PixelStats::~FrameStage_PixelStats()
+{
+}
+
+bool pm::FrameStage_PixelStats::Start()
+{
+    if (!FrameStage::Start())
+        return false;
+
+    if (!m_taskAccumulate)
+    {
+        try
+        {
+            m_taskAccumulate = std::make_unique<TaskSet_AccumulatePixelStats>(
+                    GetThreadPool());
+        }
+        catch (...)
+        {
+            Log::LogE("Failure creating tasks for pixel statistics");
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Buffers are (re)allocated with first frame
+    m_isConfigured = false;
+    m_stats.Clear();
+    m_checkpointFrameCount = 0;
+
+    return true;
+}
+
+bool pm::FrameStage_PixelStats::ProcessFrame(std::shared_ptr<Frame> frame)
+{
+    if (!frame->DecodeMetadata())
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_isConfigured && !Configure(*frame))
+        return false;
+
+    try
+    {
+        const Bitmap* bmp = GetFrameBitmap(frame);
+        if (!bmp)
+            return true; // No pixels to add
+
+        m_taskAccumulate->SetUp(bmp, &m_stats);
+        m_taskAccumulate->Execute();
+        m_taskAccumulate->Wait();
+    }
+    catch (const std::exception& ex)
+    {
+        Log::LogE("Failed to accumulate pixel statistics - %s", ex.what());
+        return false;
+    }
+
+    if (m_checkpointFrames > 0
+            && m_stats.GetFrameCount() % m_checkpointFrames == 0)
+    {
+        // Failed checkpoint is not fatal, the next one might succeed
+        SaveNextCheckpoint();
+    }
+
+    return true;
+}
+
+void pm::FrameStage_PixelStats::Stop()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_stats.GetFrameCount() > m_checkpointFrameCount)
+    {
+        SaveNextCheckpoint();
+    }
+}
+
+uint64_t pm::FrameStage_PixelStats::GetFrameCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats.GetFrameCount();
+}
+
+bool pm::FrameStage_PixelStats::SaveCheckpoint(const std::string& fileName,
+        StorageType storageType)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return DoSaveCheckpoint(fileName, storageType);
+}
+
+bool pm::FrameStage_PixelStats::Configure(const Frame& frame)
+{
+    const auto& acqCfg = frame.GetAcqCfg();
+    const auto& bmpFormat = acqCfg.GetBitmapFormat();
+    if (bmpFormat.GetPixelType() != BitmapPixelType::Mono
+            || (bmpFormat.GetDataType() != BitmapDataType::UInt8
+                && bmpFormat.GetDataType() != BitmapDataType::UInt16))
+    {
+        Log::LogE("Pixel statistics support mono frames up to 16 bits only");
+        return false;
+    }
+
+    m_rgn = acqCfg.GetImpliedRoi();
+    const uint32_t width = ((uint32_t)m_rgn.s2 + 1 - m_rgn.s1) / m_rgn.sbin;
+    const uint32_t height = ((uint32_t)m_rgn.p2 + 1 - m_rgn.p1) / m_rgn.pbin;
+
+    try
+    {
+        m_stats.Reset(width, height, bmpFormat.GetBitDepth());
+
+        // Frames without metadata have one bitmap covering whole region
+        if (acqCfg.HasMetadata())
+            m_fullBmp = std::make_unique<Bitmap>(width, height, bmpFormat);
+        else
+            m_fullBmp.reset();
+    }
+    catch (...)
+    {
+        Log::LogE("Failure allocating pixel statistics for %ux%u pixels",
+                width, height);
+        return false;
+    }
+
+    m_isConfigured = true;
+    return true;
+}
+
+const pm::Bitmap* pm::FrameStage_PixelStats::GetFrameBitmap(
+        std::shared_ptr<Frame> frame)
+{
+    m_frameProc.SetFrame(frame);
+    if (m_frameProc.GetValidBitmapCount() == 0)
+        return nullptr;
+
+    if (!m_fullBmp)
+        return m_frameProc.GetRawBitmaps()[0].get();
+
+    // Pixels not covered by any region are counted as zeros
+    m_frameProc.Fill(m_fullBmp.get(), 0.0);
+    m_frameProc.Recompose(FrameProcessor::UseBmp::Raw, m_fullBmp.get(),
+            m_rgn.s1 / m_rgn.sbin, m_rgn.p1 / m_rgn.pbin);
+    return m_fullBmp.get();
+}
+
+bool pm::FrameStage_PixelStats::DoSaveCheckpoint(const std::string& fileName,
+        StorageType storageType)
+{
+    const uint64_t frameCount = m_stats.GetFrameCount();
+    if (frameCount == 0)
+    {
+        Log::LogE("No frames in pixel statistics to save");
+        return false;
+    }
+
+    const size_t pixelCount = m_stats.GetPixelCount();
+
+    const BitmapFormat pageFormat(ImageFormat::Mono32, 32);
+    const Frame::AcqCfg pageAcqCfg(pixelCount * sizeof(uint32_t), 1, false,
+            m_rgn, pageFormat);
+
+    PrdHeader prdHeader;
+    PrdFileUtils::InitPrdHeaderStructure(prdHeader, PRD_VERSION_0_8,
+            pageAcqCfg, m_rgn, EXP_RES_ONE_MILLISEC, 0);
+    prdHeader.frameCount = (uint32_t)cCheckpointPages;
+
+    std::vector<uint32_t> page;
+    try
+    {
+        page.resize(pixelCount);
+    }
+    catch (...)
+    {
+        Log::LogE("Failure allocating pixel statistics checkpoint");
+        return false;
+    }
+
+    FileSave* file = nullptr;
+    switch (storageType)
+    {
+    case StorageType::None:
+    case StorageType::Prd:
+        file = new(std::nothrow) PrdFileSave(fileName, prdHeader);
+        break;
+    case StorageType::Tiff:
+    case StorageType::BigTiff:
+        file = new(std::nothrow) TiffFileSave(fileName, prdHeader,
+                storageType == StorageType::BigTiff);
+        break;
+    // No default section, compiler will complain when new format added
+    }
+    std::unique_ptr<FileSave> fileHolder(file);
+
+    if (!file || !file->Open())
+    {
+        Log::LogE("Failed to open pixel statistics checkpoint file '%s'",
+                fileName.c_str());
+        return false;
+    }
+
+    PrdMetaData prdMeta;
+    std::memset(&prdMeta, 0, sizeof(PrdMetaData));
+    prdMeta.roiCount = 1;
+    prdMeta.colorWbScaleRed = 1.0f;
+    prdMeta.colorWbScaleGreen = 1.0f;
+    prdMeta.colorWbScaleBlue = 1.0f;
+
+    const auto& mins = m_stats.GetMins();
+    const auto& maxs = m_stats.GetMaxs();
+    for (size_t p = 0; p < cCheckpointPages; ++p)
+    {
+        switch (p)
+        {
+        case 0:
+            std::copy(mins.begin(), mins.end(), page.begin());
+            break;
+        case 1:
+            std::copy(maxs.begin(), maxs.end(), page.begin());
+            break;
+        case 2:
+            for (size_t n = 0; n < pixelCount; ++n)
+            {
+                page[n] = ToFixedPoint(m_stats.GetMean(n));
+            }
+            break;
+        default:
+            for (size_t n = 0; n < pixelCount; ++n)
+            {
+                page[n] = ToFixedPoint(m_stats.GetVariance(n));
+            }
+            break;
+        }
+
+        prdMeta.frameNumber = (uint32_t)p + 1;
+        if (!file->WriteFrame(&prdMeta, nullptr, page.data()))
+        {
+            Log::LogE("Failed to write pixel statistics checkpoint file '%s'",
+                    fileName.c_str());
+            file->Close();
+            return false;
+        }
+    }
+    file->Close();
+
+    m_checkpointFrameCount = frameCount;
+
+    Log::LogI("Pixel statistics of %llu frames saved to '%s'",
+            (unsigned long long)frameCount, fileName.c_str());
+    return true;
+}
+
+bool pm::FrameStage_PixelStats::SaveNextCheckpoint()
+{
+    const std::string fileDir = ((m_saveDir.empty()) ? "." : m_saveDir) + "/";
+    const char* fileExt =
+        (m_storageType == StorageType::Tiff || m_storageType == StorageType::BigTiff)
+        ? ".tiff"
+        : ".prd";
+    const std::string fileName = fileDir + "pixel_stats_"
+        + std::to_string(m_stats.GetFrameCount()) + fileExt;
+
+    return DoSaveCheckpoint(fileName, m_storageType);
+}
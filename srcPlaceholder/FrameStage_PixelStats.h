@@ -0,0 +1,80 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_FRAME_STAGE_PIXEL_STATS_H
+#define PM_FRAME_STAGE_PIXEL_STATS_H
+
+/* Local */
+#include "backend/FrameProcessor.h"
+#include "backend/FrameStage.h"
+#include "backend/PixelStats.h"
+#include "backend/SettingsReader.h"
+#include "backend/TaskSet_AccumulatePixelStats.h"
+
+/* System */
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace pm {
+
+class Bitmap;
+
+// Accumulates per-pixel statistics over all frames in acquisition, so the
+// frames don't have to be saved and processed offline.
+// The statistics are saved as checkpoint file with 4 pages of 32-bit pixels:
+// min., max., mean and variance. Mean and variance are fixed-point numbers
+// with cCheckpointFracBits fractional bits, variance is saturated.
+class FrameStage_PixelStats final : public FrameStage
+{
+public:
+    static constexpr uint16_t cCheckpointFracBits = 8;
+
+public:
+    // Checkpoints go to saveDir as PRD or TIFF file based on storageType,
+    // every checkpointFrames frames and once acquisition stops.
+    // Zero checkpointFrames means only at the end.
+    explicit FrameStage_PixelStats(const std::string& saveDir,
+            StorageType storageType, size_t checkpointFrames);
+    virtual ~FrameStage_PixelStats();
+
+public: // From FrameStage
+    virtual bool Start() override;
+    virtual bool ProcessFrame(std::shared_ptr<Frame> frame) override;
+    virtual void Stop() override;
+
+public:
+    uint64_t GetFrameCount() const;
+
+    // Can be called any time, also while acquisition runs.
+    // Saves the stats as PRD for StorageType::None.
+    bool SaveCheckpoint(const std::string& fileName, StorageType storageType);
+
+private:
+    bool Configure(const Frame& frame);
+    const Bitmap* GetFrameBitmap(std::shared_ptr<Frame> frame);
+    bool DoSaveCheckpoint(const std::string& fileName, StorageType storageType);
+    bool SaveNextCheckpoint();
+
+private:
+    const std::string m_saveDir;
+    const StorageType m_storageType;
+    const size_t m_checkpointFrames;
+
+    mutable std::mutex m_mutex{};
+
+    bool m_isConfigured{ false };
+    rgn_type m_rgn{ 0, 0, 0, 0, 0, 0 };
+    PixelStats m_stats{};
+    uint64_t m_checkpointFrameCount{ 0 };
+
+    FrameProcessor m_frameProc{};
+    // Frames with metadata are recomposed to full region here
+    std::unique_ptr<Bitmap> m_fullBmp{};
+    std::unique_ptr<TaskSet_AccumulatePixelStats> m_taskAccumulate{};
+};
+
+} // namespace pm
+
+#endif /* PM_FRAME_STAGE_PIXEL_STATS_H */
@@ -0,0 +1,300 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/FrameStage_Track.h"
+
+/* Local */
+#include "backend/Camera.h"
+#include "backend/Log.h"
+#include "backend/ParticleLinker.h"
+#include "backend/TrackRuntimeLoader.h"
+#include "backend/Utils.h"
+
+/* System */
+#include <limits>
+
+bool pm::FrameStage_Track::IsNeeded(const Camera& camera)
+{
+    const bool centroidsCapable =
+        camera.GetParams().Get<PARAM_CENTROIDS_ENABLED>()->IsAvail();
+    const bool centroidsEnabled = centroidsCapable
+        && camera.GetParams().Get<PARAM_CENTROIDS_ENABLED>()->GetCur();
+    const bool centroidsCountCapable =
+        camera.GetParams().Get<PARAM_CENTROIDS_COUNT>()->IsAvail();
+    const bool centroidsRadiusCapable =
+        camera.GetParams().Get<PARAM_CENTROIDS_RADIUS>()->IsAvail();
+    const bool centroidsModeCapable =
+        camera.GetParams().Get<PARAM_CENTROIDS_MODE>()->IsAvail();
+
+    return PH_TRACK && centroidsEnabled && centroidsCountCapable
+        && centroidsRadiusCapable && centroidsModeCapable
+        && camera.GetParams().Get<PARAM_CENTROIDS_MODE>()->GetCur()
+            == PL_CENTROIDS_MODE_TRACK;
+}
+
+pm::FrameStage_Track::FrameStage_Track(std::shared_ptr<Camera> camera,
+        std::shared_ptr<FpsLimiter> fpsLimiter)
+    // Queue is limited by RAM only, the same way as the queue for saving
+    : FrameStage("Particle tracking", (std::numeric_limits<size_t>::max)()),
+    m_camera(camera),
+    m_fpsLimiter(fpsLimiter)
+{
+}
+
+pm::FrameStage_Track::~FrameStage_Track()
+{
+    Stop();
+}
+
+bool pm::FrameStage_Track::Start()
+{
+    if (!FrameStage::Start())
+        return false;
+
+    m_centroidsRadius =
+        m_camera->GetParams().Get<PARAM_CENTROIDS_RADIUS>()->GetCur();
+
+    const uint16_t maxFramesToLink = m_camera->GetSettings().GetTrackLinkFrames();
+    const uint16_t maxDistPerFrame = m_camera->GetSettings().GetTrackMaxDistance();
+    const uint16_t maxParticles =
+        m_camera->GetParams().Get<PARAM_CENTROIDS_COUNT>()->GetCur();
+    const bool useCpuOnly = m_camera->GetSettings().GetTrackCpuOnly();
+    const int32_t trackErr =
+        PH_TRACK->init(&m_trackContext, maxFramesToLink, maxDistPerFrame,
+                useCpuOnly, maxParticles, &m_trackMaxParticles);
+    if (trackErr != PH_TRACK_ERROR_NONE)
+    {
+        char msg[PH_TRACK_MAX_ERROR_LEN] = "Unknown error";
+        uint32_t size = PH_TRACK_MAX_ERROR_LEN;
+        PH_TRACK->get_last_error_message(msg, &size);
+        Log::LogE("Failed to initialize tracking context (%s)", msg);
+        return false;
+    }
+
+    m_trackParticles = new(std::nothrow) ph_track_particle[m_trackMaxParticles];
+    if (!m_trackParticles)
+    {
+        PH_TRACK->uninit(&m_trackContext);
+        m_trackContext = PH_TRACK_CONTEXT_INVALID;
+        return false;
+    }
+
+    const uint32_t historyDepth =
+        (uint32_t)m_camera->GetSettings().GetTrackTrajectoryDuration();
+    m_trackLinker = new(std::nothrow) ParticleLinker(maxParticles, historyDepth);
+    if (!m_trackLinker)
+    {
+        delete [] m_trackParticles;
+        m_trackParticles = nullptr;
+        PH_TRACK->uninit(&m_trackContext);
+        m_trackContext = PH_TRACK_CONTEXT_INVALID;
+        return false;
+    }
+
+    return true;
+}
+
+bool pm::FrameStage_Track::ProcessFrame(std::shared_ptr<Frame> frame)
+{
+    const uint32_t frameNr = frame->GetInfo().GetFrameNr();
+
+    // If all ROIs have particle ID set (non-zero) by camera,
+    // linking is not needed.
+    bool isLinkingNeeded = false;
+
+    // 1. Decode
+    if (!frame->DecodeMetadata())
+        return false;
+    auto frameMeta = frame->GetMetadata();
+    // Format is: array parallel to frameMeta->roiArray
+    auto frameExtMeta = frame->GetExtMetadata();
+
+    // 2. Verify extended metadata before using it
+    for (uint16_t n = 0; n < frameMeta->roiCount; ++n)
+    {
+        const md_frame_roi& mdRoi = frameMeta->roiArray[n];
+
+        // Do not work with background image ROI
+        if (!(mdRoi.header->flags & PL_MD_ROI_FLAG_HEADER_ONLY))
+            continue;
+
+        const uint16_t roiNr = mdRoi.header->roiNr;
+        const MetadataDecoder::ExtItems& extItems = frameExtMeta[n];
+
+        // Extract particle ID from extended metadata
+        uint32_t id;
+        if (!extItems.GetValue(PL_MD_EXT_TAG_PARTICLE_ID, id))
+        {
+            // Particle ID is usually missing, we get it after linking
+            isLinkingNeeded = true;
+        }
+        else if (id == 0)
+        {
+            // Particle ID sent by camera is invalid, we get it after linking
+            isLinkingNeeded = true;
+        }
+        // Extract M0 from extended metadata
+        uint32_t m0;
+        if (!extItems.GetValue(PL_MD_EXT_TAG_PARTICLE_M0, m0))
+        {
+            Log::LogE("Missing M0 moment in ext. metadata, frameNr %u, roiNr=%u",
+                    frameNr, roiNr);
+            return false;
+        }
+        // Extract M2 from extended metadata
+        uint32_t m2;
+        if (!extItems.GetValue(PL_MD_EXT_TAG_PARTICLE_M2, m2))
+        {
+            Log::LogE("Missing M2 moment in ext. metadata, frameNr %u, roiNr=%u",
+                    frameNr, roiNr);
+            return false;
+        }
+    }
+
+    // 3. Link particles
+    std::vector<ph_track_particle_event> events;
+    // Copy to separate variable that get overwritten after linking
+    uint32_t particlesCount = m_trackMaxParticles;
+
+    if (!isLinkingNeeded)
+    {
+        // Camera sent valid ID yet, linking not needed
+
+        // Just convert data to the same format as goes from track library
+        for (uint16_t n = 0; n < frameMeta->roiCount; ++n)
+        {
+            const md_frame_roi& mdRoi = frameMeta->roiArray[n];
+
+            // Do not work with background image ROI
+            if (!(mdRoi.header->flags & PL_MD_ROI_FLAG_HEADER_ONLY))
+                continue;
+
+            // Extract particle ID from extended metadata, verified above
+            uint32_t id = 0;
+            frameExtMeta[n].GetValue(PL_MD_EXT_TAG_PARTICLE_ID, id);
+
+            ph_track_particle particle;
+            particle.event = events[n - 1];
+            particle.id = id;
+            particle.lifetime = 10;
+            particle.state = PH_TRACK_PARTICLE_STATE_CONTINUATION;
+            m_trackParticles[n - 1] = particle;
+        }
+
+        // Update count the same way as ph_track_link_particles does
+        particlesCount = frameMeta->roiCount - 1;
+    }
+    else
+    {
+        // Linking is needed
+
+        // 3a. Prepare input data for linking
+        const uint16_t radius = m_centroidsRadius;
+
+        for (uint16_t n = 0; n < frameMeta->roiCount; ++n)
+        {
+            const md_frame_roi& mdRoi = frameMeta->roiArray[n];
+
+            // Do not work with background image ROI
+            if (!(mdRoi.header->flags & PL_MD_ROI_FLAG_HEADER_ONLY))
+                continue;
+
+            const rgn_type& rgn = mdRoi.header->roi;
+            const uint16_t roiX = rgn.s1 / rgn.sbin;
+            const uint16_t roiY = rgn.p1 / rgn.pbin;
+
+            const uint16_t x = roiX + radius;
+            const uint16_t y = roiY + radius;
+
+            // Extract M0 and M2 from extended metadata, verified above
+            uint32_t m0 = 0;
+            frameExtMeta[n].GetValue(PL_MD_EXT_TAG_PARTICLE_M0, m0);
+            uint32_t m2 = 0;
+            frameExtMeta[n].GetValue(PL_MD_EXT_TAG_PARTICLE_M2, m2);
+
+            ph_track_particle_event event;
+            event.roiNr = mdRoi.header->roiNr;
+            event.center = ph_track_particle_coord{(double)x, (double)y};
+            // Unsigned fixed-point real number in format Q22.0
+            event.m0 = Utils::FixedPointToReal<double, uint32_t>(22, 0, m0);
+            // Unsigned fixed-point real number in format Q3.19
+            event.m2 = Utils::FixedPointToReal<double, uint32_t>(3, 19, m2);
+
+            events.push_back(event);
+        }
+
+        // 3b. Link particles
+        const int32_t trackErr =
+            PH_TRACK->link_particles(m_trackContext,
+                    events.data(), (uint32_t)events.size(),
+                    m_trackParticles, &particlesCount);
+        if (trackErr != PH_TRACK_ERROR_NONE)
+        {
+            char msg[PH_TRACK_MAX_ERROR_LEN] = "Unknown error";
+            uint32_t size = PH_TRACK_MAX_ERROR_LEN;
+            PH_TRACK->get_last_error_message(msg, &size);
+            Log::LogE("Failed to link particles for frame nr. %u (%s)",
+                    frameNr, msg);
+            return false;
+        }
+    }
+
+    // 4. "Convert" particles to trajectories
+    m_trackLinker->AddParticles(m_trackParticles, particlesCount);
+
+    // 5. Store them in frame, the snapshot is shared and not copied
+    const auto trajectories = m_trackLinker->GetTrajectories();
+    frame->SetTrajectories(trajectories);
+
+    // 6. Update trajectories in camera's circular buffer
+    size_t index;
+    if (m_camera->GetFrameIndex(*frame, index))
+    {
+        auto camFrame = m_camera->GetFrameAt(index);
+        if (camFrame)
+        {
+            camFrame->SetTrajectories(trajectories);
+        }
+    }
+
+    return true;
+}
+
+void pm::FrameStage_Track::ReleaseUnsavedFrames(
+        const std::vector<std::shared_ptr<Frame>>& frames)
+{
+    // Invalidate trajectories in camera's circular buffer
+    const size_t unsavedCount = frames.size();
+    for (size_t n = 0; n < unsavedCount; ++n)
+    {
+        const auto& frame = frames[n];
+
+        size_t index;
+        if (m_camera->GetFrameIndex(*frame, index))
+        {
+            auto camFrame = m_camera->GetFrameAt(index);
+            if (camFrame)
+            {
+                camFrame->SetTrajectories(nullptr);
+
+                if (n + 1 == unsavedCount && m_fpsLimiter)
+                {
+                    m_fpsLimiter->InputNewFrame(camFrame);
+                }
+            }
+        }
+    }
+}
+
+void pm::FrameStage_Track::Stop()
+{
+    if (m_trackContext != PH_TRACK_CONTEXT_INVALID)
+    {
+        PH_TRACK->uninit(&m_trackContext);
+        m_trackContext = PH_TRACK_CONTEXT_INVALID;
+    }
+    delete [] m_trackParticles;
+    m_trackParticles = nullptr;
+    delete m_trackLinker;
+    m_trackLinker = nullptr;
+}
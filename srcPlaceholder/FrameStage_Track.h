@@ -0,0 +1,53 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_FRAME_STAGE_TRACK_H
+#define PM_FRAME_STAGE_TRACK_H
+
+/* Local */
+#include "backend/FpsLimiter.h"
+#include "backend/FrameStage.h"
+
+/* pvcam_helper_track */
+#include "pvcam_helper_track.h"
+
+namespace pm {
+
+class Camera;
+class ParticleLinker;
+
+// Links particles found by camera in centroids mode into trajectories
+class FrameStage_Track final : public FrameStage
+{
+public:
+    // Returns true if the camera is configured for particle tracking
+    static bool IsNeeded(const Camera& camera);
+
+public:
+    explicit FrameStage_Track(std::shared_ptr<Camera> camera,
+            std::shared_ptr<FpsLimiter> fpsLimiter);
+    virtual ~FrameStage_Track();
+
+public: // From FrameStage
+    virtual bool Start() override;
+    virtual bool ProcessFrame(std::shared_ptr<Frame> frame) override;
+    virtual void ReleaseUnsavedFrames(
+            const std::vector<std::shared_ptr<Frame>>& frames) override;
+    virtual void Stop() override;
+
+private:
+    std::shared_ptr<Camera> m_camera{ nullptr };
+    std::shared_ptr<FpsLimiter> m_fpsLimiter{ nullptr };
+
+    PH_TRACK_CONTEXT m_trackContext{ PH_TRACK_CONTEXT_INVALID };
+    uns32 m_trackMaxParticles{ 0 };
+    ph_track_particle* m_trackParticles{ nullptr };
+    ParticleLinker* m_trackLinker{ nullptr };
+
+    uint16_t m_centroidsRadius{ 1 };
+};
+
+} // namespace pm
+
+#endif /* PM_FRAME_STAGE_TRACK_H */
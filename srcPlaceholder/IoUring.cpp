@@ -0,0 +1,273 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/IoUring.h"
+
+/* System */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #define PM_HAS_IO_URING
+    #endif
+#endif
+
+#ifdef PM_HAS_IO_URING
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+static int IoUringSetup(unsigned int entries, io_uring_params* params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int IoUringEnter(int fd, unsigned int toSubmit, unsigned int minComplete,
+        unsigned int flags)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit,
+                minComplete, flags, nullptr, 0));
+}
+#endif
+
+pm::IoUring::IoUring()
+{
+}
+
+pm::IoUring::~IoUring()
+{
+    Release();
+}
+
+bool pm::IoUring::Init(unsigned int entries)
+{
+    Release();
+
+#ifdef PM_HAS_IO_URING
+    io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+
+    const int fd = IoUringSetup(entries, &params);
+    if (fd < 0)
+        return false;
+    m_fd = fd;
+
+    // Plain write operation came with the same kernel as this feature flag
+    if (!(params.features & IORING_FEAT_RW_CUR_POS))
+    {
+        Release();
+        return false;
+    }
+
+    m_sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    m_cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = !!(params.features & IORING_FEAT_SINGLE_MMAP);
+    if (singleMmap)
+    {
+        m_sqRingBytes = std::max(m_sqRingBytes, m_cqRingBytes);
+        m_cqRingBytes = 0;
+    }
+
+    m_sqRing = ::mmap(nullptr, m_sqRingBytes, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+    if (m_sqRing == MAP_FAILED)
+    {
+        m_sqRing = nullptr;
+        Release();
+        return false;
+    }
+
+    if (singleMmap)
+    {
+        m_cqRing = m_sqRing;
+    }
+    else
+    {
+        m_cqRing = ::mmap(nullptr, m_cqRingBytes, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_cqRing == MAP_FAILED)
+        {
+            m_cqRing = nullptr;
+            Release();
+            return false;
+        }
+    }
+
+    m_sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = ::mmap(nullptr, m_sqesBytes, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+    if (m_sqes == MAP_FAILED)
+    {
+        m_sqes = nullptr;
+        Release();
+        return false;
+    }
+
+    auto sq = static_cast<uint8_t*>(m_sqRing);
+    m_sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+    m_sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+    m_sqMask = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+    m_sqEntries = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_entries);
+    m_sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+
+    auto cq = static_cast<uint8_t*>(m_cqRing);
+    m_cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+    m_cqMask = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+    m_cqes = cq + params.cq_off.cqes;
+
+    return true;
+#else
+    (void)entries;
+    return false;
+#endif
+}
+
+bool pm::IoUring::IsValid() const
+{
+    return m_sqes != nullptr;
+}
+
+void pm::IoUring::Release()
+{
+#ifdef PM_HAS_IO_URING
+    if (m_sqes)
+        ::munmap(m_sqes, m_sqesBytes);
+    if (m_cqRing && m_cqRing != m_sqRing)
+        ::munmap(m_cqRing, m_cqRingBytes);
+    if (m_sqRing)
+        ::munmap(m_sqRing, m_sqRingBytes);
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+
+    m_fd = -1;
+    m_sqRing = nullptr;
+    m_sqRingBytes = 0;
+    m_cqRing = nullptr;
+    m_cqRingBytes = 0;
+    m_sqes = nullptr;
+    m_sqesBytes = 0;
+
+    m_sqHead = nullptr;
+    m_sqTail = nullptr;
+    m_sqMask = 0;
+    m_sqEntries = 0;
+    m_sqArray = nullptr;
+
+    m_cqHead = nullptr;
+    m_cqTail = nullptr;
+    m_cqMask = 0;
+    m_cqes = nullptr;
+
+    m_toSubmit = 0;
+}
+
+unsigned int pm::IoUring::GetFreeEntryCount() const
+{
+    if (!IsValid())
+        return 0;
+
+#ifdef PM_HAS_IO_URING
+    // Head is moved by kernel, tail by us only
+    const unsigned int head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+    const unsigned int tail = *m_sqTail;
+    return m_sqEntries - (tail - head);
+#else
+    return 0;
+#endif
+}
+
+bool pm::IoUring::QueueWrite(int fd, const void* data, size_t bytes,
+        uint64_t offset, uint64_t userData)
+{
+    if (GetFreeEntryCount() == 0)
+        return false;
+    if (bytes > (std::numeric_limits<uint32_t>::max)())
+        return false;
+
+#ifdef PM_HAS_IO_URING
+    const unsigned int tail = *m_sqTail;
+    const unsigned int index = tail & m_sqMask;
+
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(m_sqes) + index;
+    ::memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = static_cast<uint32_t>(bytes);
+    sqe->off = offset;
+    sqe->user_data = userData;
+
+    m_sqArray[index] = index;
+    // Makes the entry visible to kernel
+    __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+    m_toSubmit++;
+
+    return true;
+#else
+    (void)fd;
+    (void)data;
+    (void)offset;
+    (void)userData;
+    return false;
+#endif
+}
+
+bool pm::IoUring::Submit(unsigned int minComplete)
+{
+    if (!IsValid())
+        return false;
+
+#ifdef PM_HAS_IO_URING
+    if (m_toSubmit == 0 && minComplete == 0)
+        return true;
+
+    const unsigned int flags = (minComplete > 0) ? IORING_ENTER_GETEVENTS : 0;
+    for (;;)
+    {
+        const int submitted = IoUringEnter(m_fd, m_toSubmit, minComplete, flags);
+        if (submitted < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        m_toSubmit -= std::min<unsigned int>(m_toSubmit, submitted);
+        return true;
+    }
+#else
+    (void)minComplete;
+    return false;
+#endif
+}
+
+bool pm::IoUring::PopCompletion(uint64_t& userData, int32_t& result)
+{
+    if (!IsValid())
+        return false;
+
+#ifdef PM_HAS_IO_URING
+    // Tail is moved by kernel, head by us only
+    const unsigned int head = *m_cqHead;
+    if (head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE))
+        return false;
+
+    const io_uring_cqe* cqe =
+        static_cast<const io_uring_cqe*>(m_cqes) + (head & m_cqMask);
+    userData = cqe->user_data;
+    result = cqe->res;
+
+    // Releases the entry back to kernel
+    __atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+#else
+    (void)userData;
+    (void)result;
+    return false;
+#endif
+}
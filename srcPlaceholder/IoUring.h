@@ -0,0 +1,78 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_IO_URING_H
+#define PM_IO_URING_H
+
+/* System */
+#include <cstddef>
+#include <cstdint>
+
+namespace pm {
+
+/* Minimal wrapper around Linux io_uring used for asynchronous file writes.
+   It talks to kernel via raw system calls so no liburing is needed.
+   Requires kernel 5.6 or newer, on older kernels and other platforms Init
+   fails and the caller is expected to fall back to synchronous writes.
+   Not thread-safe, all methods must be called from the same thread. */
+class IoUring final
+{
+public:
+    IoUring();
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+public:
+    // Creates the ring with at least given number of submission entries
+    bool Init(unsigned int entries);
+    // Returns true if Init succeeded and Release wasn't called yet
+    bool IsValid() const;
+    // Releases the ring, pending requests are completed by kernel anyway
+    void Release();
+
+    // Returns number of free submission entries
+    unsigned int GetFreeEntryCount() const;
+
+    // Prepares write request, it is passed to kernel with next Submit call.
+    // The data must stay valid until the request completes.
+    // Returns false if there is no free entry or bytes exceed 32 bits.
+    bool QueueWrite(int fd, const void* data, size_t bytes, uint64_t offset,
+            uint64_t userData);
+    // Passes all prepared requests to kernel and waits until at least
+    // minComplete requests complete
+    bool Submit(unsigned int minComplete = 0);
+    // Takes one completed request if any. The result is number of written
+    // bytes or negative errno value.
+    bool PopCompletion(uint64_t& userData, int32_t& result);
+
+private:
+    int m_fd{ -1 };
+
+    void* m_sqRing{ nullptr };
+    size_t m_sqRingBytes{ 0 };
+    void* m_cqRing{ nullptr };
+    size_t m_cqRingBytes{ 0 };
+    void* m_sqes{ nullptr };
+    size_t m_sqesBytes{ 0 };
+
+    unsigned int* m_sqHead{ nullptr };
+    unsigned int* m_sqTail{ nullptr };
+    unsigned int m_sqMask{ 0 };
+    unsigned int m_sqEntries{ 0 };
+    unsigned int* m_sqArray{ nullptr };
+
+    unsigned int* m_cqHead{ nullptr };
+    unsigned int* m_cqTail{ nullptr };
+    unsigned int m_cqMask{ 0 };
+    void* m_cqes{ nullptr };
+
+    // Prepared requests not passed to kernel yet
+    unsigned int m_toSubmit{ 0 };
+};
+
+} // namespace pm
+
+#endif /* PM_IO_URING_H */
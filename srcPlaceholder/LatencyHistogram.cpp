@@ -0,0 +1,127 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/LatencyHistogram.h"
+
+/* System */
+#include <algorithm>
+#include <cmath>
+
+#ifdef _MSC_VER
+    #include <intrin.h> // _BitScanReverse64
+#endif
+
+// Number of bits for linear sub-buckets in each power-of-two range
+static constexpr unsigned int cSubBucketBits = 5;
+static constexpr uint64_t cSubBucketCount = 1ull << cSubBucketBits;
+// Values below cSubBucketCount have own bucket, then 64 - cSubBucketBits
+// ranges follow with cSubBucketCount buckets each
+static constexpr size_t cBucketCount =
+    cSubBucketCount + (64 - cSubBucketBits) * cSubBucketCount;
+
+// Returns index of the highest set bit, the value must not be zero
+static inline unsigned int HighestBit(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (unsigned int)index;
+#else
+    return 63u - (unsigned int)__builtin_clzll(value);
+#endif
+}
+
+pm::LatencyHistogram::LatencyHistogram()
+    : m_buckets(cBucketCount, 0)
+{
+}
+
+void pm::LatencyHistogram::Reset()
+{
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    m_count = 0;
+    m_sumNs = 0;
+    m_maxNs = 0;
+}
+
+void pm::LatencyHistogram::Record(double seconds)
+{
+    const uint64_t ns = (seconds > 0.0) ? (uint64_t)(seconds * 1e9) : 0;
+
+    m_buckets[GetBucketIndex(ns)]++;
+    m_count++;
+    m_sumNs += ns;
+    m_maxNs = std::max(m_maxNs, ns);
+}
+
+void pm::LatencyHistogram::Add(const LatencyHistogram& other)
+{
+    for (size_t n = 0; n < cBucketCount; ++n)
+    {
+        m_buckets[n] += other.m_buckets[n];
+    }
+    m_count += other.m_count;
+    m_sumNs += other.m_sumNs;
+    m_maxNs = std::max(m_maxNs, other.m_maxNs);
+}
+
+size_t pm::LatencyHistogram::GetCount() const
+{
+    return m_count;
+}
+
+double pm::LatencyHistogram::GetPercentile(double percent) const
+{
+    if (m_count == 0)
+        return 0.0;
+
+    const double rank = std::min(std::max(percent, 0.0), 100.0) / 100.0 * m_count;
+    // At least one value has to be counted
+    const uint64_t targetCount = std::max<uint64_t>(1, (uint64_t)std::ceil(rank));
+
+    uint64_t count = 0;
+    for (size_t n = 0; n < cBucketCount; ++n)
+    {
+        count += m_buckets[n];
+        if (count >= targetCount)
+        {
+            // The bucket bound could be above any recorded value
+            return std::min(GetBucketMaxValue(n), m_maxNs) / 1e9;
+        }
+    }
+
+    return m_maxNs / 1e9;
+}
+
+double pm::LatencyHistogram::GetMax() const
+{
+    return m_maxNs / 1e9;
+}
+
+double pm::LatencyHistogram::GetAvg() const
+{
+    return (m_count == 0) ? 0.0 : (double)m_sumNs / m_count / 1e9;
+}
+
+size_t pm::LatencyHistogram::GetBucketIndex(uint64_t ns)
+{
+    if (ns < cSubBucketCount)
+        return (size_t)ns;
+
+    // Keep cSubBucketBits bits below the highest one as the linear part
+    const unsigned int highestBit = HighestBit(ns);
+    const unsigned int shift = highestBit - cSubBucketBits;
+    const size_t subIndex = (size_t)((ns >> shift) - cSubBucketCount);
+    return (size_t)cSubBucketCount * (shift + 1) + subIndex;
+}
+
+uint64_t pm::LatencyHistogram::GetBucketMaxValue(size_t index)
+{
+    if (index < cSubBucketCount)
+        return index;
+
+    const unsigned int shift = (unsigned int)(index / cSubBucketCount) - 1;
+    const uint64_t subIndex = index % cSubBucketCount;
+    const uint64_t minValue = (cSubBucketCount + subIndex) << shift;
+    return minValue + ((1ull << shift) - 1);
+}
@@ -0,0 +1,58 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_LATENCY_HISTOGRAM_H
+#define PM_LATENCY_HISTOGRAM_H
+
+/* System */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pm {
+
+/* Histogram of time intervals with log-linear buckets (HDR-style).
+   Values are stored in nanoseconds, each power-of-two range is split to 32
+   linear buckets so any reported value is within ~3% of the recorded one.
+   Recording is just a few integer operations without any allocation.
+   Not thread-safe, each recording thread needs own instance, they can be
+   merged via Add once the threads finished. */
+class LatencyHistogram final
+{
+public:
+    LatencyHistogram();
+
+public:
+    // Removes all recorded values
+    void Reset();
+    // Adds one value, in seconds, negative values are counted as zero
+    void Record(double seconds);
+    // Adds all values recorded by other histogram
+    void Add(const LatencyHistogram& other);
+
+    size_t GetCount() const;
+    // Returns value in seconds below which given percentage of values lies,
+    // e.g. 50.0 for median. Zero if nothing has been recorded.
+    double GetPercentile(double percent) const;
+    // Returns exact max. recorded value, in seconds
+    double GetMax() const;
+    // Returns exact average of recorded values, in seconds
+    double GetAvg() const;
+
+private:
+    // Returns index of bucket the value in nanoseconds falls in
+    static size_t GetBucketIndex(uint64_t ns);
+    // Returns highest value in nanoseconds that falls in given bucket
+    static uint64_t GetBucketMaxValue(size_t index);
+
+private:
+    std::vector<uint64_t> m_buckets;
+    size_t m_count{ 0 };
+    uint64_t m_sumNs{ 0 };
+    uint64_t m_maxNs{ 0 };
+};
+
+} // namespace pm
+
+#endif /* PM_LATENCY_HISTOGRAM_H */
@@ -6,12 +6,17 @@
 #define PM_LIST_STATISTICS_H
 
 /* System */
-#include <set>
-#include <limits>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
 
 namespace pm {
 
-// Stores sorted and unique items in the list.
+/* Stores sorted and unique items in the list.
+   Consecutively-valued items are stored as one range so e.g. a long series
+   of lost frames takes just a few bytes. Adding items in ascending order is
+   O(1) and the statistics are updated on the fly, out-of-order items are
+   supported but slower. */
 template<typename T>
 class ListStatistics
 {
@@ -25,94 +30,140 @@ public:
     /* Removes all items added so far. */
     void Clear()
     {
-        m_data.clear();
+        m_ranges.clear();
+        m_count = 0;
+        m_largestCluster = 0;
     }
 
     /* Add new item to the list.
        Returns false if the same item is already in the list. */
     bool AddItem(T item)
     {
-        return m_data.insert(item).second;
+        return AddItems(item, item) > 0;
+    }
+
+    /* Adds all items from first to last inclusive.
+       Returns number of items that were not in the list yet. */
+    size_t AddItems(T first, T last)
+    {
+        if (last < first)
+            return 0;
+
+        // Fast path, items are usually added in ascending order
+        if (m_ranges.empty() || first > m_ranges.back().last)
+        {
+            if (!m_ranges.empty() && !HasGap(m_ranges.back().last, first))
+            {
+                m_ranges.back().last = last;
+            }
+            else
+            {
+                m_ranges.push_back(Range{ first, last });
+            }
+            return UpdateStats(m_ranges.back(), Length(first, last));
+        }
+
+        return InsertItems(first, last);
     }
 
     // Returns number of items in list
     size_t GetCount() const
     {
-        return m_data.size();
+        return m_count;
     }
 
     /* This algorithm requires slight explanation:
        This algorithm is intended to find the average difference between two
-       consecutively-valued elements of the list (requires sorting). */
+       consecutively-valued elements of the list (requires sorting).
+       Pairs without any gap are not counted, so it is the average size of
+       gaps between ranges. All the gaps together are the items missing from
+       the whole span of the list. */
     double GetAvgSpacing() const
     {
-        /* If there's only 1 item in the list the average value-distance must be 0 */
-         if (GetCount() <= 1)
+        /* If there's only 1 range in the list the average value-distance must be 0 */
+        if (m_ranges.size() <= 1)
             return 0.0;
 
-        /* Go through items 1-at-a-time and accumulate the distance in terms of
-           their values, and then divide by the number of items in the list-1 */
-        typename std::set<T>::const_iterator m_dataItPrev = m_data.cbegin();
-        typename std::set<T>::const_iterator m_dataIt = m_data.cbegin();
-
-        double result = 0;
-        size_t count = 0;
-
-        /* Start at the second element because we need pairs to do this measurement */
-        for (; ++m_dataIt != m_data.cend(); ++m_dataItPrev)
-        {
-            const T tempResult = *m_dataIt - 1 - *m_dataItPrev;
-            if (tempResult > 0)
-            {
-                result += tempResult;
-                count++;
-            }
-        }
-
-        return (count == 0) ? 0.0 : (result / count);
+        const double span =
+            (double)Length(m_ranges.front().first, m_ranges.back().last);
+        return (span - (double)m_count) / (double)(m_ranges.size() - 1);
     }
 
     /* This algorithm calculates the largest group of consecutively-valued
-       elements in the list. */
+       elements in the list. Ranges never shrink, it is tracked in AddItems. */
     size_t GetLargestCluster() const
     {
+        return m_largestCluster;
+    }
 
-        if (GetCount() == 0)
-            return 0;
+private:
+    // Consecutively-valued items from first to last inclusive
+    struct Range
+    {
+        T first;
+        T last;
+    };
 
-        if (GetCount() == 1)
-            return 1;
+private:
+    // Returns true if there is at least one value between the two items
+    static bool HasGap(T prev, T next)
+    {
+        return next > prev && next - prev > 1;
+    }
 
-        /* Flag that indicates if we found > 1 set of consecutively-valued elements */
-        size_t result = 1;
-        size_t tempResult = 1;
+    static size_t Length(T first, T last)
+    {
+        return static_cast<size_t>(last - first) + 1;
+    }
 
-        typename std::set<T>::const_iterator m_dataItPrev = m_data.begin();
-        typename std::set<T>::const_iterator m_dataIt = m_data.begin();
+    // Returns newItemCount for caller's convenience
+    size_t UpdateStats(const Range& range, size_t newItemCount)
+    {
+        m_count += newItemCount;
+        m_largestCluster =
+            std::max(m_largestCluster, Length(range.first, range.last));
+        return newItemCount;
+    }
 
-        for (++m_dataIt; m_dataIt != m_data.end(); ++m_dataIt, ++m_dataItPrev)
+    // Merges items with all overlapping or adjacent ranges
+    size_t InsertItems(T first, T last)
+    {
+        // The first range that isn't separated from new items by a gap
+        auto it = std::lower_bound(m_ranges.begin(), m_ranges.end(), first,
+                [](const Range& range, T value) {
+                    return HasGap(range.last, value);
+                });
+
+        Range merged{ first, last };
+        size_t existingCount = 0;
+        auto itEnd = it;
+        while (itEnd != m_ranges.end() && !HasGap(last, itEnd->first))
         {
-            if (*m_dataIt == *m_dataItPrev + 1)
-            {
-                tempResult++;
+            merged.first = std::min(merged.first, itEnd->first);
+            merged.last = std::max(merged.last, itEnd->last);
+            existingCount += Length(itEnd->first, itEnd->last);
+            ++itEnd;
+        }
 
-                /* If this cluster is bigger than we've ever seen before, record it */
-                if (tempResult > result)
-                {
-                    result = tempResult;
-                }
-            }
-            else
-            {
-                tempResult = 1;
-            }
+        if (it == itEnd)
+        {
+            it = m_ranges.insert(it, merged);
+        }
+        else
+        {
+            *it = merged;
+            m_ranges.erase(it + 1, itEnd);
         }
 
-        return result;
+        // The merged range is contiguous, anything not there before is new
+        return UpdateStats(*it, Length(merged.first, merged.last) - existingCount);
     }
 
 private:
-    std::set<T> m_data;
+    std::vector<Range> m_ranges{};
+    // Total number of items in all ranges
+    size_t m_count{ 0 };
+    size_t m_largestCluster{ 0 };
 };
 
 } // namespace pm
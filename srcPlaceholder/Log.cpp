@@ -8,6 +8,9 @@
 /******************************************************************************/
 #include "backend/Log.h"
 
+/* Local */
+#include "backend/CpuAffinity.h"
+
 /* System */
 #include <algorithm>
 #include <cstdarg>
@@ -53,6 +56,13 @@ pm::Log::~Log()
     delete m_thread;
 }
 
+bool pm::Log::SetThreadAffinity(const std::vector<unsigned int>& cpus)
+{
+    if (!Get().m_thread)
+        return false;
+    return CpuAffinity::PinThread(*Get().m_thread, cpus);
+}
+
 void pm::Log::AddListener(IListener* listener)
 {
     std::unique_lock<std::mutex> lock(Get().m_listenersMutex);
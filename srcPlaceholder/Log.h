@@ -91,6 +91,9 @@ public:
     static void AddListener(IListener* listener);
     static void RemoveListener(IListener* listener);
 
+    // Restricts logging thread to given CPUs, empty list allows all CPUs
+    static bool SetThreadAffinity(const std::vector<unsigned int>& cpus);
+
 public:
     static void LogE(const char* format, ...);
     static void LogW(const char* format, ...);
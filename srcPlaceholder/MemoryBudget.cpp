@@ -0,0 +1,228 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/MemoryBudget.h"
+
+/* Local */
+#include "backend/Utils.h"
+
+/* System */
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+// Never touch more than this from any limit
+static constexpr size_t cMaxReserveBytes = (size_t)2048 << 20;
+
+// Returns limit reduced by memory left untouched, 10% of limit up to 2 GiB
+static size_t GetUsableBytes(size_t limitBytes)
+{
+    return limitBytes - std::min<size_t>(limitBytes / 10, cMaxReserveBytes);
+}
+
+#if defined(__linux__)
+static bool ReadFileLine(const std::string& fileName, std::string& line)
+{
+    std::ifstream file(fileName);
+    return file && std::getline(file, line);
+}
+
+static bool ReadFileNumber(const std::string& fileName, size_t& value)
+{
+    std::string line;
+    if (!ReadFileLine(fileName, line))
+        return false;
+    return pm::Utils::StrToNumber<size_t>(line, value);
+}
+
+// Reads value of given key from memory.stat file
+static bool ReadStatValue(const std::string& fileName, const std::string& key,
+        size_t& value)
+{
+    std::ifstream file(fileName);
+    std::string line;
+    while (file && std::getline(file, line))
+    {
+        std::istringstream ss(line);
+        std::string name;
+        if ((ss >> name) && name == key)
+            return !!(ss >> value);
+    }
+    return false;
+}
+
+static bool DirExists(const std::string& dir)
+{
+    std::ifstream file(dir + "/cgroup.procs");
+    return !!file;
+}
+#endif
+
+pm::MemoryBudget::MemoryBudget()
+{
+    DiscoverCgroups();
+    Update();
+    ResetMinHeadroom();
+}
+
+void pm::MemoryBudget::Update()
+{
+    const size_t totalBytes = Utils::GetTotalRamMB() << 20;
+    const size_t availBytes = Utils::GetAvailRamMB() << 20;
+
+    // The system RAM is the limit on bare metal
+    const size_t usedBytes = totalBytes - std::min(availBytes, totalBytes);
+    const size_t usableBytes = GetUsableBytes(totalBytes);
+    size_t headroomBytes =
+        (usableBytes > usedBytes) ? usableBytes - usedBytes : 0;
+
+    size_t cgroupLimitBytes = 0;
+    for (const auto& level : m_cgroupLevels)
+    {
+        size_t limitBytes;
+        size_t levelUsedBytes;
+        if (!ReadCgroupLevel(level, limitBytes, levelUsedBytes))
+            continue;
+        // "Unlimited" in v1 is a huge number rounded to page size
+        if (limitBytes >= totalBytes)
+            continue;
+
+        const size_t levelUsableBytes = GetUsableBytes(limitBytes);
+        const size_t levelHeadroomBytes = (levelUsableBytes > levelUsedBytes)
+            ? levelUsableBytes - levelUsedBytes : 0;
+        headroomBytes = std::min(headroomBytes, levelHeadroomBytes);
+        cgroupLimitBytes = (cgroupLimitBytes == 0)
+            ? limitBytes : std::min(cgroupLimitBytes, limitBytes);
+    }
+
+    m_headroomBytes = headroomBytes;
+    m_cgroupLimitBytes = cgroupLimitBytes;
+
+    size_t minHeadroomBytes = m_minHeadroomBytes;
+    while (headroomBytes < minHeadroomBytes
+            && !m_minHeadroomBytes.compare_exchange_weak(minHeadroomBytes,
+                headroomBytes))
+    {
+    }
+}
+
+void pm::MemoryBudget::ResetMinHeadroom()
+{
+    m_minHeadroomBytes = m_headroomBytes.load();
+}
+
+size_t pm::MemoryBudget::GetHeadroomBytes() const
+{
+    return m_headroomBytes;
+}
+
+size_t pm::MemoryBudget::GetMinHeadroomBytes() const
+{
+    return m_minHeadroomBytes;
+}
+
+bool pm::MemoryBudget::IsCgroupLimited() const
+{
+    return m_cgroupLimitBytes > 0;
+}
+
+size_t pm::MemoryBudget::GetCgroupLimitBytes() const
+{
+    return m_cgroupLimitBytes;
+}
+
+void pm::MemoryBudget::DiscoverCgroups()
+{
+    m_cgroupLevels.clear();
+
+#if defined(__linux__)
+    // Lines are "0::/path" for v2, "<id>:<controllers>:/path" for v1
+    std::ifstream file("/proc/self/cgroup");
+    std::string line;
+    while (file && std::getline(file, line))
+    {
+        const size_t pos1 = line.find(':');
+        const size_t pos2 = (pos1 == std::string::npos)
+            ? std::string::npos : line.find(':', pos1 + 1);
+        if (pos2 == std::string::npos)
+            continue;
+
+        const std::string controllers = line.substr(pos1 + 1, pos2 - pos1 - 1);
+        std::string path = line.substr(pos2 + 1);
+
+        CgroupLevel level;
+        std::string mountDir;
+        if (line.compare(0, pos2 + 1, "0::") == 0)
+        {
+            level.isV2 = true;
+            mountDir = "/sys/fs/cgroup";
+        }
+        else
+        {
+            const auto names = Utils::StrToArray(controllers, ',');
+            if (std::find(names.begin(), names.end(), "memory") == names.end())
+                continue;
+            level.isV2 = false;
+            mountDir = "/sys/fs/cgroup/memory";
+        }
+
+        // Inside container with cgroup namespace the path could be relative
+        // to host, then only the mount root belongs to the process
+        if (!DirExists(mountDir + path))
+        {
+            path = "/";
+        }
+
+        // Parent groups can have tighter limits, walk up to the mount root
+        for (;;)
+        {
+            level.dir = mountDir + ((path == "/") ? "" : path);
+            m_cgroupLevels.push_back(level);
+            if (path.empty() || path == "/")
+                break;
+            const size_t slashPos = path.find_last_of('/');
+            path = (slashPos == 0 || slashPos == std::string::npos)
+                ? "/" : path.substr(0, slashPos);
+        }
+
+        // Both versions are mounted in hybrid mode, v1 controls memory then
+        if (!level.isV2)
+            break;
+    }
+#endif
+}
+
+bool pm::MemoryBudget::ReadCgroupLevel(const CgroupLevel& level,
+        size_t& limitBytes, size_t& usedBytes)
+{
+#if defined(__linux__)
+    size_t currentBytes;
+    size_t inactiveFileBytes = 0;
+    if (level.isV2)
+    {
+        // Contains "max" if not limited, it isn't a number then
+        if (!ReadFileNumber(level.dir + "/memory.max", limitBytes)
+                || !ReadFileNumber(level.dir + "/memory.current", currentBytes))
+            return false;
+        ReadStatValue(level.dir + "/memory.stat", "inactive_file",
+                inactiveFileBytes);
+    }
+    else
+    {
+        if (!ReadFileNumber(level.dir + "/memory.limit_in_bytes", limitBytes)
+                || !ReadFileNumber(level.dir + "/memory.usage_in_bytes", currentBytes))
+            return false;
+        ReadStatValue(level.dir + "/memory.stat", "total_inactive_file",
+                inactiveFileBytes);
+    }
+
+    // Inactive page cache, e.g. of saved files, is reclaimed before OOM kill
+    usedBytes = currentBytes - std::min(inactiveFileBytes, currentBytes);
+    return true;
+#else
+    (void)level;
+    (void)limitBytes;
+    (void)usedBytes;
+    return false;
+#endif
+}
@@ -0,0 +1,73 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_MEMORY_BUDGET_H
+#define PM_MEMORY_BUDGET_H
+
+/* System */
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace pm {
+
+/* Tells how much memory can be still allocated for frames.
+   On Linux it honors memory limits of cgroup (v2 or v1) the process runs in
+   and of all its parent groups, so frames queued in containers don't get the
+   process OOM-killed. Reclaimable page cache is not counted as used.
+   Without such limits, e.g. on bare metal and on Windows, it takes available
+   system RAM into account only.
+   Some memory is always left untouched, 10% of each limit, up to 2 GiB.
+   Update and getters can be called from different threads. */
+class MemoryBudget final
+{
+public:
+    MemoryBudget();
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+public:
+    // Re-reads the limits and current usage
+    void Update();
+    // Forgets lowest headroom seen so far
+    void ResetMinHeadroom();
+
+    // Bytes that can be allocated on top of current usage, as of last update
+    size_t GetHeadroomBytes() const;
+    // Lowest headroom seen since last reset
+    size_t GetMinHeadroomBytes() const;
+
+    // Returns true if the process runs in a cgroup with memory limit
+    bool IsCgroupLimited() const;
+    // Tightest cgroup limit, zero if not limited
+    size_t GetCgroupLimitBytes() const;
+
+private:
+    // One cgroup directory with memory limit, the process' group or parent
+    struct CgroupLevel
+    {
+        std::string dir{};
+        bool isV2{ true };
+    };
+
+private:
+    // Collects cgroup directories the process belongs to, from leaf up
+    void DiscoverCgroups();
+    // Returns false if the limit is not set or can't be read
+    static bool ReadCgroupLevel(const CgroupLevel& level, size_t& limitBytes,
+            size_t& usedBytes);
+
+private:
+    std::vector<CgroupLevel> m_cgroupLevels{};
+
+    std::atomic<size_t> m_headroomBytes{ 0 };
+    std::atomic<size_t> m_minHeadroomBytes{ 0 };
+    std::atomic<size_t> m_cgroupLimitBytes{ 0 };
+};
+
+} // namespace pm
+
+#endif /* PM_MEMORY_BUDGET_H */
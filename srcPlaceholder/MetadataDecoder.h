@@ -0,0 +1,290 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_METADATA_DECODER_H
+#define PM_METADATA_DECODER_H
+
+/* PVCAM */
+#include "master.h"
+#include "pvcam.h" // md_frame, md_frame_header, md_frame_roi_header
+
+/* System */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <iterator> // std::begin, std::end
+#include <memory>
+#include <new>
+
+namespace pm {
+
+/* Decodes frames with PVCAM metadata without calling PVCAM library.
+   Produces the same md_frame structure as pl_md_frame_decode does, but the
+   ROI array and extended metadata of all ROIs are allocated once in Setup.
+   Extended metadata are stored in flat array parallel to md_frame::roiArray,
+   with value pointers per tag instead of md_ext_item_collection.
+   Like with PVCAM, all pointers point to decoded frame buffer, they are valid
+   only as long as the buffer. */
+class MetadataDecoder final
+{
+public:
+    /* Extended metadata of one ROI or frame. */
+    struct ExtItems
+    {
+        // Values in frame buffer per tag, null if tag is not present.
+        // The values are not aligned, use GetValue to read them.
+        const void* values[PL_MD_EXT_TAG_MAX]{};
+
+        bool Has(PL_MD_EXT_TAGS tag) const
+        {
+            return tag < PL_MD_EXT_TAG_MAX && values[tag] != nullptr;
+        }
+
+        // Returns false if tag is not present or its size doesn't match
+        template<typename T>
+        bool GetValue(PL_MD_EXT_TAGS tag, T& value) const
+        {
+            const md_ext_item_info* info = GetExtTagInfo(tag);
+            if (!info || info->size != sizeof(T) || !values[tag])
+                return false;
+            std::memcpy(&value, values[tag], sizeof(T));
+            return true;
+        }
+    };
+
+public:
+    /* Returns information about known tag, the same as PVCAM uses,
+       or null for unknown tag. */
+    static const md_ext_item_info* GetExtTagInfo(PL_MD_EXT_TAGS tag)
+    {
+        static const md_ext_item_info sTagInfos[PL_MD_EXT_TAG_MAX] = {
+            { PL_MD_EXT_TAG_PARTICLE_ID, TYPE_UNS32, sizeof(uns32), "Particle ID" },
+            { PL_MD_EXT_TAG_PARTICLE_M0, TYPE_UNS32, sizeof(uns32), "Particle M0" },
+            { PL_MD_EXT_TAG_PARTICLE_M2, TYPE_UNS32, sizeof(uns32), "Particle M2" },
+        };
+        return (tag >= 0 && tag < PL_MD_EXT_TAG_MAX) ? &sTagInfos[tag] : nullptr;
+    }
+
+    /* Parses extended metadata, a sequence of one byte tag followed by value.
+       Returns false on unknown tag or if value crosses the end of buffer. */
+    static bool DecodeExt(ExtItems& items, const void* data, size_t dataBytes)
+    {
+        std::fill(std::begin(items.values), std::end(items.values), nullptr);
+
+        const uint8_t* pos = static_cast<const uint8_t*>(data);
+        const uint8_t* const end = pos + dataBytes;
+        while (pos < end)
+        {
+            const auto tag = static_cast<PL_MD_EXT_TAGS>(*pos++);
+            const md_ext_item_info* info = GetExtTagInfo(tag);
+            // Without known size the rest cannot be parsed
+            if (!info || info->size > (size_t)(end - pos))
+                return false;
+            items.values[tag] = pos;
+            pos += info->size;
+        }
+        return true;
+    }
+
+public:
+    MetadataDecoder()
+    {}
+
+    MetadataDecoder(const MetadataDecoder&) = delete;
+    MetadataDecoder& operator=(const MetadataDecoder&) = delete;
+
+public:
+    /* Allocates arrays for given number of ROIs and resets decoded data.
+       Arrays are reallocated only if the capacity has changed. */
+    bool Setup(uint16_t roiCapacity)
+    {
+        if (m_roiArray && roiCapacity == m_frame.roiCapacity)
+        {
+            Reset();
+            return true;
+        }
+
+        m_roiArray.reset(new(std::nothrow) md_frame_roi[roiCapacity]);
+        m_roiExtItems.reset(new(std::nothrow) ExtItems[roiCapacity]);
+        if (!m_roiArray || !m_roiExtItems)
+        {
+            m_roiArray = nullptr;
+            m_roiExtItems = nullptr;
+            roiCapacity = 0;
+        }
+        m_frame.roiArray = m_roiArray.get();
+        m_frame.roiCapacity = roiCapacity;
+        Reset();
+        return roiCapacity > 0;
+    }
+
+    /* Forgets decoded data, the ROI count drops to zero. */
+    void Reset()
+    {
+        m_frame.header = nullptr;
+        m_frame.extMdData = nullptr;
+        m_frame.extMdDataSize = 0;
+        m_frame.impliedRoi = rgn_type{ 0, 0, 0, 0, 0, 0 };
+        m_frame.roiCount = 0;
+        m_error = nullptr;
+    }
+
+    /* Decodes given frame, the buffer is not modified but the resulting
+       md_frame points to it. On failure the ROI count is zero and GetError
+       tells the reason. */
+    bool Decode(void* data, size_t dataBytes)
+    {
+        Reset();
+
+        if (!data || dataBytes < sizeof(md_frame_header))
+            return Fail("Buffer too small for frame header");
+
+        uint8_t* pos = static_cast<uint8_t*>(data);
+        const uint8_t* const end = pos + dataBytes;
+
+        auto header = reinterpret_cast<md_frame_header*>(pos);
+        if (header->signature != PL_MD_FRAME_SIGNATURE)
+            return Fail("Invalid frame signature");
+        if (header->version < 1 || header->version > 3)
+            return Fail("Unsupported frame header version");
+        if (header->roiCount > m_frame.roiCapacity)
+            return Fail("Too many ROIs in frame");
+        pos += sizeof(md_frame_header);
+
+        if (header->extendedMdSize > (size_t)(end - pos))
+            return Fail("Frame ext. metadata beyond buffer end");
+        void* frameExtMdData = (header->extendedMdSize > 0) ? pos : nullptr;
+        pos += header->extendedMdSize;
+
+        uint16_t roiCount = 0;
+        rgn_type impliedRoi{ 0, 0, 0, 0, 0, 0 };
+        for (uint16_t n = 0; n < header->roiCount; ++n)
+        {
+            if (sizeof(md_frame_roi_header) > (size_t)(end - pos))
+                return Fail("ROI header beyond buffer end");
+            auto roiHeader = reinterpret_cast<md_frame_roi_header*>(pos);
+            pos += sizeof(md_frame_roi_header);
+
+            const uint16_t extMdDataSize = roiHeader->extendedMdSize;
+            if (extMdDataSize > (size_t)(end - pos))
+                return Fail("ROI ext. metadata beyond buffer end");
+            void* extMdData = (extMdDataSize > 0) ? pos : nullptr;
+            pos += extMdDataSize;
+
+            const rgn_type& rgn = roiHeader->roi;
+            size_t dataSize = 0;
+            if (!(roiHeader->flags & PL_MD_ROI_FLAG_HEADER_ONLY))
+            {
+                if (header->version >= 2)
+                {
+                    dataSize = roiHeader->roiDataSize;
+                }
+                else
+                {
+                    // Version 1 has no data size in header, pixels are 16-bit
+                    if (rgn.sbin == 0 || rgn.pbin == 0
+                            || rgn.s1 > rgn.s2 || rgn.p1 > rgn.p2)
+                        return Fail("Invalid ROI region");
+                    dataSize = sizeof(uns16)
+                        * ((rgn.s2 - rgn.s1 + 1) / rgn.sbin)
+                        * ((rgn.p2 - rgn.p1 + 1) / rgn.pbin);
+                }
+                if (dataSize > (size_t)(end - pos))
+                    return Fail("ROI data beyond buffer end");
+            }
+            void* roiData = (dataSize > 0) ? pos : nullptr;
+            pos += dataSize;
+
+            // Invalid ROIs are skipped but their data still occupy the buffer
+            if (roiHeader->flags & PL_MD_ROI_FLAG_INVALID)
+                continue;
+
+            ExtItems& extItems = m_roiExtItems[roiCount];
+            if (!DecodeExt(extItems, extMdData, extMdDataSize))
+                return Fail("Invalid ROI ext. metadata");
+
+            md_frame_roi& roi = m_roiArray[roiCount];
+            roi.header = roiHeader;
+            roi.data = roiData;
+            roi.dataSize = (uns32)dataSize;
+            roi.extMdData = extMdData;
+            roi.extMdDataSize = extMdDataSize;
+
+            // Implied ROI is bounding rectangle of all ROIs
+            if (roiCount == 0)
+            {
+                impliedRoi = rgn;
+            }
+            else
+            {
+                impliedRoi.s1 = std::min(impliedRoi.s1, rgn.s1);
+                impliedRoi.s2 = std::max(impliedRoi.s2, rgn.s2);
+                impliedRoi.p1 = std::min(impliedRoi.p1, rgn.p1);
+                impliedRoi.p2 = std::max(impliedRoi.p2, rgn.p2);
+            }
+            roiCount++;
+        }
+
+        m_frame.header = header;
+        m_frame.extMdData = frameExtMdData;
+        m_frame.extMdDataSize = header->extendedMdSize;
+        m_frame.impliedRoi = impliedRoi;
+        m_frame.roiCount = roiCount;
+        return true;
+    }
+
+    /* Returns last decoded frame, the ROI count is zero if not decoded. */
+    const md_frame& GetFrame() const
+    {
+        return m_frame;
+    }
+
+    /* Returns extended metadata for each ROI in md_frame::roiArray,
+       only first md_frame::roiCount items are valid. */
+    const ExtItems* GetRoiExtItems() const
+    {
+        return m_roiExtItems.get();
+    }
+
+    /* Returns index to md_frame::roiArray of ROI with given number,
+       or md_frame::roiCount if not found. */
+    uint16_t FindRoiIndex(uint16_t roiNr) const
+    {
+        // ROI numbers are usually 1-based indexes
+        if (roiNr > 0 && roiNr <= m_frame.roiCount
+                && m_roiArray[roiNr - 1].header->roiNr == roiNr)
+            return roiNr - 1;
+        for (uint16_t n = 0; n < m_frame.roiCount; ++n)
+        {
+            if (m_roiArray[n].header->roiNr == roiNr)
+                return n;
+        }
+        return m_frame.roiCount;
+    }
+
+    /* Returns reason of last Decode failure, null if it succeeded. */
+    const char* GetError() const
+    {
+        return m_error;
+    }
+
+private:
+    bool Fail(const char* error)
+    {
+        m_frame.roiCount = 0;
+        m_error = error;
+        return false;
+    }
+
+private:
+    md_frame m_frame{};
+    std::unique_ptr<md_frame_roi[]> m_roiArray{};
+    std::unique_ptr<ExtItems[]> m_roiExtItems{};
+    const char* m_error{ nullptr };
+};
+
+} // namespace pm
+
+#endif /* PM_METADATA_DECODER_H */
@@ -0,0 +1,199 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_MPMC_RING_H
+#define PM_MPMC_RING_H
+
+/* System */
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace pm {
+
+/* Bounded lock-free ring buffer for any number of producers and consumers.
+   Every slot carries a sequence number telling whether it is ready for
+   producer or for consumer, so Push and Pop only race for a position via
+   compare-and-swap on tail or head, no thread ever waits for another one.
+   There is no waiting support, caller has to poll or notify on its own. */
+template<typename T>
+class MpmcRing final
+{
+public:
+    MpmcRing()
+    {}
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+public:
+    /* Drops all queued items and sets new capacity, rounded up to power of
+       two, min. 2. The buffer is reallocated only if the capacity has changed.
+       Not thread-safe, no producer or consumer must be active. */
+    bool Setup(size_t capacity)
+    {
+        size_t slotCount = 2;
+        while (slotCount < capacity)
+            slotCount <<= 1;
+
+        if (m_slots && slotCount == m_mask + 1)
+        {
+            Clear();
+            return true;
+        }
+
+        m_slots.reset(new(std::nothrow) Slot[slotCount]);
+        if (!m_slots)
+        {
+            m_mask = 0;
+            return false;
+        }
+        m_mask = slotCount - 1;
+
+        for (size_t n = 0; n < slotCount; ++n)
+        {
+            m_slots[n].seq.store(n, std::memory_order_relaxed);
+        }
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    /* Releases all queued items. Thread-safe, but items pushed concurrently
+       might stay in the ring. */
+    void Clear()
+    {
+        T item;
+        while (Pop(item))
+            item = T();
+    }
+
+    // Returns max. number of items the ring can hold
+    size_t GetCapacity() const
+    {
+        return (m_slots) ? m_mask + 1 : 0;
+    }
+
+    /* Returns number of queued items. Called concurrently with Push or Pop
+       the value is a snapshot that might be outdated right away. */
+    size_t GetSize() const
+    {
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        // The head could be loaded before consumer moved it past the tail
+        return (tail > head) ? tail - head : 0;
+    }
+
+    bool IsEmpty() const
+    {
+        return GetSize() == 0;
+    }
+
+public:
+    /* Appends new item at the end.
+       Returns false if the ring is full, the item is left untouched then. */
+    bool Push(T& item)
+    {
+        if (!m_slots)
+            return false;
+
+        Slot* slot;
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            slot = &m_slots[pos & m_mask];
+            const size_t seq = slot->seq.load(std::memory_order_acquire);
+            const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+            if (diff == 0)
+            {
+                // The slot is free, try to claim the position
+                if (m_tail.compare_exchange_weak(pos, pos + 1,
+                            std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                // The slot still holds item from previous lap, ring is full
+                return false;
+            }
+            else
+            {
+                // Another producer claimed the position
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->item = std::move(item);
+        // Hand the slot over to consumer of this lap
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Moves the oldest item out of the ring.
+       Returns false if the ring is empty. */
+    bool Pop(T& item)
+    {
+        if (!m_slots)
+            return false;
+
+        Slot* slot;
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            slot = &m_slots[pos & m_mask];
+            const size_t seq = slot->seq.load(std::memory_order_acquire);
+            const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+            if (diff == 0)
+            {
+                // The slot is filled, try to claim the position
+                if (m_head.compare_exchange_weak(pos, pos + 1,
+                            std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                // The slot hasn't been filled yet, ring is empty
+                return false;
+            }
+            else
+            {
+                // Another consumer claimed the position
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+
+        item = std::move(slot->item);
+        slot->item = T(); // Release resources held by moved-from item right away
+        // Hand the slot over to producer of next lap
+        slot->seq.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr size_t cCacheLineSize = 64;
+
+    struct Slot
+    {
+        std::atomic<size_t> seq{ 0 };
+        T item{};
+    };
+
+    // Members read by all sides but changed by Setup only
+    std::unique_ptr<Slot[]> m_slots{};
+    size_t m_mask{ 0 };
+
+    // Consumers side, padded to avoid false sharing with producers
+    char m_padConsumer[cCacheLineSize]{};
+    std::atomic<size_t> m_head{ 0 };
+
+    // Producers side, padded to avoid false sharing with consumers
+    char m_padProducer[cCacheLineSize]{};
+    std::atomic<size_t> m_tail{ 0 };
+    char m_padEnd[cCacheLineSize]{};
+};
+
+} // namespace pm
+
+#endif /* PM_MPMC_RING_H */
@@ -22,11 +22,14 @@ enum class OptionId : uint32_t
     AcqFrameCount,
     BufferFrameCount,
     AllocatorType,
+    AllocatorLock,
+    AllocatorPrefault,
     Regions,
     Exposure,
     VtmExposures,
     AcqMode,
     TimeLapseDelay,
+    AcqZeroCopy,
     StorageType,
     SaveDir,
     SaveTiffOptFull,
@@ -34,10 +37,22 @@ enum class OptionId : uint32_t
     SaveFirst,
     SaveLast,
     MaxStackSize,
+    SaveThreads,
+    SaveIoQueueDepth,
+    SaveSpillDir,
+    SavePreTrigger,
+    SavePostTrigger,
+    CpusAcq,
+    CpusDisk,
+    CpusWorkers,
+    CpusAux,
+    AcqRtPriority,
     TrackLinkFrames,
     TrackMaxDistance,
     TrackCpuOnly,
     TrackTrajectoryDuration,
+    PixelStats,
+    PixelStatsCheckpoint,
     ColorWbScaleRed,
     ColorWbScaleGreen,
     ColorWbScaleBlue,
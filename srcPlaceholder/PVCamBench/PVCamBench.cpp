@@ -0,0 +1,1202 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+
+/* Local */
+#include "backend/Acquisition.h"
+#include "backend/AcquisitionStats.h"
+#include "backend/Bitmap.h"
+#include "backend/ConsoleLogger.h"
+#include "backend/CpuFeatures.h"
+#include <backend/exceptions/Exception.h>
+#include "backend/FakeCamera.h"
+#include "backend/FrameStats.h"
+#include "backend/Log.h"
+#include "backend/OptionController.h"
+#include <backend/PvcamRuntimeLoader.h>
+#include "backend/Settings.h"
+#include "backend/TaskSet_ComputeFrameStats.h"
+#include "backend/TaskSet_ConvertToRgb8.h"
+#include "backend/ThreadPool.h"
+#include "backend/Timer.h"
+#include "backend/UniqueThreadPool.h"
+#include "backend/Utils.h"
+#include "backend/XoShiRo128Plus.h"
+#include "version.h"
+
+/* PVCAM */
+#include "master.h"
+#include "pvcam.h"
+
+/* System */
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+constexpr int APP_SUCCESS = 0;
+constexpr int APP_ERR_CLI_ARGS = 2;
+constexpr int APP_ERR_RUN = 3;
+constexpr int APP_ERR_LIB_LOAD = 4;
+
+// Custom CLI options
+static constexpr uint32_t OptionId_Bench =
+    static_cast<uint32_t>(pm::OptionId::CustomBase) + 0;
+static constexpr uint32_t OptionId_TrialTime =
+    static_cast<uint32_t>(pm::OptionId::CustomBase) + 1;
+static constexpr uint32_t OptionId_Report =
+    static_cast<uint32_t>(pm::OptionId::CustomBase) + 2;
+
+// Defaults applied before CLI options are parsed, user can override any of them
+static constexpr unsigned int cDefaultFakeCamFps = 10000;
+static constexpr uint32_t cDefaultAcqFrameCount = 50000;
+static constexpr uint16_t cDefaultRoiSize = 64;
+static constexpr unsigned int cDefaultTrialTimeSec = 5;
+
+// Highest frame rate tried by throughput benchmark
+static constexpr unsigned int cMaxFakeCamFps = 1000000;
+// Throughput search stops once the gap between loss-free and lossy frame
+// rate is below this fraction of the loss-free one
+static constexpr double cFpsSearchPrecision = 0.02;
+
+// Frame statistics benchmark repeats each measurement at least that long
+static constexpr double cStatsMinTimeSec = 0.5;
+// Frame sizes used by frame statistics benchmark
+static constexpr uint32_t cStatsFrameSizes[] = { 2048, 4096 };
+
+// Implementation of TaskSet_ComputeFrameStats before vectorization, used as
+// reference by frame statistics benchmark
+template<typename T>
+static void ComputeStats_Legacy(const T* dataStart, size_t pixels, bool upTo16b,
+        pm::FrameStats& stats)
+{
+    const T* dataEnd = dataStart + pixels;
+
+    T min = *dataStart;
+    T max = *dataStart;
+    if (upTo16b)
+    {
+        uint64_t sum = *dataStart;
+        uint64_t sumSq = uint64_t(*dataStart) * *dataStart;
+        for (const T* data = dataStart + 1; data < dataEnd; data++)
+        {
+            if (min > *data)
+                min = *data;
+            else if (max < *data)
+                max = *data;
+            sum += *data;
+            sumSq += uint64_t(*data) * *data;
+        }
+        stats.SetViaSums(static_cast<uint32_t>(pixels),
+                static_cast<double>(min), static_cast<double>(max),
+                static_cast<double>(sum), static_cast<double>(sumSq));
+    }
+    else
+    {
+        double M1 = *dataStart;
+        double M2 = 0.0;
+        uint32_t n = 1;
+        for (const T* data = dataStart + 1; data < dataEnd; data++)
+        {
+            if (min > *data)
+                min = *data;
+            else if (max < *data)
+                max = *data;
+            n++;
+            const double delta = *data - M1;
+            const double delta_n = delta / n;
+            M2 = M2 + delta_n * (n - 1) * delta;
+            M1 = M1 + delta_n;
+        }
+        stats.SetDirectly(static_cast<uint32_t>(pixels),
+                static_cast<double>(min), static_cast<double>(max), M1, M2);
+    }
+}
+
+// Implementation of TaskSet_ConvertToRgb8 before vectorization, used as
+// reference by RGB conversion benchmark. Same as in legacy code, the lookup
+// map is used only if not empty.
+template<typename T>
+static void ConvertToRgb8_Legacy(const pm::Bitmap& srcBmp, pm::Bitmap& dstBmp,
+        double srcMin, double srcMax, const std::vector<uint8_t>& lookupMap,
+        bool autoConbright, int brightness, int contrast)
+{
+    const uint32_t w = srcBmp.GetWidth();
+    const uint32_t h = srcBmp.GetHeight();
+    const uint32_t spp = srcBmp.GetFormat().GetSamplesPerPixel();
+
+    const double mp = (srcMax == srcMin) ? 255.0 : 255.0 / (srcMax - srcMin);
+    const T min = static_cast<T>(srcMin);
+    const T max = static_cast<T>(srcMax);
+    const double factor =
+        (259.0 * (contrast + 255))
+        / (255.0 * (259 - contrast));
+
+    auto convert = [&](T pix) -> uint8_t {
+        if (!lookupMap.empty())
+            return lookupMap[pix];
+        if (autoConbright)
+            return static_cast<uint8_t>(mp * (pm::Utils::Clamp(pix, min, max) - min));
+        const double pixF = mp * (pix - min);
+        const auto pixI = static_cast<int>(brightness + factor * (pixF - 128) + 128);
+        return static_cast<uint8_t>(pm::Utils::Clamp(pixI, 0, 255));
+    };
+
+    for (uint32_t y = 0; y < h; ++y)
+    {
+        const T* const srcLine = static_cast<const T*>(srcBmp.GetScanLine((uint16_t)y));
+        uint8_t* const dstLine = static_cast<uint8_t*>(dstBmp.GetScanLine((uint16_t)y));
+        for (uint32_t x = 0; x < w; ++x)
+        {
+            if (spp == 1)
+            {
+                const uint8_t pix8 = convert(srcLine[x]);
+                dstLine[3 * x + 0] = pix8;
+                dstLine[3 * x + 1] = pix8;
+                dstLine[3 * x + 2] = pix8;
+            }
+            else
+            {
+                dstLine[3 * x + 0] = convert(srcLine[3 * x + 0]);
+                dstLine[3 * x + 1] = convert(srcLine[3 * x + 1]);
+                dstLine[3 * x + 2] = convert(srcLine[3 * x + 2]);
+            }
+        }
+    }
+}
+
+// Calls given function repeatedly for at least cStatsMinTimeSec seconds,
+// returns throughput in GB/s
+static double MeasureThroughput(size_t bytes, const std::function<void()>& func)
+{
+    // Warm up caches and threads
+    func();
+
+    pm::Timer timer;
+    size_t reps = 0;
+    double seconds;
+    do
+    {
+        func();
+        reps++;
+        seconds = timer.Seconds();
+    }
+    while (seconds < cStatsMinTimeSec);
+
+    return (double)bytes * reps / seconds / 1e9;
+}
+
+// Fills all samples of given bitmap with random values within its bit depth
+static void FillRandomBitmap(pm::Bitmap& bmp, pm::XoShiRo128Plus& rng)
+{
+    const pm::BitmapFormat& format = bmp.GetFormat();
+    const uint16_t bitDepth = format.GetBitDepth();
+    const size_t samples = (size_t)bmp.GetWidth() * bmp.GetHeight()
+        * format.GetSamplesPerPixel();
+    const uint32_t mask = (bitDepth >= 32)
+        ? 0xFFFFFFFF : (uint32_t)((1ull << bitDepth) - 1);
+    for (size_t n = 0; n < samples; ++n)
+    {
+        const uint32_t value = rng.GetNext() & mask;
+        switch (format.GetDataType())
+        {
+        case pm::BitmapDataType::UInt8:
+            static_cast<uint8_t*>(bmp.GetData())[n] = (uint8_t)value;
+            break;
+        case pm::BitmapDataType::UInt16:
+            static_cast<uint16_t*>(bmp.GetData())[n] = (uint16_t)value;
+            break;
+        default:
+            static_cast<uint32_t*>(bmp.GetData())[n] = value;
+            break;
+        }
+    }
+}
+
+// Creates task sets running on own single-thread pool and on the unique pool
+template<typename TaskSetT>
+static bool CreateBenchTaskSets(std::unique_ptr<TaskSetT>& oneTasks,
+        std::unique_ptr<TaskSetT>& allTasks)
+{
+    try
+    {
+        oneTasks = std::make_unique<TaskSetT>(std::make_shared<pm::ThreadPool>(1));
+        allTasks = std::make_unique<TaskSetT>(pm::UniqueThreadPool::Get().GetPool());
+    }
+    catch (...)
+    {
+        pm::Log::LogE("Failed to create task sets");
+        return false;
+    }
+    return true;
+}
+
+// Measures legacy function and given task sets with every supported SIMD level
+// and appends the results of one benchmark case to given stream.
+// The setUp function prepares given task set for one execution.
+template<typename TaskSetT>
+static void MeasureSimdLevels(std::ostringstream& ss, uint32_t size,
+        const char* caseName, size_t bytes, const std::function<void()>& legacyFunc,
+        TaskSetT& oneTasks, TaskSetT& allTasks,
+        const std::function<void(TaskSetT&)>& setUp)
+{
+    const pm::SimdLevel supportedLevel = pm::CpuFeatures::GetSupportedSimdLevel();
+    const pm::SimdLevel origLevel = pm::CpuFeatures::GetSimdLevel();
+    const size_t threadCount = allTasks.GetThreadPool()->GetSize();
+
+    const double legacyGBps = MeasureThroughput(bytes, legacyFunc);
+
+    ss << "\n  " << size << "x" << size << " " << caseName << ":"
+        << "\n    Legacy, 1 thread = " << std::fixed << std::setprecision(2)
+        << legacyGBps << " GB/s";
+
+    for (int level = (int)pm::SimdLevel::Scalar;
+            level <= (int)supportedLevel; ++level)
+    {
+        pm::CpuFeatures::SetSimdLevel((pm::SimdLevel)level);
+
+        const double oneGBps = MeasureThroughput(bytes, [&]() {
+            setUp(oneTasks);
+            oneTasks.Execute();
+            oneTasks.Wait();
+        });
+        const double allGBps = MeasureThroughput(bytes, [&]() {
+            setUp(allTasks);
+            allTasks.Execute();
+            allTasks.Wait();
+        });
+
+        ss << "\n    " << pm::CpuFeatures::SimdLevelToStr((pm::SimdLevel)level)
+            << ", 1 thread = " << oneGBps << " GB/s ("
+            << oneGBps / legacyGBps << "x), "
+            << threadCount << " threads = " << allGBps << " GB/s ("
+            << allGBps / legacyGBps << "x)";
+    }
+    ss.unsetf(std::ios::fixed);
+
+    pm::CpuFeatures::SetSimdLevel(origLevel);
+}
+
+static const char* StorageTypeToStr(pm::StorageType type)
+{
+    switch (type)
+    {
+    case pm::StorageType::None:
+        return "none";
+    case pm::StorageType::Prd:
+        return "prd";
+    case pm::StorageType::Tiff:
+        return "tiff";
+    case pm::StorageType::BigTiff:
+        return "big-tiff";
+    // No default section, compiler will complain when new format added
+    }
+    return "unknown";
+}
+
+static const char* AllocatorTypeToStr(pm::AllocatorType type)
+{
+    switch (type)
+    {
+    case pm::AllocatorType::Default:
+        return "default";
+    case pm::AllocatorType::Align16:
+        return "align16";
+    case pm::AllocatorType::Align32:
+        return "align32";
+    case pm::AllocatorType::Align4k:
+        return "align4k";
+    case pm::AllocatorType::HugePages2M:
+        return "huge2m";
+    case pm::AllocatorType::HugePages1G:
+        return "huge1g";
+    // No default section, compiler will complain when new type added
+    }
+    return "unknown";
+}
+
+class Helper final
+{
+public:
+    enum class Bench {
+        Handoff,
+        Throughput,
+        FrameStats,
+        ConvertToRgb8,
+    };
+
+    // Results of one acquisition run by throughput benchmark
+    struct TrialResult
+    {
+        unsigned int targetFps{ 0 };
+        bool wasAborted{ false };
+        size_t framesAcquired{ 0 };
+        size_t acqFramesLost{ 0 };
+        size_t stageFramesLost{ 0 };
+        size_t diskFramesLost{ 0 };
+        size_t acqQueuePeak{ 0 };
+        size_t diskQueuePeak{ 0 };
+        double acqFps{ 0.0 };
+        double diskFps{ 0.0 };
+        double writeMiBps{ 0.0 };
+
+        bool IsLossFree() const
+        {
+            return !wasAborted
+                && acqFramesLost == 0 && stageFramesLost == 0 && diskFramesLost == 0;
+        }
+    };
+
+public:
+    Helper(int argc, char* argv[]);
+    ~Helper();
+
+public:
+    bool ProcessCliOptions();
+    void ShowHelp(); // Show help text if some set
+
+    int RunBenchmark();
+
+private: // CLI option handlers
+    bool HandleHelp(const std::string& value);
+    bool HandleBench(const std::string& value);
+    bool HandleTrialTime(const std::string& value);
+    bool HandleReport(const std::string& value);
+
+private:
+    void SetHelpText(const std::vector<pm::Option>& options);
+
+    // Creates and opens fake camera, parses remaining CLI options
+    int OpenFakeCamera();
+    void CloseFakeCamera();
+    // Runs one acquisition with current settings, blocks until finished
+    bool RunAcquisition();
+    // Runs acquisition for m_trialTimeSec seconds at given frame rate
+    bool RunTrial(unsigned int fps, TrialResult& result);
+    // Returns JSON object with configuration and all trial results
+    std::string GetThroughputReport(const std::vector<TrialResult>& trials,
+            unsigned int maxLossFreeFps) const;
+
+    // Measures time spent in camera callback thread to hand one frame over
+    // to acquisition thread
+    int RunBench_Handoff();
+    // Searches for max. frame rate the whole pipeline sustains without loss
+    int RunBench_Throughput();
+    // Compares frame statistics computation on all SIMD levels with legacy
+    // scalar implementation, runs without camera
+    int RunBench_FrameStats();
+    // Compares conversion to 8-bit RGB for display on all SIMD levels with
+    // legacy scalar implementation, runs without camera
+    int RunBench_ConvertToRgb8();
+
+private:
+    int m_appArgC;
+    char** m_appArgV;
+
+    pm::Settings m_settings{};
+    pm::OptionController m_optionController{};
+    pm::Option m_helpOption;
+    bool m_showFullHelp{ false };
+    std::string m_helpText{};
+    Bench m_bench{ Bench::Handoff };
+    unsigned int m_trialTimeSec{ cDefaultTrialTimeSec };
+    std::string m_reportFileName{};
+    std::shared_ptr<pm::Camera> m_camera{ nullptr };
+    std::shared_ptr<pm::Acquisition> m_acquisition{ nullptr };
+};
+
+Helper::Helper(int argc, char* argv[])
+    : m_appArgC(argc),
+    m_appArgV(argv),
+    m_helpOption(
+            { "-Help", "-help", "--help", "-h", "/?" },
+            { "" },
+            { "false" },
+            "Shows description for all supported options.",
+            static_cast<uint32_t>(pm::OptionId::Help),
+            std::bind(&Helper::HandleHelp, this, std::placeholders::_1))
+{
+    // Cannot fail, all values are valid
+    m_settings.SetFakeCamFps(cDefaultFakeCamFps);
+    m_settings.SetAcqFrameCount(cDefaultAcqFrameCount);
+}
+
+Helper::~Helper()
+{
+    CloseFakeCamera();
+}
+
+bool Helper::ProcessCliOptions()
+{
+    // Add Help option first (the variable is needed later)
+    if (!m_optionController.AddOption(m_helpOption))
+        return false;
+
+    if (!m_optionController.AddOption(pm::Option(
+            { "--bench", "-b" },
+            { "name" },
+            { "handoff" },
+            "Selects the benchmark to run.\n"
+            "Supported values are : 'handoff', 'throughput', 'stats' and 'rgb8'.\n"
+            "'handoff' benchmark:\n"
+            "  Acquires frames from fake camera at high frame rate with small ROI\n"
+            "  and reports time spent in callback thread to hand one frame over\n"
+            "  to acquisition thread. Nothing is saved to disk by default.\n"
+            "'throughput' benchmark:\n"
+            "  Runs acquisitions end to end incl. saving with given ROI, storage\n"
+            "  type, allocator, etc. The frame rate starts at fake camera FPS and\n"
+            "  doubles (or halves) until frames get lost, then the max. loss-free\n"
+            "  frame rate is found via binary search.\n"
+            "'stats' benchmark:\n"
+            "  Measures throughput of frame statistics computation in GB/s on\n"
+            "  random 2048x2048 and 4096x4096 frames of all data types, for legacy\n"
+            "  scalar code and each supported SIMD level, on one and all threads.\n"
+            "  The camera is not used.\n"
+            "'rgb8' benchmark:\n"
+            "  Same as 'stats' but measures conversion of mono and RGB frames to\n"
+            "  8-bit RGB for display, with automatic and manual contrast.\n"
+            "  The camera is not used.",
+            OptionId_Bench,
+            std::bind(&Helper::HandleBench, this, std::placeholders::_1))))
+        return false;
+
+    if (!m_optionController.AddOption(pm::Option(
+            { "--trial-time" },
+            { "seconds" },
+            { std::to_string(cDefaultTrialTimeSec) },
+            "Duration of one acquisition in 'throughput' benchmark.\n"
+            "The acquisition frame count is calculated from it and frame rate.",
+            OptionId_TrialTime,
+            std::bind(&Helper::HandleTrialTime, this, std::placeholders::_1))))
+        return false;
+
+    if (!m_optionController.AddOption(pm::Option(
+            { "--report" },
+            { "file" },
+            { "" },
+            "Appends results of 'throughput' benchmark to given file as one line\n"
+            "with JSON object, so multiple configurations can be collected.\n"
+            "The JSON is always printed to console too.",
+            OptionId_Report,
+            std::bind(&Helper::HandleReport, this, std::placeholders::_1))))
+        return false;
+
+    // Add all generic options
+    if (!m_settings.AddOptions(m_optionController))
+        return false;
+
+    const auto& cliOptions = m_optionController.GetOptions();
+    const bool cliParseOk = m_optionController.ProcessOptions(
+            m_appArgC, m_appArgV, cliOptions, true);
+    if (!cliParseOk || m_showFullHelp)
+    {
+        SetHelpText((m_showFullHelp)
+                ? cliOptions
+                : m_optionController.GetFailedProcessedOptions());
+        return cliParseOk;
+    }
+
+    if (m_settings.GetFakeCamFps() == 0)
+    {
+        pm::Log::LogE("Benchmarks run with fake camera only, FPS cannot be zero");
+        return false;
+    }
+
+    return true;
+}
+
+void Helper::ShowHelp()
+{
+    if (m_helpText.empty())
+        return;
+
+    pm::Log::LogI("\n%s", m_helpText.c_str());
+}
+
+int Helper::RunBenchmark()
+{
+    if (m_showFullHelp)
+        return APP_SUCCESS;
+
+    // Data processing benchmarks work without camera
+    const bool needsCamera =
+        m_bench != Bench::FrameStats && m_bench != Bench::ConvertToRgb8;
+    if (needsCamera)
+    {
+        const int retVal = OpenFakeCamera();
+        if (retVal != APP_SUCCESS || m_showFullHelp)
+            return retVal;
+    }
+
+    switch (m_bench)
+    {
+    case Bench::Handoff:
+        return RunBench_Handoff();
+    case Bench::Throughput:
+        return RunBench_Throughput();
+    case Bench::FrameStats:
+        return RunBench_FrameStats();
+    case Bench::ConvertToRgb8:
+        return RunBench_ConvertToRgb8();
+    // No default section, compiler will complain when new benchmark added
+    }
+
+    return APP_ERR_RUN;
+}
+
+bool Helper::HandleHelp(const std::string& value)
+{
+    if (value.empty())
+    {
+        m_showFullHelp = true;
+    }
+    else
+    {
+        if (!pm::Utils::StrToBool(value, m_showFullHelp))
+            return false;
+    }
+    return true;
+}
+
+bool Helper::HandleBench(const std::string& value)
+{
+    if (value == "handoff")
+        m_bench = Bench::Handoff;
+    else if (value == "throughput")
+        m_bench = Bench::Throughput;
+    else if (value == "stats")
+        m_bench = Bench::FrameStats;
+    else if (value == "rgb8")
+        m_bench = Bench::ConvertToRgb8;
+    else
+        return false;
+
+    return true;
+}
+
+bool Helper::HandleTrialTime(const std::string& value)
+{
+    unsigned int trialTimeSec;
+    if (!pm::Utils::StrToNumber<unsigned int>(value, trialTimeSec))
+        return false;
+    if (trialTimeSec == 0)
+        return false;
+
+    m_trialTimeSec = trialTimeSec;
+    return true;
+}
+
+bool Helper::HandleReport(const std::string& value)
+{
+    m_reportFileName = value;
+    return true;
+}
+
+void Helper::SetHelpText(const std::vector<pm::Option>& options)
+{
+    m_helpText  = "Usage\n";
+    m_helpText += "=====\n";
+    m_helpText += "\n";
+    m_helpText += "This CLI application runs performance benchmarks on top of fake camera.\n";
+    m_helpText += "Any generic acquisition option can be used to change default benchmark setup.\n";
+    m_helpText += "\n";
+    m_helpText += "Return value\n";
+    m_helpText += "------------\n";
+    m_helpText += "\n";
+    m_helpText += "  " + std::to_string(APP_SUCCESS)      + " - Application exited without any error.\n";
+    m_helpText += "  " + std::to_string(APP_ERR_CLI_ARGS) + " - Error while parsing CLI options.\n";
+    m_helpText += "  " + std::to_string(APP_ERR_RUN)      + " - Failure during benchmark setup or run.\n";
+    m_helpText += "  " + std::to_string(APP_ERR_LIB_LOAD) + " - Mandatory library not loaded at run-time.\n";
+    m_helpText += "\n";
+
+    m_helpText += m_optionController.GetOptionsDescription(options);
+
+    if (std::find_if(options.cbegin(), options.cend(),
+                [](const pm::Option& o) {
+                    return o.GetId() == static_cast<uint32_t>(pm::OptionId::Help);
+                })
+            == options.cend())
+    {
+        m_helpText += m_optionController.GetOptionsDescription(
+                { m_helpOption }, false);
+    }
+}
+
+int Helper::OpenFakeCamera()
+{
+    try
+    {
+        m_camera = std::make_shared<pm::FakeCamera>(m_settings.GetFakeCamFps());
+        m_acquisition = std::make_shared<pm::Acquisition>(m_camera);
+    }
+    catch (...)
+    {
+        pm::Log::LogE("Failure getting Camera or Acquisition instance!!!");
+        return APP_ERR_RUN;
+    }
+
+    if (!m_camera->InitLibrary())
+        return APP_ERR_RUN;
+
+    std::string camName;
+    if (!m_camera->GetName(0, camName))
+        return APP_ERR_RUN;
+
+    if (!m_camera->Open(camName, nullptr, nullptr))
+        return APP_ERR_RUN;
+
+    if (!m_camera->AddCliOptions(m_optionController, false))
+        return APP_ERR_CLI_ARGS;
+
+    const auto& cliAllOptions = m_optionController.GetOptions();
+    const bool cliParseOk = m_optionController.ProcessOptions(
+            m_appArgC, m_appArgV, cliAllOptions);
+    if (!cliParseOk || m_showFullHelp)
+    {
+        SetHelpText((m_showFullHelp)
+                ? cliAllOptions
+                : m_optionController.GetFailedProcessedOptions());
+
+        return (cliParseOk) ? APP_SUCCESS : APP_ERR_CLI_ARGS;
+    }
+
+    if (!m_camera->ReviseSettings(m_settings, m_optionController, false))
+        return APP_ERR_RUN;
+
+    // With no region specified use small one in sensor corner
+    if (m_settings.GetRegions().empty())
+    {
+        const auto width = m_camera->GetParams().Get<PARAM_SER_SIZE>()->GetCur();
+        const auto height = m_camera->GetParams().Get<PARAM_PAR_SIZE>()->GetCur();
+
+        std::vector<rgn_type> regions;
+        rgn_type rgn;
+        rgn.s1 = 0;
+        rgn.s2 = std::min<uns16>(width, cDefaultRoiSize) - 1;
+        rgn.sbin = m_settings.GetBinningSerial();
+        rgn.p1 = 0;
+        rgn.p2 = std::min<uns16>(height, cDefaultRoiSize) - 1;
+        rgn.pbin = m_settings.GetBinningParallel();
+        regions.push_back(rgn);
+        if (!m_settings.SetRegions(regions))
+            return APP_ERR_CLI_ARGS;
+    }
+
+    return APP_SUCCESS;
+}
+
+void Helper::CloseFakeCamera()
+{
+    if (m_acquisition)
+    {
+        // Ignore errors
+        m_acquisition->RequestAbort();
+        m_acquisition->WaitForStop(false);
+    }
+
+    if (m_camera)
+    {
+        // Ignore errors
+        if (m_camera->IsOpen())
+        {
+            m_camera->Close();
+        }
+        m_camera->UninitLibrary();
+    }
+
+    m_acquisition = nullptr;
+    m_camera = nullptr;
+}
+
+bool Helper::RunAcquisition()
+{
+    if (!m_camera->SetupExp(m_settings))
+    {
+        pm::Log::LogE("Please review your command line parameters");
+        return false;
+    }
+
+    if (!m_acquisition->Start())
+        return false;
+
+    const bool wasAborted = m_acquisition->WaitForStop(true);
+    return !wasAborted;
+}
+
+bool Helper::RunTrial(unsigned int fps, TrialResult& result)
+{
+    auto fakeCamera = std::static_pointer_cast<pm::FakeCamera>(m_camera);
+    if (!fakeCamera->SetTargetFps(fps) || !m_settings.SetFakeCamFps(fps))
+        return false;
+
+    const uint64_t frameCount = (uint64_t)fps * m_trialTimeSec;
+    if (!m_settings.SetAcqFrameCount((uint32_t)std::min<uint64_t>(frameCount,
+                    (std::numeric_limits<uint32_t>::max)())))
+        return false;
+
+    result = TrialResult();
+    result.targetFps = fps;
+    // Failure to start is a setup problem, abort during run counts as loss
+    if (!m_camera->SetupExp(m_settings))
+    {
+        pm::Log::LogE("Please review your command line parameters");
+        return false;
+    }
+    if (!m_acquisition->Start())
+        return false;
+    result.wasAborted = m_acquisition->WaitForStop(false);
+
+    const pm::AcquisitionStats& acqStats = m_acquisition->GetAcqStats();
+    const pm::AcquisitionStats& diskStats = m_acquisition->GetDiskStats();
+
+    result.framesAcquired = acqStats.GetFramesAcquired();
+    result.acqFramesLost = acqStats.GetFramesLost();
+    result.diskFramesLost = diskStats.GetFramesLost();
+    for (size_t n = 0; n < m_acquisition->GetFrameStageCount(); ++n)
+    {
+        result.stageFramesLost +=
+            m_acquisition->GetFrameStageStats(n).GetFramesLost();
+    }
+    result.acqQueuePeak = acqStats.GetQueueSizePeak();
+    result.diskQueuePeak = diskStats.GetQueueSizePeak();
+    result.acqFps = acqStats.GetOverallFrameRate();
+    result.diskFps = diskStats.GetOverallFrameRate();
+    if (m_settings.GetStorageType() != pm::StorageType::None)
+    {
+        const size_t frameBytes = m_camera->GetFrameAcqCfg().GetFrameBytes();
+        result.writeMiBps = result.diskFps * frameBytes / 1024 / 1024;
+    }
+
+    return true;
+}
+
+std::string Helper::GetThroughputReport(const std::vector<TrialResult>& trials,
+        unsigned int maxLossFreeFps) const
+{
+    const rgn_type rgn =
+        pm::SettingsReader::GetImpliedRegion(m_settings.GetRegions());
+    const auto& acqCfg = m_camera->GetFrameAcqCfg();
+
+    std::ostringstream ss;
+    ss << "{\"bench\":\"throughput\""
+        << ",\"roi\":{\"s1\":" << rgn.s1 << ",\"s2\":" << rgn.s2
+            << ",\"sbin\":" << rgn.sbin << ",\"p1\":" << rgn.p1
+            << ",\"p2\":" << rgn.p2 << ",\"pbin\":" << rgn.pbin << "}"
+        << ",\"roiCount\":" << m_settings.GetRegions().size()
+        << ",\"bitDepth\":" << acqCfg.GetBitmapFormat().GetBitDepth()
+        << ",\"frameBytes\":" << acqCfg.GetFrameBytes()
+        << ",\"storage\":\"" << StorageTypeToStr(m_settings.GetStorageType()) << "\""
+        << ",\"allocator\":\"" << AllocatorTypeToStr(m_settings.GetAllocatorType()) << "\""
+        << ",\"saveThreads\":" << m_settings.GetSaveThreadCount()
+        << ",\"trialTimeSec\":" << m_trialTimeSec
+        << ",\"maxLossFreeFps\":" << maxLossFreeFps
+        << ",\"trials\":[";
+    for (size_t n = 0; n < trials.size(); ++n)
+    {
+        const TrialResult& trial = trials[n];
+        ss << ((n > 0) ? "," : "")
+            << "{\"targetFps\":" << trial.targetFps
+            << ",\"lossFree\":" << ((trial.IsLossFree()) ? "true" : "false")
+            << ",\"aborted\":" << ((trial.wasAborted) ? "true" : "false")
+            << ",\"framesAcquired\":" << trial.framesAcquired
+            << ",\"acqFramesLost\":" << trial.acqFramesLost
+            << ",\"stageFramesLost\":" << trial.stageFramesLost
+            << ",\"diskFramesLost\":" << trial.diskFramesLost
+            << ",\"acqQueuePeak\":" << trial.acqQueuePeak
+            << ",\"diskQueuePeak\":" << trial.diskQueuePeak
+            << ",\"acqFps\":" << trial.acqFps
+            << ",\"diskFps\":" << trial.diskFps
+            << ",\"writeMiBps\":" << trial.writeMiBps
+            << "}";
+    }
+    ss << "]}";
+
+    return ss.str();
+}
+
+int Helper::RunBench_Handoff()
+{
+    if (!RunAcquisition())
+        return APP_ERR_RUN;
+
+    const pm::AcquisitionStats& stats = m_acquisition->GetAcqStats();
+
+    std::ostringstream ss;
+    ss << "Handoff benchmark results:"
+        << "\n  Target frame rate = " << m_settings.GetFakeCamFps() << " fps"
+        << "\n  Achieved frame rate = " << stats.GetOverallFrameRate() << " fps"
+        << "\n  Frames acquired = " << stats.GetFramesAcquired()
+        << "\n  Frames lost = " << stats.GetFramesLost()
+        << "\n  Max. queued frames = " << stats.GetQueueSizePeak()
+            << " out of " << stats.GetQueueCapacity()
+        << "\n  Avg. handoff time = " << stats.GetAvgHandoffTime() * 1e6 << " us"
+        << "\n  Max. handoff time = " << stats.GetMaxHandoffTime() * 1e6 << " us"
+        << "\n";
+    pm::Log::LogI(ss.str());
+
+    return APP_SUCCESS;
+}
+
+int Helper::RunBench_Throughput()
+{
+    std::vector<TrialResult> trials;
+    // Highest frame rate without loss and lowest one with loss, zero if none
+    unsigned int goodFps = 0;
+    unsigned int badFps = 0;
+
+    unsigned int fps = std::min(m_settings.GetFakeCamFps(), cMaxFakeCamFps);
+    for (;;)
+    {
+        pm::Log::LogI("Running %u seconds at %u fps...", m_trialTimeSec, fps);
+
+        TrialResult trial;
+        if (!RunTrial(fps, trial))
+            return APP_ERR_RUN;
+        trials.push_back(trial);
+
+        pm::Log::LogI("  %s, %zu frames acquired, %zu lost in acquisition, "
+                "%zu in stages, %zu in saving",
+                (trial.IsLossFree()) ? "loss-free" : "lossy", trial.framesAcquired,
+                trial.acqFramesLost, trial.stageFramesLost, trial.diskFramesLost);
+
+        if (trial.IsLossFree())
+            goodFps = fps;
+        else
+            badFps = fps;
+
+        if (badFps == 0)
+        {
+            // Ramp up until first loss
+            if (fps >= cMaxFakeCamFps)
+                break;
+            fps = (unsigned int)std::min<uint64_t>(2ull * fps, cMaxFakeCamFps);
+        }
+        else if (goodFps == 0)
+        {
+            // Ramp down until first loss-free run
+            if (fps <= 1)
+                break;
+            fps /= 2;
+        }
+        else
+        {
+            const unsigned int gap = badFps - goodFps;
+            if (gap <= 1 || gap <= goodFps * cFpsSearchPrecision)
+                break;
+            fps = goodFps + gap / 2;
+        }
+    }
+
+    const std::string report = GetThroughputReport(trials, goodFps);
+
+    std::ostringstream ss;
+    ss << "Throughput benchmark results:"
+        << "\n  Max. loss-free frame rate = " << goodFps << " fps";
+    if (badFps == 0)
+    {
+        ss << " (limit of the benchmark reached)";
+    }
+    ss << "\n  Frame size = " << m_camera->GetFrameAcqCfg().GetFrameBytes() << " bytes"
+        << "\n  Trials run = " << trials.size()
+        << "\n" << report << "\n";
+    pm::Log::LogI(ss.str());
+
+    if (!m_reportFileName.empty())
+    {
+        std::ofstream fout(m_reportFileName, std::ios::app);
+        fout << report << std::endl;
+        if (!fout)
+        {
+            pm::Log::LogE("Failure writing report to '%s'", m_reportFileName.c_str());
+            return APP_ERR_RUN;
+        }
+    }
+
+    return APP_SUCCESS;
+}
+
+int Helper::RunBench_FrameStats()
+{
+    struct StatsCase
+    {
+        const char* name;
+        pm::BitmapDataType dataType;
+        uint16_t bitDepth;
+    };
+    const StatsCase cases[] = {
+        { "uint8", pm::BitmapDataType::UInt8, 8 },
+        { "uint16", pm::BitmapDataType::UInt16, 16 },
+        { "uint32 (16b)", pm::BitmapDataType::UInt32, 16 },
+        { "uint32 (32b)", pm::BitmapDataType::UInt32, 32 },
+    };
+
+    std::unique_ptr<pm::TaskSet_ComputeFrameStats> oneTasks;
+    std::unique_ptr<pm::TaskSet_ComputeFrameStats> allTasks;
+    if (!CreateBenchTaskSets(oneTasks, allTasks))
+        return APP_ERR_RUN;
+
+    std::ostringstream ss;
+    ss << "Frame statistics benchmark results (GB/s, "
+        << allTasks->GetThreadPool()->GetSize() << " threads, max. SIMD level "
+        << pm::CpuFeatures::SimdLevelToStr(pm::CpuFeatures::GetSupportedSimdLevel())
+        << "):";
+
+    pm::XoShiRo128Plus rng;
+    pm::FrameStats stats;
+    for (const uint32_t size : cStatsFrameSizes)
+    {
+        for (const auto& c : cases)
+        {
+            const pm::BitmapFormat format(pm::BitmapPixelType::Mono, c.dataType,
+                    c.bitDepth);
+            std::unique_ptr<pm::Bitmap> bmp;
+            try
+            {
+                bmp = std::make_unique<pm::Bitmap>(size, size, format);
+            }
+            catch (...)
+            {
+                pm::Log::LogE("Failed to allocate %ux%u bitmap", size, size);
+                return APP_ERR_RUN;
+            }
+            FillRandomBitmap(*bmp, rng);
+
+            const size_t pixels = (size_t)size * size;
+            const bool upTo16b = c.bitDepth <= 16;
+            const auto legacyFunc = [&]() {
+                switch (c.dataType)
+                {
+                case pm::BitmapDataType::UInt8:
+                    ComputeStats_Legacy(static_cast<const uint8_t*>(bmp->GetData()),
+                            pixels, upTo16b, stats);
+                    break;
+                case pm::BitmapDataType::UInt16:
+                    ComputeStats_Legacy(static_cast<const uint16_t*>(bmp->GetData()),
+                            pixels, upTo16b, stats);
+                    break;
+                default:
+                    ComputeStats_Legacy(static_cast<const uint32_t*>(bmp->GetData()),
+                            pixels, upTo16b, stats);
+                    break;
+                }
+            };
+
+            MeasureSimdLevels<pm::TaskSet_ComputeFrameStats>(ss, size, c.name,
+                    bmp->GetDataBytes(), legacyFunc, *oneTasks, *allTasks,
+                    [&](pm::TaskSet_ComputeFrameStats& tasks) {
+                        tasks.SetUp(bmp.get(), &stats);
+                    });
+        }
+    }
+    ss << "\n";
+
+    pm::Log::LogI(ss.str());
+
+    return APP_SUCCESS;
+}
+
+int Helper::RunBench_ConvertToRgb8()
+{
+    struct ConvCase
+    {
+        const char* name;
+        pm::BitmapPixelType pixelType;
+        pm::BitmapDataType dataType;
+        uint16_t bitDepth;
+        bool autoConbright;
+    };
+    const ConvCase cases[] = {
+        { "mono uint8", pm::BitmapPixelType::Mono, pm::BitmapDataType::UInt8, 8, true },
+        { "mono uint16 (12b)", pm::BitmapPixelType::Mono, pm::BitmapDataType::UInt16, 12, true },
+        { "mono uint16 (16b), manual", pm::BitmapPixelType::Mono, pm::BitmapDataType::UInt16, 16, false },
+        { "mono uint32 (16b)", pm::BitmapPixelType::Mono, pm::BitmapDataType::UInt32, 16, true },
+        { "mono uint32 (32b)", pm::BitmapPixelType::Mono, pm::BitmapDataType::UInt32, 32, true },
+        { "mono uint32 (32b), manual", pm::BitmapPixelType::Mono, pm::BitmapDataType::UInt32, 32, false },
+        { "rgb uint16 (12b)", pm::BitmapPixelType::RGB, pm::BitmapDataType::UInt16, 12, true },
+    };
+    const int brightness = 20;
+    const int contrast = 40;
+
+    std::unique_ptr<pm::TaskSet_ConvertToRgb8> oneTasks;
+    std::unique_ptr<pm::TaskSet_ConvertToRgb8> allTasks;
+    if (!CreateBenchTaskSets(oneTasks, allTasks))
+        return APP_ERR_RUN;
+
+    std::ostringstream ss;
+    ss << "RGB8 conversion benchmark results (GB/s of source data, "
+        << allTasks->GetThreadPool()->GetSize() << " threads, max. SIMD level "
+        << pm::CpuFeatures::SimdLevelToStr(pm::CpuFeatures::GetSupportedSimdLevel())
+        << "):";
+
+    pm::XoShiRo128Plus rng;
+    std::vector<uint8_t> lookupMap;
+    std::vector<uint8_t> legacyLookupMap;
+    for (const uint32_t size : cStatsFrameSizes)
+    {
+        for (const auto& c : cases)
+        {
+            const pm::BitmapFormat format(c.pixelType, c.dataType, c.bitDepth);
+            const pm::BitmapFormat rgbFormat(pm::BitmapPixelType::RGB,
+                    pm::BitmapDataType::UInt8, 8);
+            std::unique_ptr<pm::Bitmap> bmp;
+            std::unique_ptr<pm::Bitmap> dstBmp;
+            try
+            {
+                bmp = std::make_unique<pm::Bitmap>(size, size, format);
+                dstBmp = std::make_unique<pm::Bitmap>(size, size, rgbFormat);
+            }
+            catch (...)
+            {
+                pm::Log::LogE("Failed to allocate %ux%u bitmap", size, size);
+                return APP_ERR_RUN;
+            }
+            FillRandomBitmap(*bmp, rng);
+
+            // Limits within the range so some pixels get clipped
+            const uint32_t mask = (c.bitDepth >= 32)
+                ? 0xFFFFFFFF : (uint32_t)((1ull << c.bitDepth) - 1);
+            const double min = (double)(mask / 8);
+            const double max = (double)(mask - mask / 8);
+            pm::TaskSet_ConvertToRgb8::UpdateLookupMap(lookupMap, format,
+                    min, max, c.autoConbright, brightness, contrast);
+            // Legacy code had lookup map for 8 and 16 bit data types only
+            legacyLookupMap.clear();
+            if (c.dataType != pm::BitmapDataType::UInt32)
+                legacyLookupMap = lookupMap;
+
+            const auto legacyFunc = [&]() {
+                switch (c.dataType)
+                {
+                case pm::BitmapDataType::UInt8:
+                    ConvertToRgb8_Legacy<uint8_t>(*bmp, *dstBmp, min, max,
+                            legacyLookupMap, c.autoConbright, brightness, contrast);
+                    break;
+                case pm::BitmapDataType::UInt16:
+                    ConvertToRgb8_Legacy<uint16_t>(*bmp, *dstBmp, min, max,
+                            legacyLookupMap, c.autoConbright, brightness, contrast);
+                    break;
+                default:
+                    ConvertToRgb8_Legacy<uint32_t>(*bmp, *dstBmp, min, max,
+                            legacyLookupMap, c.autoConbright, brightness, contrast);
+                    break;
+                }
+            };
+
+            MeasureSimdLevels<pm::TaskSet_ConvertToRgb8>(ss, size, c.name,
+                    bmp->GetDataBytes(), legacyFunc, *oneTasks, *allTasks,
+                    [&](pm::TaskSet_ConvertToRgb8& tasks) {
+                        tasks.SetUp(dstBmp.get(), bmp.get(), min, max,
+                                &lookupMap, c.autoConbright, brightness, contrast);
+                    });
+        }
+    }
+    ss << "\n";
+
+    pm::Log::LogI(ss.str());
+
+    return APP_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    int retVal = APP_SUCCESS;
+
+    {
+        // Initiate the Log instance as the very first before any logging starts
+        std::shared_ptr<pm::ConsoleLogger> consoleLogger;
+        try
+        {
+            consoleLogger = std::make_shared<pm::ConsoleLogger>();
+        }
+        catch (...)
+        {
+            retVal = APP_ERR_LIB_LOAD;
+            std::cerr << "Failed to initialize console logger" << std::endl;
+            std::cerr << "\nExiting with error " << retVal << std::endl;
+            return retVal;
+        }
+
+        pm::Log::LogI("PVCamBench");
+        pm::Log::LogI("Version %s", VERSION_NUMBER_STR);
+
+        // PVCAM library is needed for frame metadata decoding only,
+        // the fake camera works without it
+        auto pvcam = pm::PvcamRuntimeLoader::Get();
+        try
+        {
+            pvcam->Load();
+
+            pm::Log::LogI("-------------------");
+            pm::Log::LogI("Found %s", pvcam->GetFileName().c_str());
+            pm::Log::LogI("Path '%s'", pvcam->GetFilePath().c_str());
+
+            pvcam->LoadSymbols();
+        }
+        catch (const pm::RuntimeLoader::Exception& ex)
+        {
+            pm::Log::LogW("Failed to load PVCAM library, metadata cannot be used (%s)",
+                    ex.what());
+            if (pvcam->IsLoaded())
+            {
+                pvcam->Unload();
+            }
+        }
+
+        pm::Log::LogI("==================\n");
+
+        auto helper = std::make_shared<Helper>(argc, argv);
+
+        if (!helper->ProcessCliOptions())
+        {
+            retVal = APP_ERR_CLI_ARGS;
+        }
+        else
+        {
+            try
+            {
+                // ATM can fail either by throwing an exception or returning error
+                retVal = helper->RunBenchmark();
+            }
+            catch (const pm::Exception& ex)
+            {
+                pm::Log::LogE(ex.what());
+                retVal = APP_ERR_RUN;
+            }
+        }
+
+        helper->ShowHelp();
+        helper = nullptr;
+
+        try
+        {
+            if (pvcam->IsLoaded())
+            {
+                pvcam->Unload();
+            }
+        }
+        catch (const pm::RuntimeLoader::Exception& ex)
+        {
+            pm::Log::LogE(ex.what());
+        }
+        pvcam->Release();
+
+        pm::Log::Flush();
+    }
+
+    if (retVal != APP_SUCCESS)
+    {
+        std::cout << "\nExiting with error " << retVal << std::endl;
+    }
+    else
+    {
+        std::cout << "\nFinished successfully" << std::endl;
+    }
+
+    return retVal;
+}
@@ -137,6 +137,13 @@ static BOOL WINAPI ConsoleCtrlHandler(DWORD dwCtrlType)
 
     if (g_acquisition)
     {
+        // With pre-trigger capture enabled Ctrl+Break triggers it
+        if (dwCtrlType == CTRL_BREAK_EVENT && g_acquisition->TriggerCapture())
+        {
+            pm::Log::LogI("\n>>> Capture triggered\n");
+            return TRUE;
+        }
+
         // On first abort it gives a chance to finish processing.
         // On second abort it forces full stop.
         g_acquisition->RequestAbort(g_userAbortFlag);
@@ -162,9 +169,19 @@ static void TerminalSignalHandler(int sigNum)
         g_userAbortFlag = true;
     }
 }
+
+static void TerminalTriggerHandler(int /*sigNum*/)
+{
+    // Triggers pre-trigger capture if enabled
+    if (g_acquisition && g_acquisition->TriggerCapture())
+    {
+        pm::Log::LogI("\n>>> Capture triggered\n");
+    }
+}
 #endif
 
 // Sets handlers that properly end acquisition on Ctrl+C, Ctrl+Break, Log-off, etc.
+// and the one triggering pre-trigger capture on Ctrl+Break or SIGUSR1.
 bool Helper::InstallTerminationHandlers()
 {
     bool retVal;
@@ -175,10 +192,14 @@ bool Helper::InstallTerminationHandlers()
     struct sigaction newAction;
     memset(&newAction, 0, sizeof(newAction));
     newAction.sa_handler = TerminalSignalHandler;
+    struct sigaction triggerAction;
+    memset(&triggerAction, 0, sizeof(triggerAction));
+    triggerAction.sa_handler = TerminalTriggerHandler;
     retVal = true;
     if (0 != sigaction(SIGINT, &newAction, NULL)
             || 0 != sigaction(SIGHUP, &newAction, NULL)
-            || 0 != sigaction(SIGTERM, &newAction, NULL))
+            || 0 != sigaction(SIGTERM, &newAction, NULL)
+            || 0 != sigaction(SIGUSR1, &triggerAction, NULL))
         retVal = false;
 #endif
 
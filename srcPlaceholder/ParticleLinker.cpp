@@ -8,13 +8,15 @@
 
 /* System */
 #include <algorithm> // std::min
+#include <atomic>
 
 pm::ParticleLinker::ParticleLinker(uint32_t maxTrajectories,
         uint32_t maxTrajectoryPoints)
-    : m_depth(maxTrajectoryPoints)
+    : m_depth(maxTrajectoryPoints),
+    m_trajectories(std::make_shared<Frame::Trajectories>())
 {
-    m_trajectories.header.maxTrajectories = maxTrajectories;
-    m_trajectories.header.maxTrajectoryPoints = maxTrajectoryPoints;
+    m_trajectories->header.maxTrajectories = maxTrajectories;
+    m_trajectories->header.maxTrajectoryPoints = maxTrajectoryPoints;
 }
 
 void pm::ParticleLinker::AddParticles(const ph_track_particle* pParticles,
@@ -101,8 +103,21 @@ void pm::ParticleLinker::AddParticles(const ph_track_particle* pParticles,
         }
     }
 
-    // Update trajectories
-    m_trajectories.data.clear();
+    // Update trajectories in place if the last snapshot isn't shared,
+    // otherwise frames holding it would see the change
+    if (m_trajectories.use_count() > 1)
+    {
+        auto trajectories = std::make_shared<Frame::Trajectories>();
+        trajectories->header = m_trajectories->header;
+        m_trajectories = trajectories;
+    }
+    else
+    {
+        // Pairs with release of references held by other threads
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    auto& data = m_trajectories->data;
+    size_t trajectoryCount = 0;
     // Going through particles
     for (auto& particlePair : m_particles)
     {
@@ -113,7 +128,12 @@ void pm::ParticleLinker::AddParticles(const ph_track_particle* pParticles,
         if (newParticles.count(particleId) == 0)
             continue;
 
-        Frame::Trajectory trajectory;
+        // Re-use trajectories from previous frame with allocated points
+        if (trajectoryCount == data.size())
+        {
+            data.emplace_back();
+        }
+        Frame::Trajectory& trajectory = data[trajectoryCount++];
         trajectory.header.roiNr = queues.currentRoiNr;
         trajectory.header.particleId = particleId;
         trajectory.header.lifetime = newParticles[particleId]->lifetime;
@@ -123,14 +143,13 @@ void pm::ParticleLinker::AddParticles(const ph_track_particle* pParticles,
                 trajectory.header.lifetime));
         trajectory.header.pointCount =
             static_cast<uint32_t>(trajectory.data.size());
-
-        m_trajectories.data.push_back(trajectory);
     }
-    m_trajectories.header.trajectoryCount =
-        static_cast<uint32_t>(m_trajectories.data.size());
+    data.resize(trajectoryCount);
+    m_trajectories->header.trajectoryCount =
+        static_cast<uint32_t>(trajectoryCount);
 }
 
-const pm::Frame::Trajectories& pm::ParticleLinker::GetTrajectories() const
+std::shared_ptr<const pm::Frame::Trajectories> pm::ParticleLinker::GetTrajectories() const
 {
     return m_trajectories;
 }
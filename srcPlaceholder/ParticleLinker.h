@@ -13,6 +13,7 @@
 #include <cstdint>
 #include <deque>
 #include <map>
+#include <memory>
 #include <vector>
 
 // Forward declaration from pvcam_helper_track.h
@@ -27,7 +28,9 @@ public:
 
 public:
     void AddParticles(const ph_track_particle* pParticles, uint32_t count);
-    const Frame::Trajectories& GetTrajectories() const;
+    // Returns immutable snapshot of trajectories built by last AddParticles,
+    // frames can share it without copying
+    std::shared_ptr<const Frame::Trajectories> GetTrajectories() const;
 
 private:
     struct Queues
@@ -40,7 +43,8 @@ private:
 private:
     uint32_t m_depth{ 0 };
     std::map<uint32_t, Queues> m_particles{}; // Key is particle id
-    Frame::Trajectories m_trajectories{};
+    // Reused by next AddParticles if no frame holds it anymore
+    std::shared_ptr<Frame::Trajectories> m_trajectories{};
 };
 
 } // namespace pm
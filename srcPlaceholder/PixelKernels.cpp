@@ -0,0 +1,1695 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/PixelKernels.h"
+
+/* System */
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if PM_SIMD_X86
+    #include <immintrin.h>
+#endif
+
+using Sums = pm::PixelKernels::Sums;
+
+// Vector iterations between flushes of 32-bit partial sums to 64 bits.
+// Each 32-bit lane grows by max. 2^18 per iteration.
+static constexpr size_t cFlushVecs = 16384;
+
+// Bias flipping unsigned 16-bit values to signed range for multiply-add.
+// With y = x - 2^15: x^2 = y^2 + 2^16 * y + 2^30
+static constexpr uint64_t cBias16 = 32768;
+
+// Accumulates min., max. and sums of given pixels to existing results.
+// The min. and max. are updated via branches, on real frames they are
+// predicted well and a chain of dependent selects is slower.
+template<typename T, bool withSumSq>
+static void ComputeSums_Scalar(const T* data, size_t count, Sums& sums)
+{
+    uint32_t min = sums.min;
+    uint32_t max = sums.max;
+    uint64_t sum = sums.sum;
+    uint64_t sumSq = sums.sumSq;
+
+    for (size_t n = 0; n < count; ++n)
+    {
+        const uint32_t value = data[n];
+        if (min > value)
+            min = value;
+        else if (max < value)
+            max = value;
+        sum += value;
+        if (withSumSq)
+        {
+            sumSq += (uint64_t)value * value;
+        }
+    }
+
+    sums.min = min;
+    sums.max = max;
+    sums.sum = sum;
+    sums.sumSq = sumSq;
+}
+
+#if PM_SIMD_X86
+
+template<typename T, size_t N>
+static void FoldMinMax(const T (&mins)[N], const T (&maxs)[N], Sums& sums)
+{
+    for (size_t n = 0; n < N; ++n)
+    {
+        sums.min = std::min<uint32_t>(sums.min, mins[n]);
+        sums.max = std::max<uint32_t>(sums.max, maxs[n]);
+    }
+}
+
+template<typename T, size_t N>
+static T FoldSum(const T (&values)[N])
+{
+    T sum = 0;
+    for (size_t n = 0; n < N; ++n)
+    {
+        sum += values[n];
+    }
+    return sum;
+}
+
+// Adds sums of biased 16-bit values, see cBias16
+static void AddBiasedSums16(Sums& sums, size_t count, int64_t sumY, uint64_t sumYSq)
+{
+    // Wraps around in unsigned arithmetic but the result fits
+    sums.sum += (uint64_t)sumY + cBias16 * count;
+    sums.sumSq += sumYSq + ((uint64_t)sumY << 16) + ((uint64_t)count << 30);
+}
+
+// SSE4.1
+
+PM_TARGET_SSE41
+static size_t ComputeSums_Sse41(const uint8_t* data, size_t count, Sums& sums)
+{
+    const __m128i* src = reinterpret_cast<const __m128i*>(data);
+    const size_t vecCount = count / 16;
+
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vMin = _mm_set1_epi8(-1);
+    __m128i vMax = zero;
+    __m128i vSum = zero;
+    __m128i vSumSq = zero;
+
+    for (size_t n = 0; n < vecCount;)
+    {
+        const size_t flushAt = std::min(vecCount, n + cFlushVecs);
+        __m128i vSumSq32 = zero;
+        for (; n < flushAt; ++n)
+        {
+            const __m128i v = _mm_loadu_si128(src + n);
+            vMin = _mm_min_epu8(vMin, v);
+            vMax = _mm_max_epu8(vMax, v);
+            vSum = _mm_add_epi64(vSum, _mm_sad_epu8(v, zero));
+            const __m128i lo = _mm_unpacklo_epi8(v, zero);
+            const __m128i hi = _mm_unpackhi_epi8(v, zero);
+            vSumSq32 = _mm_add_epi32(vSumSq32,
+                    _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+        }
+        vSumSq = _mm_add_epi64(vSumSq,
+                _mm_add_epi64(_mm_unpacklo_epi32(vSumSq32, zero),
+                    _mm_unpackhi_epi32(vSumSq32, zero)));
+    }
+
+    uint8_t mins[16];
+    uint8_t maxs[16];
+    uint64_t sum[2];
+    uint64_t sumSq[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), vMin);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), vMax);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sum), vSum);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sumSq), vSumSq);
+    FoldMinMax(mins, maxs, sums);
+    sums.sum += FoldSum(sum);
+    sums.sumSq += FoldSum(sumSq);
+
+    return vecCount * 16;
+}
+
+// Accumulates 8 values already in 16-bit lanes, used for uint16 and uint32
+#define PM_SSE41_SUMS16_STEP(v) \
+    { \
+        const __m128i y = _mm_xor_si128(v, bias); \
+        vSumY32 = _mm_add_epi32(vSumY32, _mm_madd_epi16(y, ones)); \
+        const __m128i ySq = _mm_madd_epi16(y, y); \
+        vSumYSq = _mm_add_epi64(vSumYSq, _mm_add_epi64( \
+                    _mm_unpacklo_epi32(ySq, zero), _mm_unpackhi_epi32(ySq, zero))); \
+    }
+
+#define PM_SSE41_SUMS16_FLUSH() \
+    vSumY = _mm_add_epi64(vSumY, _mm_add_epi64(_mm_cvtepi32_epi64(vSumY32), \
+                _mm_cvtepi32_epi64(_mm_srli_si128(vSumY32, 8))))
+
+PM_TARGET_SSE41
+static size_t ComputeSums_Sse41(const uint16_t* data, size_t count, Sums& sums)
+{
+    const __m128i* src = reinterpret_cast<const __m128i*>(data);
+    const size_t vecCount = count / 8;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i bias = _mm_set1_epi16(-32768);
+    __m128i vMin = _mm_set1_epi16(-1);
+    __m128i vMax = zero;
+    __m128i vSumY = zero;
+    __m128i vSumYSq = zero;
+
+    for (size_t n = 0; n < vecCount;)
+    {
+        const size_t flushAt = std::min(vecCount, n + cFlushVecs);
+        __m128i vSumY32 = zero;
+        for (; n < flushAt; ++n)
+        {
+            const __m128i v = _mm_loadu_si128(src + n);
+            vMin = _mm_min_epu16(vMin, v);
+            vMax = _mm_max_epu16(vMax, v);
+            PM_SSE41_SUMS16_STEP(v);
+        }
+        PM_SSE41_SUMS16_FLUSH();
+    }
+
+    uint16_t mins[8];
+    uint16_t maxs[8];
+    int64_t sumY[2];
+    uint64_t sumYSq[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), vMin);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), vMax);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sumY), vSumY);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sumYSq), vSumYSq);
+    FoldMinMax(mins, maxs, sums);
+    AddBiasedSums16(sums, vecCount * 8, FoldSum(sumY), FoldSum(sumYSq));
+
+    return vecCount * 8;
+}
+
+PM_TARGET_SSE41
+static size_t ComputeSums_Sse41(const uint32_t* data, size_t count, Sums& sums)
+{
+    const __m128i* src = reinterpret_cast<const __m128i*>(data);
+    const size_t vecCount = count / 8;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i bias = _mm_set1_epi16(-32768);
+    __m128i vMin = _mm_set1_epi32(-1);
+    __m128i vMax = zero;
+    __m128i vSumY = zero;
+    __m128i vSumYSq = zero;
+
+    for (size_t n = 0; n < vecCount;)
+    {
+        const size_t flushAt = std::min(vecCount, n + cFlushVecs);
+        __m128i vSumY32 = zero;
+        for (; n < flushAt; ++n)
+        {
+            const __m128i v0 = _mm_loadu_si128(src + 2 * n);
+            const __m128i v1 = _mm_loadu_si128(src + 2 * n + 1);
+            vMin = _mm_min_epu32(vMin, _mm_min_epu32(v0, v1));
+            vMax = _mm_max_epu32(vMax, _mm_max_epu32(v0, v1));
+            // Values have max. 16 bits, saturation never happens
+            const __m128i v = _mm_packus_epi32(v0, v1);
+            PM_SSE41_SUMS16_STEP(v);
+        }
+        PM_SSE41_SUMS16_FLUSH();
+    }
+
+    uint32_t mins[4];
+    uint32_t maxs[4];
+    int64_t sumY[2];
+    uint64_t sumYSq[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), vMin);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), vMax);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sumY), vSumY);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sumYSq), vSumYSq);
+    FoldMinMax(mins, maxs, sums);
+    AddBiasedSums16(sums, vecCount * 8, FoldSum(sumY), FoldSum(sumYSq));
+
+    return vecCount * 8;
+}
+
+PM_TARGET_SSE41
+static size_t ComputeMinMaxSum_Sse41(const uint32_t* data, size_t count, Sums& sums)
+{
+    const __m128i* src = reinterpret_cast<const __m128i*>(data);
+    const size_t vecCount = count / 4;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo32 = _mm_set1_epi64x(0xFFFFFFFF);
+    __m128i vMin = _mm_set1_epi32(-1);
+    __m128i vMax = zero;
+    __m128i vSum = zero;
+
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const __m128i v = _mm_loadu_si128(src + n);
+        vMin = _mm_min_epu32(vMin, v);
+        vMax = _mm_max_epu32(vMax, v);
+        vSum = _mm_add_epi64(vSum,
+                _mm_add_epi64(_mm_and_si128(v, lo32), _mm_srli_epi64(v, 32)));
+    }
+
+    uint32_t mins[4];
+    uint32_t maxs[4];
+    uint64_t sum[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), vMin);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), vMax);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sum), vSum);
+    FoldMinMax(mins, maxs, sums);
+    sums.sum += FoldSum(sum);
+
+    return vecCount * 4;
+}
+
+// AVX2
+
+PM_TARGET_AVX2
+static size_t ComputeSums_Avx2(const uint8_t* data, size_t count, Sums& sums)
+{
+    const __m256i* src = reinterpret_cast<const __m256i*>(data);
+    const size_t vecCount = count / 32;
+
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i vMin = _mm256_set1_epi8(-1);
+    __m256i vMax = zero;
+    __m256i vSum = zero;
+    __m256i vSumSq = zero;
+
+    for (size_t n = 0; n < vecCount;)
+    {
+        const size_t flushAt = std::min(vecCount, n + cFlushVecs);
+        __m256i vSumSq32 = zero;
+        for (; n < flushAt; ++n)
+        {
+            const __m256i v = _mm256_loadu_si256(src + n);
+            vMin = _mm256_min_epu8(vMin, v);
+            vMax = _mm256_max_epu8(vMax, v);
+            vSum = _mm256_add_epi64(vSum, _mm256_sad_epu8(v, zero));
+            const __m256i lo = _mm256_unpacklo_epi8(v, zero);
+            const __m256i hi = _mm256_unpackhi_epi8(v, zero);
+            vSumSq32 = _mm256_add_epi32(vSumSq32, _mm256_add_epi32(
+                        _mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi)));
+        }
+        vSumSq = _mm256_add_epi64(vSumSq,
+                _mm256_add_epi64(_mm256_unpacklo_epi32(vSumSq32, zero),
+                    _mm256_unpackhi_epi32(vSumSq32, zero)));
+    }
+
+    uint8_t mins[32];
+    uint8_t maxs[32];
+    uint64_t sum[4];
+    uint64_t sumSq[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), vMin);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxs), vMax);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sum), vSum);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sumSq), vSumSq);
+    FoldMinMax(mins, maxs, sums);
+    sums.sum += FoldSum(sum);
+    sums.sumSq += FoldSum(sumSq);
+
+    return vecCount * 32;
+}
+
+#define PM_AVX2_SUMS16_STEP(v) \
+    { \
+        const __m256i y = _mm256_xor_si256(v, bias); \
+        vSumY32 = _mm256_add_epi32(vSumY32, _mm256_madd_epi16(y, ones)); \
+        const __m256i ySq = _mm256_madd_epi16(y, y); \
+        vSumYSq = _mm256_add_epi64(vSumYSq, _mm256_add_epi64( \
+                    _mm256_unpacklo_epi32(ySq, zero), _mm256_unpackhi_epi32(ySq, zero))); \
+    }
+
+#define PM_AVX2_SUMS16_FLUSH() \
+    vSumY = _mm256_add_epi64(vSumY, _mm256_add_epi64( \
+                _mm256_cvtepi32_epi64(_mm256_castsi256_si128(vSumY32)), \
+                _mm256_cvtepi32_epi64(_mm256_extracti128_si256(vSumY32, 1))))
+
+PM_TARGET_AVX2
+static size_t ComputeSums_Avx2(const uint16_t* data, size_t count, Sums& sums)
+{
+    const __m256i* src = reinterpret_cast<const __m256i*>(data);
+    const size_t vecCount = count / 16;
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i bias = _mm256_set1_epi16(-32768);
+    __m256i vMin = _mm256_set1_epi16(-1);
+    __m256i vMax = zero;
+    __m256i vSumY = zero;
+    __m256i vSumYSq = zero;
+
+    for (size_t n = 0; n < vecCount;)
+    {
+        const size_t flushAt = std::min(vecCount, n + cFlushVecs);
+        __m256i vSumY32 = zero;
+        for (; n < flushAt; ++n)
+        {
+            const __m256i v = _mm256_loadu_si256(src + n);
+            vMin = _mm256_min_epu16(vMin, v);
+            vMax = _mm256_max_epu16(vMax, v);
+            PM_AVX2_SUMS16_STEP(v);
+        }
+        PM_AVX2_SUMS16_FLUSH();
+    }
+
+    uint16_t mins[16];
+    uint16_t maxs[16];
+    int64_t sumY[4];
+    uint64_t sumYSq[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), vMin);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxs), vMax);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sumY), vSumY);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sumYSq), vSumYSq);
+    FoldMinMax(mins, maxs, sums);
+    AddBiasedSums16(sums, vecCount * 16, FoldSum(sumY), FoldSum(sumYSq));
+
+    return vecCount * 16;
+}
+
+PM_TARGET_AVX2
+static size_t ComputeSums_Avx2(const uint32_t* data, size_t count, Sums& sums)
+{
+    const __m256i* src = reinterpret_cast<const __m256i*>(data);
+    const size_t vecCount = count / 16;
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i bias = _mm256_set1_epi16(-32768);
+    __m256i vMin = _mm256_set1_epi32(-1);
+    __m256i vMax = zero;
+    __m256i vSumY = zero;
+    __m256i vSumYSq = zero;
+
+    for (size_t n = 0; n < vecCount;)
+    {
+        const size_t flushAt = std::min(vecCount, n + cFlushVecs);
+        __m256i vSumY32 = zero;
+        for (; n < flushAt; ++n)
+        {
+            const __m256i v0 = _mm256_loadu_si256(src + 2 * n);
+            const __m256i v1 = _mm256_loadu_si256(src + 2 * n + 1);
+            vMin = _mm256_min_epu32(vMin, _mm256_min_epu32(v0, v1));
+            vMax = _mm256_max_epu32(vMax, _mm256_max_epu32(v0, v1));
+            // Values have max. 16 bits, saturation never happens.
+            // The pixel order gets mixed up, doesn't matter for sums.
+            const __m256i v = _mm256_packus_epi32(v0, v1);
+            PM_AVX2_SUMS16_STEP(v);
+        }
+        PM_AVX2_SUMS16_FLUSH();
+    }
+
+    uint32_t mins[8];
+    uint32_t maxs[8];
+    int64_t sumY[4];
+    uint64_t sumYSq[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), vMin);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxs), vMax);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sumY), vSumY);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sumYSq), vSumYSq);
+    FoldMinMax(mins, maxs, sums);
+    AddBiasedSums16(sums, vecCount * 16, FoldSum(sumY), FoldSum(sumYSq));
+
+    return vecCount * 16;
+}
+
+PM_TARGET_AVX2
+static size_t ComputeMinMaxSum_Avx2(const uint32_t* data, size_t count, Sums& sums)
+{
+    const __m256i* src = reinterpret_cast<const __m256i*>(data);
+    const size_t vecCount = count / 8;
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lo32 = _mm256_set1_epi64x(0xFFFFFFFF);
+    __m256i vMin = _mm256_set1_epi32(-1);
+    __m256i vMax = zero;
+    __m256i vSum = zero;
+
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const __m256i v = _mm256_loadu_si256(src + n);
+        vMin = _mm256_min_epu32(vMin, v);
+        vMax = _mm256_max_epu32(vMax, v);
+        vSum = _mm256_add_epi64(vSum, _mm256_add_epi64(
+                    _mm256_and_si256(v, lo32), _mm256_srli_epi64(v, 32)));
+    }
+
+    uint32_t mins[8];
+    uint32_t maxs[8];
+    uint64_t sum[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), vMin);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxs), vMax);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sum), vSum);
+    FoldMinMax(mins, maxs, sums);
+    sums.sum += FoldSum(sum);
+
+    return vecCount * 8;
+}
+
+// AVX-512
+
+PM_TARGET_AVX512
+static size_t ComputeSums_Avx512(const uint8_t* data, size_t count, Sums& sums)
+{
+    const size_t vecCount = count / 64;
+
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i vMin = _mm512_set1_epi8(-1);
+    __m512i vMax = zero;
+    __m512i vSum = zero;
+    __m512i vSumSq = zero;
+
+    for (size_t n = 0; n < vecCount;)
+    {
+        const size_t flushAt = std::min(vecCount, n + cFlushVecs);
+        __m512i vSumSq32 = zero;
+        for (; n < flushAt; ++n)
+        {
+            const __m512i v = _mm512_loadu_si512(data + 64 * n);
+            vMin = _mm512_min_epu8(vMin, v);
+            vMax = _mm512_max_epu8(vMax, v);
+            vSum = _mm512_add_epi64(vSum, _mm512_sad_epu8(v, zero));
+            const __m512i lo = _mm512_unpacklo_epi8(v, zero);
+            const __m512i hi = _mm512_unpackhi_epi8(v, zero);
+            vSumSq32 = _mm512_add_epi32(vSumSq32, _mm512_add_epi32(
+                        _mm512_madd_epi16(lo, lo), _mm512_madd_epi16(hi, hi)));
+        }
+        vSumSq = _mm512_add_epi64(vSumSq,
+                _mm512_add_epi64(_mm512_unpacklo_epi32(vSumSq32, zero),
+                    _mm512_unpackhi_epi32(vSumSq32, zero)));
+    }
+
+    uint8_t mins[64];
+    uint8_t maxs[64];
+    uint64_t sum[8];
+    uint64_t sumSq[8];
+    _mm512_storeu_si512(mins, vMin);
+    _mm512_storeu_si512(maxs, vMax);
+    _mm512_storeu_si512(sum, vSum);
+    _mm512_storeu_si512(sumSq, vSumSq);
+    FoldMinMax(mins, maxs, sums);
+    sums.sum += FoldSum(sum);
+    sums.sumSq += FoldSum(sumSq);
+
+    return vecCount * 64;
+}
+
+#define PM_AVX512_SUMS16_STEP(v) \
+    { \
+        const __m512i y = _mm512_xor_si512(v, bias); \
+        vSumY32 = _mm512_add_epi32(vSumY32, _mm512_madd_epi16(y, ones)); \
+        const __m512i ySq = _mm512_madd_epi16(y, y); \
+        vSumYSq = _mm512_add_epi64(vSumYSq, _mm512_add_epi64( \
+                    _mm512_unpacklo_epi32(ySq, zero), _mm512_unpackhi_epi32(ySq, zero))); \
+    }
+
+#define PM_AVX512_SUMS16_FLUSH() \
+    vSumY = _mm512_add_epi64(vSumY, _mm512_add_epi64( \
+                _mm512_cvtepi32_epi64(_mm512_castsi512_si256(vSumY32)), \
+                _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(vSumY32, 1))))
+
+PM_TARGET_AVX512
+static size_t ComputeSums_Avx512(const uint16_t* data, size_t count, Sums& sums)
+{
+    const size_t vecCount = count / 32;
+
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i ones = _mm512_set1_epi16(1);
+    const __m512i bias = _mm512_set1_epi16(-32768);
+    __m512i vMin = _mm512_set1_epi16(-1);
+    __m512i vMax = zero;
+    __m512i vSumY = zero;
+    __m512i vSumYSq = zero;
+
+    for (size_t n = 0; n < vecCount;)
+    {
+        const size_t flushAt = std::min(vecCount, n + cFlushVecs);
+        __m512i vSumY32 = zero;
+        for (; n < flushAt; ++n)
+        {
+            const __m512i v = _mm512_loadu_si512(data + 32 * n);
+            vMin = _mm512_min_epu16(vMin, v);
+            vMax = _mm512_max_epu16(vMax, v);
+            PM_AVX512_SUMS16_STEP(v);
+        }
+        PM_AVX512_SUMS16_FLUSH();
+    }
+
+    uint16_t mins[32];
+    uint16_t maxs[32];
+    int64_t sumY[8];
+    uint64_t sumYSq[8];
+    _mm512_storeu_si512(mins, vMin);
+    _mm512_storeu_si512(maxs, vMax);
+    _mm512_storeu_si512(sumY, vSumY);
+    _mm512_storeu_si512(sumYSq, vSumYSq);
+    FoldMinMax(mins, maxs, sums);
+    AddBiasedSums16(sums, vecCount * 32, FoldSum(sumY), FoldSum(sumYSq));
+
+    return vecCount * 32;
+}
+
+PM_TARGET_AVX512
+static size_t ComputeSums_Avx512(const uint32_t* data, size_t count, Sums& sums)
+{
+    const size_t vecCount = count / 32;
+
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i ones = _mm512_set1_epi16(1);
+    const __m512i bias = _mm512_set1_epi16(-32768);
+    __m512i vMin = _mm512_set1_epi32(-1);
+    __m512i vMax = zero;
+    __m512i vSumY = zero;
+    __m512i vSumYSq = zero;
+
+    for (size_t n = 0; n < vecCount;)
+    {
+        const size_t flushAt = std::min(vecCount, n + cFlushVecs);
+        __m512i vSumY32 = zero;
+        for (; n < flushAt; ++n)
+        {
+            const __m512i v0 = _mm512_loadu_si512(data + 32 * n);
+            const __m512i v1 = _mm512_loadu_si512(data + 32 * n + 16);
+            vMin = _mm512_min_epu32(vMin, _mm512_min_epu32(v0, v1));
+            vMax = _mm512_max_epu32(vMax, _mm512_max_epu32(v0, v1));
+            // Values have max. 16 bits, saturation never happens.
+            // The pixel order gets mixed up, doesn't matter for sums.
+            const __m512i v = _mm512_packus_epi32(v0, v1);
+            PM_AVX512_SUMS16_STEP(v);
+        }
+        PM_AVX512_SUMS16_FLUSH();
+    }
+
+    uint32_t mins[16];
+    uint32_t maxs[16];
+    int64_t sumY[8];
+    uint64_t sumYSq[8];
+    _mm512_storeu_si512(mins, vMin);
+    _mm512_storeu_si512(maxs, vMax);
+    _mm512_storeu_si512(sumY, vSumY);
+    _mm512_storeu_si512(sumYSq, vSumYSq);
+    FoldMinMax(mins, maxs, sums);
+    AddBiasedSums16(sums, vecCount * 32, FoldSum(sumY), FoldSum(sumYSq));
+
+    return vecCount * 32;
+}
+
+PM_TARGET_AVX512
+static size_t ComputeMinMaxSum_Avx512(const uint32_t* data, size_t count, Sums& sums)
+{
+    const size_t vecCount = count / 16;
+
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i lo32 = _mm512_set1_epi64(0xFFFFFFFF);
+    __m512i vMin = _mm512_set1_epi32(-1);
+    __m512i vMax = zero;
+    __m512i vSum = zero;
+
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const __m512i v = _mm512_loadu_si512(data + 16 * n);
+        vMin = _mm512_min_epu32(vMin, v);
+        vMax = _mm512_max_epu32(vMax, v);
+        vSum = _mm512_add_epi64(vSum, _mm512_add_epi64(
+                    _mm512_and_si512(v, lo32), _mm512_srli_epi64(v, 32)));
+    }
+
+    uint32_t mins[16];
+    uint32_t maxs[16];
+    uint64_t sum[8];
+    _mm512_storeu_si512(mins, vMin);
+    _mm512_storeu_si512(maxs, vMax);
+    _mm512_storeu_si512(sum, vSum);
+    FoldMinMax(mins, maxs, sums);
+    sums.sum += FoldSum(sum);
+
+    return vecCount * 16;
+}
+
+#endif /* PM_SIMD_X86 */
+
+// Runs vectorized kernel for given level and the scalar one on remaining tail
+template<typename T, bool withSumSq, typename KernelSse41, typename KernelAvx2,
+    typename KernelAvx512>
+static void Dispatch(const T* data, size_t count, Sums& sums, pm::SimdLevel level,
+        KernelSse41 kernelSse41, KernelAvx2 kernelAvx2, KernelAvx512 kernelAvx512)
+{
+    sums = Sums();
+    if (count == 0)
+        return;
+    // Any pixel is in range, the else-if in scalar loop relies on it
+    sums.min = data[0];
+    sums.max = data[0];
+
+    size_t done = 0;
+#if PM_SIMD_X86
+    switch (std::min(level, pm::CpuFeatures::GetSupportedSimdLevel()))
+    {
+    case pm::SimdLevel::Avx512:
+        done = kernelAvx512(data, count, sums);
+        break;
+    case pm::SimdLevel::Avx2:
+        done = kernelAvx2(data, count, sums);
+        break;
+    case pm::SimdLevel::Sse41:
+        done = kernelSse41(data, count, sums);
+        break;
+    case pm::SimdLevel::Scalar:
+        break;
+    }
+#else
+    (void)level;
+    (void)kernelSse41;
+    (void)kernelAvx2;
+    (void)kernelAvx512;
+#endif
+
+    ComputeSums_Scalar<T, withSumSq>(data + done, count - done, sums);
+}
+
+#if PM_SIMD_X86
+    #define PM_SUMS_KERNELS(T, name) \
+        static_cast<size_t (*)(const T*, size_t, Sums&)>(&name##_Sse41), \
+        static_cast<size_t (*)(const T*, size_t, Sums&)>(&name##_Avx2), \
+        static_cast<size_t (*)(const T*, size_t, Sums&)>(&name##_Avx512)
+#else
+    #define PM_SUMS_KERNELS(T, name) nullptr, nullptr, nullptr
+#endif
+
+void pm::PixelKernels::ComputeSums(const uint8_t* data, size_t count,
+        Sums& sums, SimdLevel level)
+{
+    Dispatch<uint8_t, true>(data, count, sums, level,
+            PM_SUMS_KERNELS(uint8_t, ComputeSums));
+}
+
+void pm::PixelKernels::ComputeSums(const uint16_t* data, size_t count,
+        Sums& sums, SimdLevel level)
+{
+    Dispatch<uint16_t, true>(data, count, sums, level,
+            PM_SUMS_KERNELS(uint16_t, ComputeSums));
+}
+
+void pm::PixelKernels::ComputeSums(const uint32_t* data, size_t count,
+        Sums& sums, SimdLevel level)
+{
+    Dispatch<uint32_t, true>(data, count, sums, level,
+            PM_SUMS_KERNELS(uint32_t, ComputeSums));
+}
+
+void pm::PixelKernels::ComputeMinMaxSum(const uint32_t* data, size_t count,
+        Sums& sums, SimdLevel level)
+{
+    Dispatch<uint32_t, false>(data, count, sums, level,
+            PM_SUMS_KERNELS(uint32_t, ComputeMinMaxSum));
+}
+
+// Histogram merge
+
+#if PM_SIMD_X86
+
+PM_TARGET_SSE41
+static size_t AddCounts_Sse41(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    const size_t vecCount = count / 4;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        __m128i* d = reinterpret_cast<__m128i*>(dst) + n;
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + n);
+        _mm_storeu_si128(d, _mm_add_epi32(_mm_loadu_si128(d), s));
+    }
+    return vecCount * 4;
+}
+
+PM_TARGET_AVX2
+static size_t AddCounts_Avx2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    const size_t vecCount = count / 8;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        __m256i* d = reinterpret_cast<__m256i*>(dst) + n;
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src) + n);
+        _mm256_storeu_si256(d, _mm256_add_epi32(_mm256_loadu_si256(d), s));
+    }
+    return vecCount * 8;
+}
+
+PM_TARGET_AVX512
+static size_t AddCounts_Avx512(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    const size_t vecCount = count / 16;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const __m512i d = _mm512_loadu_si512(dst + 16 * n);
+        const __m512i s = _mm512_loadu_si512(src + 16 * n);
+        _mm512_storeu_si512(dst + 16 * n, _mm512_add_epi32(d, s));
+    }
+    return vecCount * 16;
+}
+
+#endif /* PM_SIMD_X86 */
+
+void pm::PixelKernels::AddCounts(uint32_t* dst, const uint32_t* src,
+        size_t count, SimdLevel level)
+{
+    size_t done = 0;
+#if PM_SIMD_X86
+    switch (std::min(level, CpuFeatures::GetSupportedSimdLevel()))
+    {
+    case SimdLevel::Avx512:
+        done = AddCounts_Avx512(dst, src, count);
+        break;
+    case SimdLevel::Avx2:
+        done = AddCounts_Avx2(dst, src, count);
+        break;
+    case SimdLevel::Sse41:
+        done = AddCounts_Sse41(dst, src, count);
+        break;
+    case SimdLevel::Scalar:
+        break;
+    }
+#else
+    (void)level;
+#endif
+
+    for (size_t n = done; n < count; ++n)
+    {
+        dst[n] += src[n];
+    }
+}
+
+// Per-pixel accumulation
+
+#if PM_SIMD_X86
+
+PM_TARGET_SSE41
+static inline __m128i LoadAsU16_Sse41(const uint8_t* data)
+{
+    return _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)));
+}
+
+PM_TARGET_SSE41
+static inline __m128i LoadAsU16_Sse41(const uint16_t* data)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+// Adds 4 x 32-bit values to 4 x 64-bit values in memory
+PM_TARGET_SSE41
+static inline void AddWidened_Sse41(uint64_t* dst, __m128i v)
+{
+    __m128i* d = reinterpret_cast<__m128i*>(dst);
+    _mm_storeu_si128(d, _mm_add_epi64(_mm_loadu_si128(d),
+                _mm_cvtepu32_epi64(v)));
+    _mm_storeu_si128(d + 1, _mm_add_epi64(_mm_loadu_si128(d + 1),
+                _mm_cvtepu32_epi64(_mm_srli_si128(v, 8))));
+}
+
+template<typename T>
+PM_TARGET_SSE41
+static size_t AccumulatePixels_Sse41(const T* data, size_t count,
+        uint64_t* sums, uint64_t* sumsSq, uint16_t* mins, uint16_t* maxs)
+{
+    const size_t vecCount = count / 8;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const size_t i = 8 * n;
+        const __m128i v = LoadAsU16_Sse41(data + i);
+
+        __m128i* pMin = reinterpret_cast<__m128i*>(mins + i);
+        __m128i* pMax = reinterpret_cast<__m128i*>(maxs + i);
+        _mm_storeu_si128(pMin, _mm_min_epu16(_mm_loadu_si128(pMin), v));
+        _mm_storeu_si128(pMax, _mm_max_epu16(_mm_loadu_si128(pMax), v));
+
+        // Squares of 16-bit values fit 32 bits
+        const __m128i lo = _mm_cvtepu16_epi32(v);
+        const __m128i hi = _mm_cvtepu16_epi32(_mm_srli_si128(v, 8));
+        AddWidened_Sse41(sums + i, lo);
+        AddWidened_Sse41(sums + i + 4, hi);
+        AddWidened_Sse41(sumsSq + i, _mm_mullo_epi32(lo, lo));
+        AddWidened_Sse41(sumsSq + i + 4, _mm_mullo_epi32(hi, hi));
+    }
+    return vecCount * 8;
+}
+
+PM_TARGET_AVX2
+static inline __m256i LoadAsU16_Avx2(const uint8_t* data)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+}
+
+PM_TARGET_AVX2
+static inline __m256i LoadAsU16_Avx2(const uint16_t* data)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+// Adds 8 x 32-bit values to 8 x 64-bit values in memory
+PM_TARGET_AVX2
+static inline void AddWidened_Avx2(uint64_t* dst, __m256i v)
+{
+    __m256i* d = reinterpret_cast<__m256i*>(dst);
+    _mm256_storeu_si256(d, _mm256_add_epi64(_mm256_loadu_si256(d),
+                _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v))));
+    _mm256_storeu_si256(d + 1, _mm256_add_epi64(_mm256_loadu_si256(d + 1),
+                _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1))));
+}
+
+template<typename T>
+PM_TARGET_AVX2
+static size_t AccumulatePixels_Avx2(const T* data, size_t count,
+        uint64_t* sums, uint64_t* sumsSq, uint16_t* mins, uint16_t* maxs)
+{
+    const size_t vecCount = count / 16;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const size_t i = 16 * n;
+        const __m256i v = LoadAsU16_Avx2(data + i);
+
+        __m256i* pMin = reinterpret_cast<__m256i*>(mins + i);
+        __m256i* pMax = reinterpret_cast<__m256i*>(maxs + i);
+        _mm256_storeu_si256(pMin, _mm256_min_epu16(_mm256_loadu_si256(pMin), v));
+        _mm256_storeu_si256(pMax, _mm256_max_epu16(_mm256_loadu_si256(pMax), v));
+
+        const __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+        const __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+        AddWidened_Avx2(sums + i, lo);
+        AddWidened_Avx2(sums + i + 8, hi);
+        AddWidened_Avx2(sumsSq + i, _mm256_mullo_epi32(lo, lo));
+        AddWidened_Avx2(sumsSq + i + 8, _mm256_mullo_epi32(hi, hi));
+    }
+    return vecCount * 16;
+}
+
+PM_TARGET_AVX512
+static inline __m512i LoadAsU16_Avx512(const uint8_t* data)
+{
+    return _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)));
+}
+
+PM_TARGET_AVX512
+static inline __m512i LoadAsU16_Avx512(const uint16_t* data)
+{
+    return _mm512_loadu_si512(data);
+}
+
+// Adds 16 x 32-bit values to 16 x 64-bit values in memory
+PM_TARGET_AVX512
+static inline void AddWidened_Avx512(uint64_t* dst, __m512i v)
+{
+    _mm512_storeu_si512(dst, _mm512_add_epi64(_mm512_loadu_si512(dst),
+                _mm512_cvtepu32_epi64(_mm512_castsi512_si256(v))));
+    _mm512_storeu_si512(dst + 8, _mm512_add_epi64(_mm512_loadu_si512(dst + 8),
+                _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(v, 1))));
+}
+
+template<typename T>
+PM_TARGET_AVX512
+static size_t AccumulatePixels_Avx512(const T* data, size_t count,
+        uint64_t* sums, uint64_t* sumsSq, uint16_t* mins, uint16_t* maxs)
+{
+    const size_t vecCount = count / 32;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const size_t i = 32 * n;
+        const __m512i v = LoadAsU16_Avx512(data + i);
+
+        _mm512_storeu_si512(mins + i, _mm512_min_epu16(_mm512_loadu_si512(mins + i), v));
+        _mm512_storeu_si512(maxs + i, _mm512_max_epu16(_mm512_loadu_si512(maxs + i), v));
+
+        const __m512i lo = _mm512_cvtepu16_epi32(_mm512_castsi512_si256(v));
+        const __m512i hi = _mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(v, 1));
+        AddWidened_Avx512(sums + i, lo);
+        AddWidened_Avx512(sums + i + 16, hi);
+        AddWidened_Avx512(sumsSq + i, _mm512_mullo_epi32(lo, lo));
+        AddWidened_Avx512(sumsSq + i + 16, _mm512_mullo_epi32(hi, hi));
+    }
+    return vecCount * 32;
+}
+
+#endif /* PM_SIMD_X86 */
+
+template<typename T>
+static void AccumulatePixels(const T* data, size_t count, uint64_t* sums,
+        uint64_t* sumsSq, uint16_t* mins, uint16_t* maxs, pm::SimdLevel level)
+{
+    size_t done = 0;
+#if PM_SIMD_X86
+    switch (std::min(level, pm::CpuFeatures::GetSupportedSimdLevel()))
+    {
+    case pm::SimdLevel::Avx512:
+        done = AccumulatePixels_Avx512(data, count, sums, sumsSq, mins, maxs);
+        break;
+    case pm::SimdLevel::Avx2:
+        done = AccumulatePixels_Avx2(data, count, sums, sumsSq, mins, maxs);
+        break;
+    case pm::SimdLevel::Sse41:
+        done = AccumulatePixels_Sse41(data, count, sums, sumsSq, mins, maxs);
+        break;
+    case pm::SimdLevel::Scalar:
+        break;
+    }
+#else
+    (void)level;
+#endif
+
+    for (size_t n = done; n < count; ++n)
+    {
+        const uint16_t value = data[n];
+        sums[n] += value;
+        sumsSq[n] += (uint32_t)value * value;
+        mins[n] = std::min(mins[n], value);
+        maxs[n] = std::max(maxs[n], value);
+    }
+}
+
+void pm::PixelKernels::AccumulatePixels(const uint8_t* data, size_t count,
+        uint64_t* sums, uint64_t* sumsSq, uint16_t* mins, uint16_t* maxs,
+        SimdLevel level)
+{
+    ::AccumulatePixels(data, count, sums, sumsSq, mins, maxs, level);
+}
+
+void pm::PixelKernels::AccumulatePixels(const uint16_t* data, size_t count,
+        uint64_t* sums, uint64_t* sumsSq, uint16_t* mins, uint16_t* maxs,
+        SimdLevel level)
+{
+    ::AccumulatePixels(data, count, sums, sumsSq, mins, maxs, level);
+}
+
+// Conversion to 8 bits
+
+template<typename T>
+static void LookupSamples(const T* src, size_t count, const uint8_t* lut,
+        size_t lutSize, uint8_t* dst)
+{
+    if (lutSize == 0)
+        return;
+
+    // The clamp is not free, tables for 8 and 16 bit data usually have all
+    // possible values
+    if (lutSize > (std::numeric_limits<T>::max)())
+    {
+        for (size_t n = 0; n < count; ++n)
+        {
+            dst[n] = lut[src[n]];
+        }
+        return;
+    }
+
+    const T last = static_cast<T>(lutSize - 1);
+    for (size_t n = 0; n < count; ++n)
+    {
+        dst[n] = lut[std::min(src[n], last)];
+    }
+}
+
+void pm::PixelKernels::LookupSamples(const uint8_t* src, size_t count,
+        const uint8_t* lut, size_t lutSize, uint8_t* dst)
+{
+    ::LookupSamples(src, count, lut, lutSize, dst);
+}
+
+void pm::PixelKernels::LookupSamples(const uint16_t* src, size_t count,
+        const uint8_t* lut, size_t lutSize, uint8_t* dst)
+{
+    ::LookupSamples(src, count, lut, lutSize, dst);
+}
+
+void pm::PixelKernels::LookupSamples(const uint32_t* src, size_t count,
+        const uint8_t* lut, size_t lutSize, uint8_t* dst)
+{
+    ::LookupSamples(src, count, lut, lutSize, dst);
+}
+
+// Scaling parameters shared by all levels, see ConvertOnePixel
+struct ScaleParams
+{
+    uint32_t min;
+    uint32_t max;
+    double minF;
+    double mp;
+    double brightness;
+    double factor;
+};
+
+// The double clamp before truncation gives the same result as clamping the
+// truncated integer, but cannot overflow
+template<bool autoConbright>
+static inline uint8_t ScaleSample(uint32_t value, const ScaleParams& p)
+{
+    if (autoConbright)
+    {
+        const uint32_t pix = std::min(std::max(value, p.min), p.max);
+        return static_cast<uint8_t>(p.mp * (double)(pix - p.min));
+    }
+    const double pixF = p.mp * ((double)value - p.minF);
+    const double pixD = p.brightness + p.factor * (pixF - 128) + 128;
+    return static_cast<uint8_t>(std::min(std::max(pixD, 0.0), 255.0));
+}
+
+#if PM_SIMD_X86
+
+PM_TARGET_SSE41
+static inline __m128i LoadAsU32_Sse41(const uint8_t* data)
+{
+    int32_t bytes;
+    std::memcpy(&bytes, data, sizeof(bytes));
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+}
+
+PM_TARGET_SSE41
+static inline __m128i LoadAsU32_Sse41(const uint16_t* data)
+{
+    return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)));
+}
+
+PM_TARGET_SSE41
+static inline __m128i LoadAsU32_Sse41(const uint32_t* data)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+// Converts 2 unsigned 32-bit values, there is no such instruction before
+// AVX-512 so the values are flipped to signed range and biased back
+PM_TARGET_SSE41
+static inline __m128d U32ToF64_Sse41(__m128i flipped)
+{
+    return _mm_add_pd(_mm_cvtepi32_pd(flipped), _mm_set1_pd(2147483648.0));
+}
+
+// Returns 4 x 32-bit values in range 0-255
+template<bool autoConbright>
+PM_TARGET_SSE41
+static inline __m128i Scale4_Sse41(__m128i v, const ScaleParams& p)
+{
+    const __m128i signBit = _mm_set1_epi32(INT32_MIN);
+    __m128d lo;
+    __m128d hi;
+    if (autoConbright)
+    {
+        v = _mm_min_epu32(_mm_max_epu32(v, _mm_set1_epi32((int32_t)p.min)),
+                _mm_set1_epi32((int32_t)p.max));
+        const __m128i diff = _mm_xor_si128(
+                _mm_sub_epi32(v, _mm_set1_epi32((int32_t)p.min)), signBit);
+        const __m128d mp = _mm_set1_pd(p.mp);
+        lo = _mm_mul_pd(mp, U32ToF64_Sse41(diff));
+        hi = _mm_mul_pd(mp, U32ToF64_Sse41(_mm_srli_si128(diff, 8)));
+    }
+    else
+    {
+        const __m128i flipped = _mm_xor_si128(v, signBit);
+        const __m128d minF = _mm_set1_pd(p.minF);
+        const __m128d mp = _mm_set1_pd(p.mp);
+        const __m128d c128 = _mm_set1_pd(128.0);
+        const __m128d brightness = _mm_set1_pd(p.brightness);
+        const __m128d factor = _mm_set1_pd(p.factor);
+        const __m128d pixLo = _mm_mul_pd(mp,
+                _mm_sub_pd(U32ToF64_Sse41(flipped), minF));
+        const __m128d pixHi = _mm_mul_pd(mp,
+                _mm_sub_pd(U32ToF64_Sse41(_mm_srli_si128(flipped, 8)), minF));
+        lo = _mm_add_pd(_mm_add_pd(brightness,
+                    _mm_mul_pd(factor, _mm_sub_pd(pixLo, c128))), c128);
+        hi = _mm_add_pd(_mm_add_pd(brightness,
+                    _mm_mul_pd(factor, _mm_sub_pd(pixHi, c128))), c128);
+        lo = _mm_min_pd(_mm_max_pd(lo, _mm_setzero_pd()), _mm_set1_pd(255.0));
+        hi = _mm_min_pd(_mm_max_pd(hi, _mm_setzero_pd()), _mm_set1_pd(255.0));
+    }
+    return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+template<bool autoConbright, typename T>
+PM_TARGET_SSE41
+static size_t ScaleSamples_Sse41(const T* src, size_t count, uint8_t* dst,
+        const ScaleParams& p)
+{
+    const size_t vecCount = count / 8;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const size_t i = 8 * n;
+        const __m128i a = Scale4_Sse41<autoConbright>(LoadAsU32_Sse41(src + i), p);
+        const __m128i b = Scale4_Sse41<autoConbright>(LoadAsU32_Sse41(src + i + 4), p);
+        const __m128i w = _mm_packus_epi32(a, b);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(w, w));
+    }
+    return vecCount * 8;
+}
+
+PM_TARGET_AVX2
+static inline __m256i LoadAsU32_Avx2(const uint8_t* data)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)));
+}
+
+PM_TARGET_AVX2
+static inline __m256i LoadAsU32_Avx2(const uint16_t* data)
+{
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+}
+
+PM_TARGET_AVX2
+static inline __m256i LoadAsU32_Avx2(const uint32_t* data)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+// Converts 4 unsigned 32-bit values, same trick as U32ToF64_Sse41
+PM_TARGET_AVX2
+static inline __m256d U32ToF64_Avx2(__m128i flipped)
+{
+    return _mm256_add_pd(_mm256_cvtepi32_pd(flipped), _mm256_set1_pd(2147483648.0));
+}
+
+// Returns 8 x 16-bit values in range 0-255
+template<bool autoConbright>
+PM_TARGET_AVX2
+static inline __m128i Scale8_Avx2(__m256i v, const ScaleParams& p)
+{
+    const __m256i signBit = _mm256_set1_epi32(INT32_MIN);
+    __m256d lo;
+    __m256d hi;
+    if (autoConbright)
+    {
+        v = _mm256_min_epu32(_mm256_max_epu32(v, _mm256_set1_epi32((int32_t)p.min)),
+                _mm256_set1_epi32((int32_t)p.max));
+        const __m256i diff = _mm256_xor_si256(
+                _mm256_sub_epi32(v, _mm256_set1_epi32((int32_t)p.min)), signBit);
+        const __m256d mp = _mm256_set1_pd(p.mp);
+        lo = _mm256_mul_pd(mp, U32ToF64_Avx2(_mm256_castsi256_si128(diff)));
+        hi = _mm256_mul_pd(mp, U32ToF64_Avx2(_mm256_extracti128_si256(diff, 1)));
+    }
+    else
+    {
+        const __m256i flipped = _mm256_xor_si256(v, signBit);
+        const __m256d minF = _mm256_set1_pd(p.minF);
+        const __m256d mp = _mm256_set1_pd(p.mp);
+        const __m256d c128 = _mm256_set1_pd(128.0);
+        const __m256d brightness = _mm256_set1_pd(p.brightness);
+        const __m256d factor = _mm256_set1_pd(p.factor);
+        const __m256d pixLo = _mm256_mul_pd(mp, _mm256_sub_pd(
+                    U32ToF64_Avx2(_mm256_castsi256_si128(flipped)), minF));
+        const __m256d pixHi = _mm256_mul_pd(mp, _mm256_sub_pd(
+                    U32ToF64_Avx2(_mm256_extracti128_si256(flipped, 1)), minF));
+        lo = _mm256_add_pd(_mm256_add_pd(brightness,
+                    _mm256_mul_pd(factor, _mm256_sub_pd(pixLo, c128))), c128);
+        hi = _mm256_add_pd(_mm256_add_pd(brightness,
+                    _mm256_mul_pd(factor, _mm256_sub_pd(pixHi, c128))), c128);
+        lo = _mm256_min_pd(_mm256_max_pd(lo, _mm256_setzero_pd()), _mm256_set1_pd(255.0));
+        hi = _mm256_min_pd(_mm256_max_pd(hi, _mm256_setzero_pd()), _mm256_set1_pd(255.0));
+    }
+    return _mm_packus_epi32(_mm256_cvttpd_epi32(lo), _mm256_cvttpd_epi32(hi));
+}
+
+template<bool autoConbright, typename T>
+PM_TARGET_AVX2
+static size_t ScaleSamples_Avx2(const T* src, size_t count, uint8_t* dst,
+        const ScaleParams& p)
+{
+    const size_t vecCount = count / 16;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const size_t i = 16 * n;
+        const __m128i a = Scale8_Avx2<autoConbright>(LoadAsU32_Avx2(src + i), p);
+        const __m128i b = Scale8_Avx2<autoConbright>(LoadAsU32_Avx2(src + i + 8), p);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+    }
+    return vecCount * 16;
+}
+
+PM_TARGET_AVX512
+static inline __m512i LoadAsU32_Avx512(const uint8_t* data)
+{
+    return _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+}
+
+PM_TARGET_AVX512
+static inline __m512i LoadAsU32_Avx512(const uint16_t* data)
+{
+    return _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)));
+}
+
+PM_TARGET_AVX512
+static inline __m512i LoadAsU32_Avx512(const uint32_t* data)
+{
+    return _mm512_loadu_si512(data);
+}
+
+template<bool autoConbright, typename T>
+PM_TARGET_AVX512
+static size_t ScaleSamples_Avx512(const T* src, size_t count, uint8_t* dst,
+        const ScaleParams& p)
+{
+    const __m512i vMin = _mm512_set1_epi32((int32_t)p.min);
+    const __m512i vMax = _mm512_set1_epi32((int32_t)p.max);
+    const __m512d minF = _mm512_set1_pd(p.minF);
+    const __m512d mp = _mm512_set1_pd(p.mp);
+    const __m512d c128 = _mm512_set1_pd(128.0);
+    const __m512d brightness = _mm512_set1_pd(p.brightness);
+    const __m512d factor = _mm512_set1_pd(p.factor);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d c255 = _mm512_set1_pd(255.0);
+
+    const size_t vecCount = count / 16;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const size_t i = 16 * n;
+        __m512i v = LoadAsU32_Avx512(src + i);
+        __m512d lo;
+        __m512d hi;
+        if (autoConbright)
+        {
+            v = _mm512_sub_epi32(
+                    _mm512_min_epu32(_mm512_max_epu32(v, vMin), vMax), vMin);
+            lo = _mm512_mul_pd(mp, _mm512_cvtepu32_pd(_mm512_castsi512_si256(v)));
+            hi = _mm512_mul_pd(mp, _mm512_cvtepu32_pd(_mm512_extracti64x4_epi64(v, 1)));
+        }
+        else
+        {
+            const __m512d pixLo = _mm512_mul_pd(mp, _mm512_sub_pd(
+                        _mm512_cvtepu32_pd(_mm512_castsi512_si256(v)), minF));
+            const __m512d pixHi = _mm512_mul_pd(mp, _mm512_sub_pd(
+                        _mm512_cvtepu32_pd(_mm512_extracti64x4_epi64(v, 1)), minF));
+            lo = _mm512_add_pd(_mm512_add_pd(brightness,
+                        _mm512_mul_pd(factor, _mm512_sub_pd(pixLo, c128))), c128);
+            hi = _mm512_add_pd(_mm512_add_pd(brightness,
+                        _mm512_mul_pd(factor, _mm512_sub_pd(pixHi, c128))), c128);
+            lo = _mm512_min_pd(_mm512_max_pd(lo, zero), c255);
+            hi = _mm512_min_pd(_mm512_max_pd(hi, zero), c255);
+        }
+        const __m512i pix = _mm512_inserti64x4(
+                _mm512_castsi256_si512(_mm512_cvttpd_epi32(lo)),
+                _mm512_cvttpd_epi32(hi), 1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                _mm512_cvtusepi32_epi8(pix));
+    }
+    return vecCount * 16;
+}
+
+#endif /* PM_SIMD_X86 */
+
+template<bool autoConbright, typename T>
+static void ScaleSamples(const T* src, size_t count, uint8_t* dst,
+        const ScaleParams& p, pm::SimdLevel level)
+{
+    size_t done = 0;
+#if PM_SIMD_X86
+    switch (std::min(level, pm::CpuFeatures::GetSupportedSimdLevel()))
+    {
+    case pm::SimdLevel::Avx512:
+        done = ScaleSamples_Avx512<autoConbright>(src, count, dst, p);
+        break;
+    case pm::SimdLevel::Avx2:
+        done = ScaleSamples_Avx2<autoConbright>(src, count, dst, p);
+        break;
+    case pm::SimdLevel::Sse41:
+        done = ScaleSamples_Sse41<autoConbright>(src, count, dst, p);
+        break;
+    case pm::SimdLevel::Scalar:
+        break;
+    }
+#else
+    (void)level;
+#endif
+
+    for (size_t n = done; n < count; ++n)
+    {
+        dst[n] = ScaleSample<autoConbright>(src[n], p);
+    }
+}
+
+template<typename T>
+static void ScaleSamples(const T* src, size_t count, uint8_t* dst,
+        uint32_t srcMin, uint32_t srcMax, bool autoConbright,
+        int brightness, int contrast, pm::SimdLevel level)
+{
+    ScaleParams p;
+    p.min = srcMin;
+    p.max = srcMax;
+    p.minF = srcMin;
+    p.mp = (srcMax == srcMin) ? 255.0 : 255.0 / ((double)srcMax - srcMin);
+    p.brightness = brightness;
+    // factors for contrasts [-255, 0, +255] are [0, 1, 129.5]
+    p.factor = (259.0 * (contrast + 255)) / (255.0 * (259 - contrast));
+
+    if (autoConbright)
+        ScaleSamples<true>(src, count, dst, p, level);
+    else
+        ScaleSamples<false>(src, count, dst, p, level);
+}
+
+void pm::PixelKernels::ScaleSamples(const uint8_t* src, size_t count,
+        uint8_t* dst, uint32_t srcMin, uint32_t srcMax, bool autoConbright,
+        int brightness, int contrast, SimdLevel level)
+{
+    ::ScaleSamples(src, count, dst, srcMin, srcMax, autoConbright,
+            brightness, contrast, level);
+}
+
+void pm::PixelKernels::ScaleSamples(const uint16_t* src, size_t count,
+        uint8_t* dst, uint32_t srcMin, uint32_t srcMax, bool autoConbright,
+        int brightness, int contrast, SimdLevel level)
+{
+    ::ScaleSamples(src, count, dst, srcMin, srcMax, autoConbright,
+            brightness, contrast, level);
+}
+
+void pm::PixelKernels::ScaleSamples(const uint32_t* src, size_t count,
+        uint8_t* dst, uint32_t srcMin, uint32_t srcMax, bool autoConbright,
+        int brightness, int contrast, SimdLevel level)
+{
+    ::ScaleSamples(src, count, dst, srcMin, srcMax, autoConbright,
+            brightness, contrast, level);
+}
+
+// Gray to RGB expansion
+
+#if PM_SIMD_X86
+
+// Byte shuffle indexes for 16 gray pixels producing 48 RGB bytes, repeated
+// twice so wider vectors can load any lane combination at once
+alignas(64) static const uint8_t cGrayToRgbIdx[96] = {
+     0,  0,  0,  1,  1,  1,  2,  2,  2,  3,  3,  3,  4,  4,  4,  5,
+     5,  5,  6,  6,  6,  7,  7,  7,  8,  8,  8,  9,  9,  9, 10, 10,
+    10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15,
+     0,  0,  0,  1,  1,  1,  2,  2,  2,  3,  3,  3,  4,  4,  4,  5,
+     5,  5,  6,  6,  6,  7,  7,  7,  8,  8,  8,  9,  9,  9, 10, 10,
+    10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15,
+};
+
+PM_TARGET_SSE41
+static size_t ExpandGrayToRgb_Sse41(const uint8_t* src, size_t count, uint8_t* dst)
+{
+    const __m128i* idx = reinterpret_cast<const __m128i*>(cGrayToRgbIdx);
+    const __m128i m0 = _mm_load_si128(idx + 0);
+    const __m128i m1 = _mm_load_si128(idx + 1);
+    const __m128i m2 = _mm_load_si128(idx + 2);
+
+    const size_t vecCount = count / 16;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * n));
+        __m128i* d = reinterpret_cast<__m128i*>(dst + 48 * n);
+        _mm_storeu_si128(d + 0, _mm_shuffle_epi8(g, m0));
+        _mm_storeu_si128(d + 1, _mm_shuffle_epi8(g, m1));
+        _mm_storeu_si128(d + 2, _mm_shuffle_epi8(g, m2));
+    }
+    return vecCount * 16;
+}
+
+// The shuffle works within 128-bit lanes, so each output vector gets lanes
+// with the right 16 gray pixels first
+PM_TARGET_AVX2
+static size_t ExpandGrayToRgb_Avx2(const uint8_t* src, size_t count, uint8_t* dst)
+{
+    const __m256i m0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cGrayToRgbIdx));
+    const __m256i m1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cGrayToRgbIdx + 32));
+    const __m256i m2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cGrayToRgbIdx + 16));
+
+    const size_t vecCount = count / 32;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32 * n));
+        __m256i* d = reinterpret_cast<__m256i*>(dst + 96 * n);
+        _mm256_storeu_si256(d + 0, _mm256_shuffle_epi8(
+                    _mm256_permute2x128_si256(g, g, 0x00), m0));
+        _mm256_storeu_si256(d + 1, _mm256_shuffle_epi8(g, m1));
+        _mm256_storeu_si256(d + 2, _mm256_shuffle_epi8(
+                    _mm256_permute2x128_si256(g, g, 0x11), m2));
+    }
+    return vecCount * 32;
+}
+
+PM_TARGET_AVX512
+static size_t ExpandGrayToRgb_Avx512(const uint8_t* src, size_t count, uint8_t* dst)
+{
+    const __m512i m0 = _mm512_loadu_si512(cGrayToRgbIdx);
+    const __m512i m1 = _mm512_loadu_si512(cGrayToRgbIdx + 16);
+    const __m512i m2 = _mm512_loadu_si512(cGrayToRgbIdx + 32);
+
+    const size_t vecCount = count / 64;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const __m512i g = _mm512_loadu_si512(src + 64 * n);
+        uint8_t* d = dst + 192 * n;
+        _mm512_storeu_si512(d, _mm512_shuffle_epi8(
+                    _mm512_shuffle_i32x4(g, g, _MM_SHUFFLE(1, 0, 0, 0)), m0));
+        _mm512_storeu_si512(d + 64, _mm512_shuffle_epi8(
+                    _mm512_shuffle_i32x4(g, g, _MM_SHUFFLE(2, 2, 1, 1)), m1));
+        _mm512_storeu_si512(d + 128, _mm512_shuffle_epi8(
+                    _mm512_shuffle_i32x4(g, g, _MM_SHUFFLE(3, 3, 3, 2)), m2));
+    }
+    return vecCount * 64;
+}
+
+#endif /* PM_SIMD_X86 */
+
+void pm::PixelKernels::ExpandGrayToRgb(const uint8_t* src, size_t count,
+        uint8_t* dst, SimdLevel level)
+{
+    size_t done = 0;
+#if PM_SIMD_X86
+    switch (std::min(level, CpuFeatures::GetSupportedSimdLevel()))
+    {
+    case SimdLevel::Avx512:
+        done = ExpandGrayToRgb_Avx512(src, count, dst);
+        break;
+    case SimdLevel::Avx2:
+        done = ExpandGrayToRgb_Avx2(src, count, dst);
+        break;
+    case SimdLevel::Sse41:
+        done = ExpandGrayToRgb_Sse41(src, count, dst);
+        break;
+    case SimdLevel::Scalar:
+        break;
+    }
+#else
+    (void)level;
+#endif
+
+    for (size_t n = done; n < count; ++n)
+    {
+        dst[3 * n + 0] = src[n];
+        dst[3 * n + 1] = src[n];
+        dst[3 * n + 2] = src[n];
+    }
+}
+
+// Gray and RGB to RGBA expansion
+
+#if PM_SIMD_X86
+
+// Byte shuffle indexes for 16 gray pixels producing 64 RGBA bytes, index 128
+// zeroes the alpha byte which is then set by OR with alpha mask
+alignas(64) static const uint8_t cGrayToRgbaIdx[64] = {
+      0,   0,   0, 128,   1,   1,   1, 128,   2,   2,   2, 128,   3,   3,   3, 128,
+      4,   4,   4, 128,   5,   5,   5, 128,   6,   6,   6, 128,   7,   7,   7, 128,
+      8,   8,   8, 128,   9,   9,   9, 128,  10,  10,  10, 128,  11,  11,  11, 128,
+     12,  12,  12, 128,  13,  13,  13, 128,  14,  14,  14, 128,  15,  15,  15, 128,
+};
+
+// Byte shuffle indexes for 4 RGB pixels (12 bytes) producing 16 RGBA or BGRA bytes
+alignas(16) static const uint8_t cRgbToRgbaIdx[16] = {
+      0,   1,   2, 128,   3,   4,   5, 128,   6,   7,   8, 128,   9,  10,  11, 128,
+};
+alignas(16) static const uint8_t cRgbToBgraIdx[16] = {
+      2,   1,   0, 128,   5,   4,   3, 128,   8,   7,   6, 128,  11,  10,   9, 128,
+};
+
+PM_TARGET_SSE41
+static size_t ExpandGrayToRgba_Sse41(const uint8_t* src, size_t count, uint8_t* dst)
+{
+    const __m128i* idx = reinterpret_cast<const __m128i*>(cGrayToRgbaIdx);
+    const __m128i m0 = _mm_load_si128(idx + 0);
+    const __m128i m1 = _mm_load_si128(idx + 1);
+    const __m128i m2 = _mm_load_si128(idx + 2);
+    const __m128i m3 = _mm_load_si128(idx + 3);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    const size_t vecCount = count / 16;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * n));
+        __m128i* d = reinterpret_cast<__m128i*>(dst + 64 * n);
+        _mm_storeu_si128(d + 0, _mm_or_si128(_mm_shuffle_epi8(g, m0), alpha));
+        _mm_storeu_si128(d + 1, _mm_or_si128(_mm_shuffle_epi8(g, m1), alpha));
+        _mm_storeu_si128(d + 2, _mm_or_si128(_mm_shuffle_epi8(g, m2), alpha));
+        _mm_storeu_si128(d + 3, _mm_or_si128(_mm_shuffle_epi8(g, m3), alpha));
+    }
+    return vecCount * 16;
+}
+
+// The 16 gray pixels are broadcast to all 128-bit lanes, each lane then
+// picks its own 4 pixels
+PM_TARGET_AVX2
+static size_t ExpandGrayToRgba_Avx2(const uint8_t* src, size_t count, uint8_t* dst)
+{
+    const __m256i m0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(cGrayToRgbaIdx));
+    const __m256i m1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(cGrayToRgbaIdx + 32));
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+    const size_t vecCount = count / 16;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const __m256i g = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * n)));
+        __m256i* d = reinterpret_cast<__m256i*>(dst + 64 * n);
+        _mm256_storeu_si256(d + 0, _mm256_or_si256(_mm256_shuffle_epi8(g, m0), alpha));
+        _mm256_storeu_si256(d + 1, _mm256_or_si256(_mm256_shuffle_epi8(g, m1), alpha));
+    }
+    return vecCount * 16;
+}
+
+PM_TARGET_AVX512
+static size_t ExpandGrayToRgba_Avx512(const uint8_t* src, size_t count, uint8_t* dst)
+{
+    const __m512i m = _mm512_load_si512(cGrayToRgbaIdx);
+    const __m512i alpha = _mm512_set1_epi32(static_cast<int>(0xFF000000u));
+
+    const size_t vecCount = count / 16;
+    for (size_t n = 0; n < vecCount; ++n)
+    {
+        const __m512i g = _mm512_broadcast_i32x4(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * n)));
+        _mm512_storeu_si512(dst + 64 * n,
+                _mm512_or_si512(_mm512_shuffle_epi8(g, m), alpha));
+    }
+    return vecCount * 16;
+}
+
+// Loads 16 bytes for every 4 pixels, stops early to not read beyond source
+PM_TARGET_SSE41
+static size_t ExpandRgbToRgba_Sse41(const uint8_t* src, size_t count, uint8_t* dst,
+        bool swapRedBlue)
+{
+    const __m128i m = _mm_load_si128(reinterpret_cast<const __m128i*>(
+                (swapRedBlue) ? cRgbToBgraIdx : cRgbToRgbaIdx));
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    size_t n = 0;
+    for (; n + 6 <= count; n += 4)
+    {
+        const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * n));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * n),
+                _mm_or_si128(_mm_shuffle_epi8(rgb, m), alpha));
+    }
+    return n;
+}
+
+PM_TARGET_AVX2
+static size_t ExpandRgbToRgba_Avx2(const uint8_t* src, size_t count, uint8_t* dst,
+        bool swapRedBlue)
+{
+    const __m256i m = _mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(
+                    (swapRedBlue) ? cRgbToBgraIdx : cRgbToRgbaIdx)));
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+    size_t n = 0;
+    for (; n + 10 <= count; n += 8)
+    {
+        const __m128i* s = reinterpret_cast<const __m128i*>(src + 3 * n);
+        const __m256i rgb = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(s)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * n + 12)), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * n),
+                _mm256_or_si256(_mm256_shuffle_epi8(rgb, m), alpha));
+    }
+    return n;
+}
+
+// Masked load of 48 bytes doesn't read beyond source, then each 128-bit lane
+// gets 4 pixels starting at dword 3 * lane
+PM_TARGET_AVX512
+static size_t ExpandRgbToRgba_Avx512(const uint8_t* src, size_t count, uint8_t* dst,
+        bool swapRedBlue)
+{
+    const __m512i m = _mm512_broadcast_i32x4(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(
+                    (swapRedBlue) ? cRgbToBgraIdx : cRgbToRgbaIdx)));
+    const __m512i alpha = _mm512_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m512i lanes = _mm512_setr_epi32(
+            0, 1, 2, 3, 3, 4, 5, 6, 6, 7, 8, 9, 9, 10, 11, 12);
+
+    size_t n = 0;
+    for (; n + 16 <= count; n += 16)
+    {
+        const __m512i rgb = _mm512_permutexvar_epi32(lanes,
+                _mm512_maskz_loadu_epi32(0x0FFF, src + 3 * n));
+        _mm512_storeu_si512(dst + 4 * n,
+                _mm512_or_si512(_mm512_shuffle_epi8(rgb, m), alpha));
+    }
+    return n;
+}
+
+#endif /* PM_SIMD_X86 */
+
+void pm::PixelKernels::ExpandGrayToRgba(const uint8_t* src, size_t count,
+        uint8_t* dst, SimdLevel level)
+{
+    size_t done = 0;
+#if PM_SIMD_X86
+    switch (std::min(level, CpuFeatures::GetSupportedSimdLevel()))
+    {
+    case SimdLevel::Avx512:
+        done = ExpandGrayToRgba_Avx512(src, count, dst);
+        break;
+    case SimdLevel::Avx2:
+        done = ExpandGrayToRgba_Avx2(src, count, dst);
+        break;
+    case SimdLevel::Sse41:
+        done = ExpandGrayToRgba_Sse41(src, count, dst);
+        break;
+    case SimdLevel::Scalar:
+        break;
+    }
+#else
+    (void)level;
+#endif
+
+    for (size_t n = done; n < count; ++n)
+    {
+        dst[4 * n + 0] = src[n];
+        dst[4 * n + 1] = src[n];
+        dst[4 * n + 2] = src[n];
+        dst[4 * n + 3] = 255;
+    }
+}
+
+void pm::PixelKernels::ExpandRgbToRgba(const uint8_t* src, size_t count,
+        uint8_t* dst, bool swapRedBlue, SimdLevel level)
+{
+    size_t done = 0;
+#if PM_SIMD_X86
+    switch (std::min(level, CpuFeatures::GetSupportedSimdLevel()))
+    {
+    case SimdLevel::Avx512:
+        done = ExpandRgbToRgba_Avx512(src, count, dst, swapRedBlue);
+        break;
+    case SimdLevel::Avx2:
+        done = ExpandRgbToRgba_Avx2(src, count, dst, swapRedBlue);
+        break;
+    case SimdLevel::Sse41:
+        done = ExpandRgbToRgba_Sse41(src, count, dst, swapRedBlue);
+        break;
+    case SimdLevel::Scalar:
+        break;
+    }
+#else
+    (void)level;
+#endif
+
+    const size_t r = (swapRedBlue) ? 2 : 0;
+    const size_t b = 2 - r;
+    for (size_t n = done; n < count; ++n)
+    {
+        dst[4 * n + 0] = src[3 * n + r];
+        dst[4 * n + 1] = src[3 * n + 1];
+        dst[4 * n + 2] = src[3 * n + b];
+        dst[4 * n + 3] = 255;
+    }
+}
@@ -0,0 +1,105 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_PIXEL_KERNELS_H
+#define PM_PIXEL_KERNELS_H
+
+/* Local */
+#include "backend/CpuFeatures.h"
+
+/* System */
+#include <cstddef>
+#include <cstdint>
+
+namespace pm {
+
+/* Single-threaded loops over pixel data, vectorized for each SIMD level with
+   scalar fallback. The level is chosen at runtime, by default the best one
+   CPU supports. Task sets split the data and call these per chunk. */
+class PixelKernels final
+{
+public:
+    /* Min., max., sum and sum of squares of pixel values. */
+    struct Sums
+    {
+        uint32_t min{ 0 };
+        uint32_t max{ 0 };
+        uint64_t sum{ 0 };
+        uint64_t sumSq{ 0 };
+    };
+
+public:
+    // All values are zero for empty data.
+    // The sum of squares doesn't overflow for up to 2^32 pixels.
+    static void ComputeSums(const uint8_t* data, size_t count, Sums& sums,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+    static void ComputeSums(const uint16_t* data, size_t count, Sums& sums,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+    // The values must not have more than 16 bits, otherwise the sum of
+    // squares can overflow, use ComputeMinMaxSum instead.
+    static void ComputeSums(const uint32_t* data, size_t count, Sums& sums,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+
+    // Same as ComputeSums but the sum of squares stays zero, works with any
+    // bit depth.
+    static void ComputeMinMaxSum(const uint32_t* data, size_t count, Sums& sums,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+
+    // Adds src counts to dst element-wise, e.g. to merge histograms.
+    // The arrays must not overlap.
+    static void AddCounts(uint32_t* dst, const uint32_t* src, size_t count,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+
+    // Adds one frame to per-pixel accumulators over many frames, all arrays
+    // have count items. The sums of squares don't overflow for up to 2^32
+    // frames.
+    static void AccumulatePixels(const uint8_t* data, size_t count,
+            uint64_t* sums, uint64_t* sumsSq, uint16_t* mins, uint16_t* maxs,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+    static void AccumulatePixels(const uint16_t* data, size_t count,
+            uint64_t* sums, uint64_t* sumsSq, uint16_t* mins, uint16_t* maxs,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+
+    // Maps each sample to 8 bits via lookup table, values beyond the table
+    // use its last entry. Not vectorized, gathers are not faster than scalar
+    // loads from table that stays in L1/L2 cache.
+    static void LookupSamples(const uint8_t* src, size_t count,
+            const uint8_t* lut, size_t lutSize, uint8_t* dst);
+    static void LookupSamples(const uint16_t* src, size_t count,
+            const uint8_t* lut, size_t lutSize, uint8_t* dst);
+    static void LookupSamples(const uint32_t* src, size_t count,
+            const uint8_t* lut, size_t lutSize, uint8_t* dst);
+
+    // Scales samples to 8 bits with same rounding as
+    // TaskSet_ConvertToRgb8::ConvertOnePixel, for data without lookup table.
+    // Without auto-contrast the brightness and contrast are from -255 to +255.
+    static void ScaleSamples(const uint8_t* src, size_t count, uint8_t* dst,
+            uint32_t srcMin, uint32_t srcMax, bool autoConbright,
+            int brightness, int contrast,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+    static void ScaleSamples(const uint16_t* src, size_t count, uint8_t* dst,
+            uint32_t srcMin, uint32_t srcMax, bool autoConbright,
+            int brightness, int contrast,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+    static void ScaleSamples(const uint32_t* src, size_t count, uint8_t* dst,
+            uint32_t srcMin, uint32_t srcMax, bool autoConbright,
+            int brightness, int contrast,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+
+    // Writes each gray value three times, dst has 3 * count bytes
+    static void ExpandGrayToRgb(const uint8_t* src, size_t count, uint8_t* dst,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+    // Writes each gray value three times followed by alpha 255, dst has
+    // 4 * count bytes. The result is the same for RGBA and BGRA order.
+    static void ExpandGrayToRgba(const uint8_t* src, size_t count, uint8_t* dst,
+            SimdLevel level = CpuFeatures::GetSimdLevel());
+    // Appends alpha 255 to each RGB pixel, with swapRedBlue the output is
+    // in BGRA order, dst has 4 * count bytes
+    static void ExpandRgbToRgba(const uint8_t* src, size_t count, uint8_t* dst,
+            bool swapRedBlue, SimdLevel level = CpuFeatures::GetSimdLevel());
+};
+
+} // namespace pm
+
+#endif /* PM_PIXEL_KERNELS_H */
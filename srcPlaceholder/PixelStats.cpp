@@ -0,0 +1,144 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/PixelStats.h"
+
+/* Local */
+#include "backend/Bitmap.h"
+#include "backend/PixelKernels.h"
+#include "backend/exceptions/Exception.h"
+
+/* System */
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+pm::PixelStats::PixelStats()
+{
+}
+
+void pm::PixelStats::Reset(uint32_t width, uint32_t height, uint16_t bitDepth)
+{
+    const size_t pixelCount = (size_t)width * height;
+
+    m_width = width;
+    m_height = height;
+    m_bitDepth = bitDepth;
+
+    m_sums.resize(pixelCount);
+    m_sumsSq.resize(pixelCount);
+    m_mins.resize(pixelCount);
+    m_maxs.resize(pixelCount);
+
+    Clear();
+}
+
+void pm::PixelStats::Clear()
+{
+    m_frameCount = 0;
+
+    std::fill(m_sums.begin(), m_sums.end(), 0);
+    std::fill(m_sumsSq.begin(), m_sumsSq.end(), 0);
+    std::fill(m_mins.begin(), m_mins.end(), (std::numeric_limits<uint16_t>::max)());
+    std::fill(m_maxs.begin(), m_maxs.end(), 0);
+}
+
+bool pm::PixelStats::IsEmpty() const
+{
+    return m_frameCount == 0;
+}
+
+uint32_t pm::PixelStats::GetWidth() const
+{
+    return m_width;
+}
+
+uint32_t pm::PixelStats::GetHeight() const
+{
+    return m_height;
+}
+
+uint16_t pm::PixelStats::GetBitDepth() const
+{
+    return m_bitDepth;
+}
+
+size_t pm::PixelStats::GetPixelCount() const
+{
+    return m_sums.size();
+}
+
+uint64_t pm::PixelStats::GetFrameCount() const
+{
+    return m_frameCount;
+}
+
+void pm::PixelStats::IncrementFrameCount()
+{
+    m_frameCount++;
+}
+
+void pm::PixelStats::AddPixels(const Bitmap* bmp, size_t offset, size_t count)
+{
+    assert(offset + count <= m_sums.size());
+
+    uint64_t* sums = m_sums.data() + offset;
+    uint64_t* sumsSq = m_sumsSq.data() + offset;
+    uint16_t* mins = m_mins.data() + offset;
+    uint16_t* maxs = m_maxs.data() + offset;
+
+    switch (bmp->GetFormat().GetDataType())
+    {
+    case BitmapDataType::UInt8:
+        PixelKernels::AccumulatePixels(
+                static_cast<const uint8_t*>(bmp->GetData()) + offset, count,
+                sums, sumsSq, mins, maxs);
+        break;
+    case BitmapDataType::UInt16:
+        PixelKernels::AccumulatePixels(
+                static_cast<const uint16_t*>(bmp->GetData()) + offset, count,
+                sums, sumsSq, mins, maxs);
+        break;
+    default:
+        throw Exception("Unsupported bitmap data type");
+    }
+}
+
+const std::vector<uint64_t>& pm::PixelStats::GetSums() const
+{
+    return m_sums;
+}
+
+const std::vector<uint64_t>& pm::PixelStats::GetSumsSq() const
+{
+    return m_sumsSq;
+}
+
+const std::vector<uint16_t>& pm::PixelStats::GetMins() const
+{
+    return m_mins;
+}
+
+const std::vector<uint16_t>& pm::PixelStats::GetMaxs() const
+{
+    return m_maxs;
+}
+
+double pm::PixelStats::GetMean(size_t pixelIdx) const
+{
+    if (m_frameCount == 0)
+        return 0.0;
+
+    return static_cast<double>(m_sums[pixelIdx]) / m_frameCount;
+}
+
+double pm::PixelStats::GetVariance(size_t pixelIdx) const
+{
+    if (m_frameCount == 0)
+        return 0.0;
+
+    const double sum = static_cast<double>(m_sums[pixelIdx]);
+    const double sumSq = static_cast<double>(m_sumsSq[pixelIdx]);
+    const double secondMoment = sumSq - sum * sum / m_frameCount;
+    return std::max(secondMoment, 0.0) / m_frameCount;
+}
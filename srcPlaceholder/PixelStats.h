@@ -0,0 +1,72 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_PIXEL_STATS_H
+#define PM_PIXEL_STATS_H
+
+/* System */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pm {
+
+class Bitmap;
+
+/* Per-pixel statistics over many frames, e.g. for photon transfer curves or
+   dark current maps. Each pixel has its own exact integral sums, so frames
+   can be added one by one without keeping them. Works with mono bitmaps up to
+   16 bits. */
+class PixelStats
+{
+public:
+    explicit PixelStats();
+
+public:
+    // Allocates buffers for given frame size and clears them.
+    // Throws std::bad_alloc if there's not enough memory.
+    void Reset(uint32_t width, uint32_t height, uint16_t bitDepth);
+    // Clears all sums, the size stays the same
+    void Clear();
+
+    // Stats are empty if there is no frame
+    bool IsEmpty() const;
+
+    uint32_t GetWidth() const;
+    uint32_t GetHeight() const;
+    uint16_t GetBitDepth() const;
+    size_t GetPixelCount() const;
+
+    uint64_t GetFrameCount() const;
+    // Called once all pixels of new frame were added via AddPixels
+    void IncrementFrameCount();
+
+    // Adds given range of bitmap pixels to the sums. Different ranges can be
+    // added from different threads at the same time.
+    void AddPixels(const Bitmap* bmp, size_t offset, size_t count);
+
+    const std::vector<uint64_t>& GetSums() const;
+    const std::vector<uint64_t>& GetSumsSq() const;
+    const std::vector<uint16_t>& GetMins() const;
+    const std::vector<uint16_t>& GetMaxs() const;
+
+    // Both return zero if stats are empty
+    double GetMean(size_t pixelIdx) const;
+    double GetVariance(size_t pixelIdx) const;
+
+private:
+    uint32_t m_width{ 0 };
+    uint32_t m_height{ 0 };
+    uint16_t m_bitDepth{ 0 };
+    uint64_t m_frameCount{ 0 };
+
+    std::vector<uint64_t> m_sums{};
+    std::vector<uint64_t> m_sumsSq{};
+    std::vector<uint16_t> m_mins{};
+    std::vector<uint16_t> m_maxs{};
+};
+
+} // namespace
+
+#endif
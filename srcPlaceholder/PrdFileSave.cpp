@@ -5,9 +5,12 @@
 
 /* Local */
 #include "backend/AllocatorFactory.h"
+#include "backend/Log.h"
 #include "backend/PrdFileUtils.h"
 
 /* System */
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <limits>
@@ -32,10 +35,19 @@ const static auto sPageSize = []() -> size_t
 #endif
 }();
 
+// User data of request writing PRD header, other requests use slot index
+static constexpr uint64_t cAsyncHeaderUserData = (std::numeric_limits<uint64_t>::max)();
+// Max. number of requests per frame, metadata, ext. dynamic metadata and raw data
+static constexpr unsigned int cAsyncWritesPerFrame = 3;
+
+// Fallback to synchronous writes is reported only once
+static std::atomic<bool> sAsyncFallbackReported{ false };
+
 pm::PrdFileSave::PrdFileSave(const std::string& fileName, const PrdHeader& header,
-        std::shared_ptr<Allocator> allocator)
+        std::shared_ptr<Allocator> allocator, unsigned int ioQueueDepth)
     : FileSave(fileName, header, allocator),
-    m_headerBytesAligned(PrdFileUtils::GetAlignedSize(header, sizeof(PrdHeader)))
+    m_headerBytesAligned(PrdFileUtils::GetAlignedSize(header, sizeof(PrdHeader))),
+    m_ioQueueDepth(ioQueueDepth)
 {
     // TODO: The sector size should be read from underlying device, i.e.
     //       on existing file or path takes its fill file/path name and:
@@ -95,6 +107,14 @@ bool pm::PrdFileSave::Open()
 
     m_frameIndex = 0;
 
+    if (m_ioQueueDepth > 0 && !AsyncInit())
+    {
+        if (!sAsyncFallbackReported.exchange(true))
+        {
+            Log::LogW("Asynchronous I/O not available, writing PRD files synchronously");
+        }
+    }
+
     return IsOpen();
 }
 
@@ -112,6 +132,16 @@ void pm::PrdFileSave::Close()
     if (!IsOpen())
         return;
 
+    if (m_ioUring.IsValid())
+    {
+        if (!AsyncDrain())
+        {
+            Log::LogE("Failure writing data asynchronously to '%s'",
+                    m_fileName.c_str());
+        }
+        AsyncRelease();
+    }
+
     if (m_header.frameCount != m_frameIndex)
     {
         m_header.frameCount = m_frameIndex;
@@ -187,6 +217,9 @@ bool pm::PrdFileSave::WriteFrame(std::shared_ptr<Frame> frame)
     if (!FileSave::WriteFrame(frame))
         return false;
 
+    if (m_ioUring.IsValid())
+        return AsyncWriteFrame(frame);
+
     return WriteFrame(m_framePrdMetaData, m_framePrdExtDynMetaData, frame->GetData());
 }
 
@@ -205,3 +238,207 @@ bool pm::PrdFileSave::OsWrite(const void* data, size_t bytes)
     return (::write(m_file, data, bytes) == (ssize_t)bytes);
 #endif
 }
+
+bool pm::PrdFileSave::AsyncInit()
+{
+#ifdef _WIN32
+    return false;
+#else
+    // Each slot needs up to three entries plus one for the PRD header
+    if (!m_ioUring.Init(m_ioQueueDepth * cAsyncWritesPerFrame + 1))
+        return false;
+
+    m_asyncSlots.resize(m_ioQueueDepth);
+    m_asyncFreeSlots.clear();
+    for (size_t n = m_ioQueueDepth; n > 0; --n)
+    {
+        m_asyncFreeSlots.push_back(n - 1);
+    }
+    m_asyncOffset = 0;
+    m_asyncPendingWrites = 0;
+    m_asyncFailed = false;
+
+    return true;
+#endif
+}
+
+void pm::PrdFileSave::AsyncRelease()
+{
+    m_ioUring.Release();
+
+    for (auto& slot : m_asyncSlots)
+    {
+        m_allocator->Free(slot.metaData);
+        m_allocator->Free(slot.extDynMetaData);
+    }
+    m_asyncSlots.clear();
+    m_asyncFreeSlots.clear();
+}
+
+bool pm::PrdFileSave::AsyncWriteFrame(std::shared_ptr<Frame> frame)
+{
+    if (m_asyncFailed)
+        return false;
+
+    const void* rawData = frame->GetData();
+    if (!FileSave::WriteFrame(m_framePrdMetaData, m_framePrdExtDynMetaData, rawData))
+        return false;
+
+    // Write PRD header to file only once at the beginning
+    if (m_frameIndex == 0)
+    {
+        // Copy header data to aligned memory
+        if (m_headerAlignedBuffer)
+        {
+            std::memcpy(m_headerAlignedBuffer, &m_header, sizeof(PrdHeader));
+        }
+
+        // The header buffer doesn't change until Close that drains all requests
+        if (!AsyncQueueWrite(m_headerDataPtr, m_headerBytesAligned,
+                    cAsyncHeaderUserData))
+            return false;
+    }
+
+    // Wait until some frame written before is done
+    while (m_asyncFreeSlots.empty())
+    {
+        if (!AsyncReap(1))
+            return false;
+    }
+    const size_t slotIndex = m_asyncFreeSlots.back();
+    m_asyncFreeSlots.pop_back();
+    AsyncSlot& slot = m_asyncSlots[slotIndex];
+
+    // Metadata buffers are reused for next frame, keep own copy
+    if (slot.metaDataBytes < m_framePrdMetaDataBytesAligned)
+    {
+        m_allocator->Free(slot.metaData);
+        slot.metaData = m_allocator->Allocate(m_framePrdMetaDataBytesAligned);
+        slot.metaDataBytes = (slot.metaData) ? m_framePrdMetaDataBytesAligned : 0;
+        if (!slot.metaData)
+            return false;
+    }
+    std::memcpy(slot.metaData, m_framePrdMetaData, m_framePrdMetaDataBytesAligned);
+
+    const bool hasExtDynMetaData = m_header.version >= PRD_VERSION_0_5
+        && m_framePrdExtDynMetaDataBytesAligned > 0 && m_framePrdExtDynMetaData;
+    if (hasExtDynMetaData)
+    {
+        if (slot.extDynMetaDataBytes < m_framePrdExtDynMetaDataBytesAligned)
+        {
+            m_allocator->Free(slot.extDynMetaData);
+            slot.extDynMetaData =
+                m_allocator->Allocate(m_framePrdExtDynMetaDataBytesAligned);
+            slot.extDynMetaDataBytes = (slot.extDynMetaData)
+                ? m_framePrdExtDynMetaDataBytesAligned : 0;
+            if (!slot.extDynMetaData)
+                return false;
+        }
+        std::memcpy(slot.extDynMetaData, m_framePrdExtDynMetaData,
+                m_framePrdExtDynMetaDataBytesAligned);
+    }
+
+    // Keeps the frame out of pool until its data is written
+    slot.frame = frame;
+
+    if (!AsyncQueueWrite(slot.metaData, m_framePrdMetaDataBytesAligned, slotIndex))
+        return false;
+    if (hasExtDynMetaData)
+    {
+        if (!AsyncQueueWrite(slot.extDynMetaData,
+                    m_framePrdExtDynMetaDataBytesAligned, slotIndex))
+            return false;
+    }
+    if (!AsyncQueueWrite(rawData, m_rawDataBytesAligned, slotIndex))
+        return false;
+
+    // Pass requests to kernel and release frames already written, don't wait
+    if (!AsyncReap(0))
+        return false;
+
+    m_frameIndex++;
+    return true;
+}
+
+bool pm::PrdFileSave::AsyncQueueWrite(const void* data, size_t bytes,
+        uint64_t userData)
+{
+    // Entries are freed once the kernel takes them on submit
+    if (m_ioUring.GetFreeEntryCount() == 0 && !m_ioUring.Submit())
+    {
+        m_asyncFailed = true;
+        return false;
+    }
+
+    if (!m_ioUring.QueueWrite(m_file, data, bytes, m_asyncOffset, userData))
+    {
+        m_asyncFailed = true;
+        return false;
+    }
+    m_asyncOffset += bytes;
+    m_asyncPendingWrites++;
+
+    if (userData != cAsyncHeaderUserData)
+    {
+        AsyncSlot& slot = m_asyncSlots[userData];
+        slot.pendingWrites++;
+        slot.pendingBytes += bytes;
+    }
+    return true;
+}
+
+bool pm::PrdFileSave::AsyncReap(unsigned int minComplete)
+{
+    if (!m_ioUring.Submit(minComplete))
+    {
+        m_asyncFailed = true;
+        return false;
+    }
+
+    uint64_t userData;
+    int32_t result;
+    while (m_ioUring.PopCompletion(userData, result))
+    {
+        m_asyncPendingWrites--;
+
+        if (userData == cAsyncHeaderUserData)
+        {
+            if (result < 0 || (size_t)result != m_headerBytesAligned)
+                m_asyncFailed = true;
+            continue;
+        }
+
+        AsyncSlot& slot = m_asyncSlots[userData];
+        if (result > 0)
+        {
+            slot.pendingBytes -= std::min<size_t>(slot.pendingBytes, result);
+        }
+        if (--slot.pendingWrites == 0)
+        {
+            // Partial write or error leaves some bytes not written
+            if (slot.pendingBytes != 0)
+                m_asyncFailed = true;
+            slot.pendingBytes = 0;
+            // Frame can go back to pool now
+            slot.frame = nullptr;
+            m_asyncFreeSlots.push_back(userData);
+        }
+    }
+
+    return !m_asyncFailed;
+}
+
+bool pm::PrdFileSave::AsyncDrain()
+{
+    while (m_asyncPendingWrites > 0)
+    {
+        // Stop waiting if kernel refuses requests, failure flag is set then
+        if (!m_ioUring.Submit(1))
+        {
+            m_asyncFailed = true;
+            break;
+        }
+        AsyncReap(0);
+    }
+    return !m_asyncFailed;
+}
@@ -7,14 +7,22 @@
 
 /* Local */
 #include "backend/FileSave.h"
+#include "backend/IoUring.h"
+
+/* System */
+#include <vector>
 
 namespace pm {
 
 class PrdFileSave final : public FileSave
 {
 public:
+    // With non-zero ioQueueDepth up to given number of frames is written
+    // asynchronously via io_uring if supported by system. Each frame is then
+    // held until its data is written.
     PrdFileSave(const std::string& fileName, const PrdHeader& header,
-            std::shared_ptr<Allocator> allocator = nullptr);
+            std::shared_ptr<Allocator> allocator = nullptr,
+            unsigned int ioQueueDepth = 0);
     virtual ~PrdFileSave();
 
     PrdFileSave() = delete;
@@ -33,11 +41,36 @@ public: // From FileSave
             const void* rawData) override;
     virtual bool WriteFrame(std::shared_ptr<Frame> frame) override;
 
+private:
+    // Frame written asynchronously with its own copy of metadata
+    struct AsyncSlot
+    {
+        std::shared_ptr<Frame> frame{ nullptr };
+        void* metaData{ nullptr };
+        size_t metaDataBytes{ 0 };
+        void* extDynMetaData{ nullptr };
+        size_t extDynMetaDataBytes{ 0 };
+        // Number of write requests not completed yet
+        unsigned int pendingWrites{ 0 };
+        // Number of bytes not reported as written yet
+        size_t pendingBytes{ 0 };
+    };
+
 private:
     bool OsWrite(const void *data, size_t bytes);
 
+    bool AsyncInit();
+    void AsyncRelease();
+    bool AsyncWriteFrame(std::shared_ptr<Frame> frame);
+    bool AsyncQueueWrite(const void* data, size_t bytes, uint64_t userData);
+    // Processes completed requests, waits for at least minComplete of them
+    bool AsyncReap(unsigned int minComplete);
+    // Waits for all pending requests
+    bool AsyncDrain();
+
 private:
     const size_t m_headerBytesAligned;
+    const unsigned int m_ioQueueDepth;
 
     void* m_headerAlignedBuffer{ nullptr };
     const void* m_headerDataPtr{ nullptr };
@@ -48,6 +81,15 @@ private:
     int m_file{ -1 };
 #endif
     int m_fileFlags{ 0 };
+
+    IoUring m_ioUring{};
+    std::vector<AsyncSlot> m_asyncSlots{};
+    std::vector<size_t> m_asyncFreeSlots{};
+    // File offset where next request writes to
+    uint64_t m_asyncOffset{ 0 };
+    // Number of write requests not completed yet, over all slots
+    size_t m_asyncPendingWrites{ 0 };
+    bool m_asyncFailed{ false };
 };
 
 } // namespace
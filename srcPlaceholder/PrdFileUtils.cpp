@@ -416,9 +416,17 @@ std::shared_ptr<pm::Frame> pm::PrdFileUtils::ReconstructFrame(const PrdHeader& h
     {
         auto prdTrajectories =
             static_cast<const PrdTrajectoriesHeader*>(trajectoriesAddress);
-        pm::Frame::Trajectories trajectories;
+        std::shared_ptr<pm::Frame::Trajectories> trajectories;
+        try
+        {
+            trajectories = std::make_shared<pm::Frame::Trajectories>();
+        }
+        catch (...)
+        {
+            return nullptr;
+        }
 
-        if (!ConvertTrajectoriesFromPrd(prdTrajectories, trajectories))
+        if (!ConvertTrajectoriesFromPrd(prdTrajectories, *trajectories))
             return nullptr;
 
         frame->SetTrajectories(trajectories);
@@ -894,7 +894,6 @@ bool Helper::ExportCsv_Particles(const std::string& outFileName, pm::Frame& fram
 
     std::string content;
 
-    auto extFrameMeta = frame.GetExtMetadata();
     auto& trajectories = frame.GetTrajectories();
 
     // Add CSV header
@@ -921,35 +920,30 @@ bool Helper::ExportCsv_Particles(const std::string& outFileName, pm::Frame& fram
         if (point.isValid == 0)
             continue; // First point not valid
 
-        auto collection = &extFrameMeta[trajectory.header.roiNr];
+        const pm::MetadataDecoder::ExtItems* extItems =
+            frame.FindExtMetadata(trajectory.header.roiNr);
 
         // Extract M0 from extended metadata
-        const md_ext_item* item_m0 = collection->map[PL_MD_EXT_TAG_PARTICLE_M0];
-        if (!item_m0 || !item_m0->value || !item_m0->tagInfo
-                || item_m0->tagInfo->type != TYPE_UNS32
-                || item_m0->tagInfo->size != 4)
+        uint32_t rawM0;
+        if (!extItems || !extItems->GetValue(PL_MD_EXT_TAG_PARTICLE_M0, rawM0))
         {
             pm::Log::LogE("Missing M0 moment in ext. metadata, frameNr %u, roiNr=%u",
                     frameNr, trajectory.header.roiNr);
             return false;
         }
         // Unsigned fixed-point real number in format Q22.0
-        const double m0 =
-            pm::Utils::FixedPointToReal<double, uint32_t>(22, 0, *((uint32_t*)item_m0->value));
+        const double m0 = pm::Utils::FixedPointToReal<double, uint32_t>(22, 0, rawM0);
 
         // Extract M2 from extended metadata
-        const md_ext_item* item_m2 = collection->map[PL_MD_EXT_TAG_PARTICLE_M2];
-        if (!item_m2 || !item_m2->value || !item_m2->tagInfo
-                || item_m2->tagInfo->type != TYPE_UNS32
-                || item_m2->tagInfo->size != 4)
+        uint32_t rawM2;
+        if (!extItems || !extItems->GetValue(PL_MD_EXT_TAG_PARTICLE_M2, rawM2))
         {
             pm::Log::LogE("Missing M2 moment in ext. metadata, frameNr %u, roiNr=%u",
                     frameNr, trajectory.header.roiNr);
             return false;
         }
         // Unsigned fixed-point real number in format Q3.19
-        const double m2 =
-            pm::Utils::FixedPointToReal<double, uint32_t>(3, 19, *((uint32_t*)item_m2->value));
+        const double m2 = pm::Utils::FixedPointToReal<double, uint32_t>(3, 19, rawM2);
 
         std::vector<std::string> values;
         values.push_back(std::to_string(frameNr));
@@ -0,0 +1,99 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_SEQ_LOCK_H
+#define PM_SEQ_LOCK_H
+
+/* System */
+#include <atomic>
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <thread>
+#include <type_traits>
+
+namespace pm {
+
+/* Holds a value of trivially copyable type guarded by sequence lock.
+   Readers don't write any shared memory, they only retry if a write
+   overlapped with the read, i.e. the sequence number was odd or it has
+   changed meanwhile. That's cheap for values read much more often than
+   written.
+   Store is not thread-safe with itself, writers have to be serialized
+   externally, e.g. by a mutex. Load can be called from any thread. */
+template<typename T>
+class SeqLock final
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+            "SeqLock value must be trivially copyable");
+
+public:
+    SeqLock()
+    {
+        Store(T());
+    }
+
+    explicit SeqLock(const T& value)
+    {
+        Store(value);
+    }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+public:
+    T Load() const
+    {
+        uint64_t words[cWordCount];
+        for (;;)
+        {
+            const uint32_t seq1 = m_seq.load(std::memory_order_acquire);
+            if (seq1 & 1)
+            {
+                // Write in progress
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t n = 0; n < cWordCount; ++n)
+            {
+                words[n] = m_words[n].load(std::memory_order_relaxed);
+            }
+            // Keeps the loads above before the check below
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint32_t seq2 = m_seq.load(std::memory_order_relaxed);
+            if (seq1 == seq2)
+                break;
+        }
+
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+    void Store(const T& value)
+    {
+        uint64_t words[cWordCount]{};
+        std::memcpy(words, &value, sizeof(T));
+
+        const uint32_t seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        // Keeps the stores below after odd sequence number is visible
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t n = 0; n < cWordCount; ++n)
+        {
+            m_words[n].store(words[n], std::memory_order_relaxed);
+        }
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+private:
+    static constexpr size_t cWordCount = (sizeof(T) + 7) / 8;
+
+    std::atomic<uint32_t> m_seq{ 0 };
+    // Value split to words so concurrent read and write is not a data race
+    std::atomic<uint64_t> m_words[cWordCount]{};
+};
+
+} // namespace pm
+
+#endif /* PM_SEQ_LOCK_H */
@@ -4,6 +4,7 @@
 #include "backend/Settings.h"
 
 /* Local */
+#include "backend/CpuAffinity.h"
 #include "backend/Log.h"
 #include "backend/Utils.h"
 
@@ -105,12 +106,41 @@ bool pm::Settings::AddOptions(OptionController& controller)
             "Changes how is buffer memory allocated and aligned.\n"
             "The 'align4k' allocator allows optimized streaming to disk in PRD\n"
             "format without additional buffering done by OS.\n"
-            "Supported values are: 'default', 'align16', 'align32' and 'align4k'.",
+            "The 'huge2m' and 'huge1g' allocators are 4k-aligned as well and use\n"
+            "2 MiB or 1 GiB huge pages for big buffers to reduce TLB misses.\n"
+            "On Linux the pages have to be reserved in /proc/sys/vm/nr_hugepages,\n"
+            "transparent huge pages are used otherwise. On Windows both use large\n"
+            "pages if the user has 'Lock pages in memory' privilege.\n"
+            "Supported values are: 'default', 'align16', 'align32', 'align4k',\n"
+            "'huge2m' and 'huge1g'.",
             static_cast<uint32_t>(OptionId::AllocatorType),
             std::bind(&Settings::HandleAllocatorType,
                     this, std::placeholders::_1))))
         return false;
 
+    if (!controller.AddOption(Option(
+            { "--allocator-lock" },
+            { "" },
+            { "false" },
+            "Locks buffer memory in RAM so it is never swapped out.\n"
+            "Applies to 'huge2m' and 'huge1g' allocators only.",
+            static_cast<uint32_t>(OptionId::AllocatorLock),
+            std::bind(&Settings::HandleAllocatorLock,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--allocator-prefault" },
+            { "" },
+            { "false" },
+            "Maps all pages of buffer memory right on allocation so no page fault\n"
+            "happens during acquisition.\n"
+            "Applies to 'huge2m' and 'huge1g' allocators only.",
+            static_cast<uint32_t>(OptionId::AllocatorPrefault),
+            std::bind(&Settings::HandleAllocatorPrefault,
+                    this, std::placeholders::_1))))
+        return false;
+
     if (!controller.AddOption(Option(
             { "--binning-serial", "--sbin" },
             { "factor" },
@@ -220,6 +250,21 @@ bool pm::Settings::AddOptions(OptionController& controller)
                     this, std::placeholders::_1))))
         return false;
 
+    if (!controller.AddOption(Option(
+            { "--acq-zero-copy" },
+            { "" },
+            { "false" },
+            "If 'true', frames are not copied out of the circular buffer.\n"
+            "Each frame references its buffer slot directly until it is saved.\n"
+            "The fake camera doesn't overwrite such slots, new frames are dropped\n"
+            "instead. Real cameras overwrite them, overwritten frames are detected\n"
+            "from frame numbers and reported as lost or not saved.\n"
+            "Use bigger circular buffer (via --buffer-frames) with this mode.",
+            static_cast<uint32_t>(OptionId::AcqZeroCopy),
+            std::bind(&Settings::HandleAcqZeroCopy,
+                    this, std::placeholders::_1))))
+        return false;
+
     if (!controller.AddOption(Option(
             { "--save-as" },
             { "format" },
@@ -305,6 +350,136 @@ bool pm::Settings::AddOptions(OptionController& controller)
                     this, std::placeholders::_1))))
         return false;
 
+    if (!controller.AddOption(Option(
+            { "--save-threads" },
+            { "count" },
+            { "1" },
+            "Number of threads writing files in parallel.\n"
+            "Each file is written by one thread only, file names and frame order\n"
+            "in stacks don't depend on the thread count.\n"
+            "Values above 1 help mainly with TIFF format or fast disk arrays.",
+            static_cast<uint32_t>(OptionId::SaveThreads),
+            std::bind(&Settings::HandleSaveThreadCount,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--save-io-depth" },
+            { "frames" },
+            { "0" },
+            "Max. number of frames being written to PRD file at once.\n"
+            "Non-zero value enables asynchronous writes via io_uring on Linux,\n"
+            "each frame is then reused only after its data has been written.\n"
+            "Default value is 0 which means each frame is written synchronously.\n"
+            "Synchronous writes are used also if the system doesn't support io_uring.",
+            static_cast<uint32_t>(OptionId::SaveIoQueueDepth),
+            std::bind(&Settings::HandleSaveIoQueueDepth,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--save-spill-dir" },
+            { "folder" },
+            { "" },
+            "Frames that don't fit in RAM are stored to scratch file in given\n"
+            "existing directory, ideally on fast local disk, and read back\n"
+            "in order once the saving catches up. The file is removed at the end.\n"
+            "If empty string is given (the default) such frames are dropped.",
+            static_cast<uint32_t>(OptionId::SaveSpillDir),
+            std::bind(&Settings::HandleSaveSpillDir,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--save-pre-trigger" },
+            { "count" },
+            { "0" },
+            "Enables pre-trigger capture in live modes. Up to <count> most recent\n"
+            "frames are kept in RAM and nothing is written to disk until the capture\n"
+            "is triggered, e.g. via Ctrl+Break on Windows or SIGUSR1 on Linux.\n"
+            "Then the kept frames are saved together with frames given by option\n"
+            "--save-post-trigger, the capture is re-armed afterwards.\n"
+            "The count is limited to half of frames that fit in available RAM.\n"
+            "Default value is 0 which means the capture is disabled.",
+            static_cast<uint32_t>(OptionId::SavePreTrigger),
+            std::bind(&Settings::HandleSavePreTrigger,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--save-post-trigger" },
+            { "count" },
+            { "0" },
+            "Number of frames saved after the kept ones once pre-trigger capture\n"
+            "has been triggered.\n"
+            "Ignored unless an option --save-pre-trigger is non-zero.",
+            static_cast<uint32_t>(OptionId::SavePostTrigger),
+            std::bind(&Settings::HandleSavePostTrigger,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--cpus-acq" },
+            { "list" },
+            { "" },
+            "Restricts acquisition thread to given CPUs, e.g. '2-3' or '2,6'.\n"
+            "Frames kept in RAM are then allocated on NUMA node of first CPU\n"
+            "in the list, if the system supports it.\n"
+            "If empty string is given (the default) the thread can run on any CPU.",
+            static_cast<uint32_t>(OptionId::CpusAcq),
+            std::bind(&Settings::HandleCpusAcq,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--cpus-disk" },
+            { "list" },
+            { "" },
+            "Restricts disk thread and all file writer threads to given CPUs.\n"
+            "The list format is the same as for --cpus-acq.",
+            static_cast<uint32_t>(OptionId::CpusDisk),
+            std::bind(&Settings::HandleCpusDisk,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--cpus-workers" },
+            { "list" },
+            { "" },
+            "Restricts frame processing threads, i.e. threads of all frame stages\n"
+            "and thread pools, to given CPUs.\n"
+            "The list format is the same as for --cpus-acq.",
+            static_cast<uint32_t>(OptionId::CpusWorkers),
+            std::bind(&Settings::HandleCpusWorkers,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--cpus-aux" },
+            { "list" },
+            { "" },
+            "Restricts auxiliary threads, i.e. progress update and logging\n"
+            "threads, to given CPUs.\n"
+            "The list format is the same as for --cpus-acq.",
+            static_cast<uint32_t>(OptionId::CpusAux),
+            std::bind(&Settings::HandleCpusAux,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--acq-rt-priority" },
+            { "priority" },
+            { "0" },
+            "Runs acquisition thread with real-time scheduling policy and given\n"
+            "priority 1-99 (SCHED_FIFO on Linux, time-critical on Windows).\n"
+            "It usually requires elevated privileges, if not granted the thread\n"
+            "runs with normal priority.\n"
+            "Default value is 0 which means normal scheduling.",
+            static_cast<uint32_t>(OptionId::AcqRtPriority),
+            std::bind(&Settings::HandleAcqRtPriority,
+                    this, std::placeholders::_1))))
+        return false;
+
     if (!controller.AddOption(Option(
             { "--track-link-frames" },
             { "count" },
@@ -346,6 +521,34 @@ bool pm::Settings::AddOptions(OptionController& controller)
                     this, std::placeholders::_1))))
         return false;
 
+    if (!controller.AddOption(Option(
+            { "--pixel-stats" },
+            { "" },
+            { "false" },
+            "Accumulates per-pixel min., max., mean and variance over all frames\n"
+            "without saving the frames, e.g. for photon transfer curves.\n"
+            "Works with mono frames up to 16 bits. The statistics are saved to\n"
+            "<save-dir>/pixel_stats_<frames> file in format given by option\n"
+            "--save-as (PRD if none) as 4 pages of 32-bit pixels, the mean and\n"
+            "variance with 8 fractional bits.",
+            static_cast<uint32_t>(OptionId::PixelStats),
+            std::bind(&Settings::HandlePixelStats,
+                    this, std::placeholders::_1))))
+        return false;
+
+    if (!controller.AddOption(Option(
+            { "--pixel-stats-checkpoint" },
+            { "frames" },
+            { "0" },
+            "Saves pixel statistics every given number of frames.\n"
+            "Default value is 0 which means the statistics are saved only once\n"
+            "the acquisition stops.\n"
+            "Ignored unless an option --pixel-stats is used.",
+            static_cast<uint32_t>(OptionId::PixelStatsCheckpoint),
+            std::bind(&Settings::HandlePixelStatsCheckpoint,
+                    this, std::placeholders::_1))))
+        return false;
+
     if (!controller.AddOption(Option(
             { "--color-wb-scale-red" },
             { "scale" },
@@ -462,6 +665,18 @@ bool pm::Settings::SetAllocatorType(AllocatorType value)
     return true;
 }
 
+bool pm::Settings::SetAllocatorLock(bool value)
+{
+    m_allocatorLock = value;
+    return true;
+}
+
+bool pm::Settings::SetAllocatorPrefault(bool value)
+{
+    m_allocatorPrefault = value;
+    return true;
+}
+
 bool pm::Settings::SetBinningSerial(uint16_t value)
 {
     if (value == 0)
@@ -533,6 +748,12 @@ bool pm::Settings::SetTimeLapseDelay(unsigned int value)
     return true;
 }
 
+bool pm::Settings::SetAcqZeroCopy(bool value)
+{
+    m_acqZeroCopy = value;
+    return true;
+}
+
 bool pm::Settings::SetStorageType(StorageType value)
 {
     m_storageType = value;
@@ -575,6 +796,72 @@ bool pm::Settings::SetMaxStackSize(size_t value)
     return true;
 }
 
+bool pm::Settings::SetSaveThreadCount(uint16_t value)
+{
+    if (value == 0)
+        return false;
+
+    m_saveThreadCount = value;
+    return true;
+}
+
+bool pm::Settings::SetSaveIoQueueDepth(uint16_t value)
+{
+    m_saveIoQueueDepth = value;
+    return true;
+}
+
+bool pm::Settings::SetSaveSpillDir(const std::string& value)
+{
+    m_saveSpillDir = value;
+    return true;
+}
+
+bool pm::Settings::SetSavePreTrigger(size_t value)
+{
+    m_savePreTrigger = value;
+    return true;
+}
+
+bool pm::Settings::SetSavePostTrigger(size_t value)
+{
+    m_savePostTrigger = value;
+    return true;
+}
+
+bool pm::Settings::SetCpusAcq(const std::vector<unsigned int>& value)
+{
+    m_cpusAcq = value;
+    return true;
+}
+
+bool pm::Settings::SetCpusDisk(const std::vector<unsigned int>& value)
+{
+    m_cpusDisk = value;
+    return true;
+}
+
+bool pm::Settings::SetCpusWorkers(const std::vector<unsigned int>& value)
+{
+    m_cpusWorkers = value;
+    return true;
+}
+
+bool pm::Settings::SetCpusAux(const std::vector<unsigned int>& value)
+{
+    m_cpusAux = value;
+    return true;
+}
+
+bool pm::Settings::SetAcqRtPriority(unsigned int value)
+{
+    if (value > 99)
+        return false;
+
+    m_acqRtPriority = value;
+    return true;
+}
+
 bool pm::Settings::SetTrackLinkFrames(uint16_t value)
 {
     m_trackLinkFrames = value;
@@ -599,6 +886,18 @@ bool pm::Settings::SetTrackTrajectoryDuration(uint16_t value)
     return true;
 }
 
+bool pm::Settings::SetPixelStats(bool value)
+{
+    m_pixelStats = value;
+    return true;
+}
+
+bool pm::Settings::SetPixelStatsCheckpoint(size_t value)
+{
+    m_pixelStatsCheckpoint = value;
+    return true;
+}
+
 bool pm::Settings::SetColorWbScaleRed(float value)
 {
     m_colorWbScaleRed = value;
@@ -738,12 +1037,48 @@ bool pm::Settings::HandleAllocatorType(const std::string& value)
         allocatorType = AllocatorType::Align32;
     else if (value == "align4k" || value == "4096")
         allocatorType = AllocatorType::Align4k;
+    else if (value == "huge2m")
+        allocatorType = AllocatorType::HugePages2M;
+    else if (value == "huge1g")
+        allocatorType = AllocatorType::HugePages1G;
     else
         return false;
 
     return SetAllocatorType(allocatorType);
 }
 
+bool pm::Settings::HandleAllocatorLock(const std::string& value)
+{
+    bool lock;
+    if (value.empty())
+    {
+        lock = true;
+    }
+    else
+    {
+        if (!Utils::StrToBool(value, lock))
+            return false;
+    }
+
+    return SetAllocatorLock(lock);
+}
+
+bool pm::Settings::HandleAllocatorPrefault(const std::string& value)
+{
+    bool prefault;
+    if (value.empty())
+    {
+        prefault = true;
+    }
+    else
+    {
+        if (!Utils::StrToBool(value, prefault))
+            return false;
+    }
+
+    return SetAllocatorPrefault(prefault);
+}
+
 bool pm::Settings::HandleBinningSerial(const std::string& value)
 {
     uint16_t binSer;
@@ -897,6 +1232,22 @@ bool pm::Settings::HandleTimeLapseDelay(const std::string& value)
     return SetTimeLapseDelay(timeLapseDelay);
 }
 
+bool pm::Settings::HandleAcqZeroCopy(const std::string& value)
+{
+    bool acqZeroCopy;
+    if (value.empty())
+    {
+        acqZeroCopy = true;
+    }
+    else
+    {
+        if (!Utils::StrToBool(value, acqZeroCopy))
+            return false;
+    }
+
+    return SetAcqZeroCopy(acqZeroCopy);
+}
+
 bool pm::Settings::HandleStorageType(const std::string& value)
 {
     StorageType storageType;
@@ -1005,6 +1356,104 @@ bool pm::Settings::HandleMaxStackSize(const std::string& value)
     return SetMaxStackSize(maxStackSize);
 }
 
+bool pm::Settings::HandleSaveThreadCount(const std::string& value)
+{
+    uint16_t saveThreadCount;
+    if (!Utils::StrToNumber<uint16_t>(value, saveThreadCount))
+        return false;
+
+    return SetSaveThreadCount(saveThreadCount);
+}
+
+bool pm::Settings::HandleSaveIoQueueDepth(const std::string& value)
+{
+    uint16_t saveIoQueueDepth;
+    if (!Utils::StrToNumber<uint16_t>(value, saveIoQueueDepth))
+        return false;
+
+    return SetSaveIoQueueDepth(saveIoQueueDepth);
+}
+
+bool pm::Settings::HandleSaveSpillDir(const std::string& value)
+{
+    return SetSaveSpillDir(value);
+}
+
+bool pm::Settings::HandleSavePreTrigger(const std::string& value)
+{
+    size_t savePreTrigger;
+    if (!Utils::StrToNumber<size_t>(value, savePreTrigger))
+        return false;
+
+    return SetSavePreTrigger(savePreTrigger);
+}
+
+bool pm::Settings::HandleSavePostTrigger(const std::string& value)
+{
+    size_t savePostTrigger;
+    if (!Utils::StrToNumber<size_t>(value, savePostTrigger))
+        return false;
+
+    return SetSavePostTrigger(savePostTrigger);
+}
+
+bool pm::Settings::HandleCpusAcq(const std::string& value)
+{
+    CpuAffinity::CpuSet cpus;
+    if (!CpuAffinity::StrToCpuSet(value, cpus))
+    {
+        Log::LogE("Incorrect CPU list '%s'", value.c_str());
+        return false;
+    }
+
+    return SetCpusAcq(cpus);
+}
+
+bool pm::Settings::HandleCpusDisk(const std::string& value)
+{
+    CpuAffinity::CpuSet cpus;
+    if (!CpuAffinity::StrToCpuSet(value, cpus))
+    {
+        Log::LogE("Incorrect CPU list '%s'", value.c_str());
+        return false;
+    }
+
+    return SetCpusDisk(cpus);
+}
+
+bool pm::Settings::HandleCpusWorkers(const std::string& value)
+{
+    CpuAffinity::CpuSet cpus;
+    if (!CpuAffinity::StrToCpuSet(value, cpus))
+    {
+        Log::LogE("Incorrect CPU list '%s'", value.c_str());
+        return false;
+    }
+
+    return SetCpusWorkers(cpus);
+}
+
+bool pm::Settings::HandleCpusAux(const std::string& value)
+{
+    CpuAffinity::CpuSet cpus;
+    if (!CpuAffinity::StrToCpuSet(value, cpus))
+    {
+        Log::LogE("Incorrect CPU list '%s'", value.c_str());
+        return false;
+    }
+
+    return SetCpusAux(cpus);
+}
+
+bool pm::Settings::HandleAcqRtPriority(const std::string& value)
+{
+    unsigned int priority;
+    if (!Utils::StrToNumber<unsigned int>(value, priority))
+        return false;
+
+    return SetAcqRtPriority(priority);
+}
+
 bool pm::Settings::HandleTrackLinkFrames(const std::string& value)
 {
     uint16_t frames;
@@ -1048,6 +1497,31 @@ bool pm::Settings::HandleTrackTrajectory(const std::string& value)
     return SetTrackTrajectoryDuration(duration);
 }
 
+bool pm::Settings::HandlePixelStats(const std::string& value)
+{
+    bool pixelStats;
+    if (value.empty())
+    {
+        pixelStats = true;
+    }
+    else
+    {
+        if (!Utils::StrToBool(value, pixelStats))
+            return false;
+    }
+
+    return SetPixelStats(pixelStats);
+}
+
+bool pm::Settings::HandlePixelStatsCheckpoint(const std::string& value)
+{
+    size_t frames;
+    if (!Utils::StrToNumber<size_t>(value, frames))
+        return false;
+
+    return SetPixelStatsCheckpoint(frames);
+}
+
 bool pm::Settings::HandleColorWbScaleRed(const std::string& value)
 {
     float scale;
@@ -61,6 +61,8 @@ public: // To be called by anyone
     bool SetAcqFrameCount(uint32_t value);
     bool SetBufferFrameCount(uint32_t value);
     bool SetAllocatorType(AllocatorType value);
+    bool SetAllocatorLock(bool value);
+    bool SetAllocatorPrefault(bool value);
 
     bool SetBinningSerial(uint16_t value);
     bool SetBinningParallel(uint16_t value);
@@ -70,6 +72,7 @@ public: // To be called by anyone
     bool SetVtmExposures(const std::vector<uint16_t>& value);
     bool SetAcqMode(AcqMode value);
     bool SetTimeLapseDelay(unsigned int value);
+    bool SetAcqZeroCopy(bool value);
 
     bool SetStorageType(StorageType value);
     bool SetSaveDir(const std::string& value);
@@ -78,12 +81,26 @@ public: // To be called by anyone
     bool SetSaveFirst(size_t value);
     bool SetSaveLast(size_t value);
     bool SetMaxStackSize(size_t value);
+    bool SetSaveThreadCount(uint16_t value);
+    bool SetSaveIoQueueDepth(uint16_t value);
+    bool SetSaveSpillDir(const std::string& value);
+    bool SetSavePreTrigger(size_t value);
+    bool SetSavePostTrigger(size_t value);
+
+    bool SetCpusAcq(const std::vector<unsigned int>& value);
+    bool SetCpusDisk(const std::vector<unsigned int>& value);
+    bool SetCpusWorkers(const std::vector<unsigned int>& value);
+    bool SetCpusAux(const std::vector<unsigned int>& value);
+    bool SetAcqRtPriority(unsigned int value);
 
     bool SetTrackLinkFrames(uint16_t value);
     bool SetTrackMaxDistance(uint16_t value);
     bool SetTrackCpuOnly(bool value);
     bool SetTrackTrajectoryDuration(uint16_t value);
 
+    bool SetPixelStats(bool value);
+    bool SetPixelStatsCheckpoint(size_t value);
+
     bool SetColorWbScaleRed(float value);
     bool SetColorWbScaleGreen(float value);
     bool SetColorWbScaleBlue(float value);
@@ -100,6 +117,8 @@ private: // To be called indirectly by OptionController only (CLI options parsin
     bool HandleAcqFrameCount(const std::string& value);
     bool HandleBufferFrameCount(const std::string& value);
     bool HandleAllocatorType(const std::string& value);
+    bool HandleAllocatorLock(const std::string& value);
+    bool HandleAllocatorPrefault(const std::string& value);
 
     bool HandleBinningSerial(const std::string& value);
     bool HandleBinningParallel(const std::string& value);
@@ -109,6 +128,7 @@ private: // To be called indirectly by OptionController only (CLI options parsin
     bool HandleVtmExposures(const std::string& value);
     bool HandleAcqMode(const std::string& value);
     bool HandleTimeLapseDelay(const std::string& value);
+    bool HandleAcqZeroCopy(const std::string& value);
 
     bool HandleStorageType(const std::string& value);
     bool HandleSaveDir(const std::string& value);
@@ -117,12 +137,26 @@ private: // To be called indirectly by OptionController only (CLI options parsin
     bool HandleSaveFirst(const std::string& value);
     bool HandleSaveLast(const std::string& value);
     bool HandleMaxStackSize(const std::string& value);
+    bool HandleSaveThreadCount(const std::string& value);
+    bool HandleSaveIoQueueDepth(const std::string& value);
+    bool HandleSaveSpillDir(const std::string& value);
+    bool HandleSavePreTrigger(const std::string& value);
+    bool HandleSavePostTrigger(const std::string& value);
+
+    bool HandleCpusAcq(const std::string& value);
+    bool HandleCpusDisk(const std::string& value);
+    bool HandleCpusWorkers(const std::string& value);
+    bool HandleCpusAux(const std::string& value);
+    bool HandleAcqRtPriority(const std::string& value);
 
     bool HandleTrackLinkFrames(const std::string& value);
     bool HandleTrackMaxDistance(const std::string& value);
     bool HandleTrackCpuOnly(const std::string& value);
     bool HandleTrackTrajectory(const std::string& value);
 
+    bool HandlePixelStats(const std::string& value);
+    bool HandlePixelStatsCheckpoint(const std::string& value);
+
     bool HandleColorWbScaleRed(const std::string& value);
     bool HandleColorWbScaleGreen(const std::string& value);
     bool HandleColorWbScaleBlue(const std::string& value);
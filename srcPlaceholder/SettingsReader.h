@@ -90,6 +90,10 @@ public:
     { return m_bufferFrameCount; }
     AllocatorType GetAllocatorType() const
     { return m_allocatorType; }
+    bool GetAllocatorLock() const
+    { return m_allocatorLock; }
+    bool GetAllocatorPrefault() const
+    { return m_allocatorPrefault; }
 
     uint16_t GetBinningSerial() const
     { return m_binSer; }
@@ -108,6 +112,8 @@ public:
     { return m_acqMode; }
     unsigned int GetTimeLapseDelay() const
     { return m_timeLapseDelay; }
+    bool GetAcqZeroCopy() const
+    { return m_acqZeroCopy; }
 
     StorageType GetStorageType() const
     { return m_storageType; }
@@ -123,6 +129,27 @@ public:
     { return m_saveLast; }
     size_t GetMaxStackSize() const
     { return m_maxStackSize; }
+    uint16_t GetSaveThreadCount() const
+    { return m_saveThreadCount; }
+    uint16_t GetSaveIoQueueDepth() const
+    { return m_saveIoQueueDepth; }
+    const std::string& GetSaveSpillDir() const
+    { return m_saveSpillDir; }
+    size_t GetSavePreTrigger() const
+    { return m_savePreTrigger; }
+    size_t GetSavePostTrigger() const
+    { return m_savePostTrigger; }
+
+    const std::vector<unsigned int>& GetCpusAcq() const
+    { return m_cpusAcq; }
+    const std::vector<unsigned int>& GetCpusDisk() const
+    { return m_cpusDisk; }
+    const std::vector<unsigned int>& GetCpusWorkers() const
+    { return m_cpusWorkers; }
+    const std::vector<unsigned int>& GetCpusAux() const
+    { return m_cpusAux; }
+    unsigned int GetAcqRtPriority() const
+    { return m_acqRtPriority; }
 
     uint16_t GetTrackLinkFrames() const
     { return m_trackLinkFrames; }
@@ -133,6 +160,11 @@ public:
     uint16_t GetTrackTrajectoryDuration() const
     { return m_trackTrajectoryDuration; }
 
+    bool GetPixelStats() const
+    { return m_pixelStats; }
+    size_t GetPixelStatsCheckpoint() const
+    { return m_pixelStatsCheckpoint; }
+
     float GetColorWbScaleRed() const
     { return m_colorWbScaleRed; }
     float GetColorWbScaleGreen() const
@@ -158,6 +190,8 @@ protected: // The only place where are specified default values
     uint32_t m_acqFrameCount{ 1 };
     uint32_t m_bufferFrameCount{ 50 };
     AllocatorType m_allocatorType{ AllocatorType::Align4k };
+    bool m_allocatorLock{ false };
+    bool m_allocatorPrefault{ false };
 
     uint16_t m_binSer{ 1 };
     uint16_t m_binPar{ 1 };
@@ -167,6 +201,7 @@ protected: // The only place where are specified default values
     std::vector<uint16_t> m_vtmExposures{ 10, 20, 30 };
     AcqMode m_acqMode{ AcqMode::SnapSequence };
     unsigned int m_timeLapseDelay{ 0 };
+    bool m_acqZeroCopy{ false };
 
     StorageType m_storageType{ StorageType::None };
     std::string m_saveDir{};
@@ -175,12 +210,27 @@ protected: // The only place where are specified default values
     size_t m_saveFirst{ 0 };
     size_t m_saveLast{ 0 };
     size_t m_maxStackSize{ 0 };
+    uint16_t m_saveThreadCount{ 1 };
+    uint16_t m_saveIoQueueDepth{ 0 };
+    std::string m_saveSpillDir{};
+    size_t m_savePreTrigger{ 0 };
+    size_t m_savePostTrigger{ 0 };
+
+    // Empty CPU list means no restriction
+    std::vector<unsigned int> m_cpusAcq{};
+    std::vector<unsigned int> m_cpusDisk{};
+    std::vector<unsigned int> m_cpusWorkers{};
+    std::vector<unsigned int> m_cpusAux{};
+    unsigned int m_acqRtPriority{ 0 }; // Zero for normal scheduling
 
     uint16_t m_trackLinkFrames{ 2 };
     uint16_t m_trackMaxDistance{ 25 };
     bool m_trackCpuOnly{ false };
     uint16_t m_trackTrajectoryDuration{ 10 };
 
+    bool m_pixelStats{ false };
+    size_t m_pixelStatsCheckpoint{ 0 }; // Zero for checkpoint at the end only
+
     float m_colorWbScaleRed{ 1.0 };
     float m_colorWbScaleGreen{ 1.0 };
     float m_colorWbScaleBlue{ 1.0 };
@@ -0,0 +1,199 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/SpillFile.h"
+
+/* Local */
+#include "backend/AllocatorFactory.h"
+
+/* System */
+#include <cstring>
+#include <limits>
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <fcntl.h> // open
+    #include <unistd.h> // pread, pwrite, unlink
+#endif
+
+// Covers sector size of common disks, direct I/O needs offsets, sizes and
+// buffers aligned to it
+static const size_t sSlotAlignment =
+    pm::AllocatorFactory::GetAlignment(pm::AllocatorType::Align4k);
+
+pm::SpillFile::SpillFile(const std::string& fileName, size_t frameBytes)
+    : m_fileName(fileName),
+    m_frameBytes(frameBytes),
+    m_slotBytes(((frameBytes + sSlotAlignment - 1) / sSlotAlignment) * sSlotAlignment)
+{
+}
+
+pm::SpillFile::~SpillFile()
+{
+    Close();
+}
+
+const std::string& pm::SpillFile::GetFileName() const
+{
+    return m_fileName;
+}
+
+size_t pm::SpillFile::GetSlotBytes() const
+{
+    return m_slotBytes;
+}
+
+bool pm::SpillFile::Open()
+{
+    if (IsOpen())
+        return true;
+
+    if (m_slotBytes == 0)
+        return false;
+
+    m_allocator = AllocatorFactory::Create(AllocatorType::Align4k);
+    if (!m_allocator)
+        return false;
+    m_writeBuffer = m_allocator->Allocate(m_slotBytes);
+    m_readBuffer = m_allocator->Allocate(m_slotBytes);
+    if (!m_writeBuffer || !m_readBuffer)
+    {
+        Close();
+        return false;
+    }
+
+#ifdef _WIN32
+    HANDLE file = ::CreateFileA(m_fileName.c_str(),
+            GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+            FILE_FLAG_NO_BUFFERING | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        Close();
+        return false;
+    }
+#else
+    const int flags = O_RDWR | O_CREAT | O_TRUNC;
+    const mode_t mode = S_IRUSR | S_IWUSR;
+    int file = ::open(m_fileName.c_str(), flags | O_DIRECT, mode);
+    if (file == -1)
+    {
+        // Some file systems (e.g. tmpfs) don't support direct I/O
+        file = ::open(m_fileName.c_str(), flags, mode);
+    }
+    if (file == -1)
+    {
+        Close();
+        return false;
+    }
+    // The data is accessible via descriptor only, nothing is left on crash
+    ::unlink(m_fileName.c_str());
+#endif
+    m_file = file;
+
+    return true;
+}
+
+bool pm::SpillFile::IsOpen() const
+{
+#ifdef _WIN32
+    return (m_file != INVALID_HANDLE_VALUE);
+#else
+    return (m_file > -1);
+#endif
+}
+
+void pm::SpillFile::Close()
+{
+    if (IsOpen())
+    {
+#ifdef _WIN32
+        HANDLE file = static_cast<HANDLE>(m_file);
+        ::CloseHandle(file);
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        ::close(m_file);
+        m_file = -1;
+#endif
+    }
+
+    if (m_allocator)
+    {
+        m_allocator->Free(m_writeBuffer);
+        m_allocator->Free(m_readBuffer);
+        m_allocator = nullptr;
+    }
+    m_writeBuffer = nullptr;
+    m_readBuffer = nullptr;
+}
+
+bool pm::SpillFile::Write(uint64_t offset, const void* data)
+{
+    if (!IsOpen() || !data)
+        return false;
+
+    // Avoid extra copy if caller's buffer is good enough for direct I/O
+    const bool isAligned = m_slotBytes == m_frameBytes
+        && ((uintptr_t)data % sSlotAlignment) == 0;
+    if (isAligned)
+        return OsWrite(offset, data, m_slotBytes);
+
+    std::memcpy(m_writeBuffer, data, m_frameBytes);
+    return OsWrite(offset, m_writeBuffer, m_slotBytes);
+}
+
+bool pm::SpillFile::Read(uint64_t offset, void* data)
+{
+    if (!IsOpen() || !data)
+        return false;
+
+    const bool isAligned = m_slotBytes == m_frameBytes
+        && ((uintptr_t)data % sSlotAlignment) == 0;
+    if (isAligned)
+        return OsRead(offset, data, m_slotBytes);
+
+    if (!OsRead(offset, m_readBuffer, m_slotBytes))
+        return false;
+    std::memcpy(data, m_readBuffer, m_frameBytes);
+    return true;
+}
+
+bool pm::SpillFile::OsWrite(uint64_t offset, const void* data, size_t bytes)
+{
+#ifdef _WIN32
+    if (bytes > (std::numeric_limits<DWORD>::max)())
+        return false;
+    OVERLAPPED ov{};
+    ov.Offset = (DWORD)(offset & 0xFFFFFFFF);
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD bytesWritten = 0;
+    HANDLE file = static_cast<HANDLE>(m_file);
+    return (::WriteFile(file, data, (DWORD)bytes, &bytesWritten, &ov) == TRUE
+            && bytes == bytesWritten);
+#else
+    if (bytes > (std::numeric_limits<ssize_t>::max)())
+        return false;
+    return (::pwrite(m_file, data, bytes, (off_t)offset) == (ssize_t)bytes);
+#endif
+}
+
+bool pm::SpillFile::OsRead(uint64_t offset, void* data, size_t bytes)
+{
+#ifdef _WIN32
+    if (bytes > (std::numeric_limits<DWORD>::max)())
+        return false;
+    OVERLAPPED ov{};
+    ov.Offset = (DWORD)(offset & 0xFFFFFFFF);
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD bytesRead = 0;
+    HANDLE file = static_cast<HANDLE>(m_file);
+    return (::ReadFile(file, data, (DWORD)bytes, &bytesRead, &ov) == TRUE
+            && bytes == bytesRead);
+#else
+    if (bytes > (std::numeric_limits<ssize_t>::max)())
+        return false;
+    return (::pread(m_file, data, bytes, (off_t)offset) == (ssize_t)bytes);
+#endif
+}
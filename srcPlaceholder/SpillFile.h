@@ -0,0 +1,75 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_SPILL_FILE_H
+#define PM_SPILL_FILE_H
+
+/* Local */
+#include "backend/Allocator.h"
+
+/* System */
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace pm {
+
+/* Scratch file for raw frame data that doesn't fit in RAM.
+   Frames are stored in equally sized slots, each slot aligned to 4kB so the
+   file can be accessed bypassing system cache (O_DIRECT on Linux,
+   FILE_FLAG_NO_BUFFERING on Windows). Data at unaligned address is copied
+   via internal buffer.
+   The file is removed from disk by Close at latest, on Linux right after it
+   is created so it never outlives the process.
+   Write may be called from one thread and Read from another one at the same
+   time, each of them from one thread only. */
+class SpillFile final
+{
+public:
+    explicit SpillFile(const std::string& fileName, size_t frameBytes);
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+public:
+    const std::string& GetFileName() const;
+    // Size of one slot in file, frame bytes rounded up to the alignment
+    size_t GetSlotBytes() const;
+
+    bool Open();
+    bool IsOpen() const;
+    void Close();
+
+    // Stores frame data at given offset, the offset has to be multiple of
+    // slot size
+    bool Write(uint64_t offset, const void* data);
+    // Loads frame data from given offset written by Write before
+    bool Read(uint64_t offset, void* data);
+
+private:
+    bool OsWrite(uint64_t offset, const void* data, size_t bytes);
+    bool OsRead(uint64_t offset, void* data, size_t bytes);
+
+private:
+    const std::string m_fileName;
+    const size_t m_frameBytes;
+    const size_t m_slotBytes;
+
+    std::shared_ptr<Allocator> m_allocator{ nullptr };
+    // Aligned buffers for unaligned frame data, one per calling thread
+    void* m_writeBuffer{ nullptr };
+    void* m_readBuffer{ nullptr };
+
+#ifdef _WIN32
+    void* m_file{ (void*)-1/*INVALID_HANDLE_VALUE*/ };
+#else
+    int m_file{ -1 };
+#endif
+};
+
+} // namespace pm
+
+#endif /* PM_SPILL_FILE_H */
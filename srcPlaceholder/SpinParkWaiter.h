@@ -0,0 +1,133 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_SPIN_PARK_WAITER_H
+#define PM_SPIN_PARK_WAITER_H
+
+/* System */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    #include <emmintrin.h> // _mm_pause
+    #define PM_SPIN_PARK_WAITER_CPU_RELAX() _mm_pause()
+#else
+    #define PM_SPIN_PARK_WAITER_CPU_RELAX() std::this_thread::yield()
+#endif
+
+namespace pm {
+
+/* Lets one consumer thread wait for data published by lock-free producer.
+   The consumer spins for a while first and parks on condition variable only
+   if the data doesn't arrive soon. The spin phase gets longer each time the
+   data arrives while spinning and shorter each time the consumer had to park.
+   The producer touches the mutex only if the consumer is really parked. */
+class SpinParkWaiter final
+{
+public:
+    SpinParkWaiter()
+    {}
+
+    SpinParkWaiter(const SpinParkWaiter&) = delete;
+    SpinParkWaiter& operator=(const SpinParkWaiter&) = delete;
+
+public: // Consumer side
+    /* Blocks until the ready predicate returns true or timeout elapses.
+       Returns false on timeout only. */
+    template<typename Rep, typename Period, typename Predicate>
+    bool Wait(const std::chrono::duration<Rep, Period>& timeout,
+            Predicate ready)
+    {
+        if (Spin(ready))
+            return true;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_parked.store(true, std::memory_order_relaxed);
+        // Pairs with the fence in Notify
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool isReady = m_cond.wait_for(lock, timeout, ready);
+        m_parked.store(false, std::memory_order_relaxed);
+        return isReady;
+    }
+
+    /* Blocks until the ready predicate returns true. */
+    template<typename Predicate>
+    void Wait(Predicate ready)
+    {
+        if (Spin(ready))
+            return;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_parked.store(true, std::memory_order_relaxed);
+        // Pairs with the fence in Notify
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_cond.wait(lock, ready);
+        m_parked.store(false, std::memory_order_relaxed);
+    }
+
+public: // Producer side
+    /* Has to be called after the data has been published, i.e. after the
+       atomic store that changes result of consumer's ready predicate.
+       It's cheap if consumer is not parked. */
+    void Notify()
+    {
+        // Pairs with the fence in Wait, either we see the consumer parked
+        // or the consumer sees published data before it falls asleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_parked.load(std::memory_order_relaxed))
+        {
+            WakeUp();
+        }
+    }
+
+    /* Wakes up parked consumer unconditionally, e.g. when the predicate
+       depends on some other flag. Can be called from any thread. */
+    void WakeUp()
+    {
+        {
+            // Empty lock ensures the consumer is either before its predicate
+            // check or already waiting so the notification cannot be lost
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        m_cond.notify_one();
+    }
+
+private:
+    template<typename Predicate>
+    bool Spin(Predicate& ready)
+    {
+        for (size_t n = 0; n < m_spinCount; ++n)
+        {
+            if (ready())
+            {
+                m_spinCount = (m_spinCount < cMaxSpinCount / 2)
+                    ? m_spinCount * 2 : cMaxSpinCount;
+                return true;
+            }
+            PM_SPIN_PARK_WAITER_CPU_RELAX();
+        }
+        m_spinCount = (m_spinCount > cMinSpinCount * 2)
+            ? m_spinCount / 2 : cMinSpinCount;
+        return false;
+    }
+
+private:
+    static constexpr size_t cMinSpinCount = 16;
+    static constexpr size_t cMaxSpinCount = 4096;
+
+    // Used by consumer only
+    size_t m_spinCount{ cMinSpinCount };
+
+    std::atomic<bool> m_parked{ false };
+    std::mutex m_mutex{};
+    std::condition_variable m_cond{};
+};
+
+} // namespace pm
+
+#endif /* PM_SPIN_PARK_WAITER_H */
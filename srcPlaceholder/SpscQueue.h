@@ -0,0 +1,233 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_SPSC_QUEUE_H
+#define PM_SPSC_QUEUE_H
+
+/* Local */
+#include "backend/SpinParkWaiter.h"
+
+/* System */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace pm {
+
+/* Unbounded lock-free queue for exactly one producer and one consumer.
+   Push may be called from one thread only, Pop, PopBatch and WaitForItems
+   from another one. Items are stored in linked blocks, the one block
+   released by consumer is cached for producer to avoid heap usage in steady
+   state. The consumer waits adaptively, see SpinParkWaiter for details.
+   Any capacity limit has to be checked by the producer before Push. */
+template<typename T>
+class SpscQueue final
+{
+public:
+    SpscQueue()
+    {}
+
+    ~SpscQueue()
+    {
+        Clear();
+        delete m_headBlock;
+        delete m_spareBlock.load(std::memory_order_relaxed);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+public:
+    /* Releases all queued items.
+       Not thread-safe, producer and consumer must not be active. */
+    void Clear()
+    {
+        T item;
+        while (Pop(item))
+            item = T();
+    }
+
+    /* Returns number of queued items. Called concurrently with Push or Pop
+       the value is a snapshot that might be outdated right away. */
+    size_t GetSize() const
+    {
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool IsEmpty() const
+    {
+        return GetSize() == 0;
+    }
+
+public: // Producer side
+    /* Appends new item at the end and wakes up parked consumer.
+       Returns false if new block couldn't be allocated, the item is left
+       untouched then. */
+    bool Push(T& item)
+    {
+        if (!m_tailBlock)
+        {
+            // First push ever, consumer hasn't touched head block yet
+            m_tailBlock = new(std::nothrow) Block();
+            if (!m_tailBlock)
+                return false;
+            m_headBlock = m_tailBlock;
+        }
+        else if (m_tailIndex == cBlockSize)
+        {
+            Block* block = m_spareBlock.exchange(nullptr, std::memory_order_acquire);
+            if (!block)
+            {
+                block = new(std::nothrow) Block();
+                if (!block)
+                    return false;
+            }
+            block->next = nullptr;
+            // Made visible to consumer by release store to m_tail below
+            m_tailBlock->next = block;
+            m_tailBlock = block;
+            m_tailIndex = 0;
+        }
+
+        m_tailBlock->items[m_tailIndex++] = std::move(item);
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+
+        m_waiter.Notify();
+        return true;
+    }
+
+public: // Consumer side
+    /* Moves the oldest item out of the queue.
+       Returns false if the queue is empty. */
+    bool Pop(T& item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+
+        item = TakeFront();
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Moves up to maxCount oldest items to the end of given vector.
+       All items are taken with one synchronization with producer.
+       Returns number of items added to the vector. */
+    size_t PopBatch(std::vector<T>& items, size_t maxCount)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        const size_t count = std::min(tail - head, maxCount);
+
+        for (size_t n = 0; n < count; ++n)
+        {
+            items.push_back(TakeFront());
+        }
+
+        if (count > 0)
+        {
+            m_head.store(head + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    /* Blocks until some item is queued, the stopWaiting predicate returns
+       true or timeout elapses. Returns false on timeout only. */
+    template<typename Rep, typename Period, typename Predicate>
+    bool WaitForItems(const std::chrono::duration<Rep, Period>& timeout,
+            Predicate stopWaiting)
+    {
+        return m_waiter.Wait(timeout, [&]() {
+            return HasItemsForConsumer() || stopWaiting();
+        });
+    }
+
+    /* Blocks until some item is queued or the stopWaiting predicate returns
+       true. */
+    template<typename Predicate>
+    void WaitForItems(Predicate stopWaiting)
+    {
+        m_waiter.Wait([&]() {
+            return HasItemsForConsumer() || stopWaiting();
+        });
+    }
+
+public:
+    /* Wakes up parked consumer, e.g. when its stop predicate has changed.
+       Can be called from any thread. */
+    void WakeUp()
+    {
+        m_waiter.WakeUp();
+    }
+
+private:
+    static constexpr size_t cBlockSize = 256;
+    static constexpr size_t cCacheLineSize = 64;
+
+    struct Block
+    {
+        T items[cBlockSize]{};
+        Block* next{ nullptr };
+    };
+
+private:
+    bool HasItemsForConsumer() const
+    {
+        return m_tail.load(std::memory_order_acquire)
+            != m_head.load(std::memory_order_relaxed);
+    }
+
+    // Caller has to ensure there is at least one item
+    T TakeFront()
+    {
+        if (m_headIndex == cBlockSize)
+        {
+            Block* block = m_headBlock;
+            m_headBlock = block->next;
+            m_headIndex = 0;
+            // Keep one block for producer, release others
+            Block* spare = nullptr;
+            if (!m_spareBlock.compare_exchange_strong(spare, block,
+                        std::memory_order_release, std::memory_order_relaxed))
+            {
+                delete block;
+            }
+        }
+
+        T& slot = m_headBlock->items[m_headIndex++];
+        T item = std::move(slot);
+        slot = T(); // Release resources held by moved-from item right away
+        return item;
+    }
+
+private:
+    // Consumer side
+    Block* m_headBlock{ nullptr };
+    size_t m_headIndex{ 0 };
+    std::atomic<size_t> m_head{ 0 };
+
+    // Producer side, padded to avoid false sharing with consumer
+    char m_padProducer[cCacheLineSize]{};
+    Block* m_tailBlock{ nullptr };
+    size_t m_tailIndex{ 0 };
+    std::atomic<size_t> m_tail{ 0 };
+
+    // Block recycled by consumer for producer
+    char m_padSpare[cCacheLineSize]{};
+    std::atomic<Block*> m_spareBlock{ nullptr };
+
+    // Parking, used only if consumer runs out of spins
+    char m_padWaiter[cCacheLineSize]{};
+    SpinParkWaiter m_waiter{};
+};
+
+} // namespace pm
+
+#endif /* PM_SPSC_QUEUE_H */
@@ -0,0 +1,188 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_SPSC_RING_H
+#define PM_SPSC_RING_H
+
+/* Local */
+#include "backend/SpinParkWaiter.h"
+
+/* System */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace pm {
+
+/* Bounded lock-free ring buffer for exactly one producer and one consumer.
+   Push may be called from one thread only, Pop and WaitForItems from another
+   one. The consumer waits adaptively, see SpinParkWaiter for details. */
+template<typename T>
+class SpscRing final
+{
+public:
+    SpscRing()
+    {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+public:
+    /* Drops all queued items and sets new capacity, auto-corrected to be
+       min. 1. The buffer is reallocated only if the capacity has changed.
+       Not thread-safe, producer and consumer must not be active. */
+    bool Setup(size_t capacity)
+    {
+        capacity = std::max<size_t>(1, capacity);
+        if (m_slots && capacity == m_capacity)
+        {
+            Clear();
+            return true;
+        }
+
+        size_t slotCount = 1;
+        while (slotCount < capacity)
+            slotCount <<= 1;
+
+        m_slots.reset(new(std::nothrow) T[slotCount]);
+        if (!m_slots)
+        {
+            m_mask = 0;
+            m_capacity = 0;
+            return false;
+        }
+        m_mask = slotCount - 1;
+        m_capacity = capacity;
+
+        m_head.store(0, std::memory_order_relaxed);
+        m_tailCached = 0;
+        m_tail.store(0, std::memory_order_relaxed);
+        m_headCached = 0;
+        return true;
+    }
+
+    /* Releases all queued items.
+       Not thread-safe, producer and consumer must not be active. */
+    void Clear()
+    {
+        T item;
+        while (Pop(item))
+            item = T();
+    }
+
+    // Returns max. number of items the ring can hold
+    size_t GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    /* Returns number of queued items. Called concurrently with Push or Pop
+       the value is a snapshot that might be outdated right away. */
+    size_t GetSize() const
+    {
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool IsEmpty() const
+    {
+        return GetSize() == 0;
+    }
+
+public: // Producer side
+    /* Appends new item at the end and wakes up parked consumer.
+       Returns false if the ring is full, the item is left untouched then. */
+    bool Push(T& item)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headCached >= m_capacity)
+        {
+            m_headCached = m_head.load(std::memory_order_acquire);
+            if (tail - m_headCached >= m_capacity)
+                return false;
+        }
+
+        m_slots[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+
+        m_waiter.Notify();
+        return true;
+    }
+
+public: // Consumer side
+    /* Moves the oldest item out of the ring.
+       Returns false if the ring is empty. */
+    bool Pop(T& item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tailCached)
+        {
+            m_tailCached = m_tail.load(std::memory_order_acquire);
+            if (head == m_tailCached)
+                return false;
+        }
+
+        T& slot = m_slots[head & m_mask];
+        item = std::move(slot);
+        slot = T(); // Release resources held by moved-from item right away
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Blocks until some item is queued, the stopWaiting predicate returns
+       true or timeout elapses. Returns false on timeout only. */
+    template<typename Rep, typename Period, typename Predicate>
+    bool WaitForItems(const std::chrono::duration<Rep, Period>& timeout,
+            Predicate stopWaiting)
+    {
+        return m_waiter.Wait(timeout, [&]() {
+            return HasItemsForConsumer() || stopWaiting();
+        });
+    }
+
+public:
+    /* Wakes up parked consumer, e.g. when its stop predicate has changed.
+       Can be called from any thread. */
+    void WakeUp()
+    {
+        m_waiter.WakeUp();
+    }
+
+private:
+    bool HasItemsForConsumer() const
+    {
+        return m_tail.load(std::memory_order_acquire)
+            != m_head.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t cCacheLineSize = 64;
+
+    // Members read by both sides but changed by Setup only
+    std::unique_ptr<T[]> m_slots{};
+    size_t m_mask{ 0 };
+    size_t m_capacity{ 0 };
+
+    // Consumer side, padded to avoid false sharing with producer
+    char m_padConsumer[cCacheLineSize]{};
+    std::atomic<size_t> m_head{ 0 };
+    size_t m_tailCached{ 0 };
+
+    // Producer side, padded to avoid false sharing with consumer
+    char m_padProducer[cCacheLineSize]{};
+    std::atomic<size_t> m_tail{ 0 };
+    size_t m_headCached{ 0 };
+
+    // Parking, used only if consumer runs out of spins
+    char m_padWaiter[cCacheLineSize]{};
+    SpinParkWaiter m_waiter{};
+};
+
+} // namespace pm
+
+#endif /* PM_SPSC_RING_H */
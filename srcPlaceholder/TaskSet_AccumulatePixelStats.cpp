@@ -0,0 +1,111 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/TaskSet_AccumulatePixelStats.h"
+
+/* Local */
+#include "backend/Bitmap.h"
+#include "backend/exceptions/Exception.h"
+
+/* System */
+#include <cassert>
+
+// Chunks start at multiple of 64 pixels so tasks don't share cache lines
+static constexpr size_t cChunkAlignPixels = 64;
+
+// TaskSet_AccumulatePixelStats::Task
+
+pm::TaskSet_AccumulatePixelStats::ATask::ATask(
+        std::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t taskCount)
+    : pm::Task(semDone, taskIndex, taskCount),
+    m_maxTasks(taskCount)
+{
+}
+
+void pm::TaskSet_AccumulatePixelStats::ATask::SetUp(const Bitmap* bmp,
+        PixelStats* stats)
+{
+    const size_t dataBytes = bmp->GetDataBytes();
+
+    m_maxTasks = (dataBytes < 4096)
+        ? (dataBytes == 0) ? 0 : 1
+        : GetTaskCount();
+
+    m_bmp = const_cast<Bitmap*>(bmp);
+    m_stats = stats;
+}
+
+void pm::TaskSet_AccumulatePixelStats::ATask::Execute()
+{
+    assert(m_bmp != nullptr);
+    assert(m_stats != nullptr);
+
+    const size_t taskId = GetTaskIndex();
+    if (taskId >= m_maxTasks)
+        return;
+
+    const size_t pixels = (size_t)m_bmp->GetWidth() * m_bmp->GetHeight();
+
+    const size_t chunkPixels =
+        (pixels / m_maxTasks) & ~(cChunkAlignPixels - 1);
+    const size_t chunkOffset = taskId * chunkPixels;
+    const size_t count = (taskId == m_maxTasks - 1)
+        ? pixels - chunkOffset
+        : chunkPixels;
+
+    m_stats->AddPixels(m_bmp, chunkOffset, count);
+}
+
+// TaskSet_AccumulatePixelStats
+
+pm::TaskSet_AccumulatePixelStats::TaskSet_AccumulatePixelStats(
+        std::shared_ptr<ThreadPool> pool)
+    : TaskSet(pool)
+{
+    CreateTasks<ATask>();
+}
+
+void pm::TaskSet_AccumulatePixelStats::SetUp(const Bitmap* bmp,
+        PixelStats* stats)
+{
+    assert(bmp != nullptr);
+    assert(stats != nullptr);
+
+    const auto& bmpFormat = bmp->GetFormat();
+    if (bmpFormat.GetPixelType() != BitmapPixelType::Mono)
+        throw Exception("Unsupported bitmap pixel type");
+    if (bmpFormat.GetDataType() != BitmapDataType::UInt8
+            && bmpFormat.GetDataType() != BitmapDataType::UInt16)
+        throw Exception("Unsupported bitmap data type");
+    if (bmp->GetWidth() != stats->GetWidth()
+            || bmp->GetHeight() != stats->GetHeight())
+        throw Exception("Bitmap size doesn't match the pixel stats");
+
+    m_stats = stats;
+
+    const auto& tasks = GetTasks();
+    const size_t taskCount = tasks.size();
+    for (size_t n = 0; n < taskCount; ++n)
+    {
+        static_cast<ATask*>(tasks[n])->SetUp(bmp, stats);
+    }
+}
+
+void pm::TaskSet_AccumulatePixelStats::Wait()
+{
+    TaskSet::Wait();
+    m_stats->IncrementFrameCount();
+}
+
+template<typename Rep, typename Period>
+bool pm::TaskSet_AccumulatePixelStats::Wait(
+        const std::chrono::duration<Rep, Period>& timeout)
+{
+    const bool retVal = TaskSet::Wait(timeout);
+    // The frame is complete only if all tasks have finished
+    if (retVal)
+    {
+        m_stats->IncrementFrameCount();
+    }
+    return retVal;
+}
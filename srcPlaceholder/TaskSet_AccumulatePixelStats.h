@@ -0,0 +1,56 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_TASK_SET_ACCUMULATE_PIXEL_STATS_H
+#define PM_TASK_SET_ACCUMULATE_PIXEL_STATS_H
+
+/* Local */
+#include "backend/PixelStats.h"
+#include "backend/Task.h"
+#include "backend/TaskSet.h"
+
+namespace pm {
+
+class Bitmap;
+
+class TaskSet_AccumulatePixelStats : public TaskSet
+{
+private:
+    class ATask final : public Task
+    {
+    public:
+        explicit ATask(std::shared_ptr<Semaphore> semDone, size_t taskIndex,
+                size_t taskCount);
+
+    public:
+        void SetUp(const Bitmap* bmp, PixelStats* stats);
+
+    public: // Task
+        virtual void Execute() override;
+
+    private:
+        size_t m_maxTasks{ 0 };
+        Bitmap* m_bmp{ nullptr }; // Cannot be const to auto-generate assignment operator
+        PixelStats* m_stats{ nullptr };
+    };
+
+public:
+    explicit TaskSet_AccumulatePixelStats(std::shared_ptr<ThreadPool> pool);
+
+public:
+    // Adds the bitmap as new frame to the stats of same size
+    void SetUp(const Bitmap* bmp, PixelStats* stats);
+
+public: // TaskSet
+    virtual void Wait() override;
+    template<typename Rep, typename Period>
+    bool Wait(const std::chrono::duration<Rep, Period>& timeout);
+
+private:
+    PixelStats* m_stats{ nullptr };
+};
+
+} // namespace pm
+
+#endif /* PM_TASK_SET_ACCUMULATE_PIXEL_STATS_H */
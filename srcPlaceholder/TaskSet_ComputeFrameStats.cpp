@@ -5,13 +5,18 @@
 
 /* Local */
 #include "backend/Bitmap.h"
+#include "backend/PixelKernels.h"
 #include "backend/exceptions/Exception.h"
 
 /* System */
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <numeric>
 
+// Definition is needed before C++17 if bound to reference, e.g. by std::min
+constexpr size_t pm::TaskSet_ComputeFrameStats::cBlockPixels;
+
 // TaskSet_ComputeFrameStats::Task
 
 pm::TaskSet_ComputeFrameStats::ATask::ATask(
@@ -78,29 +83,16 @@ void pm::TaskSet_ComputeFrameStats::ATask::ExecuteT(
         size_t chunkOffset, size_t chunkPixels)
 {
     const T* dataStart = static_cast<T*>(m_bmp->GetData()) + chunkOffset;
-    const T* dataEnd = dataStart + chunkPixels;
-
-    T min = *dataStart;
-    T max = *dataStart;
-    double M1 = *dataStart; // mean
-    double M2 = 0.0;
-    uint32_t n = 1;
 
-    for (const T* data = dataStart + 1; data < dataEnd; data++)
+    FrameStats blockStats;
+    for (size_t offset = 0; offset < chunkPixels; offset += cBlockPixels)
     {
-        if (min > *data)
-            min = *data;
-        else if (max < *data)
-            max = *data;
-        n++;
-        const double delta = *data - M1;
-        const double delta_n = delta / n;
-        M2 = M2 + delta_n * (n - 1) * delta;
-        M1 = M1 + delta_n;
-    }
+        const T* block = dataStart + offset;
+        const size_t blockPixels = std::min(cBlockPixels, chunkPixels - offset);
 
-    m_stats->SetDirectly(static_cast<uint32_t>(chunkPixels),
-            static_cast<double>(min), static_cast<double>(max), M1, M2);
+        ComputeBlockStats(block, blockPixels, blockStats);
+        m_stats->Add(blockStats);
+    }
 }
 
 template<typename T>
@@ -108,28 +100,15 @@ void pm::TaskSet_ComputeFrameStats::ATask::ExecuteT_UpTo16b(
         size_t chunkOffset, size_t chunkPixels)
 {
     const T* dataStart = static_cast<T*>(m_bmp->GetData()) + chunkOffset;
-    const T* dataEnd = dataStart + chunkPixels;
 
-    T min = *dataStart;
-    T max = *dataStart;
-    // For 16b utilizes max. 48 bits - W(16b)*H(16b)*P(16b)
-    uint64_t sum = *dataStart;
-    // For 16b utilizes all  64 bits - W(16b)*H(16b)*P(16b)*P(16b)
-    uint64_t sumSq = uint64_t(*dataStart) * *dataStart;
-
-    for (const T* data = dataStart + 1; data < dataEnd; data++)
-    {
-        if (min > *data)
-            min = *data;
-        else if (max < *data)
-            max = *data;
-        sum += *data;
-        sumSq += uint64_t(*data) * *data;
-    }
+    // For 16b the sum utilizes max. 48 bits - W(16b)*H(16b)*P(16b)
+    // and the sum of squares all 64 bits - W(16b)*H(16b)*P(16b)*P(16b)
+    PixelKernels::Sums sums;
+    PixelKernels::ComputeSums(dataStart, chunkPixels, sums);
 
     m_stats->SetViaSums(static_cast<uint32_t>(chunkPixels),
-            static_cast<double>(min), static_cast<double>(max),
-            static_cast<double>(sum), static_cast<double>(sumSq));
+            static_cast<double>(sums.min), static_cast<double>(sums.max),
+            static_cast<double>(sums.sum), static_cast<double>(sums.sumSq));
 }
 
 // TaskSet_ComputeFrameStats
@@ -163,6 +142,43 @@ void pm::TaskSet_ComputeFrameStats::SetUp(const Bitmap* bmp, FrameStats* stats)
     }
 }
 
+void pm::TaskSet_ComputeFrameStats::ComputeBlockStats(const uint32_t* block,
+        size_t blockPixels, FrameStats& stats)
+{
+    assert(blockPixels <= cBlockPixels);
+
+    if (blockPixels == 0)
+    {
+        stats.Clear();
+        return;
+    }
+
+    PixelKernels::Sums sums;
+    PixelKernels::ComputeMinMaxSum(block, blockPixels, sums);
+    const double mean = static_cast<double>(sums.sum) / blockPixels;
+
+    // More accumulators to not wait for previous addition
+    double M2[4] = { 0.0, 0.0, 0.0, 0.0 };
+    size_t n = 0;
+    for (; n + 4 <= blockPixels; n += 4)
+    {
+        for (size_t k = 0; k < 4; ++k)
+        {
+            const double delta = block[n + k] - mean;
+            M2[k] += delta * delta;
+        }
+    }
+    for (; n < blockPixels; ++n)
+    {
+        const double delta = block[n] - mean;
+        M2[0] += delta * delta;
+    }
+
+    stats.SetDirectly(static_cast<uint32_t>(blockPixels),
+            static_cast<double>(sums.min), static_cast<double>(sums.max),
+            mean, (M2[0] + M2[1]) + (M2[2] + M2[3]));
+}
+
 void pm::TaskSet_ComputeFrameStats::Wait()
 {
     TaskSet::Wait();
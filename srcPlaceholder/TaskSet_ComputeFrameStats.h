@@ -34,8 +34,10 @@ private:
         virtual void Execute() override;
 
     private:
-        // Uses generic one-pass algorithm with real numbers as described in
-        // Higher-order statistics chapter on wikipedia.
+        // Splits the chunk to blocks small enough to stay in L1 cache.
+        // Each block gets min., max. and exact integral sum in one pass and
+        // sum of squared deviations from its mean in second pass. Blocks are
+        // combined with parallel algorithm described on wikipedia.
         template<typename T>
         void ExecuteT(size_t chunkOffset, size_t chunkPixels);
 
@@ -56,6 +58,15 @@ public:
 public:
     void SetUp(const Bitmap* bmp, FrameStats* stats);
 
+public:
+    // 16kB of 32-bit pixels, the second pass reads them from L1 cache
+    static constexpr size_t cBlockPixels = 4096;
+
+    // Computes stats of one block of up to cBlockPixels pixels with any bit
+    // depth, in two passes like ExecuteT. Stats are overwritten.
+    static void ComputeBlockStats(const uint32_t* block, size_t blockPixels,
+            FrameStats& stats);
+
 public: // TaskSet
     virtual void Wait() override;
     template<typename Rep, typename Period>
@@ -0,0 +1,187 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/TaskSet_ComputeHistogram.h"
+
+/* Local */
+#include "backend/Bitmap.h"
+#include "backend/PixelKernels.h"
+#include "backend/exceptions/Exception.h"
+
+/* System */
+#include <algorithm>
+#include <cassert>
+
+// Up to 12-bit bins the 4 sub-histograms still fit in L2 cache
+static constexpr uint32_t cMaxSubBins = 4096;
+static constexpr size_t cSubCount = 4;
+
+// TaskSet_ComputeHistogram::Task
+
+pm::TaskSet_ComputeHistogram::ATask::ATask(
+        std::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t taskCount)
+    : pm::Task(semDone, taskIndex, taskCount),
+    m_maxTasks(taskCount)
+{
+}
+
+void pm::TaskSet_ComputeHistogram::ATask::SetUp(const Bitmap* bmp,
+        uint32_t binCount, uint16_t binShift)
+{
+    const size_t dataBytes = bmp->GetDataBytes();
+
+    m_maxTasks = (dataBytes < 4096)
+        ? (dataBytes == 0) ? 0 : 1
+        : GetTaskCount();
+
+    m_bmp = const_cast<Bitmap*>(bmp);
+    m_binCount = binCount;
+    m_binShift = binShift;
+    m_subCount = (binCount <= cMaxSubBins) ? cSubCount : 1;
+}
+
+const uint32_t* pm::TaskSet_ComputeHistogram::ATask::GetBins() const
+{
+    return m_bins.data();
+}
+
+uint64_t pm::TaskSet_ComputeHistogram::ATask::GetPixelCount() const
+{
+    return m_pixelCount;
+}
+
+void pm::TaskSet_ComputeHistogram::ATask::Execute()
+{
+    assert(m_bmp != nullptr);
+
+    m_pixelCount = 0;
+
+    const size_t taskId = GetTaskIndex();
+    if (taskId >= m_maxTasks)
+        return;
+
+    const size_t pixels = (size_t)m_bmp->GetWidth() * m_bmp->GetHeight();
+
+    size_t chunkPixels = pixels / m_maxTasks;
+    const size_t chunkOffset = taskId * chunkPixels;
+    if (taskId == m_maxTasks - 1)
+    {
+        chunkPixels += pixels % m_maxTasks;
+    }
+    if (chunkPixels == 0)
+        return;
+
+    // Allocated once, later only cleared
+    m_bins.resize(m_subCount * m_binCount);
+    std::fill(m_bins.begin(), m_bins.end(), 0);
+
+    switch (m_bmp->GetFormat().GetDataType())
+    {
+    case BitmapDataType::UInt8:
+        ExecuteT<uint8_t>(chunkOffset, chunkPixels);
+        break;
+    case BitmapDataType::UInt16:
+        ExecuteT<uint16_t>(chunkOffset, chunkPixels);
+        break;
+    case BitmapDataType::UInt32:
+        ExecuteT<uint32_t>(chunkOffset, chunkPixels);
+        break;
+    default:
+        throw Exception("Unsupported bitmap data type");
+    }
+
+    for (size_t s = 1; s < m_subCount; ++s)
+    {
+        PixelKernels::AddCounts(m_bins.data(), m_bins.data() + s * m_binCount,
+                m_binCount);
+    }
+
+    m_pixelCount = chunkPixels;
+}
+
+template<typename T>
+void pm::TaskSet_ComputeHistogram::ATask::ExecuteT(
+        size_t chunkOffset, size_t chunkPixels)
+{
+    const T* data = static_cast<T*>(m_bmp->GetData()) + chunkOffset;
+
+    const uint16_t shift = m_binShift;
+    const uint32_t lastBin = m_binCount - 1;
+    uint32_t* bins = m_bins.data();
+
+    size_t n = 0;
+    if (m_subCount == cSubCount)
+    {
+        uint32_t* bins1 = bins + m_binCount;
+        uint32_t* bins2 = bins1 + m_binCount;
+        uint32_t* bins3 = bins2 + m_binCount;
+        for (; n + 4 <= chunkPixels; n += 4)
+        {
+            ++bins[std::min<uint32_t>(data[n + 0] >> shift, lastBin)];
+            ++bins1[std::min<uint32_t>(data[n + 1] >> shift, lastBin)];
+            ++bins2[std::min<uint32_t>(data[n + 2] >> shift, lastBin)];
+            ++bins3[std::min<uint32_t>(data[n + 3] >> shift, lastBin)];
+        }
+    }
+    for (; n < chunkPixels; ++n)
+    {
+        ++bins[std::min<uint32_t>(data[n] >> shift, lastBin)];
+    }
+}
+
+// TaskSet_ComputeHistogram
+
+pm::TaskSet_ComputeHistogram::TaskSet_ComputeHistogram(
+        std::shared_ptr<ThreadPool> pool)
+    : TaskSet(pool)
+{
+    CreateTasks<ATask>();
+}
+
+void pm::TaskSet_ComputeHistogram::SetUp(const Bitmap* bmp,
+        FrameHistogram* histogram)
+{
+    assert(bmp != nullptr);
+    assert(histogram != nullptr);
+
+    if (bmp->GetFormat().GetPixelType() != BitmapPixelType::Mono)
+        throw Exception("Unsupported bitmap pixel type");
+    if (bmp->GetFormat().GetBitDepth() != histogram->GetBitDepth())
+        throw Exception("Histogram bit depth doesn't match the bitmap");
+
+    m_histogram = histogram;
+
+    const auto& tasks = GetTasks();
+    const size_t taskCount = tasks.size();
+    for (size_t n = 0; n < taskCount; ++n)
+    {
+        static_cast<ATask*>(tasks[n])->SetUp(bmp, histogram->GetBinCount(),
+                histogram->GetBinShift());
+    }
+}
+
+void pm::TaskSet_ComputeHistogram::Wait()
+{
+    TaskSet::Wait();
+    CollectResults();
+}
+
+template<typename Rep, typename Period>
+bool pm::TaskSet_ComputeHistogram::Wait(
+        const std::chrono::duration<Rep, Period>& timeout)
+{
+    const bool retVal = TaskSet::Wait(timeout);
+    CollectResults();
+    return retVal;
+}
+
+void pm::TaskSet_ComputeHistogram::CollectResults()
+{
+    const auto& tasks = GetTasks();
+    const size_t taskCount = tasks.size();
+    for (size_t n = 0; n < taskCount; ++n)
+    {
+        const auto task = static_cast<const ATask*>(tasks[n]);
+        m_histogram->Add(task->GetBins(), task->GetPixelCount());
+    }
+}
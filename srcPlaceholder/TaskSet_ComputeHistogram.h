@@ -0,0 +1,79 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_TASK_SET_COMPUTE_HISTOGRAM_H
+#define PM_TASK_SET_COMPUTE_HISTOGRAM_H
+
+/* Local */
+#include "backend/FrameHistogram.h"
+#include "backend/Task.h"
+#include "backend/TaskSet.h"
+
+/* System */
+#include <vector>
+
+namespace pm {
+
+class Bitmap;
+
+class TaskSet_ComputeHistogram : public TaskSet
+{
+private:
+    class ATask final : public Task
+    {
+    public:
+        explicit ATask(std::shared_ptr<Semaphore> semDone, size_t taskIndex,
+                size_t taskCount);
+
+    public:
+        void SetUp(const Bitmap* bmp, uint32_t binCount, uint16_t binShift);
+
+        // Valid after execution, with zero pixels the bins are not touched
+        const uint32_t* GetBins() const;
+        uint64_t GetPixelCount() const;
+
+    public: // Task
+        virtual void Execute() override;
+
+    private:
+        // Every pixel increments a counter in memory. If neighbor pixels
+        // have same value, each increment waits for previous one. With few
+        // bins the pixels are spread over more sub-histograms to break that
+        // dependency, they are merged at the end.
+        template<typename T>
+        void ExecuteT(size_t chunkOffset, size_t chunkPixels);
+
+    private:
+        size_t m_maxTasks{ 0 };
+        Bitmap* m_bmp{ nullptr }; // Cannot be const to auto-generate assignment operator
+        uint32_t m_binCount{ 0 };
+        uint16_t m_binShift{ 0 };
+        size_t m_subCount{ 0 };
+        std::vector<uint32_t> m_bins{}; // m_subCount sub-histograms
+        uint64_t m_pixelCount{ 0 };
+    };
+
+public:
+    explicit TaskSet_ComputeHistogram(std::shared_ptr<ThreadPool> pool);
+
+public:
+    // Counts are added to given histogram so it can be called for more
+    // bitmaps. The histogram has to be reset to bitmap's bit depth first.
+    void SetUp(const Bitmap* bmp, FrameHistogram* histogram);
+
+public: // TaskSet
+    virtual void Wait() override;
+    template<typename Rep, typename Period>
+    bool Wait(const std::chrono::duration<Rep, Period>& timeout);
+
+private:
+    void CollectResults();
+
+private:
+    FrameHistogram* m_histogram{ nullptr };
+};
+
+} // namespace pm
+
+#endif /* PM_TASK_SET_COMPUTE_HISTOGRAM_H */
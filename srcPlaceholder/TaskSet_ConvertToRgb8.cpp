@@ -6,11 +6,36 @@
 /* Local */
 #include "backend/Bitmap.h"
 #include "backend/exceptions/Exception.h"
+#include "backend/PixelKernels.h"
 #include "backend/Utils.h"
 
 /* System */
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+
+// Mono pixels are converted in blocks of 4kB gray bytes on stack
+static constexpr size_t cBlockPixels = 4096;
+// RGB pixels going to RGBA or BGRA use the same block
+static constexpr size_t cRgbBlockPixels = cBlockPixels / 3;
+
+template<typename T>
+static void ConvertSamplesT(const T* src, size_t count, uint8_t* dst,
+        double srcMin, double srcMax, const std::vector<uint8_t>& pixLookupMap,
+        bool autoConbright, int brightness, int contrast)
+{
+    if (!pixLookupMap.empty())
+    {
+        pm::PixelKernels::LookupSamples(src, count, pixLookupMap.data(),
+                pixLookupMap.size(), dst);
+    }
+    else
+    {
+        pm::PixelKernels::ScaleSamples(src, count, dst,
+                static_cast<uint32_t>(srcMin), static_cast<uint32_t>(srcMax),
+                autoConbright, brightness, contrast);
+    }
+}
 
 // TaskSet_ConvertToRgb8::Task
 
@@ -52,16 +77,10 @@ void pm::TaskSet_ConvertToRgb8::ATask::Execute()
     switch (m_srcBmp->GetFormat().GetDataType())
     {
     case BitmapDataType::UInt8:
-        if (!m_pixLookupMap->empty())
-            ExecuteT_Lookup<uint8_t>();
-        else
-            ExecuteT<uint8_t>();
+        ExecuteT<uint8_t>();
         break;
     case BitmapDataType::UInt16:
-        if (!m_pixLookupMap->empty())
-            ExecuteT_Lookup<uint16_t>();
-        else
-            ExecuteT<uint16_t>();
+        ExecuteT<uint16_t>();
         break;
     case BitmapDataType::UInt32:
         ExecuteT<uint32_t>();
@@ -80,183 +99,70 @@ void pm::TaskSet_ConvertToRgb8::ATask::ExecuteT()
     const uint32_t h = m_srcBmp->GetHeight();
     const uint32_t w = m_srcBmp->GetWidth();
 
-    const double mp = (m_srcMax == m_srcMin) ? 255.0 : 255.0 / (m_srcMax - m_srcMin);
-
-    const T srcMin = static_cast<T>(m_srcMin);
-    const T srcMax = static_cast<T>(m_srcMax);
-
     const auto srcSpp = m_srcBmp->GetFormat().GetSamplesPerPixel();
     const auto dstSpp = m_dstBmp->GetFormat().GetSamplesPerPixel();
-    assert(dstSpp == 3);
+    const auto dstPixelType = m_dstBmp->GetFormat().GetPixelType();
 
-    // brightness value is from -255 to +255
-    // contrast value is from -255 to +255
-    // factors for contrasts [-255, 0, +255] are [0, 1, 129.5]
-    const double factor =
-        (259.0 * (m_contrast + 255))
-        / (255.0 * (259 - m_contrast));
+    uint8_t block[cBlockPixels];
 
     switch (m_srcBmp->GetFormat().GetPixelType())
     {
     case BitmapPixelType::Mono:
         assert(srcSpp == 1);
-        if (m_autoConbright)
-        {
-            for (uint32_t y = lineOff; y < h; y += lineStep)
-            {
-                const T* const srcLine =
-                    static_cast<const T*>(m_srcBmp->GetScanLine((uint16_t)y));
-                uint8_t* const dstLine =
-                    static_cast<uint8_t*>(m_dstBmp->GetScanLine((uint16_t)y));
-                for (uint32_t x = 0; x < w; ++x)
-                {
-                    const uint32_t srcPixOff = srcSpp * x;
-                    const uint32_t dstPixOff = dstSpp * x;
-                    const T pix = Utils::Clamp(srcLine[srcPixOff], srcMin, srcMax);
-                    const auto pix8 = static_cast<uint8_t>(mp * (pix - srcMin));
-                    dstLine[dstPixOff + 0] = pix8;
-                    dstLine[dstPixOff + 1] = pix8;
-                    dstLine[dstPixOff + 2] = pix8;
-                }
-            }
-        }
-        else
-        {
-            for (uint32_t y = lineOff; y < h; y += lineStep)
-            {
-                const T* const srcLine =
-                    static_cast<const T*>(m_srcBmp->GetScanLine((uint16_t)y));
-                uint8_t* const dstLine =
-                    static_cast<uint8_t*>(m_dstBmp->GetScanLine((uint16_t)y));
-                for (uint32_t x = 0; x < w; ++x)
-                {
-                    const uint32_t srcPixOff = srcSpp * x;
-                    const uint32_t dstPixOff = dstSpp * x;
-                    const double pixF = mp * (srcLine[srcPixOff] - srcMin);
-                    const auto pixI = static_cast<int>(
-                            m_brightness + factor * (pixF - 128) + 128);
-                    // Truncate the pixel value to range [0, 255]
-                    const auto pix8 = static_cast<uint8_t>(Utils::Clamp(pixI, 0, 255));
-                    dstLine[dstPixOff + 0] = pix8;
-                    dstLine[dstPixOff + 1] = pix8;
-                    dstLine[dstPixOff + 2] = pix8;
-                }
-            }
-        }
-        break;
-
-    case BitmapPixelType::RGB:
-        assert(srcSpp == 3);
-        if (m_autoConbright)
-        {
-            for (uint32_t y = lineOff; y < h; y += lineStep)
-            {
-                const T* const srcLine =
-                    static_cast<const T*>(m_srcBmp->GetScanLine((uint16_t)y));
-                uint8_t* const dstLine =
-                    static_cast<uint8_t*>(m_dstBmp->GetScanLine((uint16_t)y));
-                for (uint32_t x = 0; x < w; ++x)
-                {
-                    const uint32_t srcPixOff = srcSpp * x;
-                    const uint32_t dstPixOff = dstSpp * x;
-                    const T pixR = Utils::Clamp(srcLine[srcPixOff + 0], srcMin, srcMax);
-                    const T pixG = Utils::Clamp(srcLine[srcPixOff + 1], srcMin, srcMax);
-                    const T pixB = Utils::Clamp(srcLine[srcPixOff + 2], srcMin, srcMax);
-                    dstLine[dstPixOff + 0] = static_cast<uint8_t>(mp * (pixR - srcMin));
-                    dstLine[dstPixOff + 1] = static_cast<uint8_t>(mp * (pixG - srcMin));
-                    dstLine[dstPixOff + 2] = static_cast<uint8_t>(mp * (pixB - srcMin));
-                }
-            }
-        }
-        else
-        {
-            for (uint32_t y = lineOff; y < h; y += lineStep)
-            {
-                const T* const srcLine =
-                    static_cast<const T*>(m_srcBmp->GetScanLine((uint16_t)y));
-                uint8_t* const dstLine =
-                    static_cast<uint8_t*>(m_dstBmp->GetScanLine((uint16_t)y));
-                for (uint32_t x = 0; x < w; ++x)
-                {
-                    const uint32_t srcPixOff = srcSpp * x;
-                    const uint32_t dstPixOff = dstSpp * x;
-                    const double pixFR = mp * (srcLine[srcPixOff + 0] - srcMin);
-                    const double pixFG = mp * (srcLine[srcPixOff + 1] - srcMin);
-                    const double pixFB = mp * (srcLine[srcPixOff + 2] - srcMin);
-                    const auto pixIR = static_cast<int>(
-                            m_brightness + factor * (pixFR - 128) + 128);
-                    const auto pixIG = static_cast<int>(
-                            m_brightness + factor * (pixFG - 128) + 128);
-                    const auto pixIB = static_cast<int>(
-                            m_brightness + factor * (pixFB - 128) + 128);
-                    // Truncate the pixel value to range [0, 255]
-                    dstLine[dstPixOff + 0] = static_cast<uint8_t>(Utils::Clamp(pixIR, 0, 255));
-                    dstLine[dstPixOff + 1] = static_cast<uint8_t>(Utils::Clamp(pixIG, 0, 255));
-                    dstLine[dstPixOff + 2] = static_cast<uint8_t>(Utils::Clamp(pixIB, 0, 255));
-                }
-            }
-        }
-        break;
-    }
-}
-
-template<typename T>
-void pm::TaskSet_ConvertToRgb8::ATask::ExecuteT_Lookup()
-{
-    const uint32_t lineStep = static_cast<uint32_t>(m_maxTasks);
-    const uint32_t lineOff = static_cast<uint32_t>(GetTaskIndex());
-
-    const uint32_t h = m_srcBmp->GetHeight();
-    const uint32_t w = m_srcBmp->GetWidth();
-
-    const auto srcSpp = m_srcBmp->GetFormat().GetSamplesPerPixel();
-    const auto dstSpp = m_dstBmp->GetFormat().GetSamplesPerPixel();
-    assert(dstSpp == 3);
-
-    const uint8_t* lookupMapData = m_pixLookupMap->data();
-
-    switch (m_srcBmp->GetFormat().GetPixelType())
-    {
-    case BitmapPixelType::Mono:
         for (uint32_t y = lineOff; y < h; y += lineStep)
         {
             const T* const srcLine =
                 static_cast<const T*>(m_srcBmp->GetScanLine((uint16_t)y));
             uint8_t* const dstLine =
                 static_cast<uint8_t*>(m_dstBmp->GetScanLine((uint16_t)y));
-            for (uint32_t x = 0; x < w; ++x)
+            if (dstPixelType == BitmapPixelType::Mono)
+            {
+                ConvertSamples(srcLine, w, dstLine, m_srcMin, m_srcMax,
+                        *m_pixLookupMap, m_autoConbright, m_brightness, m_contrast);
+                continue;
+            }
+            for (uint32_t x = 0; x < w; x += cBlockPixels)
             {
-                const uint32_t srcPixOff = srcSpp * x;
-                const uint32_t dstPixOff = dstSpp * x;
-                const T pix = srcLine[srcPixOff];
-                const uint8_t pix8 = lookupMapData[pix];
-                dstLine[dstPixOff + 0] = pix8;
-                dstLine[dstPixOff + 1] = pix8;
-                dstLine[dstPixOff + 2] = pix8;
+                const size_t count = std::min<size_t>(cBlockPixels, w - x);
+                ConvertSamples(srcLine + x, count, block, m_srcMin, m_srcMax,
+                        *m_pixLookupMap, m_autoConbright, m_brightness, m_contrast);
+                ExpandGrayPixels(block, count, dstLine + (size_t)dstSpp * x,
+                        dstPixelType);
             }
         }
         break;
 
     case BitmapPixelType::RGB:
+        assert(srcSpp == 3);
         for (uint32_t y = lineOff; y < h; y += lineStep)
         {
             const T* const srcLine =
                 static_cast<const T*>(m_srcBmp->GetScanLine((uint16_t)y));
             uint8_t* const dstLine =
                 static_cast<uint8_t*>(m_dstBmp->GetScanLine((uint16_t)y));
-            for (uint32_t x = 0; x < w; ++x)
+            if (dstPixelType == BitmapPixelType::RGB)
+            {
+                ConvertSamples(srcLine, (size_t)srcSpp * w, dstLine, m_srcMin,
+                        m_srcMax, *m_pixLookupMap, m_autoConbright, m_brightness,
+                        m_contrast);
+                continue;
+            }
+            assert(dstSpp == 4);
+            const bool swapRedBlue = (dstPixelType == BitmapPixelType::BGRA);
+            for (uint32_t x = 0; x < w; x += cRgbBlockPixels)
             {
-                const uint32_t srcPixOff = srcSpp * x;
-                const uint32_t dstPixOff = dstSpp * x;
-                const T pixR = srcLine[srcPixOff + 0];
-                const T pixG = srcLine[srcPixOff + 1];
-                const T pixB = srcLine[srcPixOff + 2];
-                dstLine[dstPixOff + 0] = lookupMapData[pixR];
-                dstLine[dstPixOff + 1] = lookupMapData[pixG];
-                dstLine[dstPixOff + 2] = lookupMapData[pixB];
+                const size_t count = std::min<size_t>(cRgbBlockPixels, w - x);
+                ConvertSamples(srcLine + (size_t)srcSpp * x, srcSpp * count,
+                        block, m_srcMin, m_srcMax, *m_pixLookupMap,
+                        m_autoConbright, m_brightness, m_contrast);
+                PixelKernels::ExpandRgbToRgba(block, count,
+                        dstLine + (size_t)dstSpp * x, swapRedBlue);
             }
         }
         break;
+
+    default:
+        throw Exception("Unsupported bitmap pixel type");
     }
 }
 
@@ -276,6 +182,16 @@ void pm::TaskSet_ConvertToRgb8::SetUp(const Bitmap* dstBmp,
 {
     static const std::vector<uint8_t> emptyLookupMap{};
 
+    assert(dstBmp != nullptr);
+    assert(srcBmp != nullptr);
+
+    const auto& dstFormat = dstBmp->GetFormat();
+    if (dstFormat.GetDataType() != BitmapDataType::UInt8)
+        throw Exception("Unsupported destination bitmap data type");
+    if (dstFormat.GetPixelType() == BitmapPixelType::Mono
+            && srcBmp->GetFormat().GetPixelType() != BitmapPixelType::Mono)
+        throw Exception("Unable to convert color bitmap to mono");
+
     const std::vector<uint8_t>* lookupMap =
         (pixLookupMap) ? pixLookupMap : &emptyLookupMap;
 
@@ -315,6 +231,51 @@ uint8_t pm::TaskSet_ConvertToRgb8::ConvertOnePixel(double srcValue, double srcMi
     }
 }
 
+void pm::TaskSet_ConvertToRgb8::ConvertSamples(const uint8_t* src,
+        size_t count, uint8_t* dst, double srcMin, double srcMax,
+        const std::vector<uint8_t>& pixLookupMap,
+        bool autoConbright, int brightness, int contrast)
+{
+    ConvertSamplesT(src, count, dst, srcMin, srcMax, pixLookupMap,
+            autoConbright, brightness, contrast);
+}
+
+void pm::TaskSet_ConvertToRgb8::ConvertSamples(const uint16_t* src,
+        size_t count, uint8_t* dst, double srcMin, double srcMax,
+        const std::vector<uint8_t>& pixLookupMap,
+        bool autoConbright, int brightness, int contrast)
+{
+    ConvertSamplesT(src, count, dst, srcMin, srcMax, pixLookupMap,
+            autoConbright, brightness, contrast);
+}
+
+void pm::TaskSet_ConvertToRgb8::ConvertSamples(const uint32_t* src,
+        size_t count, uint8_t* dst, double srcMin, double srcMax,
+        const std::vector<uint8_t>& pixLookupMap,
+        bool autoConbright, int brightness, int contrast)
+{
+    ConvertSamplesT(src, count, dst, srcMin, srcMax, pixLookupMap,
+            autoConbright, brightness, contrast);
+}
+
+void pm::TaskSet_ConvertToRgb8::ExpandGrayPixels(const uint8_t* gray,
+        size_t count, uint8_t* dst, BitmapPixelType dstPixelType)
+{
+    switch (dstPixelType)
+    {
+    case BitmapPixelType::Mono:
+        std::memcpy(dst, gray, count);
+        break;
+    case BitmapPixelType::RGB:
+        PixelKernels::ExpandGrayToRgb(gray, count, dst);
+        break;
+    case BitmapPixelType::RGBA:
+    case BitmapPixelType::BGRA:
+        PixelKernels::ExpandGrayToRgba(gray, count, dst);
+        break;
+    }
+}
+
 void pm::TaskSet_ConvertToRgb8::UpdateLookupMap(std::vector<uint8_t>& lookupMap,
         const BitmapFormat& srcBmpFormat, double srcMin, double srcMax,
         bool autoConbright, int brightness, int contrast)
@@ -335,6 +296,15 @@ void pm::TaskSet_ConvertToRgb8::UpdateLookupMap(std::vector<uint8_t>& lookupMap,
         mapSize = 65536;
         assert(bitDepth <= 16);
         break; // OK, keep going
+    case pm::BitmapDataType::UInt32:
+        if (bitDepth > cMaxLookupBits)
+        {
+            lookupMap.clear();
+            return;
+        }
+        // Limited to bit depth, greater values are clamped by the conversion
+        mapSize = (uint32_t)1 << bitDepth;
+        break; // OK, keep going
     default:
         lookupMap.clear();
         return;
@@ -407,7 +377,8 @@ void pm::TaskSet_ConvertToRgb8::UpdateLookupMap(std::vector<uint8_t>& lookupMap,
         {
             for (uint32_t n = 0; n <= maxPixelValue; ++n)
             {
-                const double pixF = mp * (n - min);
+                // Signed, the values below min. must not wrap around
+                const double pixF = mp * ((double)n - min);
                 const int pixI = static_cast<int>(
                         brightness + factor * (pixF - 128) + 128);
                 // Truncate the pixel value to range [0, 255]
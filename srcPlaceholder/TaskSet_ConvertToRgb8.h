@@ -35,10 +35,12 @@ private:
         virtual void Execute() override;
 
     private:
+        // Mono lines are converted in blocks to gray bytes on stack and then
+        // expanded to destination pixel type, or directly for Mono destination.
+        // RGB lines are converted sample by sample, through a block on stack
+        // for RGBA and BGRA destination.
         template<typename T>
         void ExecuteT();
-        template<typename T>
-        void ExecuteT_Lookup();
 
     private:
         size_t m_maxTasks{ 0 };
@@ -62,16 +64,40 @@ public:
     // Does either automatic or manual contrast and brightness adjustment.
     // brightness value is from -255 to +255, 0 means no change.
     // contrast value is from -255 to +255, 0 means no change.
-    // Lookup map can be used to speed up conversion from 8 and 16 bit pixels only.
+    // Lookup map can be used to speed up conversion from 8 and 16 bit pixels
+    // and 32 bit pixels up to cMaxLookupBits bit depth.
+    // Destination has UInt8 data type and any pixel type, Mono (gray) works
+    // with mono source only. Alpha of RGBA and BGRA pixels is set to 255.
     void SetUp(const Bitmap* dstBmp,
             const Bitmap* srcBmp, double srcMin, double srcMax,
             const std::vector<uint8_t>* pixLookupMap = nullptr,
             bool autoConbright = true, int brightness = 0, int contrast = 0);
 
+public:
+    // Bigger map would take longer to fill than converting the whole frame
+    static constexpr uint16_t cMaxLookupBits = 16;
+
 public:
     static uint8_t ConvertOnePixel(double srcValue, double srcMin, double srcMax,
             bool autoConbright = true, int brightness = 0, int contrast = 0);
 
+    // Converts a run of samples to 8 bits, either via lookup map if not empty,
+    // or directly with vectorized math giving the same values as
+    // ConvertOnePixel with integral min/max.
+    static void ConvertSamples(const uint8_t* src, size_t count, uint8_t* dst,
+            double srcMin, double srcMax, const std::vector<uint8_t>& pixLookupMap,
+            bool autoConbright = true, int brightness = 0, int contrast = 0);
+    static void ConvertSamples(const uint16_t* src, size_t count, uint8_t* dst,
+            double srcMin, double srcMax, const std::vector<uint8_t>& pixLookupMap,
+            bool autoConbright = true, int brightness = 0, int contrast = 0);
+    static void ConvertSamples(const uint32_t* src, size_t count, uint8_t* dst,
+            double srcMin, double srcMax, const std::vector<uint8_t>& pixLookupMap,
+            bool autoConbright = true, int brightness = 0, int contrast = 0);
+
+    // Writes 8-bit gray pixels as given pixel type, Mono simply copies them
+    static void ExpandGrayPixels(const uint8_t* gray, size_t count,
+            uint8_t* dst, BitmapPixelType dstPixelType);
+
     static void UpdateLookupMap(std::vector<uint8_t>& lookupMap,
             const BitmapFormat& srcBmpFormat, double srcMin, double srcMax,
             bool autoConbright, int brightness, int contrast);
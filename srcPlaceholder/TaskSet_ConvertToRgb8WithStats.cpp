@@ -0,0 +1,301 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#include "backend/TaskSet_ConvertToRgb8WithStats.h"
+
+/* Local */
+#include "backend/Bitmap.h"
+#include "backend/PixelKernels.h"
+#include "backend/TaskSet_ComputeFrameStats.h"
+#include "backend/TaskSet_ConvertToRgb8.h"
+#include "backend/exceptions/Exception.h"
+
+/* System */
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+// Same blocks as for stats, the conversion reads them again from L1 cache
+static constexpr size_t cBlockPixels = pm::TaskSet_ComputeFrameStats::cBlockPixels;
+
+// TaskSet_ConvertToRgb8WithStats::Task
+
+pm::TaskSet_ConvertToRgb8WithStats::ATask::ATask(
+        std::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t taskCount)
+    : pm::Task(semDone, taskIndex, taskCount),
+    m_maxTasks(taskCount)
+{
+}
+
+void pm::TaskSet_ConvertToRgb8WithStats::ATask::SetUp(const Bitmap* dstBmp,
+        const Bitmap* srcBmp, double srcMin, double srcMax, bool autoConbright,
+        int brightness, int contrast, const std::vector<uint8_t>* pixLookupMap,
+        uint32_t binCount, uint16_t binShift)
+{
+    const size_t dataBytes = srcBmp->GetDataBytes();
+    const size_t rows = srcBmp->GetHeight();
+
+    m_maxTasks = (dataBytes < 4096)
+        ? (dataBytes == 0) ? 0 : 1
+        : std::min(rows, GetTaskCount());
+
+    m_dstBmp = const_cast<Bitmap*>(dstBmp);
+    m_srcBmp = const_cast<Bitmap*>(srcBmp);
+    m_srcMin = srcMin;
+    m_srcMax = srcMax;
+    m_autoConbright = autoConbright;
+    m_brightness = brightness;
+    m_contrast = contrast;
+    m_pixLookupMap = const_cast<std::vector<uint8_t>*>(pixLookupMap);
+    m_binCount = binCount;
+    m_binShift = binShift;
+}
+
+const pm::FrameStats& pm::TaskSet_ConvertToRgb8WithStats::ATask::GetStats() const
+{
+    return m_stats;
+}
+
+const uint32_t* pm::TaskSet_ConvertToRgb8WithStats::ATask::GetBins() const
+{
+    return m_bins.data();
+}
+
+uint64_t pm::TaskSet_ConvertToRgb8WithStats::ATask::GetPixelCount() const
+{
+    return m_pixelCount;
+}
+
+void pm::TaskSet_ConvertToRgb8WithStats::ATask::Execute()
+{
+    assert(m_dstBmp != nullptr);
+    assert(m_srcBmp != nullptr);
+    assert(m_pixLookupMap != nullptr);
+
+    m_stats.Clear();
+    m_pixelCount = 0;
+
+    const size_t taskId = GetTaskIndex();
+    if (taskId >= m_maxTasks)
+        return;
+
+    // Whole rows, the stats don't care about the order of pixels
+    const uint32_t h = m_srcBmp->GetHeight();
+    const uint32_t rowsPerTask = h / static_cast<uint32_t>(m_maxTasks);
+    const uint32_t rowOff = static_cast<uint32_t>(taskId) * rowsPerTask;
+    const uint32_t rowCount = (taskId == m_maxTasks - 1)
+        ? h - rowOff
+        : rowsPerTask;
+    if (rowCount == 0 || m_srcBmp->GetWidth() == 0)
+        return;
+
+    if (m_binCount > 0)
+    {
+        // Allocated once, later only cleared
+        m_bins.resize(m_binCount);
+        std::fill(m_bins.begin(), m_bins.end(), 0);
+    }
+
+    switch (m_srcBmp->GetFormat().GetDataType())
+    {
+    case BitmapDataType::UInt8:
+        ExecuteT_UpTo16b<uint8_t>(rowOff, rowCount);
+        break;
+    case BitmapDataType::UInt16:
+        ExecuteT_UpTo16b<uint16_t>(rowOff, rowCount);
+        break;
+    case BitmapDataType::UInt32:
+        if (m_srcBmp->GetFormat().GetBitDepth() <= 16)
+            ExecuteT_UpTo16b<uint32_t>(rowOff, rowCount);
+        else
+            ExecuteT<uint32_t>(rowOff, rowCount);
+        break;
+    default:
+        throw Exception("Unsupported bitmap data type");
+    }
+
+    m_pixelCount = (uint64_t)rowCount * m_srcBmp->GetWidth();
+}
+
+template<typename T>
+void pm::TaskSet_ConvertToRgb8WithStats::ATask::ExecuteT(
+        uint32_t rowOff, uint32_t rowCount)
+{
+    const uint32_t w = m_srcBmp->GetWidth();
+    const size_t dstSpp = m_dstBmp->GetFormat().GetSamplesPerPixel();
+
+    FrameStats blockStats;
+    for (uint32_t y = rowOff; y < rowOff + rowCount; ++y)
+    {
+        const T* const srcLine =
+            static_cast<const T*>(m_srcBmp->GetScanLine((uint16_t)y));
+        uint8_t* const dstLine =
+            static_cast<uint8_t*>(m_dstBmp->GetScanLine((uint16_t)y));
+        for (uint32_t x = 0; x < w; x += cBlockPixels)
+        {
+            const T* block = srcLine + x;
+            const size_t blockPixels = std::min<size_t>(cBlockPixels, w - x);
+
+            TaskSet_ComputeFrameStats::ComputeBlockStats(
+                    block, blockPixels, blockStats);
+            m_stats.Add(blockStats);
+
+            CountBlock(block, blockPixels);
+            ConvertBlock(block, blockPixels, dstLine + dstSpp * x);
+        }
+    }
+}
+
+template<typename T>
+void pm::TaskSet_ConvertToRgb8WithStats::ATask::ExecuteT_UpTo16b(
+        uint32_t rowOff, uint32_t rowCount)
+{
+    const uint32_t w = m_srcBmp->GetWidth();
+    const size_t dstSpp = m_dstBmp->GetFormat().GetSamplesPerPixel();
+
+    // Same limits as in TaskSet_ComputeFrameStats, the whole chunk has less
+    // than 2^32 pixels so the sum of squares doesn't overflow
+    PixelKernels::Sums total;
+    total.min = (std::numeric_limits<uint32_t>::max)();
+    for (uint32_t y = rowOff; y < rowOff + rowCount; ++y)
+    {
+        const T* const srcLine =
+            static_cast<const T*>(m_srcBmp->GetScanLine((uint16_t)y));
+        uint8_t* const dstLine =
+            static_cast<uint8_t*>(m_dstBmp->GetScanLine((uint16_t)y));
+        for (uint32_t x = 0; x < w; x += cBlockPixels)
+        {
+            const T* block = srcLine + x;
+            const size_t blockPixels = std::min<size_t>(cBlockPixels, w - x);
+
+            PixelKernels::Sums sums;
+            PixelKernels::ComputeSums(block, blockPixels, sums);
+            total.min = std::min(total.min, sums.min);
+            total.max = std::max(total.max, sums.max);
+            total.sum += sums.sum;
+            total.sumSq += sums.sumSq;
+
+            CountBlock(block, blockPixels);
+            ConvertBlock(block, blockPixels, dstLine + dstSpp * x);
+        }
+    }
+
+    m_stats.SetViaSums(rowCount * w,
+            static_cast<double>(total.min), static_cast<double>(total.max),
+            static_cast<double>(total.sum), static_cast<double>(total.sumSq));
+}
+
+template<typename T>
+void pm::TaskSet_ConvertToRgb8WithStats::ATask::CountBlock(
+        const T* src, size_t count)
+{
+    if (m_binCount == 0)
+        return;
+
+    const uint16_t shift = m_binShift;
+    const uint32_t lastBin = m_binCount - 1;
+    uint32_t* bins = m_bins.data();
+
+    for (size_t n = 0; n < count; ++n)
+    {
+        ++bins[std::min<uint32_t>(src[n] >> shift, lastBin)];
+    }
+}
+
+template<typename T>
+void pm::TaskSet_ConvertToRgb8WithStats::ATask::ConvertBlock(
+        const T* src, size_t count, uint8_t* dst) const
+{
+    assert(count <= cBlockPixels);
+
+    const auto dstPixelType = m_dstBmp->GetFormat().GetPixelType();
+    if (dstPixelType == BitmapPixelType::Mono)
+    {
+        TaskSet_ConvertToRgb8::ConvertSamples(src, count, dst, m_srcMin,
+                m_srcMax, *m_pixLookupMap, m_autoConbright, m_brightness,
+                m_contrast);
+        return;
+    }
+
+    uint8_t gray[cBlockPixels];
+    TaskSet_ConvertToRgb8::ConvertSamples(src, count, gray, m_srcMin, m_srcMax,
+            *m_pixLookupMap, m_autoConbright, m_brightness, m_contrast);
+    TaskSet_ConvertToRgb8::ExpandGrayPixels(gray, count, dst, dstPixelType);
+}
+
+// TaskSet_ConvertToRgb8WithStats
+
+pm::TaskSet_ConvertToRgb8WithStats::TaskSet_ConvertToRgb8WithStats(
+        std::shared_ptr<ThreadPool> pool)
+    : TaskSet(pool)
+{
+    CreateTasks<ATask>();
+}
+
+void pm::TaskSet_ConvertToRgb8WithStats::SetUp(const Bitmap* dstBmp,
+        const Bitmap* srcBmp, double srcMin, double srcMax,
+        FrameStats* stats, FrameHistogram* histogram,
+        const std::vector<uint8_t>* pixLookupMap,
+        bool autoConbright, int brightness, int contrast)
+{
+    static const std::vector<uint8_t> emptyLookupMap{};
+
+    assert(dstBmp != nullptr);
+    assert(srcBmp != nullptr);
+    assert(stats != nullptr);
+
+    if (srcBmp->GetFormat().GetPixelType() != BitmapPixelType::Mono)
+        throw Exception("Unsupported bitmap pixel type");
+    if (dstBmp->GetFormat().GetDataType() != BitmapDataType::UInt8)
+        throw Exception("Unsupported destination bitmap data type");
+    if (histogram && srcBmp->GetFormat().GetBitDepth() != histogram->GetBitDepth())
+        throw Exception("Histogram bit depth doesn't match the bitmap");
+
+    m_stats = stats;
+    m_histogram = histogram;
+
+    const std::vector<uint8_t>* lookupMap =
+        (pixLookupMap) ? pixLookupMap : &emptyLookupMap;
+    const uint32_t binCount = (histogram) ? histogram->GetBinCount() : 0;
+    const uint16_t binShift = (histogram) ? histogram->GetBinShift() : 0;
+
+    const auto& tasks = GetTasks();
+    for (auto task : tasks)
+    {
+        static_cast<ATask*>(task)->SetUp(dstBmp, srcBmp, srcMin, srcMax,
+                autoConbright, brightness, contrast, lookupMap,
+                binCount, binShift);
+    }
+}
+
+void pm::TaskSet_ConvertToRgb8WithStats::Wait()
+{
+    TaskSet::Wait();
+    CollectResults();
+}
+
+template<typename Rep, typename Period>
+bool pm::TaskSet_ConvertToRgb8WithStats::Wait(
+        const std::chrono::duration<Rep, Period>& timeout)
+{
+    const bool retVal = TaskSet::Wait(timeout);
+    CollectResults();
+    return retVal;
+}
+
+void pm::TaskSet_ConvertToRgb8WithStats::CollectResults()
+{
+    m_stats->Clear();
+
+    const auto& tasks = GetTasks();
+    const size_t taskCount = tasks.size();
+    for (size_t n = 0; n < taskCount; ++n)
+    {
+        const auto task = static_cast<const ATask*>(tasks[n]);
+        m_stats->Add(task->GetStats());
+        if (m_histogram && task->GetPixelCount() > 0)
+        {
+            m_histogram->Add(task->GetBins(), task->GetPixelCount());
+        }
+    }
+}
@@ -0,0 +1,116 @@
+/******************************************************************************/
+/* Copyright (C) Teledyne Photometrics. All rights reserved.                  */
+/******************************************************************************/
+#pragma once
+#ifndef PM_TASK_SET_CONVERT_TO_RGB8_WITH_STATS_H
+#define PM_TASK_SET_CONVERT_TO_RGB8_WITH_STATS_H
+
+/* Local */
+#include "backend/FrameHistogram.h"
+#include "backend/FrameStats.h"
+#include "backend/Task.h"
+#include "backend/TaskSet.h"
+
+/* System */
+#include <vector>
+
+namespace pm {
+
+class Bitmap;
+
+// Does the same as TaskSet_ConvertToRgb8 and TaskSet_ComputeFrameStats
+// (optionally also TaskSet_ComputeHistogram) in one pass over source pixels.
+// Each row is processed in blocks small enough to stay in L1 cache, the stats
+// read the block from memory and the conversion from cache. Because the stats
+// are known only at the end, the conversion uses limits given by caller,
+// usually the stats of previous frame.
+class TaskSet_ConvertToRgb8WithStats : public TaskSet
+{
+private:
+    class ATask final : public Task
+    {
+    public:
+        explicit ATask(std::shared_ptr<Semaphore> semDone, size_t taskIndex,
+                size_t taskCount);
+
+    public:
+        void SetUp(const Bitmap* dstBmp, const Bitmap* srcBmp,
+                double srcMin, double srcMax, bool autoConbright,
+                int brightness, int contrast,
+                const std::vector<uint8_t>* pixLookupMap,
+                uint32_t binCount, uint16_t binShift);
+
+        // Valid after execution
+        const FrameStats& GetStats() const;
+        // Valid after execution, with zero pixels or bins the bins are not touched
+        const uint32_t* GetBins() const;
+        uint64_t GetPixelCount() const;
+
+    public: // Task
+        virtual void Execute() override;
+
+    private:
+        // Stats for more than 16 bits are computed per block in two passes
+        // like in TaskSet_ComputeFrameStats
+        template<typename T>
+        void ExecuteT(uint32_t rowOff, uint32_t rowCount);
+        template<typename T>
+        void ExecuteT_UpTo16b(uint32_t rowOff, uint32_t rowCount);
+
+        template<typename T>
+        void CountBlock(const T* src, size_t count);
+        template<typename T>
+        void ConvertBlock(const T* src, size_t count, uint8_t* dst) const;
+
+    private:
+        size_t m_maxTasks{ 0 };
+        // Cannot be const to auto-generate assignment operator
+        Bitmap* m_dstBmp{ nullptr };
+        // Cannot be const to auto-generate assignment operator
+        Bitmap* m_srcBmp{ nullptr };
+        double m_srcMin{ 0.0 };
+        double m_srcMax{ 0.0 };
+        bool m_autoConbright{ true };
+        int m_brightness{ 0 };
+        int m_contrast{ 0 };
+        // Cannot be const to auto-generate assignment operator
+        std::vector<uint8_t>* m_pixLookupMap{ nullptr };
+        uint32_t m_binCount{ 0 }; // Zero if histogram is not wanted
+        uint16_t m_binShift{ 0 };
+
+        FrameStats m_stats{};
+        std::vector<uint32_t> m_bins{};
+        uint64_t m_pixelCount{ 0 };
+    };
+
+public:
+    explicit TaskSet_ConvertToRgb8WithStats(std::shared_ptr<ThreadPool> pool);
+
+public:
+    // The conversion parameters are the same as for TaskSet_ConvertToRgb8.
+    // Works with mono source bitmaps only, destination can be any 8-bit
+    // pixel type like with TaskSet_ConvertToRgb8. The stats are overwritten.
+    // If histogram is given, counts are added to it like with
+    // TaskSet_ComputeHistogram, it has to be reset to bitmap's bit depth.
+    void SetUp(const Bitmap* dstBmp,
+            const Bitmap* srcBmp, double srcMin, double srcMax,
+            FrameStats* stats, FrameHistogram* histogram = nullptr,
+            const std::vector<uint8_t>* pixLookupMap = nullptr,
+            bool autoConbright = true, int brightness = 0, int contrast = 0);
+
+public: // TaskSet
+    virtual void Wait() override;
+    template<typename Rep, typename Period>
+    bool Wait(const std::chrono::duration<Rep, Period>& timeout);
+
+private:
+    void CollectResults();
+
+private:
+    FrameStats* m_stats{ nullptr };
+    FrameHistogram* m_histogram{ nullptr };
+};
+
+} // namespace pm
+
+#endif /* PM_TASK_SET_CONVERT_TO_RGB8_WITH_STATS_H */
@@ -4,6 +4,7 @@
 #include "backend/ThreadPool.h"
 
 /* Local */
+#include "backend/CpuAffinity.h"
 #include "backend/Task.h"
 
 /* System */
@@ -32,6 +33,16 @@ size_t pm::ThreadPool::GetSize() const
     return m_threads.size();
 }
 
+bool pm::ThreadPool::SetAffinity(const std::vector<unsigned int>& cpus)
+{
+    bool ok = true;
+    for (auto& thread : m_threads)
+    {
+        ok = CpuAffinity::PinThread(*thread, cpus) && ok;
+    }
+    return ok;
+}
+
 void pm::ThreadPool::Execute(Task* task)
 {
     assert(task != nullptr);
@@ -27,6 +27,9 @@ public:
 public:
     size_t GetSize() const;
 
+    // Restricts all pool threads to given CPUs, empty list allows all CPUs
+    bool SetAffinity(const std::vector<unsigned int>& cpus);
+
     void Execute(Task* task);
     void Execute(const std::vector<Task*>& tasks);
 